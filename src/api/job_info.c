@@ -1344,6 +1344,156 @@ slurm_load_jobs (time_t update_time, job_info_msg_t **job_info_msg_pptr,
 	return rc;
 }
 
+/*
+ * slurm_load_jobs_delta - issue RPC to get the local cluster's jobs that
+ *	changed since a generation returned by an earlier call
+ * IN delta_gen - (*job_info_msg_pptr)->delta_gen of the earlier call, or 0
+ *	for all jobs
+ * OUT job_info_msg_pptr - place to store the jobs: all of them if
+ *	delta_full is set, otherwise those changed since delta_gen and the
+ *	ids of those removed
+ * IN show_flags - job filtering options
+ * RET 0 or -1 on error, errno is SLURM_NO_CHANGE_IN_DATA if nothing changed
+ * NOTE: free the response using slurm_free_job_info_msg
+ */
+extern int slurm_load_jobs_delta(uint64_t delta_gen,
+				 job_info_msg_t **job_info_msg_pptr,
+				 uint16_t show_flags)
+{
+	slurm_msg_t req_msg, resp_msg;
+	info_delta_request_msg_t req;
+	int rc = SLURM_SUCCESS;
+
+	slurm_msg_t_init(&req_msg);
+	slurm_msg_t_init(&resp_msg);
+	memset(&req, 0, sizeof(req));
+	req.delta_gen    = delta_gen;
+	req.show_flags   = (show_flags | SHOW_LOCAL) & (~SHOW_FEDERATION);
+	req_msg.msg_type = REQUEST_JOB_INFO_DELTA;
+	req_msg.data     = &req;
+
+	*job_info_msg_pptr = NULL;
+
+	if (slurm_send_recv_controller_msg(&req_msg, &resp_msg,
+					   working_cluster_rec) < 0)
+		return SLURM_ERROR;
+
+	switch (resp_msg.msg_type) {
+	case RESPONSE_JOB_INFO_DELTA:
+		*job_info_msg_pptr = (job_info_msg_t *) resp_msg.data;
+		break;
+	case RESPONSE_SLURM_RC:
+		rc = ((return_code_msg_t *) resp_msg.data)->return_code;
+		slurm_free_return_code_msg(resp_msg.data);
+		break;
+	default:
+		rc = SLURM_UNEXPECTED_MSG_ERROR;
+		break;
+	}
+	if (rc)
+		slurm_seterrno_ret(rc);
+
+	return SLURM_SUCCESS;
+}
+
+typedef struct {
+	uint32_t job_id;
+	int delta_inx;		/* in the delta's job_array, -1 if removed */
+} _merge_job_t;
+
+static int _cmp_merge_job(const void *x, const void *y)
+{
+	const _merge_job_t *merge_x = x, *merge_y = y;
+
+	if (merge_x->job_id < merge_y->job_id)
+		return -1;
+	if (merge_x->job_id > merge_y->job_id)
+		return 1;
+	return 0;
+}
+
+/*
+ * slurm_merge_job_info - apply the response of slurm_load_jobs_delta() to
+ *	the jobs it was requested against
+ * IN/OUT job_info_msg_pptr - jobs as of the generation asked for, replaced
+ *	by the jobs as of the response
+ * IN delta_msg_ptr - the response, freed
+ * RET 0 or -1 if delta_msg_ptr doesn't fit the jobs, errno set
+ */
+extern int slurm_merge_job_info(job_info_msg_t **job_info_msg_pptr,
+				job_info_msg_t *delta_msg_ptr)
+{
+	job_info_msg_t *old_msg = *job_info_msg_pptr;
+	_merge_job_t *merge, key, *found;
+	job_info_t *job_array;
+	bool *merged;
+	uint32_t merge_cnt, cnt = 0;
+	int i;
+
+	if (delta_msg_ptr->delta_full) {
+		slurm_free_job_info_msg(old_msg);
+		*job_info_msg_pptr = delta_msg_ptr;
+		return SLURM_SUCCESS;
+	}
+	if (!old_msg) {
+		slurm_free_job_info_msg(delta_msg_ptr);
+		slurm_seterrno_ret(EINVAL);
+	}
+
+	/* the delta's jobs and removed jobs by job_id */
+	merge_cnt = delta_msg_ptr->record_count + delta_msg_ptr->removed_count;
+	merge = xcalloc(MAX(merge_cnt, 1), sizeof(_merge_job_t));
+	for (i = 0; i < delta_msg_ptr->record_count; i++) {
+		merge[i].job_id = delta_msg_ptr->job_array[i].job_id;
+		merge[i].delta_inx = i;
+	}
+	for (i = 0; i < delta_msg_ptr->removed_count; i++) {
+		merge[delta_msg_ptr->record_count + i].job_id =
+			delta_msg_ptr->removed_job_ids[i];
+		merge[delta_msg_ptr->record_count + i].delta_inx = -1;
+	}
+	qsort(merge, merge_cnt, sizeof(_merge_job_t), _cmp_merge_job);
+	merged = xcalloc(MAX(delta_msg_ptr->record_count, 1), sizeof(bool));
+
+	/* keep the order of the jobs, new ones go last */
+	job_array = xcalloc(MAX(old_msg->record_count +
+				delta_msg_ptr->record_count, 1),
+			    sizeof(job_info_t));
+	for (i = 0; i < old_msg->record_count; i++) {
+		key.job_id = old_msg->job_array[i].job_id;
+		found = bsearch(&key, merge, merge_cnt, sizeof(_merge_job_t),
+				_cmp_merge_job);
+		if (!found) {
+			job_array[cnt++] = old_msg->job_array[i];
+			continue;
+		}
+		slurm_free_job_info_members(&old_msg->job_array[i]);
+		if ((found->delta_inx >= 0) && !merged[found->delta_inx]) {
+			job_array[cnt++] =
+				delta_msg_ptr->job_array[found->delta_inx];
+			merged[found->delta_inx] = true;
+		}
+	}
+	for (i = 0; i < delta_msg_ptr->record_count; i++) {
+		if (!merged[i])
+			job_array[cnt++] = delta_msg_ptr->job_array[i];
+	}
+
+	xfree(old_msg->job_array);
+	old_msg->job_array = job_array;
+	old_msg->record_count = cnt;
+	old_msg->last_update = delta_msg_ptr->last_update;
+	old_msg->delta_gen = delta_msg_ptr->delta_gen;
+
+	/* its jobs were all moved over */
+	delta_msg_ptr->record_count = 0;
+	slurm_free_job_info_msg(delta_msg_ptr);
+	xfree(merge);
+	xfree(merged);
+
+	return SLURM_SUCCESS;
+}
+
 /*
  * slurm_load_job_user - issue RPC to get slurm information about all jobs
  *	to be run as the specified user
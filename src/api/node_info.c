@@ -747,6 +747,105 @@ extern int slurm_load_node2(time_t update_time, node_info_msg_t **resp,
 	return _load_cluster_nodes(&req_msg, resp, cluster, show_flags);
 }
 
+/*
+ * slurm_load_node_delta - issue RPC to get the local cluster's nodes that
+ *	changed since a generation returned by an earlier call
+ * IN delta_gen - (*resp)->delta_gen of the earlier call, or 0 for all nodes
+ * OUT resp - place to store the nodes: all of them if delta_full is set,
+ *	otherwise those changed since delta_gen along with their delta_inx
+ * IN show_flags - node filtering options
+ * RET 0 or -1 on error, errno is SLURM_NO_CHANGE_IN_DATA if nothing changed
+ * NOTE: free the response using slurm_free_node_info_msg
+ */
+extern int slurm_load_node_delta(uint64_t delta_gen, node_info_msg_t **resp,
+				 uint16_t show_flags)
+{
+	slurm_msg_t req_msg, resp_msg;
+	info_delta_request_msg_t req;
+	int rc;
+
+	slurm_msg_t_init(&req_msg);
+	slurm_msg_t_init(&resp_msg);
+	memset(&req, 0, sizeof(req));
+	req.delta_gen    = delta_gen;
+	req.show_flags   = (show_flags | SHOW_LOCAL) & (~SHOW_FEDERATION);
+	req_msg.msg_type = REQUEST_NODE_INFO_DELTA;
+	req_msg.data     = &req;
+
+	*resp = NULL;
+
+	if (slurm_send_recv_controller_msg(&req_msg, &resp_msg,
+					   working_cluster_rec) < 0)
+		return SLURM_ERROR;
+
+	switch (resp_msg.msg_type) {
+	case RESPONSE_NODE_INFO_DELTA:
+		*resp = (node_info_msg_t *) resp_msg.data;
+		if (show_flags & SHOW_MIXED)
+			_set_node_mixed(*resp);
+		break;
+	case RESPONSE_SLURM_RC:
+		rc = ((return_code_msg_t *) resp_msg.data)->return_code;
+		slurm_free_return_code_msg(resp_msg.data);
+		if (rc)
+			slurm_seterrno_ret(rc);
+		break;
+	default:
+		slurm_seterrno_ret(SLURM_UNEXPECTED_MSG_ERROR);
+		break;
+	}
+
+	return SLURM_SUCCESS;
+}
+
+/*
+ * slurm_merge_node_info - apply the response of slurm_load_node_delta() to
+ *	the nodes it was requested against
+ * IN/OUT node_info_msg_pptr - nodes as of the generation asked for,
+ *	replaced by the nodes as of the response
+ * IN delta_msg_ptr - the response, freed
+ * RET 0 or -1 if delta_msg_ptr doesn't fit the nodes, errno set
+ */
+extern int slurm_merge_node_info(node_info_msg_t **node_info_msg_pptr,
+				 node_info_msg_t *delta_msg_ptr)
+{
+	node_info_msg_t *old_msg = *node_info_msg_pptr;
+	uint32_t inx;
+	int i;
+
+	if (delta_msg_ptr->delta_full) {
+		slurm_free_node_info_msg(old_msg);
+		*node_info_msg_pptr = delta_msg_ptr;
+		return SLURM_SUCCESS;
+	}
+
+	if (!old_msg) {
+		slurm_free_node_info_msg(delta_msg_ptr);
+		slurm_seterrno_ret(EINVAL);
+	}
+	/* the nodes must be from the same node table */
+	for (i = 0; i < delta_msg_ptr->record_count; i++) {
+		if (delta_msg_ptr->delta_inx[i] >= old_msg->record_count) {
+			slurm_free_node_info_msg(delta_msg_ptr);
+			slurm_seterrno_ret(EINVAL);
+		}
+	}
+
+	for (i = 0; i < delta_msg_ptr->record_count; i++) {
+		inx = delta_msg_ptr->delta_inx[i];
+		slurm_free_node_info_members(&old_msg->node_array[inx]);
+		old_msg->node_array[inx] = delta_msg_ptr->node_array[i];
+	}
+	old_msg->last_update = delta_msg_ptr->last_update;
+	old_msg->delta_gen = delta_msg_ptr->delta_gen;
+
+	/* its nodes were all moved over */
+	delta_msg_ptr->record_count = 0;
+	slurm_free_node_info_msg(delta_msg_ptr);
+
+	return SLURM_SUCCESS;
+}
+
 /*
  * slurm_load_node_single - issue RPC to get slurm configuration information
  *	for a specific node
@@ -143,6 +143,9 @@ struct node_record {
 					 * plugins */
 	uint64_t sched_weight;		/* Node's weight for scheduling
 					 * purposes. For cons_tres use */
+	uint16_t io_load;		/*AG load (percent) of its I/O path
+					 * (LNet routers, OSTs) from remote
+					 * metrics, not saved */
 	uint32_t weight;		/* orignal weight, used only for state
 					 * save/restore, DO NOT use for
 					 * scheduling purposes. */
@@ -172,6 +175,11 @@ struct node_record {
 	char *tres_fmt_str;		/* tres this node has */
 	uint64_t *tres_cnt;		/* tres this node has. NO_PACK*/
 	char *mcs_label;		/* mcs_label if mcs plugin in use */
+	uint64_t delta_gen;		/* change generation, see slurmctld's
+					 * info_delta.c, NO_PACK */
+	uint32_t delta_state;		/* node_state and */
+	time_t delta_reason_time;	/* reason_time as of delta_gen,
+					 * NO_PACK */
 };
 extern node_record_t *node_record_table_ptr;  /* ptr to node records */
 extern int node_record_count;		/* count in node_record_table_ptr */
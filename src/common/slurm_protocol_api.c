@@ -4057,19 +4057,42 @@ int slurm_send_node_msg(int fd, slurm_msg_t * msg)
 		slurm_seterrno_ret(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
 	}
 
-	/*
-	 * Pack message into buffer
-	 */
-	_pack_msg(msg, &header, buffer);
+	if (pack_msg_prepacked(msg->msg_type)) {
+		/*
+		 * The body is an already packed buffer (often a cached
+		 * dump of the whole job or node table). Send it straight
+		 * from the caller's memory after the header and auth
+		 * credential instead of copying it into our buffer; the
+		 * caller keeps it until we return.
+		 */
+		struct iovec iov[2];
+		uint32_t tmplen = get_buf_offset(buffer);
+
+		update_header(&header, msg->data_size);
+		set_buf_offset(buffer, 0);
+		pack_header(&header, buffer);
+		set_buf_offset(buffer, tmplen);
+
+		iov[0].iov_base = get_buf_data(buffer);
+		iov[0].iov_len = get_buf_offset(buffer);
+		iov[1].iov_base = msg->data;
+		iov[1].iov_len = msg->data_size;
+		rc = slurm_msg_sendv(fd, iov, 2);
+	} else {
+		/*
+		 * Pack message into buffer
+		 */
+		_pack_msg(msg, &header, buffer);
 
 #if	_DEBUG
-	_print_data (get_buf_data(buffer),get_buf_offset(buffer));
+		_print_data (get_buf_data(buffer),get_buf_offset(buffer));
 #endif
-	/*
-	 * Send message
-	 */
-	rc = slurm_msg_sendto(fd, get_buf_data(buffer),
-			      get_buf_offset(buffer));
+		/*
+		 * Send message
+		 */
+		rc = slurm_msg_sendto(fd, get_buf_data(buffer),
+				      get_buf_offset(buffer));
+	}
 
 	if ((rc < 0) && (errno == ENOTCONN)) {
 		debug3("slurm_msg_sendto: peer has disappeared for msg_type=%u",
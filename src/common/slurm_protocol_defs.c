@@ -906,6 +906,11 @@ extern void slurm_free_node_info_request_msg(node_info_request_msg_t *msg)
 	xfree(msg);
 }
 
+extern void slurm_free_info_delta_request_msg(info_delta_request_msg_t *msg)
+{
+	xfree(msg);
+}
+
 extern void slurm_free_node_info_single_msg(node_info_single_msg_t *msg)
 {
 	if (msg) {
@@ -1657,6 +1662,16 @@ extern void slurm_free_stats_response_msg(stats_info_response_msg_t *msg)
 			xfree(msg->rpc_dump_hostlist[i]);
 		}
 		xfree(msg->rpc_dump_hostlist);
+		xfree(msg->lock_read_cnt);
+		xfree(msg->lock_write_cnt);
+		xfree(msg->lock_contended);
+		xfree(msg->lock_wait_usec);
+		xfree(msg->lock_wait_max);
+		xfree(msg->rpc_lane_queue);
+		xfree(msg->rpc_lane_queue_max);
+		xfree(msg->rpc_lane_count);
+		xfree(msg->rpc_lane_wait_usec);
+		xfree(msg->rpc_lane_wait_max);
 		xfree(msg);
 	}
 }
@@ -4111,6 +4126,7 @@ extern void slurm_free_job_info_msg(job_info_msg_t * job_buffer_ptr)
 			_free_all_job_info(job_buffer_ptr);
 			xfree(job_buffer_ptr->job_array);
 		}
+		xfree(job_buffer_ptr->removed_job_ids);
 		xfree(job_buffer_ptr);
 	}
 }
@@ -4244,6 +4260,7 @@ extern void slurm_free_node_info_msg(node_info_msg_t * msg)
 			_free_all_node_info(msg);
 			xfree(msg->node_array);
 		}
+		xfree(msg->delta_inx);
 		xfree(msg);
 	}
 }
@@ -4753,6 +4770,10 @@ extern int slurm_free_msg_data(slurm_msg_type_t type, void *data)
 	case REQUEST_NODE_INFO:
 		slurm_free_node_info_request_msg(data);
 		break;
+	case REQUEST_JOB_INFO_DELTA:
+	case REQUEST_NODE_INFO_DELTA:
+		slurm_free_info_delta_request_msg(data);
+		break;
 	case REQUEST_NODE_INFO_SINGLE:
 		slurm_free_node_info_single_msg(data);
 		break;
@@ -5105,6 +5126,12 @@ extern int slurm_free_msg_data(slurm_msg_type_t type, void *data)
 	case RESPONSE_BURST_BUFFER_STATUS:
 		slurm_free_bb_status_resp_msg(data);
 		break;
+	case RESPONSE_JOB_INFO_DELTA:
+		slurm_free_job_info_msg(data);
+		break;
+	case RESPONSE_NODE_INFO_DELTA:
+		slurm_free_node_info_msg(data);
+		break;
 	default:
 		error("invalid type trying to be freed %u", type);
 		break;
@@ -5373,6 +5400,14 @@ rpc_num2string(uint16_t opcode)
 		return "REQUEST_BURST_BUFFER_STATUS";
 	case RESPONSE_BURST_BUFFER_STATUS:
 		return "RESPONSE_BURST_BUFFER_STATUS";
+	case REQUEST_JOB_INFO_DELTA:
+		return "REQUEST_JOB_INFO_DELTA";
+	case RESPONSE_JOB_INFO_DELTA:
+		return "RESPONSE_JOB_INFO_DELTA";
+	case REQUEST_NODE_INFO_DELTA:
+		return "REQUEST_NODE_INFO_DELTA";
+	case RESPONSE_NODE_INFO_DELTA:
+		return "RESPONSE_NODE_INFO_DELTA";
 
 	case REQUEST_UPDATE_JOB:				/* 3001 */
 		return "REQUEST_UPDATE_JOB";
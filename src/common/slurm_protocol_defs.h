@@ -286,6 +286,10 @@ typedef enum {
 	RESPONSE_CONTROL_STATUS,
 	REQUEST_BURST_BUFFER_STATUS,
 	RESPONSE_BURST_BUFFER_STATUS,
+	REQUEST_JOB_INFO_DELTA,
+	RESPONSE_JOB_INFO_DELTA,
+	REQUEST_NODE_INFO_DELTA,
+	RESPONSE_NODE_INFO_DELTA,
 
 	REQUEST_UPDATE_JOB = 3001,
 	REQUEST_UPDATE_NODE,
@@ -636,6 +640,13 @@ typedef struct node_info_request_msg {
 	uint16_t show_flags;
 } node_info_request_msg_t;
 
+/* REQUEST_JOB_INFO_DELTA and REQUEST_NODE_INFO_DELTA */
+typedef struct info_delta_request_msg {
+	uint64_t delta_gen;	/* generation of the client's records, 0 for
+				 * none */
+	uint16_t show_flags;
+} info_delta_request_msg_t;
+
 typedef struct node_info_single_msg {
 	char *node_name;
 	uint16_t show_flags;
@@ -1345,6 +1356,7 @@ extern void slurm_free_job_step_info_request_msg(
 extern void slurm_free_front_end_info_request_msg(
 		front_end_info_request_msg_t *msg);
 extern void slurm_free_node_info_request_msg(node_info_request_msg_t *msg);
+extern void slurm_free_info_delta_request_msg(info_delta_request_msg_t *msg);
 extern void slurm_free_node_info_single_msg(node_info_single_msg_t *msg);
 extern void slurm_free_part_info_request_msg(part_info_request_msg_t *msg);
 extern void slurm_free_sib_msg(sib_msg_t *msg);
@@ -48,6 +48,7 @@
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "src/common/macros.h"
@@ -95,6 +96,18 @@ extern ssize_t slurm_msg_sendto_timeout(int open_fd,
 					size_t size,
 					int timeout);
 
+/* slurm_msg_sendv
+ * Send a message held in several buffers over the given connection, framed
+ * as one message, without first copying the buffers together
+ * IN open_fd - an open file descriptor
+ * IN iov - buffers to transmit, in order
+ * IN iovcnt - number of entries in iov, at most SLURM_MSG_IOV_MAX
+ * RET number of bytes written (excluding the length prefix)
+ */
+#define SLURM_MSG_IOV_MAX 4
+extern ssize_t slurm_msg_sendv(int open_fd, const struct iovec *iov,
+			       int iovcnt);
+
 /********************/
 /* stream functions */
 /********************/
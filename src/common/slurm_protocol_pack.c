@@ -69,10 +69,12 @@
 #include "src/common/xstring.h"
 
 #define _pack_job_info_msg(msg,buf)		_pack_buffer_msg(msg,buf)
+#define _pack_job_info_delta_msg(msg,buf)	_pack_buffer_msg(msg,buf)
 #define _pack_job_step_info_msg(msg,buf)	_pack_buffer_msg(msg,buf)
 #define _pack_burst_buffer_info_resp_msg(msg,buf) _pack_buffer_msg(msg,buf)
 #define _pack_front_end_info_msg(msg,buf)	_pack_buffer_msg(msg,buf)
 #define _pack_node_info_msg(msg,buf)		_pack_buffer_msg(msg,buf)
+#define _pack_node_info_delta_msg(msg,buf)	_pack_buffer_msg(msg,buf)
 #define _pack_partition_info_msg(msg,buf)	_pack_buffer_msg(msg,buf)
 #define _pack_stats_response_msg(msg,buf)	_pack_buffer_msg(msg,buf)
 #define _pack_reserve_info_msg(msg,buf)		_pack_buffer_msg(msg,buf)
@@ -1626,6 +1628,45 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+/* NOTE: change pack_delta_node() in slurmctld/node_mgr.c with this */
+static int _unpack_node_info_delta_msg(node_info_msg_t **msg, Buf buffer,
+				       uint16_t protocol_version)
+{
+	int i;
+	uint8_t full;
+	node_info_msg_t *tmp_ptr;
+
+	xassert(msg);
+	tmp_ptr = xmalloc(sizeof(node_info_msg_t));
+	*msg = tmp_ptr;
+
+	safe_unpack64(&tmp_ptr->delta_gen, buffer);
+	safe_unpack8(&full, buffer);
+	tmp_ptr->delta_full = full;
+	safe_unpack32(&tmp_ptr->record_count, buffer);
+	safe_unpack_time(&tmp_ptr->last_update, buffer);
+
+	safe_xcalloc(tmp_ptr->node_array, tmp_ptr->record_count,
+		     sizeof(node_info_t));
+	safe_xcalloc(tmp_ptr->delta_inx, tmp_ptr->record_count,
+		     sizeof(uint32_t));
+
+	for (i = 0; i < tmp_ptr->record_count; i++) {
+		safe_unpack32(&tmp_ptr->delta_inx[i], buffer);
+		if (_unpack_node_info_members(&tmp_ptr->node_array[i], buffer,
+					      protocol_version))
+			goto unpack_error;
+	}
+	if (tmp_ptr->delta_full)
+		xfree(tmp_ptr->delta_inx);
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_node_info_msg(tmp_ptr);
+	*msg = NULL;
+	return SLURM_ERROR;
+}
+
 static int
 _unpack_node_info_members(node_info_t * node, Buf buffer,
 			  uint16_t protocol_version)
@@ -3286,6 +3327,32 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+/* NOTE: change pack_delta_jobs() in slurmctld/job_mgr.c with this */
+static int _unpack_job_info_delta_msg(job_info_msg_t **msg, Buf buffer,
+				      uint16_t protocol_version)
+{
+	uint64_t delta_gen;
+	uint8_t full;
+
+	xassert(msg);
+	*msg = NULL;
+
+	safe_unpack64(&delta_gen, buffer);
+	safe_unpack8(&full, buffer);
+	if (_unpack_job_info_msg(msg, buffer, protocol_version))
+		return SLURM_ERROR;
+	(*msg)->delta_gen = delta_gen;
+	(*msg)->delta_full = full;
+	safe_unpack32_array(&(*msg)->removed_job_ids, &(*msg)->removed_count,
+			    buffer);
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_job_info_msg(*msg);
+	*msg = NULL;
+	return SLURM_ERROR;
+}
+
 /* Translate bitmap representation from hex to decimal format, replacing
  * array_task_str and store the bitmap in job->array_bitmap. */
 static void _xlate_task_str(job_info_t *job_ptr)
@@ -9051,6 +9118,32 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+static void _pack_info_delta_request_msg(info_delta_request_msg_t *msg,
+					 Buf buffer, uint16_t protocol_version)
+{
+	pack64(msg->delta_gen, buffer);
+	pack16(msg->show_flags, buffer);
+}
+
+static int _unpack_info_delta_request_msg(info_delta_request_msg_t **msg,
+					  Buf buffer,
+					  uint16_t protocol_version)
+{
+	info_delta_request_msg_t *delta_req;
+
+	delta_req = xmalloc(sizeof(info_delta_request_msg_t));
+	*msg = delta_req;
+
+	safe_unpack64(&delta_req->delta_gen, buffer);
+	safe_unpack16(&delta_req->show_flags, buffer);
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_info_delta_request_msg(delta_req);
+	*msg = NULL;
+	return SLURM_ERROR;
+}
+
 static void
 _pack_node_info_single_msg(node_info_single_msg_t * msg, Buf buffer,
 			   uint16_t protocol_version)
@@ -11067,6 +11160,82 @@ static int  _unpack_stats_response_msg(stats_info_response_msg_t **msg_ptr,
 				     buffer);
 		if (uint32_tmp != msg->rpc_dump_count)
 			goto unpack_error;
+
+		/*AG 20.02 controllers stop here, see STAT_EXT_VERSION */
+		if (!msg->parts_packed || !remaining_buf(buffer))
+			return SLURM_SUCCESS;
+		safe_unpack32(&msg->ext_version, buffer);
+
+		safe_unpack32(&msg->bf_queue_build_last, buffer);
+		safe_unpack64(&msg->bf_queue_build_sum, buffer);
+		safe_unpack32(&msg->bf_lic_init_last, buffer);
+		safe_unpack64(&msg->bf_lic_init_sum, buffer);
+		safe_unpack32(&msg->bf_lic_test_last, buffer);
+		safe_unpack64(&msg->bf_lic_test_sum, buffer);
+		safe_unpack32(&msg->bf_lic_update_last, buffer);
+		safe_unpack64(&msg->bf_lic_update_sum, buffer);
+		safe_unpack32(&msg->bf_resv_test_last, buffer);
+		safe_unpack64(&msg->bf_resv_test_sum, buffer);
+		safe_unpack32(&msg->bf_try_sched_last, buffer);
+		safe_unpack64(&msg->bf_try_sched_sum, buffer);
+		safe_unpack32(&msg->bf_node_space_last, buffer);
+		safe_unpack64(&msg->bf_node_space_sum, buffer);
+		safe_unpack32(&msg->bf_lic_tests_last, buffer);
+		safe_unpack32(&msg->bf_lic_tests_sum, buffer);
+		safe_unpack32(&msg->bf_lic_defers_last, buffer);
+		safe_unpack32(&msg->bf_lic_defers_sum, buffer);
+		safe_unpack32(&msg->bf_lic_resvs_last, buffer);
+		safe_unpack32(&msg->bf_lic_resvs_sum, buffer);
+
+		safe_unpack32(&msg->lustre_util_cache_hits, buffer);
+		safe_unpack32(&msg->lustre_util_cache_misses, buffer);
+		safe_unpack32(&msg->lustre_util_cache_size, buffer);
+
+		safe_unpack32(&msg->job_info_cache_hits, buffer);
+		safe_unpack32(&msg->job_info_cache_misses, buffer);
+		safe_unpack32(&msg->job_info_cache_size, buffer);
+
+		safe_unpack64_array(&msg->lock_read_cnt,
+				    &msg->lock_stats_cnt, buffer);
+		safe_unpack64_array(&msg->lock_write_cnt,
+				    &uint32_tmp, buffer);
+		if (uint32_tmp != msg->lock_stats_cnt)
+			goto unpack_error;
+		safe_unpack64_array(&msg->lock_contended,
+				    &uint32_tmp, buffer);
+		if (uint32_tmp != msg->lock_stats_cnt)
+			goto unpack_error;
+		safe_unpack64_array(&msg->lock_wait_usec,
+				    &uint32_tmp, buffer);
+		if (uint32_tmp != msg->lock_stats_cnt)
+			goto unpack_error;
+		safe_unpack32_array(&msg->lock_wait_max,
+				    &uint32_tmp, buffer);
+		if (uint32_tmp != msg->lock_stats_cnt)
+			goto unpack_error;
+
+		safe_unpack32(&msg->rpc_workers, buffer);
+		safe_unpack32(&msg->rpc_workers_busy, buffer);
+		safe_unpack32(&msg->rpc_conn_queue, buffer);
+		safe_unpack32(&msg->rpc_conn_queue_max, buffer);
+		safe_unpack32_array(&msg->rpc_lane_queue,
+				    &msg->rpc_lane_cnt, buffer);
+		safe_unpack32_array(&msg->rpc_lane_queue_max,
+				    &uint32_tmp, buffer);
+		if (uint32_tmp != msg->rpc_lane_cnt)
+			goto unpack_error;
+		safe_unpack64_array(&msg->rpc_lane_count,
+				    &uint32_tmp, buffer);
+		if (uint32_tmp != msg->rpc_lane_cnt)
+			goto unpack_error;
+		safe_unpack64_array(&msg->rpc_lane_wait_usec,
+				    &uint32_tmp, buffer);
+		if (uint32_tmp != msg->rpc_lane_cnt)
+			goto unpack_error;
+		safe_unpack32_array(&msg->rpc_lane_wait_max,
+				    &uint32_tmp, buffer);
+		if (uint32_tmp != msg->rpc_lane_cnt)
+			goto unpack_error;
 	} else if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		safe_unpack32(&msg->parts_packed,	buffer);
 		if (msg->parts_packed) {
@@ -11630,6 +11799,27 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+extern bool pack_msg_prepacked(uint16_t msg_type)
+{
+	switch (msg_type) {
+	case RESPONSE_JOB_INFO:
+	case RESPONSE_JOB_INFO_DELTA:
+	case RESPONSE_JOB_STEP_INFO:
+	case RESPONSE_BURST_BUFFER_INFO:
+	case RESPONSE_FRONT_END_INFO:
+	case RESPONSE_NODE_INFO:
+	case RESPONSE_NODE_INFO_DELTA:
+	case RESPONSE_PARTITION_INFO:
+	case RESPONSE_STATS_INFO:
+	case RESPONSE_RESERVATION_INFO:
+	case RESPONSE_LAYOUT_INFO:
+	case RESPONSE_ASSOC_MGR_INFO:
+		return true;
+	default:
+		return false;
+	}
+}
+
 /* pack_msg
  * packs a generic slurm protocol message body
  * IN msg - the body structure to pack (note: includes message type)
@@ -11652,6 +11842,12 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 					    msg->data, buffer,
 					    msg->protocol_version);
 		break;
+	case REQUEST_JOB_INFO_DELTA:
+	case REQUEST_NODE_INFO_DELTA:
+		_pack_info_delta_request_msg((info_delta_request_msg_t *)
+					     msg->data, buffer,
+					     msg->protocol_version);
+		break;
 	case REQUEST_NODE_INFO_SINGLE:
 		_pack_node_info_single_msg((node_info_single_msg_t *)
 					   msg->data, buffer,
@@ -11685,6 +11881,9 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 	case RESPONSE_JOB_INFO:
 		_pack_job_info_msg((slurm_msg_t *) msg, buffer);
 		break;
+	case RESPONSE_JOB_INFO_DELTA:
+		_pack_job_info_delta_msg((slurm_msg_t *) msg, buffer);
+		break;
 	case RESPONSE_BATCH_SCRIPT:
 		_pack_job_script_msg((Buf) msg->data, buffer,
 				     msg->protocol_version);
@@ -11695,6 +11894,9 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 	case RESPONSE_NODE_INFO:
 		_pack_node_info_msg((slurm_msg_t *) msg, buffer);
 		break;
+	case RESPONSE_NODE_INFO_DELTA:
+		_pack_node_info_delta_msg((slurm_msg_t *) msg, buffer);
+		break;
 	case MESSAGE_NODE_REGISTRATION_STATUS:
 		_pack_node_registration_status_msg(
 			(slurm_node_registration_status_msg_t *) msg->data,
@@ -12294,6 +12496,12 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 						   & (msg->data), buffer,
 						   msg->protocol_version);
 		break;
+	case REQUEST_JOB_INFO_DELTA:
+	case REQUEST_NODE_INFO_DELTA:
+		rc = _unpack_info_delta_request_msg(
+			(info_delta_request_msg_t **) &(msg->data), buffer,
+			msg->protocol_version);
+		break;
 	case REQUEST_NODE_INFO_SINGLE:
 		rc = _unpack_node_info_single_msg((node_info_single_msg_t **)
 						  & (msg->data), buffer,
@@ -12330,6 +12538,11 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 					  buffer,
 					  msg->protocol_version);
 		break;
+	case RESPONSE_JOB_INFO_DELTA:
+		rc = _unpack_job_info_delta_msg((job_info_msg_t **)
+						&(msg->data), buffer,
+						msg->protocol_version);
+		break;
 	case RESPONSE_BATCH_SCRIPT:
 		rc = _unpack_job_script_msg((char **) &(msg->data),
 					    buffer,
@@ -12345,6 +12558,11 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 					   (msg->data), buffer,
 					   msg->protocol_version);
 		break;
+	case RESPONSE_NODE_INFO_DELTA:
+		rc = _unpack_node_info_delta_msg((node_info_msg_t **)
+						 &(msg->data), buffer,
+						 msg->protocol_version);
+		break;
 	case MESSAGE_NODE_REGISTRATION_STATUS:
 		rc = _unpack_node_registration_status_msg(
 			(slurm_node_registration_status_msg_t **)
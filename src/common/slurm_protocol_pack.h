@@ -80,6 +80,14 @@ extern int unpack_header(header_t *header, Buf buffer);
  */
 extern int pack_msg(slurm_msg_t const *msg, Buf buffer);
 
+/*
+ * pack_msg_prepacked - report if the body of a message of this type is an
+ *	already packed buffer (msg->data, msg->data_size) sent as is
+ * IN msg_type - message type
+ * RET true if pack_msg() would only copy msg->data into the buffer
+ */
+extern bool pack_msg_prepacked(uint16_t msg_type);
+
 /*
  * unpacks a generic slurm protocol message body
  * OUT msg - the body structure to unpack (note: includes message type)
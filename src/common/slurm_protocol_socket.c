@@ -196,6 +196,124 @@ ssize_t slurm_msg_sendto_timeout(int fd, char *buffer,
 	return len;
 }
 
+extern ssize_t slurm_msg_sendv(int fd, const struct iovec *iov, int iovcnt)
+{
+	struct iovec vec[SLURM_MSG_IOV_MAX + 1];
+	struct iovec *cur = vec;
+	struct pollfd ufds;
+	struct timeval tstart;
+	SigFunc *ohandler;
+	uint32_t usize;
+	size_t size = 0, total, sent = 0;
+	int cnt = iovcnt + 1, fd_flags, timeleft, rc, i;
+	int timeout = slurm_get_msg_timeout() * 1000;
+	ssize_t len;
+	char temp[2];
+
+	xassert((iovcnt > 0) && (iovcnt <= SLURM_MSG_IOV_MAX));
+
+	for (i = 0; i < iovcnt; i++) {
+		vec[i + 1] = iov[i];
+		size += iov[i].iov_len;
+	}
+	usize = htonl(size);
+	vec[0].iov_base = &usize;
+	vec[0].iov_len = sizeof(usize);
+	total = size + sizeof(usize);
+
+	/*
+	 *  Ignore SIGPIPE so that writev can return a error code if the
+	 *    other side closes the socket
+	 */
+	ohandler = xsignal(SIGPIPE, SIG_IGN);
+
+	ufds.fd     = fd;
+	ufds.events = POLLOUT;
+
+	fd_flags = fcntl(fd, F_GETFL);
+	fd_set_nonblocking(fd);
+
+	gettimeofday(&tstart, NULL);
+
+	while (sent < total) {
+		timeleft = timeout - _tot_wait(&tstart);
+		if (timeleft <= 0) {
+			debug("%s at %zu of %zu, timeout",
+			      __func__, sent, total);
+			slurm_seterrno(SLURM_PROTOCOL_SOCKET_IMPL_TIMEOUT);
+			len = SLURM_ERROR;
+			goto done;
+		}
+
+		if ((rc = poll(&ufds, 1, timeleft)) <= 0) {
+			if ((rc == 0) || (errno == EINTR) || (errno == EAGAIN))
+				continue;
+			debug("%s at %zu of %zu, poll error: %m",
+			      __func__, sent, total);
+			slurm_seterrno(SLURM_COMMUNICATIONS_SEND_ERROR);
+			len = SLURM_ERROR;
+			goto done;
+		}
+
+		/* Same checks as slurm_send_timeout() */
+		if (ufds.revents & POLLERR) {
+			debug("%s: Socket POLLERR", __func__);
+			slurm_seterrno(ENOTCONN);
+			len = SLURM_ERROR;
+			goto done;
+		}
+		if ((ufds.revents & POLLHUP) || (ufds.revents & POLLNVAL) ||
+		    (recv(fd, &temp, 1, 0) == 0)) {
+			debug2("%s: Socket no longer there", __func__);
+			slurm_seterrno(ENOTCONN);
+			len = SLURM_ERROR;
+			goto done;
+		}
+
+		len = writev(fd, cur, cnt);
+		if (len < 0) {
+			if ((errno == EINTR) || (errno == EAGAIN))
+				continue;
+			debug("%s at %zu of %zu, writev error: %m",
+			      __func__, sent, total);
+			slurm_seterrno(SLURM_COMMUNICATIONS_SEND_ERROR);
+			len = SLURM_ERROR;
+			goto done;
+		}
+		if (len == 0) {
+			debug("%s at %zu of %zu, sent zero bytes",
+			      __func__, sent, total);
+			slurm_seterrno(SLURM_PROTOCOL_SOCKET_ZERO_BYTES_SENT);
+			len = SLURM_ERROR;
+			goto done;
+		}
+
+		sent += len;
+		/* Skip what was written, resume inside a partial entry */
+		while (cnt && ((size_t) len >= cur->iov_len)) {
+			len -= cur->iov_len;
+			cur++;
+			cnt--;
+		}
+		if (cnt) {
+			cur->iov_base = (char *) cur->iov_base + len;
+			cur->iov_len -= len;
+		}
+	}
+	len = size;
+
+done:
+	/* Reset fd flags to prior state, preserve errno */
+	if (fd_flags != -1) {
+		int slurm_err = slurm_get_errno();
+		if (fcntl(fd, F_SETFL, fd_flags) < 0)
+			error("%s: fcntl(F_SETFL) error: %m", __func__);
+		slurm_seterrno(slurm_err);
+	}
+	xsignal(SIGPIPE, ohandler);
+	return len;
+}
+
 /* Send slurm message with timeout
  * RET message size (as specified in argument) or SLURM_ERROR on error */
 extern int slurm_send_timeout(int fd, char *buf, size_t size,
@@ -45,6 +45,7 @@
 #include <signal.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -58,6 +59,8 @@
 
 #include "src/slurmd/slurmd/slurmd.h"
 
+#include "lustre_ring.h"
+
 
 /***************************************************************/
 
@@ -108,10 +111,20 @@ typedef struct {
 static lustre_stats_t lstats = {0,0,0,0,0};
 static lustre_stats_t lstats_prev = {0,0,0,0,0};
 
+typedef enum {
+	LUSTRE_SOURCE_PROC,	/* parse the llite stats files */
+	LUSTRE_SOURCE_LDMS,	/* read the ring the LDMS daemon fills */
+} lustre_source_t;
+
 static uint64_t debug_flags = 0;
 static pthread_mutex_t lustre_lock = PTHREAD_MUTEX_INITIALIZER;
 static int tres_pos = -1;
 
+static lustre_source_t lustre_source = LUSTRE_SOURCE_PROC;
+static char *lustre_ring_path = NULL;
+static lustre_ring_hdr_t *ring = NULL;	/* mapped read only */
+static uint32_t ring_rec_cnt = 0;
+
 
 /*
  * _llite_path()
@@ -163,7 +176,11 @@ static int _check_lustre_fs(void)
 		set = true;
 		acct_gather_profile_g_get(ACCT_GATHER_PROFILE_RUNNING,
 					  &profile);
-		if ((profile & ACCT_GATHER_PROFILE_LUSTRE)) {
+		if ((profile & ACCT_GATHER_PROFILE_LUSTRE) &&
+		    (lustre_source == LUSTRE_SOURCE_LDMS)) {
+			debug("%s: using Lustre counters in %s",
+			      __func__, lustre_ring_path);
+		} else if ((profile & ACCT_GATHER_PROFILE_LUSTRE)) {
 			char *llite_path = _llite_path();
 			if (!llite_path) {
 				error("%s: can't find Lustre stats", __func__);
@@ -284,6 +301,141 @@ static int _read_lustre_counters(void)
 	return SLURM_SUCCESS;
 }
 
+/*
+ * _map_ring()
+ *
+ * map the ring of counters the LDMS daemon fills, see lustre_ring.h
+ *
+ */
+static int _map_ring(void)
+{
+	static bool logged = false;
+	lustre_ring_hdr_t hdr;
+	struct stat st;
+	void *addr;
+	int fd;
+
+	if (ring)
+		return SLURM_SUCCESS;
+
+	if ((fd = open(lustre_ring_path, O_RDONLY | O_CLOEXEC)) < 0) {
+		if (!logged)
+			error("%s: Cannot open %s %m",
+			      __func__, lustre_ring_path);
+		logged = true;
+		return SLURM_ERROR;
+	}
+
+	if ((fstat(fd, &st) < 0) || (st.st_size < sizeof(hdr)) ||
+	    (read(fd, &hdr, sizeof(hdr)) != sizeof(hdr)) ||
+	    (hdr.magic != LUSTRE_RING_MAGIC) ||
+	    (hdr.version != LUSTRE_RING_VERSION) || !hdr.rec_cnt ||
+	    (st.st_size < LUSTRE_RING_SIZE(hdr.rec_cnt))) {
+		if (!logged)
+			error("%s: %s is not a ring of Lustre counters",
+			      __func__, lustre_ring_path);
+		logged = true;
+		close(fd);
+		return SLURM_ERROR;
+	}
+
+	addr = mmap(NULL, LUSTRE_RING_SIZE(hdr.rec_cnt), PROT_READ,
+		    MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) {
+		error("%s: Cannot map %s %m", __func__, lustre_ring_path);
+		return SLURM_ERROR;
+	}
+
+	ring = addr;
+	ring_rec_cnt = hdr.rec_cnt;
+	logged = false;
+	debug3("%s: mapped %s, %u records",
+	       __func__, lustre_ring_path, ring_rec_cnt);
+
+	return SLURM_SUCCESS;
+}
+
+/* _read_ring_counters()
+ *
+ * Read the latest counters the LDMS daemon put in the ring. These are the
+ * node's cumulative counters summed over all mounted lustre fs, as
+ * _read_lustre_counters() gets them, but taking them costs a copy of one
+ * record instead of reading a stats file per fs.
+ *
+ * Until the daemon has written a record the counters stay at zero.
+ *
+ */
+static int _read_ring_counters(void)
+{
+	static bool first = true;
+	lustre_ring_rec_t *recs, *slot, rec;
+	uint64_t seq = 0;
+	int tries;
+
+	if (_map_ring() != SLURM_SUCCESS)
+		return SLURM_ERROR;
+
+	recs = (lustre_ring_rec_t *) (ring + 1);
+	for (tries = 0; tries < 3; tries++) {
+		seq = __atomic_load_n(&ring->seq, __ATOMIC_ACQUIRE);
+		if (!seq)
+			break;
+		slot = &recs[(seq - 1) % ring_rec_cnt];
+		if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != seq)
+			continue;
+		memcpy(&rec, slot, sizeof(rec));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == seq)
+			break;
+	}
+
+	if (!seq) {
+		debug2("%s: no counters in %s yet",
+		       __func__, lustre_ring_path);
+		return SLURM_SUCCESS;
+	}
+	if (tries == 3) {
+		debug2("%s: %s is being rewritten, keeping the last counters",
+		       __func__, lustre_ring_path);
+		return SLURM_SUCCESS;
+	}
+
+	if ((rec.write_bytes < lstats.write_bytes) ||
+	    (rec.read_bytes < lstats.read_bytes) ||
+	    (rec.write_samples < lstats.write_samples) ||
+	    (rec.read_samples < lstats.read_samples)) {
+		/* the LDMS daemon restarted or a fs was unmounted */
+		debug("%s: Lustre counters in %s went back, starting over",
+		      __func__, lustre_ring_path);
+		first = true;
+	}
+
+	lstats.update_time = rec.time;
+	lstats.write_samples = rec.write_samples;
+	lstats.read_samples = rec.read_samples;
+	lstats.write_bytes = rec.write_bytes;
+	lstats.read_bytes = rec.read_bytes;
+	debug3("%s: write_bytes %"PRIu64" read_bytes %"PRIu64,
+	       __func__, lstats.write_bytes, lstats.read_bytes);
+	debug3("%s: write_samples %"PRIu64" read_samples %"PRIu64,
+	       __func__, lstats.write_samples, lstats.read_samples);
+
+	if (first) {
+		memcpy(&lstats_prev, &lstats, sizeof(lustre_stats_t));
+		first = false;
+	}
+
+	return SLURM_SUCCESS;
+}
+
+static int _read_counters(void)
+{
+	if (lustre_source == LUSTRE_SOURCE_LDMS)
+		return _read_ring_counters();
+	return _read_lustre_counters();
+}
+
 /*
  *_update_node_filesystem()
  *
@@ -319,7 +471,7 @@ static int _update_node_filesystem(void)
 
 	slurm_mutex_lock(&lustre_lock);
 
-	if (_read_lustre_counters() != SLURM_SUCCESS) {
+	if (_read_counters() != SLURM_SUCCESS) {
 		error("%s: Cannot read lustre counters", __func__);
 		slurm_mutex_unlock(&lustre_lock);
 		return SLURM_ERROR;
@@ -401,6 +553,11 @@ extern int fini(void)
 	if (debug_flags & DEBUG_FLAG_FILESYSTEM)
 		info("lustre: ended");
 
+	if (ring)
+		munmap(ring, LUSTRE_RING_SIZE(ring_rec_cnt));
+	ring = NULL;
+	xfree(lustre_ring_path);
+
 	return SLURM_SUCCESS;
 }
 
@@ -415,6 +572,23 @@ extern int acct_gather_filesystem_p_node_update(void)
 
 extern void acct_gather_filesystem_p_conf_set(s_p_hashtbl_t *tbl)
 {
+	char *tmp = NULL;
+
+	if (tbl && s_p_get_string(&tmp, "FilesystemLustreSource", tbl)) {
+		if (!xstrcasecmp(tmp, "ldms"))
+			lustre_source = LUSTRE_SOURCE_LDMS;
+		else if (!xstrcasecmp(tmp, "proc"))
+			lustre_source = LUSTRE_SOURCE_PROC;
+		else
+			fatal("FilesystemLustreSource=%s is invalid", tmp);
+		xfree(tmp);
+	}
+
+	xfree(lustre_ring_path);
+	if (!tbl ||
+	    !s_p_get_string(&lustre_ring_path, "FilesystemLustreRing", tbl))
+		lustre_ring_path = xstrdup(LUSTRE_RING_DEFAULT);
+
 	if (!running_in_slurmstepd())
 		return;
 
@@ -424,12 +598,33 @@ extern void acct_gather_filesystem_p_conf_set(s_p_hashtbl_t *tbl)
 extern void acct_gather_filesystem_p_conf_options(s_p_options_t **full_options,
 						  int *full_options_cnt)
 {
+	s_p_options_t options[] = {
+		{"FilesystemLustreSource", S_P_STRING},
+		{"FilesystemLustreRing", S_P_STRING},
+		{NULL} };
+
+	transfer_s_p_options(full_options, options, full_options_cnt);
 
 	return;
 }
 
 extern void acct_gather_filesystem_p_conf_values(List *data)
 {
+	config_key_pair_t *key_pair;
+
+	xassert(*data);
+
+	key_pair = xmalloc(sizeof(config_key_pair_t));
+	key_pair->name = xstrdup("FilesystemLustreSource");
+	key_pair->value = xstrdup((lustre_source == LUSTRE_SOURCE_LDMS) ?
+				  "ldms" : "proc");
+	list_append(*data, key_pair);
+
+	key_pair = xmalloc(sizeof(config_key_pair_t));
+	key_pair->name = xstrdup("FilesystemLustreRing");
+	key_pair->value = xstrdup(lustre_ring_path);
+	list_append(*data, key_pair);
+
 	return;
 }
 
@@ -444,7 +639,7 @@ extern int acct_gather_filesystem_p_get_data(acct_gather_data_t *data)
 
 	slurm_mutex_lock(&lustre_lock);
 
-	if (_read_lustre_counters() != SLURM_SUCCESS) {
+	if (_read_counters() != SLURM_SUCCESS) {
 		error("%s: Cannot read lustre counters", __func__);
 		slurm_mutex_unlock(&lustre_lock);
 		return SLURM_ERROR;
@@ -0,0 +1,85 @@
+/*****************************************************************************\
+ *  lustre_ring.h - shared memory ring of Lustre client counters
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+/*
+ * With FilesystemLustreSource=ldms the plugin doesn't parse the llite stats
+ * itself but reads the node's cumulative Lustre client counters that the
+ * local LDMS daemon already samples. The daemon (or whatever stores its
+ * llite samples) publishes them in a file, normally under /dev/shm, laid out
+ * as a lustre_ring_hdr_t followed by rec_cnt lustre_ring_rec_t, all in host
+ * byte order.
+ *
+ * Record n (counting from 0) goes to slot n % rec_cnt. The single writer
+ *   1. sets the slot's seq to 0,
+ *   2. fills in the rest of the slot,
+ *   3. sets the slot's seq to n + 1,
+ *   4. sets the header's seq to n + 1,
+ * with a release barrier between the steps. A reader takes the slot of
+ * header seq - 1 and keeps its copy only if the slot's seq equals the
+ * header seq before and after copying; otherwise the writer lapped it and
+ * it tries again.
+ *
+ * The writer must update the file in place: a reader keeps it mapped, so a
+ * file that is replaced rather than rewritten is not seen until the next
+ * step. lustre_ring_feed.c is a writer to test with.
+ */
+
+#ifndef _LUSTRE_RING_H
+#define _LUSTRE_RING_H
+
+#include <inttypes.h>
+
+#define LUSTRE_RING_MAGIC	0x474e49524c444c53ULL	/* "SLDLRING" */
+#define LUSTRE_RING_VERSION	1
+#define LUSTRE_RING_DEFAULT	"/dev/shm/ldms_lustre_ring"
+
+typedef struct {
+	uint64_t magic;		/* LUSTRE_RING_MAGIC */
+	uint32_t version;	/* LUSTRE_RING_VERSION */
+	uint32_t rec_cnt;	/* slots in the ring */
+	uint64_t seq;		/* records written, 0 if none yet */
+} lustre_ring_hdr_t;
+
+typedef struct {
+	uint64_t seq;		/* record number + 1, 0 while being written */
+	uint64_t time;		/* when sampled, seconds since the epoch */
+	uint64_t write_samples;	/* cumulative, summed over all llite mounts */
+	uint64_t read_samples;
+	uint64_t write_bytes;
+	uint64_t read_bytes;
+} lustre_ring_rec_t;
+
+#define LUSTRE_RING_SIZE(rec_cnt) \
+	(sizeof(lustre_ring_hdr_t) + (rec_cnt) * sizeof(lustre_ring_rec_t))
+
+#endif
@@ -0,0 +1,241 @@
+/*****************************************************************************\
+ *  lustre_ring_feed.c - fill a ring of Lustre counters for testing
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+/*
+ * Stands in for the LDMS daemon that feeds FilesystemLustreSource=ldms, see
+ * lustre_ring.h. The ring may be any file, so a node without /dev/shm or
+ * without Lustre can run the plugin against it.
+ *
+ * Usage: lustre_ring_feed [options] <ring file>
+ *   -n <slots>         slots of a new ring (default 64)
+ *   -i <ms>            milliseconds between records (default 1000)
+ *   -c <count>         records to write, 0 for no end (default 0)
+ *   -r <bytes>         bytes read per record, in one read (default 0)
+ *   -w <bytes>         bytes written per record, in one write (default 0)
+ *   -l <llite dir>     sum the stats of the llite mounts under <llite dir>
+ *                      instead, as an LDMS sampler would
+ *   -z                 start the counters over from zero
+ *
+ * An existing ring with the right number of slots is continued from its
+ * last record, anything else at <ring file> is overwritten.
+ */
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lustre_ring.h"
+
+static void _usage(void)
+{
+	fprintf(stderr, "Usage: lustre_ring_feed [-n slots] [-i ms] "
+		"[-c count] [-r bytes] [-w bytes] [-l llite dir] [-z] "
+		"<ring file>\n");
+	exit(1);
+}
+
+/* the sums over the llite mounts, as acct_gather_filesystem/lustre reads */
+static int _read_llite(const char *llite_dir, lustre_ring_rec_t *rec)
+{
+	DIR *dir;
+	struct dirent *entry;
+	FILE *fp;
+	char path[PATH_MAX], line[BUFSIZ];
+	uint64_t samples, bytes;
+
+	if (!(dir = opendir(llite_dir))) {
+		perror(llite_dir);
+		return -1;
+	}
+	rec->write_samples = rec->read_samples = 0;
+	rec->write_bytes = rec->read_bytes = 0;
+	while ((entry = readdir(dir))) {
+		if (entry->d_name[0] == '.')
+			continue;
+		snprintf(path, sizeof(path), "%s/%s/stats",
+			 llite_dir, entry->d_name);
+		if (!(fp = fopen(path, "r")))
+			continue;
+		while (fgets(line, sizeof(line), fp)) {
+			if (sscanf(line, "write_bytes %"SCNu64" %*s %*s %*d "
+				   "%*d %"SCNu64, &samples, &bytes) == 2) {
+				rec->write_samples += samples;
+				rec->write_bytes += bytes;
+			} else if (sscanf(line, "read_bytes %"SCNu64" %*s %*s "
+					  "%*d %*d %"SCNu64,
+					  &samples, &bytes) == 2) {
+				rec->read_samples += samples;
+				rec->read_bytes += bytes;
+			}
+		}
+		fclose(fp);
+	}
+	closedir(dir);
+	return 0;
+}
+
+/* maps the ring at path, making a new one unless there is one of rec_cnt */
+static lustre_ring_hdr_t *_open_ring(const char *path, uint32_t rec_cnt)
+{
+	lustre_ring_hdr_t *ring, hdr;
+	size_t size = LUSTRE_RING_SIZE(rec_cnt);
+	bool reuse;
+	int fd;
+
+	/* no O_TRUNC, readers keep the file mapped */
+	if ((fd = open(path, O_RDWR | O_CREAT, 0644)) < 0) {
+		perror(path);
+		return NULL;
+	}
+	reuse = (read(fd, &hdr, sizeof(hdr)) == sizeof(hdr)) &&
+		(hdr.magic == LUSTRE_RING_MAGIC) &&
+		(hdr.version == LUSTRE_RING_VERSION) &&
+		(hdr.rec_cnt == rec_cnt);
+	if (ftruncate(fd, size) < 0) {
+		perror(path);
+		close(fd);
+		return NULL;
+	}
+	ring = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ring == MAP_FAILED) {
+		perror(path);
+		return NULL;
+	}
+	if (!reuse) {
+		memset(ring, 0, size);
+		ring->magic = LUSTRE_RING_MAGIC;
+		ring->version = LUSTRE_RING_VERSION;
+		ring->rec_cnt = rec_cnt;
+	}
+	return ring;
+}
+
+/* appends rec as the next record, see lustre_ring.h */
+static void _append(lustre_ring_hdr_t *ring, lustre_ring_rec_t *rec)
+{
+	lustre_ring_rec_t *recs = (lustre_ring_rec_t *) (ring + 1);
+	uint64_t seq = ring->seq + 1;
+	lustre_ring_rec_t *slot = &recs[(seq - 1) % ring->rec_cnt];
+
+	__atomic_store_n(&slot->seq, 0, __ATOMIC_RELEASE);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	slot->time = rec->time;
+	slot->write_samples = rec->write_samples;
+	slot->read_samples = rec->read_samples;
+	slot->write_bytes = rec->write_bytes;
+	slot->read_bytes = rec->read_bytes;
+	__atomic_store_n(&slot->seq, seq, __ATOMIC_RELEASE);
+	__atomic_store_n(&ring->seq, seq, __ATOMIC_RELEASE);
+}
+
+int main(int argc, char **argv)
+{
+	lustre_ring_hdr_t *ring;
+	lustre_ring_rec_t rec;
+	uint32_t rec_cnt = 64;
+	uint64_t read_bytes = 0, write_bytes = 0;
+	char *llite_dir = NULL;
+	long interval = 1000, count = 0, i;
+	int opt, zero = 0;
+
+	while ((opt = getopt(argc, argv, "n:i:c:r:w:l:z")) != -1) {
+		switch (opt) {
+		case 'n':
+			rec_cnt = strtoul(optarg, NULL, 10);
+			break;
+		case 'i':
+			interval = atol(optarg);
+			break;
+		case 'c':
+			count = atol(optarg);
+			break;
+		case 'r':
+			read_bytes = strtoull(optarg, NULL, 10);
+			break;
+		case 'w':
+			write_bytes = strtoull(optarg, NULL, 10);
+			break;
+		case 'l':
+			llite_dir = optarg;
+			break;
+		case 'z':
+			zero = 1;
+			break;
+		default:
+			_usage();
+		}
+	}
+	if ((optind != argc - 1) || !rec_cnt || (interval < 0) || (count < 0))
+		_usage();
+
+	if (!(ring = _open_ring(argv[optind], rec_cnt)))
+		return 1;
+
+	memset(&rec, 0, sizeof(rec));
+	if (ring->seq && !zero)
+		memcpy(&rec, (lustre_ring_rec_t *) (ring + 1) +
+		       (ring->seq - 1) % rec_cnt, sizeof(rec));
+
+	for (i = 0; !count || (i < count); i++) {
+		if (i)
+			usleep(interval * 1000);
+		if (llite_dir) {
+			if (_read_llite(llite_dir, &rec) < 0)
+				return 1;
+		} else {
+			if (read_bytes) {
+				rec.read_samples++;
+				rec.read_bytes += read_bytes;
+			}
+			if (write_bytes) {
+				rec.write_samples++;
+				rec.write_bytes += write_bytes;
+			}
+		}
+		rec.time = time(NULL);
+		_append(ring, &rec);
+	}
+
+	munmap(ring, LUSTRE_RING_SIZE(rec_cnt));
+	return 0;
+}
@@ -2053,7 +2053,7 @@ static void *_start_stage_out(void *x)
 		} else {
 			job_ptr->job_state &= (~JOB_STAGE_OUT);
 			xfree(job_ptr->state_desc);
-			last_job_update = time(NULL);
+			job_updated(job_ptr, time(NULL));
 		}
 		slurm_mutex_lock(&bb_state.bb_mutex);
 		bb_job = _get_bb_job(job_ptr);
@@ -4150,7 +4150,7 @@ fini:
 /* Kill job from CONFIGURING state */
 static void _kill_job(job_record_t *job_ptr, bool hold_job)
 {
-	last_job_update = time(NULL);
+	job_updated(job_ptr, time(NULL));
 	job_ptr->end_time = last_job_update;
 	if (hold_job)
 		job_ptr->priority = 0;
@@ -0,0 +1,58 @@
+#!/bin/sh
+#
+# Benchmarks job_submit/lustre_util against a slow, a flapping, a dead and
+# a hung middleman, see mock_middleman.c and lustre_util_bench.c.
+#
+# Usage: bench_middleman.sh [<directory with the built programs>]
+#
+# JOBS, THREADS, PORT and the VINSNL_* variables of the plugin can be
+# set in the environment.
+
+BIN=${1:-.}
+JOBS=${JOBS:-2000}
+THREADS=${THREADS:-32}
+PORT=${PORT:-19999}
+export VINSNL_SERVER=${VINSNL_SERVER:-127.0.0.1:$PORT}
+export VINSNL_TIMEOUT=${VINSNL_TIMEOUT:-1000}
+
+if [ ! -x "$BIN/mock_middleman" ] || [ ! -x "$BIN/lustre_util_bench" ]; then
+	echo "mock_middleman and lustre_util_bench not found in $BIN" >&2
+	exit 1
+fi
+
+# run <title> <lustre_util_bench options> -- <mock_middleman options>
+# without "--" no middleman is started
+run()
+{
+	title=$1
+	shift
+	bench_opts=
+	while [ $# -gt 0 ] && [ "$1" != "--" ]; do
+		bench_opts="$bench_opts $1"
+		shift
+	done
+	echo "=== $title"
+	mock_pid=
+	if [ "$1" = "--" ]; then
+		shift
+		"$BIN/mock_middleman" -p "$PORT" "$@" >/dev/null 2>&1 &
+		mock_pid=$!
+		sleep 1
+	fi
+	"$BIN/lustre_util_bench" -n "$JOBS" -c "$THREADS" $bench_opts
+	if [ -n "$mock_pid" ]; then
+		kill "$mock_pid"
+		wait "$mock_pid" 2>/dev/null
+	fi
+	echo
+}
+
+run "fast: 5-10 ms per request" \
+	-- -l 5 -j 5
+run "slow: 200-500 ms per request, 2% errors" \
+	-- -l 200 -j 300 -e 2
+run "flapping: 2 s up, 2 s down, 1% dropped connections, 500 submits/s" \
+	-r 500 -- -l 5 -j 5 -f 2:2 -d 1
+run "dead: nothing listening"
+run "hung: accepts, never answers" \
+	-n $((THREADS * 2)) -- -H
@@ -1,92 +1,386 @@
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <netdb.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
-#include <netdb.h>
+#include <slurm/slurm_errno.h>
 #include "cJSON.h"
 
+#include "src/common/log.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
 #include "client.h"
 
-#define MAX 1024
-//#define SA struct sockaddr
 #define ID_LEN 32
+#define READ_CHUNK 4096
 
+struct client_conn_struct {
+  int fd;
+  int timeout_ms;
+  unsigned int count;   /* last req_id sent */
+  char *buf;            /* received but not yet parsed data */
+  size_t len;           /* bytes in buf */
+  size_t size;          /* allocated size of buf, less the trailing '\0' */
+};
 
 
-cJSON *
-send_receive(int sockfd, cJSON *req)
+
+/* deadline timeout_ms from now */
+static void _set_deadline(struct timeval *deadline, int timeout_ms)
+{
+  gettimeofday(deadline, NULL);
+  deadline->tv_sec += timeout_ms / 1000;
+  deadline->tv_usec += (timeout_ms % 1000) * 1000;
+  if (deadline->tv_usec >= 1000000) {
+    deadline->tv_sec++;
+    deadline->tv_usec -= 1000000;
+  }
+}
+
+
+
+/* milliseconds left until deadline, 0 if passed */
+static int _time_left(struct timeval *deadline)
+{
+  struct timeval now;
+  long ms;
+
+  gettimeofday(&now, NULL);
+  ms = (deadline->tv_sec - now.tv_sec) * 1000 +
+       (deadline->tv_usec - now.tv_usec) / 1000;
+  return ms > 0 ? ms : 0;
+}
+
+
+
+/*
+ * wait until the socket is ready for events or the deadline passes
+ * returns SLURM_SUCCESS, ETIMEDOUT or SLURM_ERROR
+ */
+static int _wait_for(int fd, short events, struct timeval *deadline)
+{
+  struct pollfd pfd = { .fd = fd, .events = events };
+  int rc;
+
+  while (1) {
+    rc = poll(&pfd, 1, _time_left(deadline));
+    if (rc > 0) {
+      return SLURM_SUCCESS;
+    }
+    if (rc == 0) {
+      return ETIMEDOUT;
+    }
+    if (errno != EINTR) {
+      error("%s: poll: %m", __func__);
+      return SLURM_ERROR;
+    }
+  }
+}
+
+
+
+static int _write_all(client_conn_t *conn, const char *data, size_t len,
+                      struct timeval *deadline)
 {
-  static unsigned int count = 0;
-  static char req_id[ID_LEN+1];
-  static char buff[MAX+1];
-  cJSON *res = NULL;
-  count++;
+  ssize_t sent;
+  int rc;
+
+  while (len > 0) {
+    if ((rc = _wait_for(conn->fd, POLLOUT, deadline)) != SLURM_SUCCESS) {
+      if (rc == ETIMEDOUT) {
+        error("%s: timeout", __func__);
+      }
+      return SLURM_ERROR;
+    }
+    sent = send(conn->fd, data, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (sent < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
+        continue;
+      }
+      error("%s: send: %m", __func__);
+      return SLURM_ERROR;
+    }
+    data += sent;
+    len -= sent;
+  }
+  return SLURM_SUCCESS;
+}
+
+
+
+/*
+ * append whatever is available on the socket to the buffer
+ * returns SLURM_SUCCESS, ETIMEDOUT or SLURM_ERROR
+ */
+static int _read_some(client_conn_t *conn, struct timeval *deadline)
+{
+  ssize_t got;
+  int rc;
+
+  if (conn->size - conn->len < READ_CHUNK) {
+    if (conn->size >= CLIENT_MAX_MSG) {
+      error("%s: response is longer than %d bytes", __func__, CLIENT_MAX_MSG);
+      return SLURM_ERROR;
+    }
+    conn->size = conn->size ? conn->size * 2 : READ_CHUNK * 4;
+    xrealloc(conn->buf, conn->size + 1);
+  }
+
+  while (1) {
+    if ((rc = _wait_for(conn->fd, POLLIN, deadline)) != SLURM_SUCCESS) {
+      return rc;
+    }
+    got = recv(conn->fd, conn->buf + conn->len, conn->size - conn->len,
+               MSG_DONTWAIT);
+    if (got > 0) {
+      conn->len += got;
+      conn->buf[conn->len] = '\0';
+      return SLURM_SUCCESS;
+    }
+    if (got == 0) {
+      error("%s: connection closed by the server", __func__);
+      return SLURM_ERROR;
+    }
+    if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+      error("%s: recv: %m", __func__);
+      return SLURM_ERROR;
+    }
+  }
+}
+
+
+
+/* drop the first n bytes of the buffer */
+static void _consume(client_conn_t *conn, size_t n)
+{
+  memmove(conn->buf, conn->buf + n, conn->len - n);
+  conn->len -= n;
+  conn->buf[conn->len] = '\0';
+}
+
+
+
+/*
+ * Takes the next complete message out of the buffer.
+ * Returns NULL if more data is needed.
+ *
+ * Messages are normally newline-terminated, but a complete JSON object is
+ * accepted without the newline too. A line that can't be parsed is
+ * dropped without affecting the following ones.
+ */
+static cJSON *_next_message(client_conn_t *conn)
+{
+  const char *end = NULL;
+  char *newline;
+  cJSON *msg;
+  size_t skip;
+
+  while (conn->len) {
+    for (skip = 0; skip < conn->len && isspace(conn->buf[skip]); skip++)
+      ;
+    _consume(conn, skip);
+    if (!conn->len) {
+      break;
+    }
+
+    msg = cJSON_ParseWithOpts(conn->buf, &end, 0);
+    if (msg) {
+      _consume(conn, end - conn->buf);
+      return msg;
+    }
+
+    newline = memchr(conn->buf, '\n', conn->len);
+    if (!newline) {
+      /* incomplete message */
+      break;
+    }
+    *newline = '\0';
+    error("%s: can't parse message from the server: %s", __func__, conn->buf);
+    _consume(conn, newline - conn->buf + 1);
+  }
+  return NULL;
+}
+
+
+
+static int _recv(client_conn_t *conn, struct timeval *deadline, cJSON **msg)
+{
+  int rc;
+
+  while (!(*msg = _next_message(conn))) {
+    if ((rc = _read_some(conn, deadline)) != SLURM_SUCCESS) {
+      return rc;
+    }
+  }
+  return SLURM_SUCCESS;
+}
+
+
+
+int client_send(client_conn_t *conn, cJSON *req, unsigned int *req_id)
+{
+  char id_str[ID_LEN+1];
+  struct timeval deadline;
+  char *req_str = NULL, *line;
+  int rc = SLURM_ERROR;
+
+  if (conn == NULL) {
+    error("%s: not connected", __func__);
+    return SLURM_ERROR;
+  }
   if (req == NULL) {
-    fprintf(stderr, "Error: empty request JSON\n");
-    //TODO: process error
-    goto Cleanup01;
+    error("%s: empty request JSON", __func__);
+    return SLURM_ERROR;
+  }
+  conn->count++;
+  if (conn->count == 0) {
+    /* 0 means "no id" */
+    conn->count++;
   }
-  snprintf(req_id, ID_LEN, "%d", count);
-  if (cJSON_AddStringToObject(req, "req_id", req_id) == NULL) {
-    fprintf(stderr, "Error adding req_id\n");
-    //TODO: process error
-    goto Cleanup01;
+  snprintf(id_str, ID_LEN, "%u", conn->count);
+  cJSON_DeleteItemFromObject(req, "req_id");
+  if (cJSON_AddStringToObject(req, "req_id", id_str) == NULL) {
+    error("%s: error adding req_id", __func__);
+    return SLURM_ERROR;
   }
-  char *req_str = cJSON_PrintUnformatted(req);
+  req_str = cJSON_PrintUnformatted(req);
   if (req_str == NULL) {
-    fprintf(stderr, "Failed to print JSON.\n");
-    //TODO: process error
-    goto Cleanup01;
+    error("%s: failed to print JSON", __func__);
+    return SLURM_ERROR;
   }
 
-  write(sockfd, req_str, strlen(req_str));
+  /* a single write: a separate one for the newline would wait for the
+   * server's delayed ACK (Nagle), ~40 ms per request */
+  line = xstrdup_printf("%s\n", req_str);
   free(req_str);
+  _set_deadline(&deadline, conn->timeout_ms);
+  if (_write_all(conn, line, strlen(line), &deadline) == SLURM_SUCCESS) {
+    *req_id = conn->count;
+    rc = SLURM_SUCCESS;
+  }
+  xfree(line);
+  return rc;
+}
+
+
+
+int client_recv(client_conn_t *conn, int timeout_ms, cJSON **msg)
+{
+  struct timeval deadline;
+
+  *msg = NULL;
+  if (conn == NULL) {
+    error("%s: not connected", __func__);
+    return SLURM_ERROR;
+  }
+  _set_deadline(&deadline, timeout_ms);
+  return _recv(conn, &deadline, msg);
+}
+
+
+
+unsigned int client_msg_id(cJSON *msg)
+{
+  cJSON *id = cJSON_GetObjectItem(msg, "req_id");
+
+  if (!cJSON_IsString(id) || id->valuestring == NULL) {
+    return 0;
+  }
+  return strtoul(id->valuestring, NULL, 10);
+}
+
+
 
+cJSON *
+send_receive(client_conn_t *conn, cJSON *req)
+{
+  struct timeval deadline;
+  unsigned int req_id, resp_id;
+  cJSON *resp;
+  int rc;
+
+  if (client_send(conn, req, &req_id) != SLURM_SUCCESS) {
+    return NULL;
+  }
+
+  _set_deadline(&deadline, conn->timeout_ms);
   for (;;) {
-    bzero(buff, sizeof(buff));
-    read(sockfd, buff, MAX);
-    printf("From Server : %s\n", buff);
-    cJSON *resp = cJSON_Parse(buff);
-    if (resp == NULL) {
-      const char *error_ptr = cJSON_GetErrorPtr();
-      if (error_ptr != NULL) {
-        fprintf(stderr, "Error before: %s\n", error_ptr);
-      } else {
-        fprintf(stderr, "Error parsing\n");
+    if ((rc = _recv(conn, &deadline, &resp)) != SLURM_SUCCESS) {
+      if (rc == ETIMEDOUT) {
+        error("%s: timeout waiting for response %u", __func__, req_id);
       }
-      break;
+      return NULL;
     }
-    cJSON* id = cJSON_GetObjectItem(resp, "req_id");
-    if (id == NULL || !cJSON_IsString(id) || id->valuestring == NULL) {
-      fprintf(stderr, "Error: no id\n");
-      cJSON_Delete(resp);
-      break;
+    resp_id = client_msg_id(resp);
+    if (resp_id == req_id) {
+      return resp;
     }
-    if (strcmp(id->valuestring, req_id) != 0) {
-      fprintf(stderr, "Error: wrong id: sent \"%s\" got \"%s\"\n", req_id, id->valuestring);
-      int resp_id = atoi(id->valuestring);
-      cJSON_Delete(resp);
-      if(resp_id && resp_id < count) {
-        continue;
-      }
-      break;
+    cJSON_Delete(resp);
+    if (resp_id && resp_id < req_id) {
+      /* late response to an earlier (timed out) request */
+      debug3("%s: ignoring stale response %u", __func__, resp_id);
+      continue;
+    }
+    if (!resp_id) {
+      error("%s: no id in response", __func__);
+    } else {
+      error("%s: wrong id: sent \"%u\" got \"%u\"", __func__, req_id, resp_id);
     }
-    res = resp;
-    break;
+    return NULL;
   }
+}
+
 
-Cleanup01:
 
-  return res;
+const char *
+get_response_status(cJSON *resp)
+{
+  cJSON *status = cJSON_GetObjectItem(resp, "status");
+  if (!cJSON_IsString(status)) {
+    return NULL;
+  }
+  return status->valuestring;
 }
 
 
 
-int connect_to_simple_server(const char *addr, const char *port) {
+/* connect() with a timeout */
+static int _connect_timeout(int sockfd, struct addrinfo *addr, int timeout_ms)
+{
+  struct timeval deadline;
+  int flags, err = 0;
+  socklen_t err_len = sizeof(err);
+
+  flags = fcntl(sockfd, F_GETFL);
+  fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
+  if (connect(sockfd, addr->ai_addr, addr->ai_addrlen) != 0) {
+    if (errno != EINPROGRESS) {
+      return SLURM_ERROR;
+    }
+    _set_deadline(&deadline, timeout_ms);
+    if (_wait_for(sockfd, POLLOUT, &deadline) != SLURM_SUCCESS ||
+        getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &err, &err_len) != 0 ||
+        err != 0) {
+      return SLURM_ERROR;
+    }
+  }
+  fcntl(sockfd, F_SETFL, flags);
+  return SLURM_SUCCESS;
+}
+
+
+
+client_conn_t *client_connect(const char *addr, const char *port,
+                              int timeout_ms) {
   int sockfd = -1;
   // resolve address
   struct addrinfo hint = { 0 };
@@ -98,41 +392,38 @@ int connect_to_simple_server(const char *addr, const char *port) {
   struct addrinfo *addrs = NULL;
   int ret = getaddrinfo(addr, port, &hint, &addrs);
   if (ret != 0) {
-    printf("Could not resolve address\n");
-    return -1;
+    error("%s: could not resolve address %s", __func__, addr);
+    return NULL;
 // <------
   }
 
   // check resolved addresses by connecting until success
   for (struct addrinfo *addr = addrs; addr != NULL; addr = addr->ai_next) {
     // log ip address
-    char *s = NULL;
+    char s[INET6_ADDRSTRLEN] = "?";
     struct sockaddr *res = addr->ai_addr;
     switch (res->sa_family) {
       case AF_INET: {
         struct sockaddr_in *addr_in = (struct sockaddr_in*) res;
-        s = (char*) malloc(INET_ADDRSTRLEN);
         inet_ntop(AF_INET, &(addr_in->sin_addr), s, INET_ADDRSTRLEN);
         break;
       }
       case AF_INET6: {
         struct sockaddr_in6 *addr_in6 = (struct sockaddr_in6*) res;
-        s = (char*) malloc(INET6_ADDRSTRLEN);
         inet_ntop(AF_INET6, &(addr_in6->sin6_addr), s, INET6_ADDRSTRLEN);
         break;
       }
       default:
         break;
     }
-    printf("IP address: %s\n", s);
-    free(s);
+    debug3("%s: IP address: %s", __func__, s);
 
     // create socket
     sockfd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
     if (sockfd == -1) {
-      printf("Could not create socket\n");
+      error("%s: could not create socket: %m", __func__);
     } else {
-      if (connect(sockfd, addr->ai_addr, addr->ai_addrlen) == 0) {
+      if (_connect_timeout(sockfd, addr, timeout_ms) == SLURM_SUCCESS) {
         // connected
         break;
       } else {
@@ -141,12 +432,30 @@ int connect_to_simple_server(const char *addr, const char *port) {
       }
     }
     if (addr->ai_next == NULL) {
-      printf("connect error\n");
+      error("%s: could not connect to %s:%s", __func__, s, port);
     }
   }
 
   freeaddrinfo(addrs);
 
-  return sockfd;
+  if (sockfd < 0) {
+    return NULL;
+  }
+
+  client_conn_t *conn = xmalloc(sizeof(client_conn_t));
+  conn->fd = sockfd;
+  conn->timeout_ms = timeout_ms;
+  return conn;
+}
+
+
 
+void client_disconnect(client_conn_t *conn)
+{
+  if (!conn) {
+    return;
+  }
+  close(conn->fd);
+  xfree(conn->buf);
+  xfree(conn);
 }
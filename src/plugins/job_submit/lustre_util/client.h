@@ -12,20 +12,80 @@
 
 
 /**
- * Sends a JSON request to socket sockfd and block until gets response.
+ * Connection to a simple server.
+ *
+ * Messages are newline-terminated JSON objects. Incoming data is
+ * reassembled in a growable per-connection buffer, so responses can be
+ * of any length (up to CLIENT_MAX_MSG) and split across reads.
+ *
+ * A connection has no shared state with other connections, but must not
+ * be used by several threads at the same time.
+ */
+typedef struct client_conn_struct client_conn_t;
+
+/* Largest response accepted (bytes) */
+#define CLIENT_MAX_MSG (16 * 1024 * 1024)
+
+
+/**
+ * Connects to the given address and port.
+ * timeout_ms applies to connecting and to each send_receive.
+ *
+ * Returns the connection or NULL if error.
+ */
+client_conn_t *client_connect(const char *addr, const char *port,
+                              int timeout_ms);
+
+
+/**
+ * Closes the connection and frees its state (NULL is OK).
+ */
+void client_disconnect(client_conn_t *conn);
+
+
+/**
+ * Sends a JSON request to the connection and block until gets response.
  * Adds the field "req_id" to the request and checks that
  * the response from the socket contains the same request id.
  * Ignores responses with smaller request ids.
  *
- * Returns the response or NULL in case of an error.
+ * Returns the response or NULL in case of an error (including timeout);
+ * the connection should then be closed.
+ */
+cJSON * send_receive(client_conn_t *conn, cJSON *req);
+
+
+/**
+ * Sends a request without waiting for the response, so several requests
+ * can be outstanding on one connection.
+ * Sets the request's "req_id" to the next id of the connection and
+ * stores it in *req_id.
+ *
+ * Returns SLURM_SUCCESS or SLURM_ERROR (the connection should then be closed).
+ */
+int client_send(client_conn_t *conn, cJSON *req, unsigned int *req_id);
+
+
+/**
+ * Waits at most timeout_ms for the next message from the connection
+ * and stores it in *msg (the caller gets the ownership).
+ *
+ * Returns SLURM_SUCCESS, ETIMEDOUT if no complete message arrived in time
+ * (the connection is still usable) or SLURM_ERROR.
+ */
+int client_recv(client_conn_t *conn, int timeout_ms, cJSON **msg);
+
+
+/**
+ * Returns the request id of a message or 0 if it has none.
  */
-cJSON * send_receive(int sockfd, cJSON *req);
+unsigned int client_msg_id(cJSON *msg);
 
 
 /**
- * Connects to the given address and port and
- * returns socket id or -1 if error.
+ * Returns the "status" field of the response
+ * (still owned by the response) or NULL if there is none.
  */
-int connect_to_simple_server(const char *addr, const char *port);
+const char *get_response_status(cJSON *resp);
 
 #endif /* CLIENT_H_ */
@@ -0,0 +1,276 @@
+/*
+ * client_pool.c
+ *
+ * Pool of connections to the simple server shared by several threads.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <sys/time.h>
+#include <time.h>
+#include <slurm/slurm_errno.h>
+
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include "client.h"
+#include "client_pool.h"
+
+/* a request waiting for its response, lives on the requester's stack */
+typedef struct pending_struct {
+  struct pending_struct *next;
+  unsigned int req_id;
+  cJSON *resp;
+  bool done;            /* resp is set, or NULL if the request failed */
+} pending_t;
+
+typedef struct pool_slot_struct {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  client_conn_t *conn;  /* NULL if not connected */
+  bool reading;         /* a waiter reads from conn without holding mutex */
+  bool broken;          /* conn failed while being read; the reader drops it */
+  int outstanding;      /* requests sent and not yet answered */
+  pending_t *pending;
+} pool_slot_t;
+
+struct client_pool_struct {
+  char *addr;
+  char *port;
+  int timeout_ms;
+  int size;
+  unsigned int next;    /* round robin among equally busy connections */
+  pool_slot_t *slots;
+};
+
+
+
+/* milliseconds left until deadline, 0 if passed */
+static int _ms_left(struct timespec *deadline)
+{
+  struct timeval now;
+  long ms;
+
+  gettimeofday(&now, NULL);
+  ms = (deadline->tv_sec - now.tv_sec) * 1000 +
+       (deadline->tv_nsec / 1000 - now.tv_usec) / 1000;
+  return ms > 0 ? ms : 0;
+}
+
+
+
+client_pool_t *client_pool_create(const char *addr, const char *port,
+                                  int size, int timeout_ms)
+{
+  client_pool_t *pool = xmalloc(sizeof(client_pool_t));
+  int i;
+
+  if (size < 1) {
+    size = 1;
+  }
+  pool->addr = xstrdup(addr);
+  pool->port = xstrdup(port);
+  pool->timeout_ms = timeout_ms;
+  pool->size = size;
+  pool->slots = xcalloc(size, sizeof(pool_slot_t));
+  for (i = 0; i < size; i++) {
+    slurm_mutex_init(&pool->slots[i].mutex);
+    slurm_cond_init(&pool->slots[i].cond, NULL);
+  }
+  return pool;
+}
+
+
+
+void client_pool_destroy(client_pool_t *pool)
+{
+  int i;
+
+  if (!pool) {
+    return;
+  }
+  for (i = 0; i < pool->size; i++) {
+    client_disconnect(pool->slots[i].conn);
+    slurm_mutex_destroy(&pool->slots[i].mutex);
+    slurm_cond_destroy(&pool->slots[i].cond);
+  }
+  xfree(pool->slots);
+  xfree(pool->addr);
+  xfree(pool->port);
+  xfree(pool);
+}
+
+
+
+/* the connection with the fewest outstanding requests, connected preferred */
+static pool_slot_t *_pick_slot(client_pool_t *pool)
+{
+  pool_slot_t *best = NULL, *slot;
+  unsigned int start = __sync_fetch_and_add(&pool->next, 1);
+  int i, load, best_load = 0;
+
+  for (i = 0; i < pool->size; i++) {
+    slot = &pool->slots[(start + i) % pool->size];
+    /* racy read, it is only a hint */
+    load = slot->outstanding * 2 + (slot->conn ? 0 : 1);
+    if (!best || load < best_load) {
+      best = slot;
+      best_load = load;
+    }
+  }
+  return best;
+}
+
+
+
+/*
+ * Drops the slot's connection and fails all its pending requests.
+ * If another thread is reading from the connection, only marks it broken
+ * and leaves the rest to the reader.
+ *
+ * slot->mutex must be locked
+ */
+static void _slot_reset(pool_slot_t *slot)
+{
+  pending_t *p;
+
+  if (slot->reading) {
+    slot->broken = true;
+    return;
+  }
+  client_disconnect(slot->conn);
+  slot->conn = NULL;
+  slot->broken = false;
+  for (p = slot->pending; p; p = p->next) {
+    p->done = true;
+  }
+  slurm_cond_broadcast(&slot->cond);
+}
+
+
+
+/*
+ * Hands the response to the waiting requester.
+ *
+ * slot->mutex must be locked
+ */
+static void _dispatch(pool_slot_t *slot, cJSON *msg)
+{
+  unsigned int id = client_msg_id(msg);
+  pending_t *p;
+
+  for (p = slot->pending; p; p = p->next) {
+    if (!p->done && p->req_id == id) {
+      p->resp = msg;
+      p->done = true;
+      return;
+    }
+  }
+  /* the requester has given up already */
+  debug3("%s: ignoring response %u nobody waits for", __func__, id);
+  cJSON_Delete(msg);
+}
+
+
+
+/* slot->mutex must be locked */
+static void _remove_pending(pool_slot_t *slot, pending_t *pending)
+{
+  pending_t **p;
+
+  for (p = &slot->pending; *p; p = &(*p)->next) {
+    if (*p == pending) {
+      *p = pending->next;
+      slot->outstanding--;
+      return;
+    }
+  }
+}
+
+
+
+cJSON *client_pool_send_receive(client_pool_t *pool, cJSON *req)
+{
+  pool_slot_t *slot = _pick_slot(pool);
+  pending_t pending = { 0 };
+  struct timespec deadline;
+  struct timeval now;
+  client_conn_t *conn;
+  cJSON *msg;
+  int rc, ms;
+
+  gettimeofday(&now, NULL);
+  deadline.tv_sec = now.tv_sec + pool->timeout_ms / 1000;
+  deadline.tv_nsec = now.tv_usec * 1000 +
+                     (long) (pool->timeout_ms % 1000) * 1000000;
+  if (deadline.tv_nsec >= 1000000000) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000;
+  }
+
+  slurm_mutex_lock(&slot->mutex);
+  if (slot->broken) {
+    /* the reader will drop it shortly */
+    slurm_mutex_unlock(&slot->mutex);
+    return NULL;
+  }
+  if (!slot->conn) {
+    debug3("%s: connecting to host: %s, port: %s",
+           __func__, pool->addr, pool->port);
+    slot->conn = client_connect(pool->addr, pool->port, pool->timeout_ms);
+    if (!slot->conn) {
+      slurm_mutex_unlock(&slot->mutex);
+      return NULL;
+    }
+  }
+  if (client_send(slot->conn, req, &pending.req_id) != SLURM_SUCCESS) {
+    _slot_reset(slot);
+    slurm_mutex_unlock(&slot->mutex);
+    return NULL;
+  }
+  pending.next = slot->pending;
+  slot->pending = &pending;
+  slot->outstanding++;
+
+  while (!pending.done) {
+    if (slot->reading) {
+      /* somebody else is reading, it will hand over our response */
+      slurm_cond_timedwait(&slot->cond, &slot->mutex, &deadline);
+      if (!pending.done && !_ms_left(&deadline)) {
+        break;
+      }
+      continue;
+    }
+    if (!(ms = _ms_left(&deadline))) {
+      break;
+    }
+
+    /* take the reader role until our own response arrives */
+    slot->reading = true;
+    conn = slot->conn;
+    slurm_mutex_unlock(&slot->mutex);
+    rc = client_recv(conn, ms, &msg);
+    slurm_mutex_lock(&slot->mutex);
+    slot->reading = false;
+
+    if (rc == SLURM_SUCCESS) {
+      _dispatch(slot, msg);
+    }
+    if (rc == SLURM_ERROR || slot->broken) {
+      _slot_reset(slot);
+    }
+    /* wake the requester of msg and let another waiter read */
+    slurm_cond_broadcast(&slot->cond);
+  }
+
+  if (!pending.done) {
+    error("%s: timeout waiting for response %u", __func__, pending.req_id);
+  }
+  _remove_pending(slot, &pending);
+  slurm_mutex_unlock(&slot->mutex);
+
+  return pending.resp;
+}
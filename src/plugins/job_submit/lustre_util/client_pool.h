@@ -0,0 +1,49 @@
+/*
+ * client_pool.h
+ *
+ * Pool of connections to the simple server shared by several threads.
+ */
+
+#ifndef _SLURM_LUSTRE_UTIL_CLIENT_POOL_H
+#define _SLURM_LUSTRE_UTIL_CLIENT_POOL_H
+
+#include "cJSON.h"
+
+/**
+ * A fixed number of connections to one server, (re)connected on demand.
+ *
+ * Requests are pipelined: a thread sends its request on the least busy
+ * connection without waiting for the requests already outstanding on it.
+ * Whichever waiting thread currently holds the reader role takes the
+ * responses off the connection and hands each one to the thread waiting
+ * for its req_id, so a slow response delays nobody but its requester.
+ */
+typedef struct client_pool_struct client_pool_t;
+
+
+/**
+ * Creates a pool of size connections to addr:port (nothing is connected yet).
+ * timeout_ms applies to connecting and to each request.
+ */
+client_pool_t *client_pool_create(const char *addr, const char *port,
+                                  int size, int timeout_ms);
+
+
+/**
+ * Closes all connections and frees the pool (NULL is OK).
+ * No other thread may use the pool at this point.
+ */
+void client_pool_destroy(client_pool_t *pool);
+
+
+/**
+ * Sends the request on one of the connections and waits for its response.
+ * The caller keeps the ownership of the request ("req_id" is overwritten).
+ *
+ * Returns the response (the caller gets the ownership) or NULL in case of
+ * an error or timeout. A broken connection is dropped and reconnected
+ * by the next request.
+ */
+cJSON *client_pool_send_receive(client_pool_t *pool, cJSON *req);
+
+#endif  /* _SLURM_LUSTRE_UTIL_CLIENT_POOL_H */
@@ -35,15 +35,24 @@
 \*****************************************************************************/
 #include <pthread.h>
 #include <ctype.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <time.h>
 
 #include <slurm/slurm.h>
 #include <slurm/slurm_errno.h>
 
+#include "src/common/assoc_mgr.h"
+#include "src/common/slurm_accounting_storage.h"
+#include "src/common/xhash.h"
+#include "src/slurmctld/licenses.h"
+#include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/common/xstring.h"
 
 #include "remote_metrics.h"
 #include "client.h"
+#include "client_pool.h"
 
 
 /*
@@ -82,10 +91,377 @@ static pthread_mutex_t lustre_util_thread_flag_mutex = PTHREAD_MUTEX_INITIALIZER
 static const char *VARIETY_ID_ENV_NAME = "LDMS_VARIETY_ID";
 static const char *REMOTE_SERVER_ENV_NAME = "VINSNL_SERVER";
 static const char *REMOTE_SERVER_STRING = "127.0.0.1:9999";
-static int sockfd = -1;
+/* number of background workers resolving variety_id; 0 means synchronous */
+static const char *ASYNC_WORKERS_ENV_NAME = "VINSNL_ASYNC_WORKERS";
+/* how long (seconds) a job is held waiting for its estimate */
+static const char *ASYNC_HOLD_ENV_NAME = "VINSNL_ASYNC_HOLD";
+static const int ASYNC_HOLD_DEFAULT = 60;
+/* admin_comment prefix marking a job whose estimate is still being resolved */
+static const char PENDING_PREFIX[] = "variety_req=";
+/* admin_comment token with the predicted runtime, see sched/backfill */
+static const char PREDICTED_RUNTIME_PREFIX[] = "predicted_runtime=";
+/* how long (seconds) the server's answers are cached; 0 disables the cache */
+static const char *CACHE_TTL_ENV_NAME = "VINSNL_CACHE_TTL";
+/* maximum number of cached answers */
+static const char *CACHE_SIZE_ENV_NAME = "VINSNL_CACHE_SIZE";
+static const int CACHE_SIZE_DEFAULT = 4096;
+/* timeout (milliseconds) for connecting to and waiting for the server */
+static const char *TIMEOUT_ENV_NAME = "VINSNL_TIMEOUT";
+static const int TIMEOUT_DEFAULT = 5000;
+static int server_timeout = 0;
+/* number of connections shared by job_submit, the workers and the agent */
+static const char *POOL_SIZE_ENV_NAME = "VINSNL_POOL_SIZE";
+static const int POOL_SIZE_DEFAULT = 2;
+static client_pool_t *server_pool = NULL;
+/* metrics polled by the remote metrics agent: "metric[=license],..." */
+static const char *METRICS_ENV_NAME = "VINSNL_METRICS";
+static const char *METRICS_DEFAULT = "lustre";
+/* I/O load of node groups polled by the agent: "metric:nodes;..." */
+static const char *IO_GROUPS_ENV_NAME = "VINSNL_IO_GROUPS";
+/* how often (seconds) the remote metrics agent polls the server */
+static const char *POLL_INTERVAL_ENV_NAME = "VINSNL_POLL_INTERVAL";
+static const int POLL_INTERVAL_DEFAULT = 5;
+/* 1: have the server push metric updates (falls back to polling), 0: poll */
+static const char *SUBSCRIBE_ENV_NAME = "VINSNL_SUBSCRIBE";
+/* seconds between heartbeats the server sends on a quiet subscription */
+static const char *HEARTBEAT_ENV_NAME = "VINSNL_HEARTBEAT";
+static const int HEARTBEAT_DEFAULT = 10;
+/*
+ * cleared once the server answers "not implemented" to classify_and_estimate,
+ * accessed atomically: the async workers clear it while submits read it
+ */
+static bool combined_supported = true;
 static char *variety_id_server = NULL;
 static char *variety_id_port = NULL;
 
+/*
+ * Asynchronous mode.
+ *
+ * job_submit() only builds the variety_id request, tags the job
+ * admin_comment with "variety_req=<token>;" and delays the job's begin time
+ * by ASYNC_HOLD seconds (the provisional estimate is whatever the user asked
+ * for). job_created() trades the tag of the new job record for its job id.
+ * Worker threads talk to the server and the applier thread patches the
+ * pending jobs (comment, time limit, licenses, environment and begin time)
+ * in batches under a single job write lock. If the server doesn't answer in
+ * time, the job simply becomes eligible with the provisional estimate.
+ */
+typedef struct variety_work_struct {
+  char *token;
+  cJSON *request;       /* variety_id request, consumed by the worker */
+  char *cache_key;      /* NULL if the cache is disabled */
+  bool set_time_limit;  /* user didn't specify the time limit */
+  bool set_lustre;      /* user didn't request the lustre license */
+  time_t begin_time;    /* begin time requested by the user */
+  time_t deadline;      /* the hold expires at this time */
+  /* set by the worker */
+  char *variety_id;
+  uint32_t time_limit;  /* NO_VAL if not to be changed */
+  uint32_t lustre;      /* 0 if not to be changed */
+  uint32_t runtime;     /* predicted runtime (minutes), 0 if unknown */
+  char *profile;        /* lustre profile comment token or NULL */
+  /* set by the applier */
+  uint32_t job_id;      /* 0 until the job is created */
+  int applied;
+} variety_work_t;
+
+/* a job created with a variety_req tag, see job_created() */
+typedef struct variety_job_struct {
+  char *token;
+  uint32_t job_id;
+  time_t deadline;      /* forgotten at this time if no work matched it */
+} variety_job_t;
+
+static int async_workers = 0;
+static int async_hold = 0;
+static pthread_t *worker_threads = NULL;
+static pthread_t applier_thread = 0;
+static pthread_mutex_t work_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t resolved_cond = PTHREAD_COND_INITIALIZER;
+static List work_queue = NULL;     /* waiting for a worker */
+static List resolved_list = NULL;  /* waiting for the applier */
+static List created_list = NULL;   /* variety_job_t waiting for the applier */
+static bool stop_async = false;
+static time_t token_epoch = 0;
+static uint32_t token_count = 0;
+
+static void *_variety_worker(void *args);
+static void *_variety_applier(void *args);
+
+
+
+static void _free_work(void *x)
+{
+  variety_work_t *work = (variety_work_t *) x;
+  if (work) {
+    xfree(work->token);
+    xfree(work->cache_key);
+    if (work->request)
+      cJSON_Delete(work->request);
+    xfree(work->variety_id);
+    xfree(work->profile);
+    xfree(work);
+  }
+}
+
+static void _free_job(void *x)
+{
+  variety_job_t *job = (variety_job_t *) x;
+  if (job) {
+    xfree(job->token);
+    xfree(job);
+  }
+}
+
+
+
+static int _get_env_int(const char *name, int default_value)
+{
+  char *end_num, *str = getenv(name);
+  long value;
+
+  if (str == NULL)
+    return default_value;
+  value = strtol(str, &end_num, 10);
+  if (*end_num != '\0' || value < 0 || value > INT_MAX) {
+    error("job_submit_lustre_util: malformed %s: \"%s\", using %d",
+          name, str, default_value);
+    return default_value;
+  }
+  return (int) value;
+}
+
+
+
+/*
+ * Cache of the server's answers.
+ *
+ * Identical submissions (job arrays, parameter sweeps) produce identical
+ * variety_id requests, so the answer is cached keyed on a hash of the
+ * request (script, arguments, UID, node counts or the manual jobtype).
+ * Entries expire after CACHE_TTL seconds; when the cache is full the
+ * oldest entry is evicted. The hash table holds the entries and the list
+ * keeps them in insertion (and thus expiration) order.
+ */
+typedef struct cache_entry_struct {
+  char *key;
+  char *variety_id;
+  cJSON *utilization;
+  time_t expires;
+} cache_entry_t;
+
+static int cache_ttl = 0;
+static int cache_size = 0;
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static xhash_t *cache_table = NULL;
+static List cache_fifo = NULL;
+
+
+
+static void _cache_entry_id(void *item, const char **key, uint32_t *key_len)
+{
+  cache_entry_t *entry = (cache_entry_t *) item;
+  *key = entry->key;
+  *key_len = strlen(entry->key);
+}
+
+
+
+static void _free_cache_entry(void *x)
+{
+  cache_entry_t *entry = (cache_entry_t *) x;
+  if (entry) {
+    xfree(entry->key);
+    xfree(entry->variety_id);
+    if (entry->utilization)
+      cJSON_Delete(entry->utilization);
+    xfree(entry);
+  }
+}
+
+
+
+static void _start_cache(void)
+{
+  cache_ttl = _get_env_int(CACHE_TTL_ENV_NAME, 0);
+  cache_size = _get_env_int(CACHE_SIZE_ENV_NAME, CACHE_SIZE_DEFAULT);
+  if (cache_ttl == 0 || cache_size == 0) {
+    cache_ttl = 0;
+    return;
+  }
+  debug3("%s: ttl %d sec, size %d", __func__, cache_ttl, cache_size);
+
+  /* the table owns the entries, the list only orders them */
+  cache_table = xhash_init(_cache_entry_id, _free_cache_entry);
+  cache_fifo = list_create(NULL);
+}
+
+
+
+static void _stop_cache(void)
+{
+  slurm_mutex_lock(&cache_mutex);
+  FREE_NULL_LIST(cache_fifo);
+  xhash_free_ptr(&cache_table);
+  cache_ttl = 0;
+  slurm_mutex_unlock(&cache_mutex);
+}
+
+
+
+/*
+ * Returns the cache key of the variety_id request (caller must xfree)
+ * or NULL if the cache is disabled.
+ */
+static char *_cache_key(cJSON *request)
+{
+  uint64_t hash = 14695981039346656037ULL; /* FNV-1a */
+  char *str, *c;
+  size_t len;
+
+  if (!cache_ttl)
+    return NULL;
+  str = cJSON_PrintUnformatted(request);
+  if (!str)
+    return NULL;
+  for (c = str; *c; c++) {
+    hash ^= (unsigned char) *c;
+    hash *= 1099511628211ULL;
+  }
+  len = c - str;
+  free(str);
+  return xstrdup_printf("%016"PRIx64":%zu", hash, len);
+}
+
+
+
+/* Drop expired entries and, if full, the oldest one. Caller holds cache_mutex */
+static void _cache_purge(time_t now, bool make_room)
+{
+  cache_entry_t *entry;
+
+  while ((entry = list_peek(cache_fifo))) {
+    if (entry->expires > now &&
+        !(make_room && xhash_count(cache_table) >= cache_size))
+      break;
+    list_pop(cache_fifo);
+    xhash_delete_str(cache_table, entry->key);
+  }
+}
+
+
+
+/*
+ * Looks up the cached answer for key.
+ * On hit, sets *variety_id and *utilization (caller gets the ownership)
+ * and returns true.
+ */
+static bool _cache_lookup(char *key, char **variety_id, cJSON **utilization)
+{
+  cache_entry_t *entry;
+  bool hit = false;
+
+  if (!key)
+    return false;
+
+  slurm_mutex_lock(&cache_mutex);
+  if (cache_table) {
+    _cache_purge(time(NULL), false);
+    entry = xhash_get_str(cache_table, key);
+    if (entry) {
+      *variety_id = xstrdup(entry->variety_id);
+      *utilization = cJSON_Duplicate(entry->utilization, true);
+      slurmctld_diag_stats.lustre_util_cache_hits++;
+      hit = true;
+    } else {
+      slurmctld_diag_stats.lustre_util_cache_misses++;
+    }
+    slurmctld_diag_stats.lustre_util_cache_size = xhash_count(cache_table);
+  }
+  slurm_mutex_unlock(&cache_mutex);
+
+  if (hit)
+    debug3("%s: cache hit for %s: variety_id %s", __func__, key, *variety_id);
+  return hit;
+}
+
+
+
+/* Stores the answer for key, the caller keeps the ownership of the arguments */
+static void _cache_store(char *key, char *variety_id, cJSON *utilization)
+{
+  cache_entry_t *entry;
+  time_t now = time(NULL);
+
+  if (!key || !variety_id || !utilization)
+    return;
+
+  slurm_mutex_lock(&cache_mutex);
+  if (cache_table && !xhash_get_str(cache_table, key)) {
+    _cache_purge(now, true);
+    entry = xmalloc(sizeof(cache_entry_t));
+    entry->key = xstrdup(key);
+    entry->variety_id = xstrdup(variety_id);
+    entry->utilization = cJSON_Duplicate(utilization, true);
+    entry->expires = now + cache_ttl;
+    xhash_add(cache_table, entry);
+    list_append(cache_fifo, entry);
+    slurmctld_diag_stats.lustre_util_cache_size = xhash_count(cache_table);
+  }
+  slurm_mutex_unlock(&cache_mutex);
+}
+
+
+
+static void _start_async(void)
+{
+  int i;
+
+  async_workers = _get_env_int(ASYNC_WORKERS_ENV_NAME, 0);
+  async_hold = _get_env_int(ASYNC_HOLD_ENV_NAME, ASYNC_HOLD_DEFAULT);
+  if (async_workers == 0)
+    return;
+  debug3("%s: %d workers, hold %d sec", __func__, async_workers, async_hold);
+
+  token_epoch = time(NULL);
+  stop_async = false;
+  work_queue = list_create(_free_work);
+  resolved_list = list_create(_free_work);
+  created_list = list_create(_free_job);
+  worker_threads = xcalloc(async_workers, sizeof(pthread_t));
+  for (i = 0; i < async_workers; i++)
+    slurm_thread_create(&worker_threads[i], _variety_worker, NULL);
+  slurm_thread_create(&applier_thread, _variety_applier, NULL);
+}
+
+
+
+static void _stop_async(void)
+{
+  int i;
+
+  if (async_workers == 0)
+    return;
+
+  slurm_mutex_lock(&work_mutex);
+  stop_async = true;
+  slurm_cond_broadcast(&work_cond);
+  slurm_cond_broadcast(&resolved_cond);
+  slurm_mutex_unlock(&work_mutex);
+
+  for (i = 0; i < async_workers; i++)
+    pthread_join(worker_threads[i], NULL);
+  pthread_join(applier_thread, NULL);
+  applier_thread = 0;
+  xfree(worker_threads);
+  /* jobs still held will start with the provisional estimate */
+  FREE_NULL_LIST(work_queue);
+  FREE_NULL_LIST(resolved_list);
+  FREE_NULL_LIST(created_list);
+  async_workers = 0;
+}
+
 
 
 int init( void )
@@ -93,7 +469,7 @@ int init( void )
   debug2( "=========== Lustre utilization plugin starting ================" );
 
   /* initializing server address */
-  char *server_string = getenv(REMOTE_SERVER_ENV_NAME);
+  const char *server_string = getenv(REMOTE_SERVER_ENV_NAME);
   if (server_string == NULL) {
     debug3("%s: env %s isn't set, using default", __func__, REMOTE_SERVER_ENV_NAME);
     server_string = REMOTE_SERVER_STRING;
@@ -106,6 +482,10 @@ int init( void )
   variety_id_server = xstrndup(server_string, colon - server_string);
   variety_id_port = xstrdup(colon+1);
   debug3("%s: addr: %s, port: %s", __func__, variety_id_server, variety_id_port);
+  server_timeout = _get_env_int(TIMEOUT_ENV_NAME, TIMEOUT_DEFAULT);
+  if (server_timeout == 0) {
+    server_timeout = TIMEOUT_DEFAULT;
+  }
 
   slurm_mutex_lock( &lustre_util_thread_flag_mutex );
   if ( remote_metrics_thread ) {
@@ -114,13 +494,36 @@ int init( void )
     return SLURM_ERROR;
   }
 
+  server_pool = client_pool_create(variety_id_server, variety_id_port,
+                                   _get_env_int(POOL_SIZE_ENV_NAME,
+                                                POOL_SIZE_DEFAULT),
+                                   server_timeout);
+
   remote_metric_agent_arg_t *args = xmalloc(sizeof(remote_metric_agent_arg_t));
   args->addr = xstrdup(variety_id_server);
   args->port = xstrdup(variety_id_port);
+  args->pool = server_pool;
+  args->metrics = xstrdup(getenv(METRICS_ENV_NAME) ?
+                          getenv(METRICS_ENV_NAME) : METRICS_DEFAULT);
+  args->io_groups = xstrdup(getenv(IO_GROUPS_ENV_NAME));
+  args->poll_interval = _get_env_int(POLL_INTERVAL_ENV_NAME,
+                                     POLL_INTERVAL_DEFAULT);
+  if (args->poll_interval == 0) {
+    args->poll_interval = POLL_INTERVAL_DEFAULT;
+  }
+  args->timeout_ms = server_timeout;
+  args->subscribe = _get_env_int(SUBSCRIBE_ENV_NAME, 1);
+  args->heartbeat = _get_env_int(HEARTBEAT_ENV_NAME, HEARTBEAT_DEFAULT);
+  if (args->heartbeat == 0) {
+    args->heartbeat = HEARTBEAT_DEFAULT;
+  }
 
   /* since we do a join on this later we don't make it detached */
   slurm_thread_create(&remote_metrics_thread, remote_metrics_agent, (void *)args);
 
+  _start_cache();
+  _start_async();
+
   slurm_mutex_unlock( &lustre_util_thread_flag_mutex );
 
   return SLURM_SUCCESS;
@@ -131,12 +534,16 @@ int init( void )
 void fini( void )
 {
   slurm_mutex_lock( &lustre_util_thread_flag_mutex );
+  _stop_async();
+  _stop_cache();
   if ( remote_metrics_thread ) {
     verbose( "Lustre utilization plugin shutting down" );
     stop_remote_metrics_agent();
     pthread_join(remote_metrics_thread, NULL);
     remote_metrics_thread = 0;
   }
+  client_pool_destroy(server_pool);
+  server_pool = NULL;
   slurm_mutex_unlock( &lustre_util_thread_flag_mutex );
   debug2( "=========== Lustre utilization plugin finished ================" );
 }
@@ -199,6 +606,9 @@ static void _add_or_update_env_param(job_desc_msg_t *job_desc,
  * function consumes request
  *
  * caller gets the ownership of response
+ *
+ * can be called from several threads at once; the pool (re)connects
+ * as needed
  */
 static cJSON *_send_receive(cJSON* request)
 {
@@ -207,27 +617,14 @@ static cJSON *_send_receive(cJSON* request)
 RETRY:
   if (++tries > max_tries) {
     error("%s: tried %d times and gave up", __func__, max_tries);
+    cJSON_Delete(request);
     return NULL;
   }
 
-  // make sure we connected
-  if (sockfd <= 0) {
-    debug3("%s: connecting to host: %s, port: %s",
-        __func__, variety_id_server, variety_id_port);
-    sockfd = connect_to_simple_server(variety_id_server, variety_id_port);
-  }
-  if (sockfd <= 0) {
-    error("%s: could not connect to the server for job_submit",
-        __func__);
-    return NULL;
-  }
-
-  cJSON *resp = send_receive(sockfd, request);
+  cJSON *resp = client_pool_send_receive(server_pool, request);
   if (!resp) {
     error("%s: did not get expected response from the server for job_submit",
         __func__);
-    close(sockfd);
-    sockfd = -1;
     goto RETRY;
   }
   cJSON_Delete(request);
@@ -241,21 +638,26 @@ RETRY:
  */
 static bool _license_exist(char *licenses, const char *name)
 {
-  char *token, *last;
+  char *token, *last, *tmp;
+  bool found = false;
 
   if ((licenses == NULL) || (licenses[0] == '\0')) {
     return false;
   }
 
-  token = strtok_r(licenses, ",;", &last);
+  /* strtok_r modifies the string */
+  tmp = xstrdup(licenses);
+  token = strtok_r(tmp, ",;", &last);
   while (token) {
     if (xstrncmp(token, name, strlen(name)) == 0) {
-      return true;
+      found = true;
+      break;
     }
 
     token = strtok_r(NULL, ",;", &last);
   }
-  return false;
+  xfree(tmp);
+  return found;
 }
 
 
@@ -288,7 +690,12 @@ static bool _add_license_to_job_desc(job_desc_msg_t *job_desc,
 
 
 
-static char *_get_variety_id(job_desc_msg_t *job_desc, uint32_t uid)
+/**
+ * Builds the variety_id request for the job.
+ *
+ * caller gets the ownership of the request; returns NULL on malformed jobtype
+ */
+static cJSON *_build_variety_id_request(job_desc_msg_t *job_desc, uint32_t uid)
 {
   cJSON *request = cJSON_CreateObject();
   // get the comment field
@@ -302,9 +709,10 @@ static char *_get_variety_id(job_desc_msg_t *job_desc, uint32_t uid)
       // check if all characters are alphanumeric or '_'
       char *c;
       for(c = equalchar+1; c < semicolon; c++) {
-        if (!isalnum(c) && *c != '_') {
+        if (!isalnum(*c) && *c != '_') {
           // a wrong character in jobname
           error("_get_variety_id: wrong character in jobtype: '%c'", *c);
+          cJSON_Delete(request);
           return NULL;
         }
       }
@@ -314,9 +722,11 @@ static char *_get_variety_id(job_desc_msg_t *job_desc, uint32_t uid)
       // prepare request for jobtype option
       cJSON_AddStringToObject(request, "type", "variety_id/manual");
       cJSON_AddStringToObject(request, "variety_name", jobname);
+      xfree(jobname);
     } else {
       error("_get_variety_id: no semicolon after jobtype");
-          return NULL;
+      cJSON_Delete(request);
+      return NULL;
     }
   } else {
     // no job type specified
@@ -340,7 +750,8 @@ static char *_get_variety_id(job_desc_msg_t *job_desc, uint32_t uid)
 //        if(!n) error("environment %d is NULL", i);
 //        else debug3("environment %d is \"%s\"", i, n);
 //    }
-    cJSON *arg_array = cJSON_CreateStringArray(job_desc->argv, job_desc->argc);
+    cJSON *arg_array = cJSON_CreateStringArray(
+        (const char *const *) job_desc->argv, job_desc->argc);
     cJSON_AddItemToObject(request, "script_args", arg_array);
   }
   char buf[256];
@@ -355,6 +766,18 @@ static char *_get_variety_id(job_desc_msg_t *job_desc, uint32_t uid)
   cJSON_AddStringToObject(request, "UID", buf);
   /*AG TODO: add groupid */
 
+  return request;
+}
+
+
+
+/**
+ * function consumes request
+ *
+ * caller gets the ownership of the returned variety_id
+ */
+static char *_get_variety_id(cJSON *request)
+{
   cJSON * resp = _send_receive(request);
 
   if(resp == NULL){
@@ -378,6 +801,9 @@ static char *_get_variety_id(job_desc_msg_t *job_desc, uint32_t uid)
 
 
 
+/**
+ * caller gets the ownership of the returned utilization
+ */
 static cJSON *_get_job_usage(char *variety_id)
 {
   cJSON *request = cJSON_CreateObject();
@@ -391,7 +817,8 @@ static cJSON *_get_job_usage(char *variety_id)
     return NULL;
   }
 
-  cJSON *util = cJSON_GetObjectItem(resp, "response");
+  cJSON *util = cJSON_DetachItemFromObject(resp, "response");
+  cJSON_Delete(resp);
   if (util == NULL) {
     error("%s: bad response from server: no response field", __func__);
     return NULL;
@@ -402,90 +829,607 @@ static cJSON *_get_job_usage(char *variety_id)
 
 
 
+/**
+ * Gets both the variety_id and the utilization for the job described by
+ * the variety_id request: with a single "classify_and_estimate" round trip
+ * if the server supports it, otherwise with the two separate requests.
+ *
+ * function consumes request
+ *
+ * caller gets the ownership of the returned variety_id and *utilization;
+ * on error returns NULL and/or sets *utilization to NULL
+ */
+static char *_classify_and_estimate(cJSON *request, cJSON **utilization)
+{
+  char *variety_id = NULL;
+
+  *utilization = NULL;
+  if (__atomic_load_n(&combined_supported, __ATOMIC_RELAXED)) {
+    cJSON *type = cJSON_GetObjectItem(request, "type");
+    cJSON *combined = cJSON_Duplicate(request, true);
+    /* "variety_id/manual" -> "classify_and_estimate/manual" etc. */
+    char *new_type = xstrdup_printf("classify_and_estimate%s",
+        type->valuestring + strlen("variety_id"));
+    cJSON_ReplaceItemInObject(combined, "type", cJSON_CreateString(new_type));
+    xfree(new_type);
+
+    cJSON *resp = _send_receive(combined);
+    if (resp == NULL) {
+      error("%s: could not get response from variety_id server", __func__);
+      cJSON_Delete(request);
+      return NULL;
+    }
+    if (xstrcmp(get_response_status(resp), "not implemented") == 0) {
+      info("%s: server doesn't support classify_and_estimate, falling back to separate requests",
+           __func__);
+      __atomic_store_n(&combined_supported, false, __ATOMIC_RELAXED);
+      cJSON_Delete(resp);
+    } else {
+      cJSON_Delete(request);
+      cJSON *json_var_id = cJSON_GetObjectItem(resp, "variety_id");
+      if (cJSON_IsString(json_var_id)) {
+        variety_id = xstrdup(json_var_id->valuestring);
+        debug3("Variety id is '%s'", variety_id);
+        *utilization = cJSON_DetachItemFromObject(resp, "response");
+        if (*utilization == NULL)
+          error("%s: bad response from server: no response field",
+                __func__);
+      } else {
+        error("%s:  malformed response from variety_id server", __func__);
+      }
+      cJSON_Delete(resp);
+      return variety_id;
+    }
+  }
+
+  variety_id = _get_variety_id(request);
+  if (variety_id)
+    *utilization = _get_job_usage(variety_id);
+  return variety_id;
+}
+
+
+
+/**
+ * Reads a non-negative integer parameter of the utilization.
+ * Returns the value, or 0 if the parameter is missing, malformed or zero.
+ */
+static long _get_util_param(cJSON *utilization, const char *name,
+                            const char *variety_id)
+{
+  cJSON * json_object;
+  char *end_num;
+  long num;
+
+  json_object = cJSON_GetObjectItem(utilization, name);
+  if (!json_object) {
+    debug2("%s: didn't get %s from server for variety_id %s",
+        __func__, name, variety_id);
+    return 0;
+  }
+  if (!cJSON_IsString(json_object)) {
+    error("%s: malformed %s from server for variety_id %s",
+        __func__, name, variety_id);
+    return 0;
+  }
+  num = strtol(json_object->valuestring, &end_num, 10);
+  if (*end_num != '\0' || num < 0) {
+    error("%s: can't understand %s from server: %s",
+        __func__, name, json_object->valuestring);
+    return 0;
+  }
+  if (num == 0) {
+    debug3("%s: got zero %s from server for variety_id %s",
+      __func__, name, variety_id);
+  }
+  return num;
+}
+
+
+
+/**
+ * Reads the predicted runtime (minutes) of the job from the utilization:
+ * "runtime" if the server sends it, otherwise the "time_limit" estimate.
+ * Returns 0 if there is neither.
+ */
+static uint32_t _get_util_runtime(cJSON *utilization, const char *variety_id)
+{
+  long runtime = 0;
+
+  if (cJSON_GetObjectItem(utilization, "runtime"))
+    runtime = _get_util_param(utilization, "runtime", variety_id);
+  if (!runtime)
+    runtime = _get_util_param(utilization, "time_limit", variety_id);
+  return MIN(runtime, INFINITE - 1);
+}
+
+
+
+/**
+ * Reads the demand profile of a license from the utilization,
+ * "<name>_profile": [[<offset>, <count>], ...] with ascending offsets
+ * starting at 0, and formats it as a job admin_comment token.
+ * Returns "<name>_profile=<offset>:<count>,...;" (caller must xfree)
+ * or NULL if the profile is missing or malformed.
+ */
+static char *_get_util_profile(cJSON *utilization, const char *name,
+                               const char *variety_id)
+{
+  cJSON *profile, *phase, *offset, *count;
+  char *key, *token = NULL;
+  const char *sep = "";
+  double prev = -1;
+
+  key = xstrdup_printf("%s_profile", name);
+  profile = cJSON_GetObjectItem(utilization, key);
+  if (!profile) {
+    xfree(key);
+    return NULL;
+  }
+  if (!cJSON_IsArray(profile) || !cJSON_GetArraySize(profile))
+    goto bad;
+  xstrfmtcat(token, "%s=", key);
+  cJSON_ArrayForEach(phase, profile) {
+    if (!cJSON_IsArray(phase) || cJSON_GetArraySize(phase) != 2)
+      goto bad;
+    offset = cJSON_GetArrayItem(phase, 0);
+    count = cJSON_GetArrayItem(phase, 1);
+    if (!cJSON_IsNumber(offset) || !cJSON_IsNumber(count) ||
+        offset->valuedouble <= prev || count->valuedouble < 0 ||
+        (prev < 0 && offset->valuedouble != 0))
+      goto bad;
+    prev = offset->valuedouble;
+    xstrfmtcat(token, "%s%ld:%ld", sep,
+               (long) offset->valuedouble, (long) count->valuedouble);
+    sep = ",";
+  }
+  xstrcat(token, ";");
+  xfree(key);
+  return token;
+
+bad:
+  error("%s: malformed %s from server for variety_id %s",
+        __func__, key, variety_id);
+  xfree(token);
+  xfree(key);
+  return NULL;
+}
+
+
+
+static void *_variety_worker(void *args)
+{
+  variety_work_t *work;
+
+  while (1) {
+    slurm_mutex_lock(&work_mutex);
+    while (!stop_async && list_is_empty(work_queue))
+      slurm_cond_wait(&work_cond, &work_mutex);
+    if (stop_async) {
+      slurm_mutex_unlock(&work_mutex);
+      break;
+    }
+    work = list_dequeue(work_queue);
+    slurm_mutex_unlock(&work_mutex);
+
+    cJSON *request = work->request;
+    cJSON *utilization;
+    work->request = NULL;
+    work->variety_id = _classify_and_estimate(request, &utilization);
+    _cache_store(work->cache_key, work->variety_id, utilization);
+    if (work->variety_id) {
+      if (utilization) {
+        if (work->set_time_limit)
+          work->time_limit = _get_util_param(utilization, "time_limit",
+                                             work->variety_id);
+        if (!work->time_limit)
+          work->time_limit = NO_VAL;
+        work->runtime = _get_util_runtime(utilization, work->variety_id);
+        if (work->set_lustre)
+          work->lustre = _get_util_param(utilization, "lustre",
+                                         work->variety_id);
+        if (work->lustre)
+          work->profile = _get_util_profile(utilization, "lustre",
+                                            work->variety_id);
+        cJSON_Delete(utilization);
+      } else {
+        error("%s: no utilization for variety_id %s, using provisional estimate",
+              __func__, work->variety_id);
+      }
+    } else {
+      error("%s: no variety_id for request %s, using provisional estimate",
+            __func__, work->token);
+    }
+
+    slurm_mutex_lock(&work_mutex);
+    list_append(resolved_list, work);
+    slurm_cond_signal(&resolved_cond);
+    slurm_mutex_unlock(&work_mutex);
+  }
+
+  return NULL;
+}
+
+
+
+static int _find_job_token(void *x, void *key)
+{
+  variety_job_t *job = (variety_job_t *) x;
+  char *token = (char *) key;
+
+  return (xstrcmp(job->token, token) == 0);
+}
+
+
+
+static int _find_job_expired(void *x, void *key)
+{
+  variety_job_t *job = (variety_job_t *) x;
+  time_t now = *(time_t *) key;
+
+  return (job->deadline <= now);
+}
+
+
+
+/*
+ * Prepends a token for the schedulers to an admin_comment, which users
+ * can't set (slurmctld checks that before calling the job_submit plugins),
+ * unlike the comment.
+ */
+static void _prepend_admin_token(char **admin_comment, char *token)
+{
+  char *old = *admin_comment;
+
+  *admin_comment = xstrdup_printf("%s%s", token, old ? old : "");
+  xfree(old);
+}
+
+
+
+static int _find_work_done(void *x, void *key)
+{
+  variety_work_t *work = (variety_work_t *) x;
+  time_t now = *(time_t *) key;
+
+  return (work->applied || work->deadline <= now);
+}
+
+
+
+/*
+ * Patches the pending job with the resolved estimate.
+ *
+ * The job is modified directly rather than through update_job(), which
+ * calls back into the job_submit plugins (g_context_lock) and would
+ * deadlock with fini() joining the applier.
+ *
+ * Caller must hold the job write lock.
+ */
+static void _apply_work(variety_work_t *work, job_record_t *job_ptr)
+{
+  assoc_mgr_lock_t locks = { .tres = READ_LOCK };
+  struct job_details *details = job_ptr->details;
+  time_t now = time(NULL);
+  List license_list;
+  char *comment, *licenses, *token;
+  bool valid;
+
+  // comment and admin_comment
+  if (work->variety_id) {
+    comment = xstrdup_printf("variety_id=%s;%s", work->variety_id,
+                             job_ptr->comment ? job_ptr->comment : "");
+    xfree(job_ptr->comment);
+    job_ptr->comment = comment;
+    if (work->profile && work->lustre &&
+        !_license_exist(job_ptr->licenses, "lustre"))
+      _prepend_admin_token(&job_ptr->admin_comment, work->profile);
+    if (work->runtime) {
+      token = xstrdup_printf("%s%u;", PREDICTED_RUNTIME_PREFIX,
+                             work->runtime);
+      _prepend_admin_token(&job_ptr->admin_comment, token);
+      xfree(token);
+    }
+    token = xstrdup_printf("variety_id=%s;", work->variety_id);
+    _prepend_admin_token(&job_ptr->admin_comment, token);
+    xfree(token);
+  }
+
+  // time_limit
+  if (work->time_limit != NO_VAL) {
+    uint32_t time_limit = work->time_limit;
+    if (job_ptr->part_ptr && job_ptr->part_ptr->max_time != INFINITE &&
+        time_limit > job_ptr->part_ptr->max_time)
+      time_limit = job_ptr->part_ptr->max_time;
+    if (time_limit < job_ptr->time_min) {
+      debug2("%s: time_limit %u below time_min for %pJ",
+             __func__, time_limit, job_ptr);
+    } else {
+      job_ptr->time_limit = time_limit;
+    }
+  }
+
+  // lustre
+  if (work->lustre && !_license_exist(job_ptr->licenses, "lustre")) {
+    if (job_ptr->licenses && job_ptr->licenses[0])
+      licenses = xstrdup_printf("%s,lustre:%u",
+                                job_ptr->licenses, work->lustre);
+    else
+      licenses = xstrdup_printf("lustre:%u", work->lustre);
+    license_list = license_validate(licenses, true, true, NULL, &valid);
+    if (valid) {
+      FREE_NULL_LIST(job_ptr->license_list);
+      job_ptr->license_list = license_list;
+      xfree(job_ptr->licenses);
+      job_ptr->licenses = licenses;
+      assoc_mgr_lock(&locks);
+      license_set_job_tres_cnt(job_ptr->license_list,
+                               job_ptr->tres_req_cnt, true);
+      set_job_tres_req_str(job_ptr, true);
+      assoc_mgr_unlock(&locks);
+    } else {
+      error("%s: invalid licenses \"%s\" for %pJ",
+            __func__, licenses, job_ptr);
+      FREE_NULL_LIST(license_list);
+      xfree(licenses);
+    }
+  }
+
+  if (details) {
+    // the batch environment is already saved, use the supplemental one
+    if (work->variety_id) {
+      details->env_sup = xrealloc(details->env_sup,
+                                  (sizeof(char *) * (details->env_cnt + 1)));
+      xstrfmtcat(details->env_sup[details->env_cnt++], "%s=%s",
+                 VARIETY_ID_ENV_NAME, work->variety_id);
+    }
+    // release the hold
+    details->begin_time = MAX(work->begin_time, now);
+  }
+
+  job_updated(job_ptr, now);
+  jobacct_storage_job_start_direct(acct_db_conn, job_ptr);
+  debug3("%s: applied variety_id %s to %pJ",
+         __func__, work->variety_id, job_ptr);
+}
+
+
+
+/*
+ * Patches the jobs created for the resolved work, found by job id.
+ * RET number of jobs patched
+ */
+static int _apply_batch(List batch)
+{
+  /* Locks: Read config, write job, write node, read partition, read fed */
+  slurmctld_lock_t job_write_lock = {
+    READ_LOCK, WRITE_LOCK, WRITE_LOCK, READ_LOCK, READ_LOCK };
+  ListIterator iter;
+  job_record_t *job_ptr;
+  variety_work_t *work;
+  variety_job_t *job;
+  time_t now = time(NULL);
+  int created = 0, cnt = 0;
+
+  // the job records might not exist yet, the unmatched are retried
+  slurm_mutex_lock(&work_mutex);
+  iter = list_iterator_create(batch);
+  while ((work = list_next(iter))) {
+    if (!work->job_id &&
+        (job = list_remove_first(created_list, _find_job_token,
+                                 work->token))) {
+      work->job_id = job->job_id;
+      _free_job(job);
+    }
+    if (work->job_id)
+      created++;
+  }
+  list_iterator_destroy(iter);
+  list_delete_all(created_list, _find_job_expired, &now);
+  slurm_mutex_unlock(&work_mutex);
+  if (!created)
+    return 0;
+
+  /*
+   * fini() joins this thread and can be called with the locks held
+   * (job_submit_plugin_reconfig() from read_slurm_conf()), so don't wait
+   * for them past _stop_async(). The batch is dropped then anyway.
+   */
+  if (!lock_slurmctld_unless(job_write_lock, &stop_async))
+    return 0;
+  iter = list_iterator_create(batch);
+  while ((work = list_next(iter))) {
+    if (!work->job_id)
+      continue;
+    // done with it even if the job is gone or has started meanwhile
+    work->applied++;
+    job_ptr = find_job_record(work->job_id);
+    if (!job_ptr || !IS_JOB_PENDING(job_ptr))
+      continue;
+    _apply_work(work, job_ptr);
+    cnt++;
+  }
+  list_iterator_destroy(iter);
+  unlock_slurmctld(job_write_lock);
+
+  return cnt;
+}
+
+
+
+static void *_variety_applier(void *args)
+{
+  List batch = list_create(_free_work);
+  struct timespec ts = {0, 0};
+  time_t now;
+
+  while (1) {
+    slurm_mutex_lock(&work_mutex);
+    if (!stop_async && list_is_empty(resolved_list)) {
+      /* wake up periodically to retry jobs not created yet */
+      ts.tv_sec = time(NULL) + 1;
+      slurm_cond_timedwait(&resolved_cond, &work_mutex, &ts);
+    }
+    if (stop_async) {
+      slurm_mutex_unlock(&work_mutex);
+      break;
+    }
+    list_transfer(batch, resolved_list);
+    slurm_mutex_unlock(&work_mutex);
+
+    if (list_is_empty(batch))
+      continue;
+    if (_apply_batch(batch))
+      queue_job_scheduler();
+    now = time(NULL);
+    list_delete_all(batch, _find_work_done, &now);
+  }
+
+  FREE_NULL_LIST(batch);
+  return NULL;
+}
+
+
+
+/**
+ * Prepends "variety_id=<variety_id>;" to the comment of the job, and the
+ * same, the predicted runtime "predicted_runtime=<minutes>;" (if known) and
+ * the profile token (if any) to its admin_comment.
+ */
+static void _set_variety_comment(job_desc_msg_t *job_desc, char *variety_id,
+                                 uint32_t runtime, char *profile)
+{
+  char *comment = job_desc->comment;
+  char *token;
+
+  job_desc->comment = xstrdup_printf("variety_id=%s;%s", variety_id,
+                                     comment ? comment : "");
+  debug3("New comment is '%s'", job_desc->comment);
+  xfree(comment);
+  if (profile)
+    _prepend_admin_token(&job_desc->admin_comment, profile);
+  if (runtime) {
+    token = xstrdup_printf("%s%u;", PREDICTED_RUNTIME_PREFIX, runtime);
+    _prepend_admin_token(&job_desc->admin_comment, token);
+    xfree(token);
+  }
+  token = xstrdup_printf("variety_id=%s;", variety_id);
+  _prepend_admin_token(&job_desc->admin_comment, token);
+  xfree(token);
+}
+
+
+
+/**
+ * function consumes request and cache_key
+ */
+static int _job_submit_async(job_desc_msg_t *job_desc, cJSON *request,
+                             char *cache_key)
+{
+  time_t now = time(NULL);
+  variety_work_t *work = xmalloc(sizeof(variety_work_t));
+  work->request = request;
+  work->cache_key = cache_key;
+  work->set_time_limit = (job_desc->time_limit == NO_VAL);
+  work->set_lustre = !_license_exist(job_desc->licenses, "lustre");
+  work->begin_time = job_desc->begin_time;
+  work->deadline = now + async_hold;
+  work->time_limit = NO_VAL;
+
+  slurm_mutex_lock(&work_mutex);
+  work->token = xstrdup_printf("%ld.%u", (long) token_epoch, ++token_count);
+  slurm_mutex_unlock(&work_mutex);
+
+  // tag the job so that job_created() can tell the applier its id
+  char *token = xstrdup_printf("%s%s;", PENDING_PREFIX, work->token);
+  _prepend_admin_token(&job_desc->admin_comment, token);
+  xfree(token);
+
+  // hold the job until the estimate is applied (or the hold expires)
+  if (job_desc->begin_time < work->deadline)
+    job_desc->begin_time = work->deadline;
+
+  debug3("%s: queued variety_id request %s", __func__, work->token);
+
+  slurm_mutex_lock(&work_mutex);
+  list_enqueue(work_queue, work);
+  slurm_cond_signal(&work_cond);
+  slurm_mutex_unlock(&work_mutex);
+
+  return SLURM_SUCCESS;
+}
+
+
+
 extern int job_submit(job_desc_msg_t *job_desc, uint32_t submit_uid,
 		      char **err_msg)
 {
 	// NOTE: no job id actually exists yet (=NO_VAL)
 
-  // get variety_id
-  char *variety_id = _get_variety_id(job_desc, submit_uid);
+  // get variety_id and usage info from the cache or from remote
+  /*AG TODO: implement "if needed" check*/
+  cJSON *utilization = NULL;
+  char *variety_id = NULL;
+  cJSON *request = _build_variety_id_request(job_desc, submit_uid);
+  if (!request) {
+    *err_msg = xstrdup("Error getting variety id. Is the jobtype correct?");
+    return SLURM_ERROR;
+  }
+  char *key = _cache_key(request);
+  if (_cache_lookup(key, &variety_id, &utilization)) {
+    cJSON_Delete(request);
+  } else if (async_workers > 0) {
+    return _job_submit_async(job_desc, request, key);
+  } else {
+    variety_id = _classify_and_estimate(request, &utilization);
+    _cache_store(key, variety_id, utilization);
+  }
+  xfree(key);
   if (!variety_id) {
     *err_msg = xstrdup("Error getting variety id. Is the server on?");
     return SLURM_ERROR;
   }
 
-  // store the variety_id in the comment field
-  char *comment = job_desc->comment;
-  char *new_comment = xstrdup_printf("variety_id=%s;%s", variety_id, comment);
-  job_desc->comment = new_comment;
-  debug3("New comment is '%s'", job_desc->comment);
-  xfree(comment);
-
   // store variety_id so that compute notes can access it
   _add_or_update_env_param(job_desc, VARIETY_ID_ENV_NAME, variety_id);
 
-  // get usage info from remote (if needed)
-  /*AG TODO: implement "if needed" check*/
-  cJSON * utilization = _get_job_usage(variety_id);
   if (!utilization) {
+    _set_variety_comment(job_desc, variety_id, 0, NULL);
+    xfree(variety_id);
     *err_msg = xstrdup("Error getting job utilization. Is the server on?");
     return SLURM_ERROR;
   }
 
   //// set usage for the job
 
-  cJSON * json_object;
-  char *end_num;
-
   // time_limit
   if (job_desc->time_limit == NO_VAL) {
-    json_object = cJSON_GetObjectItem(utilization, "time_limit");
-    if (!json_object) {
-      debug2("%s: didn't get time_limit from server for variety_id %s",
-          __func__, variety_id);
-    } else if (!cJSON_IsString(json_object)) {
-      error("%s: malformed time_limit from server for variety_id %s",
-          __func__, variety_id);
-    } else {
-      long time_limit = strtol(json_object->valuestring, &end_num, 10);
-      if (*end_num != '\0' || time_limit < 0) {
-        error("%s: can't understand time_limit from server: %s",
-            __func__, json_object->valuestring);
-      } else if (time_limit == 0) {
-        debug3("%s: got zero time_limit from server for variety_id %s",
-          __func__, variety_id);
-      } else {
-        job_desc->time_limit = time_limit;
-      }
+    long time_limit = _get_util_param(utilization, "time_limit", variety_id);
+    if (time_limit > 0) {
+      job_desc->time_limit = time_limit;
     }
   }
 
   // lustre
+  char *profile = NULL;
   if (!_license_exist(job_desc->licenses, "lustre")) {
-    json_object = cJSON_GetObjectItem(utilization, "lustre");
-    if (!json_object) {
-      debug2("%s: didn't get lustre param from server for variety_id %s",
-          __func__, variety_id);
-    } else if (!cJSON_IsString(json_object)) {
-      error("%s: malformed lustre param from server for variety_id %s",
-          __func__, variety_id);
-    } else {
-      long num = strtol(json_object->valuestring, &end_num, 10);
-      if (*end_num != '\0' || num < 0) {
-        error("%s: can't understand lustre param from server: %s",
-            __func__, json_object->valuestring);
-      } else if (num == 0) {
-        debug3("%s: got zero lustre param from server for variety_id %s",
-          __func__, variety_id);
+    long num = _get_util_param(utilization, "lustre", variety_id);
+    if (num > 0) {
+      if (!_add_license_to_job_desc(job_desc, "lustre", num)) {
+        error("%s: can't update licenses: %s",
+          __func__, job_desc->licenses);
       } else {
-        if (!_add_license_to_job_desc(job_desc, "lustre", num)) {
-          error("%s: can't update licenses: %s",
-            __func__, job_desc->licenses);
-        }
+        profile = _get_util_profile(utilization, "lustre", variety_id);
       }
     }
   }
 
+  // store the variety_id (the predicted runtime and the lustre profile)
+  // in the comment field
+  _set_variety_comment(job_desc, variety_id,
+                       _get_util_runtime(utilization, variety_id), profile);
+  xfree(profile);
+
   cJSON_Delete(utilization);
 
   xfree(variety_id);
@@ -508,3 +1452,39 @@ int job_modify(job_desc_msg_t *job_desc, job_record_t *job_ptr,
 
 	return SLURM_SUCCESS;
 }
+
+
+
+/*
+ * Called by slurmctld with the job write lock held for every new job record.
+ * Records the id of the jobs tagged by _job_submit_async() for the applier
+ * and drops the tag.
+ */
+extern void job_created(job_record_t *job_ptr)
+{
+  const int prefix_len = sizeof(PENDING_PREFIX) - 1;
+  variety_job_t *job;
+  char *token, *semicolon, *rest;
+
+  if (xstrncmp(job_ptr->admin_comment, PENDING_PREFIX, prefix_len))
+    return;
+  token = job_ptr->admin_comment + prefix_len;
+  if (!(semicolon = xstrchr(token, ';')))
+    return;
+
+  job = xmalloc(sizeof(variety_job_t));
+  job->token = xstrndup(token, semicolon - token);
+  job->job_id = job_ptr->job_id;
+  job->deadline = time(NULL) + async_hold;
+  rest = semicolon[1] ? xstrdup(semicolon + 1) : NULL;
+  xfree(job_ptr->admin_comment);
+  job_ptr->admin_comment = rest;
+
+  slurm_mutex_lock(&work_mutex);
+  if (created_list) {
+    list_append(created_list, job);
+    slurm_cond_signal(&resolved_cond);
+  } else
+    _free_job(job);
+  slurm_mutex_unlock(&work_mutex);
+}
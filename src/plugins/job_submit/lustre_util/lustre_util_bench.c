@@ -0,0 +1,303 @@
+/*
+ * lustre_util_bench.c
+ *
+ * Load generator for job_submit/lustre_util.
+ *
+ * The plugin is built into this program and driven the way slurmctld
+ * drives it: init(), then job_submit() from several threads at once
+ * (slurmctld serves each RPC on its own thread), then fini(). Each call
+ * gets a fresh job description, so the middleman (VINSNL_SERVER, see
+ * protocol.md and mock_middleman.c) sees the same requests it would
+ * from real submissions. The plugin is configured with its usual
+ * VINSNL_* environment variables.
+ *
+ * The rest of slurmctld is stubbed out: there are no job records, so the
+ * asynchronous mode (VINSNL_ASYNC_WORKERS) only measures the submit path
+ * and the licenses updated by the remote metrics agent don't exist.
+ *
+ * Usage: lustre_util_bench [options]
+ *   -n <count>         job_submit() calls (default 1000)
+ *   -c <threads>       concurrent callers (default 16)
+ *   -k <count>         distinct jobs, e.g. to exercise the cache
+ *                      (default 0, all different)
+ *   -j <jobtype>       submit with "jobtype=<jobtype>;" in the comment
+ *   -r <rate>          submit at most <rate> jobs per second, so that the
+ *                      run spans a flapping middleman's cycles
+ *                      (default 0, as fast as the threads can)
+ *   -v                 more verbose logging (repeatable)
+ *
+ * Prints the throughput and the latency percentiles of job_submit(),
+ * separately for the failed calls.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/slurm_protocol_defs.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+#include "src/slurmctld/licenses.h"
+#include "src/slurmctld/locks.h"
+#include "src/slurmctld/slurmctld.h"
+
+/* the plugin's entry points */
+extern int init(void);
+extern void fini(void);
+extern int job_submit(job_desc_msg_t *job_desc, uint32_t submit_uid,
+                      char **err_msg);
+
+/* normally from slurmctld, just enough for the plugin */
+diag_stats_t slurmctld_diag_stats;
+void *acct_db_conn = NULL;
+List license_list = NULL;
+pthread_mutex_t license_mutex = PTHREAD_MUTEX_INITIALIZER;
+time_t last_license_update = 0;
+
+void lock_slurmctld(slurmctld_lock_t lock_levels) {}
+void unlock_slurmctld(slurmctld_lock_t lock_levels) {}
+bool lock_slurmctld_unless(slurmctld_lock_t lock_levels, const bool *stop)
+{
+  return true;
+}
+void queue_job_scheduler(void) {}
+job_record_t *find_job_record(uint32_t job_id) { return NULL; }
+void job_updated(job_record_t *job_ptr, time_t now) {}
+void set_job_tres_req_str(job_record_t *job_ptr, bool assoc_mgr_locked) {}
+void license_set_job_tres_cnt(List license_list, uint64_t *tres_cnt,
+                              bool locked) {}
+List license_validate(char *licenses, bool validate_configured,
+                      bool validate_existing, uint64_t *tres_req_cnt,
+                      bool *valid)
+{
+  *valid = false;
+  return NULL;
+}
+
+static int job_cnt = 1000;
+static int thread_cnt = 16;
+static int distinct = 0;
+static char *jobtype = NULL;
+static double rate = 0;
+
+static pthread_mutex_t next_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int next_job = 0;
+static double *latency = NULL;   /* ms, negative if the call failed */
+static double start_ms = 0;
+
+
+
+static double _now_ms(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1e3 + tv.tv_usec / 1e3;
+}
+
+
+
+static void _usage(void)
+{
+  fprintf(stderr, "Usage: lustre_util_bench [-n count] [-c threads] "
+          "[-k count] [-j jobtype] [-r rate] [-v]\n");
+  exit(1);
+}
+
+
+
+/* a job description like the ones sbatch sends */
+static job_desc_msg_t *_job_desc(int job)
+{
+  job_desc_msg_t *job_desc = xmalloc(sizeof(job_desc_msg_t));
+
+  slurm_init_job_desc_msg(job_desc);
+  job_desc->script = xstrdup_printf("#!/bin/sh\nsrun ./app %d\n", job);
+  job_desc->argc = 2;
+  job_desc->argv = xcalloc(3, sizeof(char *));
+  job_desc->argv[0] = xstrdup("job.sh");
+  job_desc->argv[1] = xstrdup_printf("input_%d", job);
+  job_desc->min_nodes = 1 + job % 4;
+  job_desc->max_nodes = job_desc->min_nodes;
+  job_desc->user_id = 1000 + job % 10;
+  job_desc->group_id = 1000;
+  if (jobtype)
+    job_desc->comment = xstrdup_printf("jobtype=%s;", jobtype);
+  job_desc->env_size = 1;
+  job_desc->environment = xcalloc(2, sizeof(char *));
+  job_desc->environment[0] = xstrdup("PATH=/bin:/usr/bin");
+  return job_desc;
+}
+
+
+
+/*
+ * slurm_free_job_desc_msg() would load the select plugin,
+ * free what _job_desc() and the plugin set
+ */
+static void _free_job_desc(job_desc_msg_t *job_desc)
+{
+  int i;
+
+  for (i = 0; i < job_desc->argc; i++)
+    xfree(job_desc->argv[i]);
+  xfree(job_desc->argv);
+  for (i = 0; i < job_desc->env_size; i++)
+    xfree(job_desc->environment[i]);
+  xfree(job_desc->environment);
+  xfree(job_desc->comment);
+  xfree(job_desc->admin_comment);
+  xfree(job_desc->licenses);
+  xfree(job_desc->script);
+  xfree(job_desc);
+}
+
+
+
+static void *_submitter(void *arg)
+{
+  job_desc_msg_t *job_desc;
+  char *err_msg;
+  double start, wait_ms;
+  int job, rc;
+
+  while (1) {
+    slurm_mutex_lock(&next_mutex);
+    job = next_job++;
+    slurm_mutex_unlock(&next_mutex);
+    if (job >= job_cnt)
+      break;
+    if (rate && (wait_ms = start_ms + job * 1e3 / rate - _now_ms()) > 0)
+      usleep(wait_ms * 1e3);
+
+    job_desc = _job_desc(distinct ? job % distinct : job);
+    err_msg = NULL;
+    start = _now_ms();
+    rc = job_submit(job_desc, job_desc->user_id, &err_msg);
+    latency[job] = _now_ms() - start;
+    if (rc != SLURM_SUCCESS) {
+      debug("job %d: %s", job, err_msg);
+      latency[job] = -latency[job];
+    }
+    xfree(err_msg);
+    _free_job_desc(job_desc);
+  }
+  return NULL;
+}
+
+
+
+static int _cmp_double(const void *a, const void *b)
+{
+  double x = *(const double *) a, y = *(const double *) b;
+
+  return (x > y) - (x < y);
+}
+
+
+
+/* prints the latency percentiles of the cnt sorted values */
+static void _percentiles(const char *what, double *values, int cnt)
+{
+  if (!cnt)
+    return;
+  printf("%-8s %8d %9.2f %9.2f %9.2f %9.2f %9.2f\n", what, cnt,
+         values[cnt / 2], values[(int) (cnt * 0.90)],
+         values[(int) (cnt * 0.99)], values[(int) (cnt * 0.999)],
+         values[cnt - 1]);
+}
+
+
+
+int main(int argc, char **argv)
+{
+  log_options_t log_opts = LOG_OPTS_STDERR_ONLY;
+  pthread_t *threads;
+  double elapsed, *ok, *failed;
+  int opt, i, ok_cnt = 0, failed_cnt = 0;
+
+  log_opts.stderr_level = LOG_LEVEL_QUIET;
+  while ((opt = getopt(argc, argv, "n:c:k:j:r:v")) != -1) {
+    switch (opt) {
+    case 'n':
+      job_cnt = atoi(optarg);
+      break;
+    case 'c':
+      thread_cnt = atoi(optarg);
+      break;
+    case 'k':
+      distinct = atoi(optarg);
+      break;
+    case 'j':
+      jobtype = optarg;
+      break;
+    case 'r':
+      rate = atof(optarg);
+      break;
+    case 'v':
+      if (log_opts.stderr_level == LOG_LEVEL_QUIET)
+        log_opts.stderr_level = LOG_LEVEL_ERROR;
+      else
+        log_opts.stderr_level++;
+      break;
+    default:
+      _usage();
+    }
+  }
+  if (optind != argc || job_cnt < 1 || thread_cnt < 1 || distinct < 0 ||
+      rate < 0)
+    _usage();
+  log_init("lustre_util_bench", log_opts, 0, NULL);
+
+  license_list = list_create(NULL);
+  latency = xcalloc(job_cnt, sizeof(double));
+  threads = xcalloc(thread_cnt, sizeof(pthread_t));
+
+  if (init() != SLURM_SUCCESS) {
+    fprintf(stderr, "lustre_util_bench: plugin init failed\n");
+    return 1;
+  }
+  start_ms = _now_ms();
+  for (i = 0; i < thread_cnt; i++)
+    slurm_thread_create(&threads[i], _submitter, NULL);
+  for (i = 0; i < thread_cnt; i++)
+    pthread_join(threads[i], NULL);
+  elapsed = _now_ms() - start_ms;
+  fini();
+
+  ok = xcalloc(job_cnt, sizeof(double));
+  failed = xcalloc(job_cnt, sizeof(double));
+  for (i = 0; i < job_cnt; i++) {
+    if (latency[i] >= 0)
+      ok[ok_cnt++] = latency[i];
+    else
+      failed[failed_cnt++] = -latency[i];
+  }
+  qsort(ok, ok_cnt, sizeof(double), _cmp_double);
+  qsort(failed, failed_cnt, sizeof(double), _cmp_double);
+
+  printf("%d jobs, %d threads: %.1f s, %.1f submits/s, %d failed\n",
+         job_cnt, thread_cnt, elapsed / 1e3, job_cnt / (elapsed / 1e3),
+         failed_cnt);
+  printf("%-8s %8s %9s %9s %9s %9s %9s\n", "ms", "calls",
+         "p50", "p90", "p99", "p99.9", "max");
+  _percentiles("ok", ok, ok_cnt);
+  _percentiles("failed", failed, failed_cnt);
+  printf("cache hits %u, misses %u\n",
+         slurmctld_diag_stats.lustre_util_cache_hits,
+         slurmctld_diag_stats.lustre_util_cache_misses);
+
+  xfree(ok);
+  xfree(failed);
+  xfree(latency);
+  xfree(threads);
+  FREE_NULL_LIST(license_list);
+  log_fini();
+  return 0;
+}
@@ -0,0 +1,773 @@
+/*
+ * mock_middleman.c
+ *
+ * Stand-in for the SLURM-LDMS middleman server (see protocol.md), for
+ * testing and benchmarking job_submit/lustre_util without LDMS.
+ *
+ * Answers every request type of the protocol with canned estimates after
+ * a configurable delay, can fail some of the requests, pad the responses
+ * and periodically stop listening altogether (a flapping server).
+ * A single thread serves all the connections; responses to pipelined
+ * requests are sent when their delay expires, so they may go out of order.
+ *
+ * Usage: mock_middleman [options]
+ *   -p <port>          port to listen on (default 9999)
+ *   -l <ms>            response delay (default 0)
+ *   -j <ms>            random extra delay, 0 to <ms> (default 0)
+ *   -e <percent>       answer "status": "error" (default 0)
+ *   -d <percent>       close the connection instead of answering (default 0)
+ *   -s <bytes>         pad each response with a string this long (default 0)
+ *   -f <up>:<down>     serve for <up> seconds, then refuse connections
+ *                      for <down> seconds, and so on
+ *   -H                 hang: accept and read requests, never answer
+ *   -c                 answer "not implemented" to classify_and_estimate
+ *   -S                 answer "not implemented" to subscribe
+ *   -B                 answer "not implemented" to process_jobs
+ *   -L <count>         "lustre" estimate of the jobs (default 10)
+ *   -T <minutes>       "time_limit" estimate of the jobs (default 60)
+ *   -R <minutes>       "runtime" prediction of the jobs (default 0, none)
+ *   -P <profile>       "lustre_profile" estimate, "<offset>:<count>,..."
+ *   -U <count>         remote "usage" of every metric (default 0)
+ *   -C <seconds>       redraw the usage between 0 and twice -U this often,
+ *                      pushing it to subscribers (default 0, never)
+ *   -v                 log every request
+ *
+ * On SIGINT or SIGTERM prints the number of requests of each type and of
+ * completed jobs reported (process_job and process_jobs, see jobcomp/ldms).
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+
+#include "src/common/log.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include "cJSON.h"
+
+#define MAX_CONNS 1024
+#define READ_CHUNK 4096
+
+typedef struct mock_conn_struct {
+  int fd;               /* -1 if the slot is free */
+  unsigned int gen;     /* tells a reused slot from the old connection */
+  char *in;
+  size_t in_len;
+  char *out;
+  size_t out_len;
+  size_t out_sent;
+  cJSON *subscribed;    /* metrics to push, NULL if not subscribed */
+  int heartbeat;        /* seconds */
+  int64_t last_push;    /* ms */
+} mock_conn_t;
+
+/* a response waiting for its delay to expire */
+typedef struct mock_reply_struct {
+  int64_t due;          /* ms */
+  int conn;
+  unsigned int gen;
+  char *msg;            /* NULL: drop the connection */
+} mock_reply_t;
+
+static int port = 9999;
+static int latency_ms = 0;
+static int jitter_ms = 0;
+static int error_pct = 0;
+static int drop_pct = 0;
+static int pad_bytes = 0;
+static int flap_up = 0, flap_down = 0;
+static bool hang = false;
+static bool no_combined = false;
+static bool no_subscribe = false;
+static bool no_batch = false;
+static int est_lustre = 10;
+static int est_time_limit = 60;
+static int est_runtime = 0;
+static cJSON *est_profile = NULL;
+static int usage_base = 0;
+static int usage_change = 0;
+static char *padding = NULL;
+
+static mock_conn_t conns[MAX_CONNS];
+static mock_reply_t *replies = NULL;
+static int reply_cnt = 0, reply_size = 0;
+static int listen_fd = -1;
+static int usage_value = 0;
+static volatile sig_atomic_t stop = 0;
+
+/* requests served, by type */
+static const char *type_names[] = {
+  "usage", "subscribe", "variety_id", "classify_and_estimate",
+  "job_utilization", "process_job", "process_jobs", "other", NULL
+};
+static int type_cnt[9];
+static int errors_sent = 0, drops = 0, accepted = 0, jobs_reported = 0;
+
+
+
+static int64_t _now_ms(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return (int64_t) tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+
+
+static void _usage(void)
+{
+  fprintf(stderr,
+          "Usage: mock_middleman [-p port] [-l ms] [-j ms] [-e percent] "
+          "[-d percent] [-s bytes]\n"
+          "                      [-f up:down] [-H] [-c] [-S] [-B] [-L count] "
+          "[-T minutes] [-R minutes] [-P profile]\n"
+          "                      [-U count] [-C seconds] [-v]\n");
+  exit(1);
+}
+
+
+
+static void _on_signal(int sig)
+{
+  stop = 1;
+}
+
+
+
+/* "<offset>:<count>,..." -> [[offset, count], ...] */
+static cJSON *_parse_profile(char *spec)
+{
+  cJSON *profile = cJSON_CreateArray(), *phase;
+  char *tmp = xstrdup(spec), *save_ptr = NULL, *tok, *colon;
+
+  for (tok = strtok_r(tmp, ",", &save_ptr); tok;
+       tok = strtok_r(NULL, ",", &save_ptr)) {
+    if (!(colon = strchr(tok, ':'))) {
+      fprintf(stderr, "mock_middleman: malformed profile phase \"%s\"\n", tok);
+      exit(1);
+    }
+    phase = cJSON_CreateArray();
+    cJSON_AddItemToArray(phase, cJSON_CreateNumber(atol(tok)));
+    cJSON_AddItemToArray(phase, cJSON_CreateNumber(atol(colon + 1)));
+    cJSON_AddItemToArray(profile, phase);
+  }
+  xfree(tmp);
+  return profile;
+}
+
+
+
+static int _listen(void)
+{
+  struct sockaddr_in addr = { 0 };
+  int fd, one = 1;
+
+  if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+    fatal("socket: %m");
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) ||
+      listen(fd, 128))
+    fatal("can't listen on port %d: %m", port);
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  return fd;
+}
+
+
+
+static void _close_conn(int i)
+{
+  if (conns[i].fd < 0)
+    return;
+  debug("connection %d closed", i);
+  close(conns[i].fd);
+  conns[i].fd = -1;
+  conns[i].gen++;
+  xfree(conns[i].in);
+  xfree(conns[i].out);
+  conns[i].in_len = conns[i].out_len = conns[i].out_sent = 0;
+  if (conns[i].subscribed)
+    cJSON_Delete(conns[i].subscribed);
+  conns[i].subscribed = NULL;
+}
+
+
+
+static void _accept(void)
+{
+  int fd, i;
+
+  while ((fd = accept(listen_fd, NULL, NULL)) >= 0) {
+    for (i = 0; i < MAX_CONNS && conns[i].fd >= 0; i++)
+      ;
+    if (i == MAX_CONNS) {
+      error("too many connections");
+      close(fd);
+      continue;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    conns[i].fd = fd;
+    accepted++;
+    debug("connection %d accepted", i);
+  }
+}
+
+
+
+/* queues msg (consumed) to be written to the connection */
+static void _send(int i, char *msg)
+{
+  size_t len = strlen(msg);
+
+  if (conns[i].fd < 0) {
+    xfree(msg);
+    return;
+  }
+  xrealloc(conns[i].out, conns[i].out_len + len + 2);
+  memcpy(conns[i].out + conns[i].out_len, msg, len);
+  conns[i].out_len += len;
+  conns[i].out[conns[i].out_len++] = '\n';
+  xfree(msg);
+}
+
+
+
+/* prints the response (consumed) as a newly allocated string */
+static char *_print(cJSON *resp)
+{
+  char *str = cJSON_PrintUnformatted(resp), *msg = xstrdup(str);
+
+  free(str);
+  cJSON_Delete(resp);
+  return msg;
+}
+
+
+
+static void _flush(int i)
+{
+  ssize_t sent;
+
+  while (conns[i].out_sent < conns[i].out_len) {
+    sent = send(conns[i].fd, conns[i].out + conns[i].out_sent,
+                conns[i].out_len - conns[i].out_sent,
+                MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (sent < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        _close_conn(i);
+      return;
+    }
+    conns[i].out_sent += sent;
+  }
+  conns[i].out_len = conns[i].out_sent = 0;
+}
+
+
+
+/* {"<metric>": "<usage>", ...} for the metrics in the array */
+static cJSON *_metrics(cJSON *list)
+{
+  cJSON *metrics = cJSON_CreateObject(), *item;
+  char buf[32];
+
+  snprintf(buf, sizeof(buf), "%d", usage_value);
+  cJSON_ArrayForEach(item, list) {
+    if (cJSON_IsString(item))
+      cJSON_AddStringToObject(metrics, item->valuestring, buf);
+  }
+  return metrics;
+}
+
+
+
+/* the estimates for job_utilization and classify_and_estimate */
+static cJSON *_estimate(void)
+{
+  cJSON *util = cJSON_CreateObject();
+  char buf[32];
+
+  snprintf(buf, sizeof(buf), "%d", est_time_limit);
+  cJSON_AddStringToObject(util, "time_limit", buf);
+  if (est_runtime) {
+    snprintf(buf, sizeof(buf), "%d", est_runtime);
+    cJSON_AddStringToObject(util, "runtime", buf);
+  }
+  snprintf(buf, sizeof(buf), "%d", est_lustre);
+  cJSON_AddStringToObject(util, "lustre", buf);
+  if (est_profile)
+    cJSON_AddItemToObject(util, "lustre_profile",
+                          cJSON_Duplicate(est_profile, true));
+  return util;
+}
+
+
+
+/* a variety_id that only depends on what identifies the job */
+static char *_variety_id(cJSON *req)
+{
+  uint32_t hash = 2166136261U; /* FNV-1a */
+  cJSON *item;
+  char *str, *c;
+
+  item = cJSON_GetObjectItem(req, "variety_name");
+  if (cJSON_IsString(item))
+    return xstrdup(item->valuestring);
+  str = cJSON_PrintUnformatted(cJSON_GetObjectItem(req, "script_args"));
+  for (c = str; c && *c; c++) {
+    hash ^= (unsigned char) *c;
+    hash *= 16777619U;
+  }
+  free(str);
+  item = cJSON_GetObjectItem(req, "UID");
+  return xstrdup_printf("mock_%s_%08x",
+                        cJSON_IsString(item) ? item->valuestring : "0", hash);
+}
+
+
+
+static int _type_index(const char *type)
+{
+  int i, len;
+
+  for (i = 0; type_names[i + 1]; i++) {
+    len = strlen(type_names[i]);
+    if (!xstrncmp(type, type_names[i], len) &&
+        (type[len] == '\0' || type[len] == '/'))
+      return i;
+  }
+  return i;
+}
+
+
+
+/* builds the response to the request, NULL if there is nothing to send */
+static cJSON *_handle(int i, cJSON *req)
+{
+  cJSON *type = cJSON_GetObjectItem(req, "type");
+  cJSON *resp = cJSON_CreateObject(), *item;
+  const char *status = "OK";
+  char *variety_id;
+  int t;
+
+  if (!cJSON_IsString(type)) {
+    error("request without type");
+    cJSON_AddStringToObject(resp, "status", "error");
+    return resp;
+  }
+  t = _type_index(type->valuestring);
+  type_cnt[t]++;
+  debug("connection %d: %s", i, type->valuestring);
+
+  if (error_pct && rand() % 100 < error_pct) {
+    errors_sent++;
+    cJSON_AddStringToObject(resp, "status", "error");
+    return resp;
+  }
+
+  switch (t) {
+  case 0: /* usage */
+    cJSON_AddItemToObject(resp, "response",
+                          _metrics(cJSON_GetObjectItem(req, "request")));
+    break;
+  case 1: /* subscribe */
+    if (no_subscribe) {
+      status = "not implemented";
+      break;
+    }
+    item = cJSON_GetObjectItem(req, "heartbeat");
+    conns[i].heartbeat = cJSON_IsNumber(item) && item->valueint > 0 ?
+                         item->valueint : 10;
+    conns[i].last_push = _now_ms();
+    if (conns[i].subscribed)
+      cJSON_Delete(conns[i].subscribed);
+    conns[i].subscribed = cJSON_Duplicate(cJSON_GetObjectItem(req, "request"),
+                                          true);
+    cJSON_AddItemToObject(resp, "response", _metrics(conns[i].subscribed));
+    break;
+  case 2: /* variety_id */
+    variety_id = _variety_id(req);
+    cJSON_AddStringToObject(resp, "variety_id", variety_id);
+    xfree(variety_id);
+    break;
+  case 3: /* classify_and_estimate */
+    if (no_combined) {
+      status = "not implemented";
+      break;
+    }
+    variety_id = _variety_id(req);
+    cJSON_AddStringToObject(resp, "variety_id", variety_id);
+    xfree(variety_id);
+    cJSON_AddItemToObject(resp, "response", _estimate());
+    break;
+  case 4: /* job_utilization */
+    cJSON_AddItemToObject(resp, "response", _estimate());
+    break;
+  case 5: /* process_job */
+    jobs_reported++;
+    status = "ACK";
+    break;
+  case 6: /* process_jobs */
+    if (no_batch) {
+      status = "not implemented";
+      break;
+    }
+    jobs_reported += cJSON_GetArraySize(cJSON_GetObjectItem(req, "jobs"));
+    status = "ACK";
+    break;
+  default:
+    status = "not implemented";
+  }
+  cJSON_AddStringToObject(resp, "status", status);
+  if (padding)
+    cJSON_AddStringToObject(resp, "padding", padding);
+  return resp;
+}
+
+
+
+/* schedules the response (msg consumed, NULL drops the connection) */
+static void _schedule(int i, char *msg)
+{
+  int64_t due = _now_ms() + latency_ms;
+
+  if (jitter_ms)
+    due += rand() % (jitter_ms + 1);
+  if (reply_cnt == reply_size) {
+    reply_size = reply_size ? reply_size * 2 : 64;
+    xrecalloc(replies, reply_size, sizeof(mock_reply_t));
+  }
+  replies[reply_cnt].due = due;
+  replies[reply_cnt].conn = i;
+  replies[reply_cnt].gen = conns[i].gen;
+  replies[reply_cnt].msg = msg;
+  reply_cnt++;
+}
+
+
+
+static void _request(int i, char *line)
+{
+  cJSON *req, *resp, *id;
+
+  if (!(req = cJSON_Parse(line))) {
+    error("connection %d: can't parse request: %s", i, line);
+    return;
+  }
+  resp = _handle(i, req);
+  id = cJSON_GetObjectItem(req, "req_id");
+  if (cJSON_IsString(id))
+    cJSON_AddStringToObject(resp, "req_id", id->valuestring);
+  cJSON_Delete(req);
+
+  if (hang) {
+    cJSON_Delete(resp);
+    return;
+  }
+  if (drop_pct && rand() % 100 < drop_pct) {
+    drops++;
+    cJSON_Delete(resp);
+    _schedule(i, NULL);
+    return;
+  }
+  _schedule(i, _print(resp));
+}
+
+
+
+static void _read(int i)
+{
+  char *line, *newline;
+  ssize_t got;
+  size_t used;
+
+  while (1) {
+    xrealloc(conns[i].in, conns[i].in_len + READ_CHUNK + 1);
+    got = recv(conns[i].fd, conns[i].in + conns[i].in_len, READ_CHUNK,
+               MSG_DONTWAIT);
+    if (got == 0) {
+      _close_conn(i);
+      return;
+    }
+    if (got < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        _close_conn(i);
+      break;
+    }
+    conns[i].in_len += got;
+  }
+
+  conns[i].in[conns[i].in_len] = '\0';
+  line = conns[i].in;
+  while ((newline = strchr(line, '\n'))) {
+    *newline = '\0';
+    if (newline > line)
+      _request(i, line);
+    if (conns[i].fd < 0)
+      return;
+    line = newline + 1;
+  }
+  used = line - conns[i].in;
+  memmove(conns[i].in, line, conns[i].in_len - used);
+  conns[i].in_len -= used;
+}
+
+
+
+/* sends the responses that are due, returns ms until the next one or -1 */
+static int _send_due(int64_t now)
+{
+  int64_t next = -1;
+  int r, kept = 0;
+
+  for (r = 0; r < reply_cnt; r++) {
+    mock_reply_t *reply = &replies[r];
+    if (reply->due > now) {
+      if (next < 0 || reply->due - now < next)
+        next = reply->due - now;
+      replies[kept++] = *reply;
+      continue;
+    }
+    if (conns[reply->conn].fd < 0 || conns[reply->conn].gen != reply->gen) {
+      /* the connection is gone */
+      xfree(reply->msg);
+    } else if (!reply->msg) {
+      _close_conn(reply->conn);
+    } else {
+      _send(reply->conn, reply->msg);
+    }
+  }
+  reply_cnt = kept;
+  return next;
+}
+
+
+
+/* pushes updates and heartbeats to the subscribers */
+static void _push(int64_t now, bool changed)
+{
+  cJSON *msg;
+  int i;
+
+  for (i = 0; i < MAX_CONNS; i++) {
+    if (conns[i].fd < 0 || !conns[i].subscribed || hang)
+      continue;
+    if (!changed && now - conns[i].last_push < conns[i].heartbeat * 1000)
+      continue;
+    msg = cJSON_CreateObject();
+    if (changed) {
+      cJSON_AddStringToObject(msg, "type", "update");
+      cJSON_AddItemToObject(msg, "response", _metrics(conns[i].subscribed));
+    } else {
+      cJSON_AddStringToObject(msg, "type", "heartbeat");
+    }
+    _send(i, _print(msg));
+    conns[i].last_push = now;
+  }
+}
+
+
+
+static void _report(void)
+{
+  int t;
+
+  printf("connections accepted: %d\n", accepted);
+  for (t = 0; type_names[t]; t++)
+    printf("%-22s %d\n", type_names[t], type_cnt[t]);
+  printf("completed jobs reported: %d\n", jobs_reported);
+  printf("errors sent: %d, connections dropped: %d\n", errors_sent, drops);
+  fflush(stdout);
+}
+
+
+
+int main(int argc, char **argv)
+{
+  log_options_t log_opts = LOG_OPTS_STDERR_ONLY;
+  struct pollfd *pfds = xcalloc(MAX_CONNS + 1, sizeof(struct pollfd));
+  int *pfd_conn = xcalloc(MAX_CONNS + 1, sizeof(int));
+  int opt, i, p, n, timeout, next;
+  int64_t now, flap_at = 0, change_at = 0;
+  bool up = true;
+
+  log_opts.stderr_level = LOG_LEVEL_INFO;
+  while ((opt = getopt(argc, argv, "p:l:j:e:d:s:f:HcSBL:T:R:P:U:C:v")) != -1) {
+    switch (opt) {
+    case 'p':
+      port = atoi(optarg);
+      break;
+    case 'l':
+      latency_ms = atoi(optarg);
+      break;
+    case 'j':
+      jitter_ms = atoi(optarg);
+      break;
+    case 'e':
+      error_pct = atoi(optarg);
+      break;
+    case 'd':
+      drop_pct = atoi(optarg);
+      break;
+    case 's':
+      pad_bytes = atoi(optarg);
+      break;
+    case 'f':
+      if (sscanf(optarg, "%d:%d", &flap_up, &flap_down) != 2 ||
+          flap_up < 1 || flap_down < 1)
+        _usage();
+      break;
+    case 'H':
+      hang = true;
+      break;
+    case 'c':
+      no_combined = true;
+      break;
+    case 'S':
+      no_subscribe = true;
+      break;
+    case 'B':
+      no_batch = true;
+      break;
+    case 'L':
+      est_lustre = atoi(optarg);
+      break;
+    case 'T':
+      est_time_limit = atoi(optarg);
+      break;
+    case 'R':
+      est_runtime = atoi(optarg);
+      break;
+    case 'P':
+      est_profile = _parse_profile(optarg);
+      break;
+    case 'U':
+      usage_base = atoi(optarg);
+      break;
+    case 'C':
+      usage_change = atoi(optarg);
+      break;
+    case 'v':
+      log_opts.stderr_level = LOG_LEVEL_DEBUG;
+      break;
+    default:
+      _usage();
+    }
+  }
+  if (optind != argc || port < 1 || latency_ms < 0 || jitter_ms < 0 ||
+      pad_bytes < 0 || usage_base < 0 || usage_change < 0)
+    _usage();
+  log_init("mock_middleman", log_opts, 0, NULL);
+  signal(SIGINT, _on_signal);
+  signal(SIGTERM, _on_signal);
+  signal(SIGPIPE, SIG_IGN);
+  if (pad_bytes) {
+    padding = xmalloc(pad_bytes + 1);
+    memset(padding, 'x', pad_bytes);
+  }
+  for (i = 0; i < MAX_CONNS; i++)
+    conns[i].fd = -1;
+  usage_value = usage_base;
+
+  listen_fd = _listen();
+  info("listening on port %d", port);
+  now = _now_ms();
+  if (flap_up)
+    flap_at = now + flap_up * 1000;
+  if (usage_change)
+    change_at = now + usage_change * 1000;
+
+  while (!stop) {
+    now = _now_ms();
+    if (flap_up && now >= flap_at) {
+      up = !up;
+      if (up) {
+        listen_fd = _listen();
+        info("up");
+      } else {
+        /* refuse new connections and drop the current ones */
+        close(listen_fd);
+        listen_fd = -1;
+        for (i = 0; i < MAX_CONNS; i++)
+          _close_conn(i);
+        info("down");
+      }
+      flap_at = now + (up ? flap_up : flap_down) * 1000;
+    }
+    if (usage_change && now >= change_at) {
+      usage_value = rand() % (2 * usage_base + 1);
+      _push(now, true);
+      change_at = now + usage_change * 1000;
+    }
+    _push(now, false);
+
+    /* wake up for the next response, push or flap; at least once a second */
+    timeout = 1000;
+    if ((next = _send_due(now)) >= 0 && next < timeout)
+      timeout = next;
+
+    n = 0;
+    if (listen_fd >= 0) {
+      pfds[n].fd = listen_fd;
+      pfds[n].events = POLLIN;
+      pfd_conn[n++] = -1;
+    }
+    for (i = 0; i < MAX_CONNS; i++) {
+      if (conns[i].fd < 0)
+        continue;
+      pfds[n].fd = conns[i].fd;
+      pfds[n].events = POLLIN | (conns[i].out_len ? POLLOUT : 0);
+      pfd_conn[n++] = i;
+    }
+    if (poll(pfds, n, timeout) < 0) {
+      if (errno == EINTR)
+        continue;
+      fatal("poll: %m");
+    }
+
+    for (p = 0; p < n; p++) {
+      if (!pfds[p].revents)
+        continue;
+      if ((i = pfd_conn[p]) < 0) {
+        _accept();
+        continue;
+      }
+      if (pfds[p].revents & (POLLIN | POLLERR | POLLHUP))
+        _read(i);
+      if (conns[i].fd >= 0 && conns[i].out_len)
+        _flush(i);
+    }
+  }
+
+  _report();
+  for (i = 0; i < MAX_CONNS; i++)
+    _close_conn(i);
+  for (i = 0; i < reply_cnt; i++)
+    xfree(replies[i].msg);
+  xfree(replies);
+  xfree(pfds);
+  xfree(pfd_conn);
+  xfree(padding);
+  if (est_profile)
+    cJSON_Delete(est_profile);
+  if (listen_fd >= 0)
+    close(listen_fd);
+  log_fini();
+  return 0;
+}
@@ -12,9 +12,12 @@
 #  include <sys/prctl.h>
 #endif
 
+#include "src/common/node_conf.h"
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/xstring.h"
 #include "src/slurmctld/licenses.h"
+#include "src/slurmctld/locks.h"
+#include "src/slurmctld/slurmctld.h"
 
 #include "client.h"
 #include "cJSON.h"
@@ -60,119 +63,395 @@ static uint32_t _my_sleep(int64_t usec)
   return sleep_time;
 }
 
-/* Find a license_t record by license name (for use by list_find_first)
- *
- * copied from licenses.c
- * */
-static int _license_find_rec(void *x, void *key)
+/*
+ * one metric requested from the server and the license it updates,
+ * or the nodes whose I/O load it is
+ */
+typedef struct remote_metric_struct {
+  char *metric;
+  char *license;        /* NULL for an I/O group */
+  char *nodes;          /* nodes of an I/O group, NULL for a license */
+  bool bad_nodes;       /* invalid nodes of the I/O group reported */
+  int64_t value;        /* -1 if not in the last response */
+} remote_metric_t;
+
+
+
+/*
+ * Parses "metric[=license],..." (the license defaults to the metric name).
+ * Returns the array of *cnt metrics, caller must free with _free_metrics()
+ */
+static remote_metric_t *_parse_metrics(const char *spec, int *cnt)
 {
-  licenses_t *license_entry = (licenses_t *) x;
-  char *name = (char *) key;
+  remote_metric_t *metrics = NULL;
+  char *tmp = xstrdup(spec), *save_ptr = NULL, *tok, *eq;
+
+  *cnt = 0;
+  for (tok = strtok_r(tmp, ",", &save_ptr); tok;
+       tok = strtok_r(NULL, ",", &save_ptr)) {
+    xrecalloc(metrics, *cnt + 1, sizeof(remote_metric_t));
+    if ((eq = strchr(tok, '='))) {
+      *eq = '\0';
+      metrics[*cnt].license = xstrdup(eq + 1);
+    } else {
+      metrics[*cnt].license = xstrdup(tok);
+    }
+    metrics[*cnt].metric = xstrdup(tok);
+    metrics[*cnt].value = -1;
+    debug3("%s: metric %s -> license %s", __func__,
+           metrics[*cnt].metric, metrics[*cnt].license);
+    (*cnt)++;
+  }
+  xfree(tmp);
+  return metrics;
+}
 
-  if ((license_entry->name == NULL) || (name == NULL))
-    return 0;
-  if (xstrcmp(license_entry->name, name))
-    return 0;
-  return 1;
+
+
+/*
+ * Parses the I/O groups "metric:nodes;..." (e.g. "rtr1:node[1-16]") and
+ * appends them to the *cnt metrics.
+ * Returns the metrics array, which may have moved.
+ */
+static remote_metric_t *_parse_io_groups(const char *spec,
+                                         remote_metric_t *metrics, int *cnt)
+{
+  char *tmp = xstrdup(spec), *save_ptr = NULL, *tok, *colon;
+
+  for (tok = strtok_r(tmp, ";", &save_ptr); tok;
+       tok = strtok_r(NULL, ";", &save_ptr)) {
+    if (!(colon = strchr(tok, ':')) || (colon == tok) || !colon[1]) {
+      error("%s: malformed I/O group \"%s\", expected metric:nodes",
+            __func__, tok);
+      continue;
+    }
+    *colon = '\0';
+    xrecalloc(metrics, *cnt + 1, sizeof(remote_metric_t));
+    metrics[*cnt].metric = xstrdup(tok);
+    metrics[*cnt].nodes = xstrdup(colon + 1);
+    metrics[*cnt].value = -1;
+    debug3("%s: metric %s -> I/O load of %s", __func__,
+           metrics[*cnt].metric, metrics[*cnt].nodes);
+    (*cnt)++;
+  }
+  xfree(tmp);
+  return metrics;
 }
 
 
-extern void *remote_metrics_agent(void *args)
+
+static void _free_metrics(remote_metric_t *metrics, int cnt)
 {
-  int i = 0;
+  int i;
 
-  debug3("starting remote_metrics_agent");
+  for (i = 0; i < cnt; i++) {
+    xfree(metrics[i].metric);
+    xfree(metrics[i].license);
+    xfree(metrics[i].nodes);
+  }
+  xfree(metrics);
+}
 
-  remote_metric_agent_arg_t *server = (remote_metric_agent_arg_t *) args;
 
-  char *addr = server->addr;
-  char *port = server->port;
 
-  debug3("%s: addr: %s, port: %s", __func__, addr, port);
+/*
+ * Sets the value of every metric found in the response.
+ * A partial response (a pushed delta) need not contain all metrics.
+ * Returns the number of metrics set.
+ */
+static int _parse_response(cJSON *resp, remote_metric_t *metrics, int cnt,
+                           bool partial)
+{
+  cJSON *payload = cJSON_GetObjectItem(resp, "response");
+  cJSON *item;
+  int i, updated = 0;
 
-  xfree(server);
+  for (i = 0; i < cnt; i++) {
+    metrics[i].value = -1;
+  }
+  if (!payload) {
+    error("remote_metric server response has no \"response\"");
+    return 0;
+  }
+  for (i = 0; i < cnt; i++) {
+    item = cJSON_GetObjectItem(payload, metrics[i].metric);
+    if (!item) {
+      if (!partial)
+        error("remote_metric server response has no item \"%s\"",
+              metrics[i].metric);
+    } else if (cJSON_IsString(item)) {
+      metrics[i].value = strtoll(item->valuestring, NULL, 10);
+    } else if (cJSON_IsNumber(item)) {
+      metrics[i].value = (int64_t) item->valuedouble;
+    } else {
+      error("remote_metric server response item \"%s\" isn't a number",
+            metrics[i].metric);
+    }
+    if (metrics[i].value >= 0) {
+      updated++;
+    } else {
+      metrics[i].value = -1;
+    }
+  }
+  return updated;
+}
 
-  int sockfd = 0;
 
-  while(!stop_remote_metrics) {
 
-    // if not connected, attempt to connect
+/*
+ * Updates all licenses with new values in a single pass under one lock.
+ * Returns true if any license became less used (more capacity available).
+ */
+static bool _update_licenses(remote_metric_t *metrics, int cnt)
+{
+  ListIterator iter;
+  licenses_t *license;
+  uint32_t r_used;
+  int i, found = 0, wanted = 0;
+  bool freed = false;
+
+  for (i = 0; i < cnt; i++) {
+    if ((metrics[i].value >= 0) && metrics[i].license) {
+      wanted++;
+    }
+  }
 
-    if (sockfd <= 0) {
-      debug3("%s: connecting to addr: %s, port: %s", __func__, addr, port);
-      sockfd = connect_to_simple_server(addr, port);
+  slurm_mutex_lock(&license_mutex);
+  iter = list_iterator_create(license_list);
+  while ((found < wanted) && (license = list_next(iter))) {
+    for (i = 0; i < cnt; i++) {
+      if ((metrics[i].value < 0) || !metrics[i].license ||
+          xstrcmp(license->name, metrics[i].license)) {
+        continue;
+      }
+      /* clump value to total */
+      r_used = MIN(metrics[i].value, (int64_t) license->total);
+      if (r_used < license->r_used)
+        freed = true;
+      license->r_used = r_used;
+      debug3("remotely updated license %s for %u",
+             license->name, license->r_used);
+      metrics[i].value = -1;
+      found++;
     }
+  }
+  list_iterator_destroy(iter);
+  slurm_mutex_unlock(&license_mutex);
 
-    // if connected, get new metrics
+  for (i = 0; i < cnt; i++) {
+    if ((metrics[i].value >= 0) && metrics[i].license) {
+      debug("could not find license %s for remote_metric update",
+            metrics[i].license);
+    }
+  }
+  return freed;
+}
 
-    bool updated = false;
 
-    if (sockfd <= 0) {
-      error("error connecting to remote_metric server");
-    } else {
-      cJSON *req =  cJSON_CreateObject();
-      cJSON_AddStringToObject(req, "type", "usage");
-      cJSON *metric_list = cJSON_CreateArray();
-      cJSON_AddItemToArray(metric_list, cJSON_CreateString("lustre"));
-      cJSON_AddItemToObject(req, "request", metric_list);
-      cJSON *resp = send_receive(sockfd, req);
-      cJSON_Delete(req);
-      if (!resp) {
-        debug2("could not get response from remote_metric server");
-        close(sockfd);
-        sockfd = -1;
-      } else {
-        cJSON *payload = cJSON_GetObjectItem(resp, "response");
-        if (!payload) {
-          error("remote_metric server response has no \"response\"");
-        } else {
-          cJSON *lustre = cJSON_GetObjectItem(payload, "lustre");
-          if (!lustre) {
-            error("remote_metric server response has no item \"lustre\"");
-          } else if (!cJSON_IsString(lustre)) {
-            error("remote_metric server response item \"luster\" isn't a string");
-          } else {
-            i = atoi(lustre->valuestring);
-            if (i >= 0) {
-              updated = true;
-            }
-          }
-        }
-      }
+
+/*
+ * Sets the I/O load (percent, capped at 100) of the nodes of every I/O group
+ * in the response, for select/cons_tres (SchedulerParameters=io_aware_nodes).
+ */
+static void _update_io_load(remote_metric_t *metrics, int cnt)
+{
+  /* Write nodes */
+  slurmctld_lock_t node_write_lock = {
+    NO_LOCK, NO_LOCK, WRITE_LOCK, NO_LOCK, NO_LOCK };
+  bitstr_t *node_bitmap;
+  uint16_t load;
+  int i, n, first, last;
+  bool locked = false;
+
+  for (i = 0; i < cnt; i++) {
+    if ((metrics[i].value < 0) || !metrics[i].nodes)
+      continue;
+    if (!locked) {
+      /* fini() may hold the locks while it joins us, see _apply_batch() */
+      if (!lock_slurmctld_unless(node_write_lock, &stop_remote_metrics))
+        return;
+      locked = true;
+    }
+    if (node_name2bitmap(metrics[i].nodes, false, &node_bitmap) &&
+        !metrics[i].bad_nodes) {
+      error("I/O group %s has invalid nodes \"%s\"",
+            metrics[i].metric, metrics[i].nodes);
+      metrics[i].bad_nodes = true;
+    }
+    load = MIN(metrics[i].value, 100);
+    first = bit_ffs(node_bitmap);
+    last = (first >= 0) ? bit_fls(node_bitmap) : -1;
+    for (n = first; n <= last; n++) {
+      if (bit_test(node_bitmap, n))
+        node_record_table_ptr[n].io_load = load;
     }
+    FREE_NULL_BITMAP(node_bitmap);
+    debug3("remotely updated I/O load of %s to %u", metrics[i].nodes, load);
+    metrics[i].value = -1;
+  }
+  if (locked)
+    unlock_slurmctld(node_write_lock);
+}
+
+
+
+/*
+ * Applies the metrics in a response or pushed update to the licenses and
+ * lets the schedulers know if more capacity became available.
+ */
+static void _apply_response(cJSON *resp, remote_metric_t *metrics, int cnt,
+                            bool partial)
+{
+  if (!_parse_response(resp, metrics, cnt, partial))
+    return;
+  _update_io_load(metrics, cnt);
+  if (_update_licenses(metrics, cnt)) {
+    /* backfill checks it in _more_work() */
+    last_license_update = time(NULL);
+    queue_job_scheduler();
+  }
+}
 
-    // if got new metrics, update metrics
-    if (updated) {
-      licenses_t *match;
 
-      char* license_name = "lustre";
 
-      slurm_mutex_lock(&license_mutex);
+/* creates a request of the given type for all the metrics */
+static cJSON *_metrics_request(const char *type, remote_metric_t *metrics,
+                               int cnt)
+{
+  cJSON *req = cJSON_CreateObject();
+  cJSON *metric_list = cJSON_CreateArray();
+  int i;
 
-      match = list_find_first(license_list, _license_find_rec,
-        license_name);
-      if (!match) {
-        debug("could not find license %s for remote_metric update",
-              license_name);
-      } else {
-        if (i > match->total) {
-          /* clump value to total */
-          i = match->total;
-        }
-        match->r_used = i;
-        debug3("remotely updated license %s for %d",
-                    license_name, i);
+  cJSON_AddStringToObject(req, "type", type);
+  for (i = 0; i < cnt; i++) {
+    cJSON_AddItemToArray(metric_list, cJSON_CreateString(metrics[i].metric));
+  }
+  cJSON_AddItemToObject(req, "request", metric_list);
+  return req;
+}
+
+
+
+/*
+ * Subscribes to the metrics on a dedicated connection and applies the
+ * updates the server pushes until stopped or the connection fails.
+ *
+ * Returns SLURM_SUCCESS if stopped, ESLURM_NOT_SUPPORTED if the server
+ * doesn't support subscriptions, SLURM_ERROR otherwise.
+ */
+static int _subscribe(remote_metric_agent_arg_t *server,
+                      remote_metric_t *metrics, int cnt)
+{
+  client_conn_t *conn;
+  cJSON *req, *msg;
+  time_t last_msg;
+  int rc;
+
+  conn = client_connect(server->addr, server->port, server->timeout_ms);
+  if (!conn) {
+    error("error connecting to remote_metric server");
+    return SLURM_ERROR;
+  }
 
+  req = _metrics_request("subscribe", metrics, cnt);
+  cJSON_AddNumberToObject(req, "heartbeat", server->heartbeat);
+  msg = send_receive(conn, req);
+  cJSON_Delete(req);
+  if (!msg) {
+    debug2("could not get response from remote_metric server");
+    client_disconnect(conn);
+    return SLURM_ERROR;
+  }
+  if (xstrcmp(get_response_status(msg), "OK")) {
+    info("remote_metric server doesn't support subscriptions (status \"%s\"), polling instead",
+         get_response_status(msg));
+    cJSON_Delete(msg);
+    client_disconnect(conn);
+    return ESLURM_NOT_SUPPORTED;
+  }
+  debug2("%s: subscribed to %d metrics", __func__, cnt);
+
+  /* the first response carries all the metrics, updates only changes */
+  _apply_response(msg, metrics, cnt, false);
+  cJSON_Delete(msg);
+  last_msg = time(NULL);
+
+  while (!stop_remote_metrics) {
+    rc = client_recv(conn, 1000, &msg);
+    if (rc == ETIMEDOUT) {
+      if (difftime(time(NULL), last_msg) > 3 * server->heartbeat) {
+        error("no heartbeat from remote_metric server for %d s",
+              3 * server->heartbeat);
+        break;
       }
-      slurm_mutex_unlock(&license_mutex);
+      continue;
+    }
+    if (rc != SLURM_SUCCESS)
+      break;
+    last_msg = time(NULL);
+    if (cJSON_GetObjectItem(msg, "response"))
+      _apply_response(msg, metrics, cnt, true);
+    cJSON_Delete(msg);
+  }
+
+  client_disconnect(conn);
+  return stop_remote_metrics ? SLURM_SUCCESS : SLURM_ERROR;
+}
+
+
+
+extern void *remote_metrics_agent(void *args)
+{
+  remote_metric_t *metrics;
+  int metric_cnt;
+
+  debug3("starting remote_metrics_agent");
+
+  remote_metric_agent_arg_t *server = (remote_metric_agent_arg_t *) args;
+  bool subscribe = server->subscribe;
+
+  metrics = _parse_metrics(server->metrics, &metric_cnt);
+  if (server->io_groups)
+    metrics = _parse_io_groups(server->io_groups, metrics, &metric_cnt);
+
+  debug3("%s: addr: %s, port: %s, %d metrics, %s",
+         __func__, server->addr, server->port, metric_cnt,
+         subscribe ? "subscribe" : "poll");
+
+  while (!stop_remote_metrics && metric_cnt) {
+
+    if (subscribe) {
+      if (_subscribe(server, metrics, metric_cnt) == ESLURM_NOT_SUPPORTED)
+        subscribe = false;
+      else
+        /* back off before reconnecting */
+        _my_sleep((int64_t) server->poll_interval * USEC_IN_SEC);
+      continue;
+    }
+
+    // get new metrics
+
+    cJSON *req = _metrics_request("usage", metrics, metric_cnt);
+    cJSON *resp = client_pool_send_receive(server->pool, req);
+    cJSON_Delete(req);
+    if (!resp) {
+      debug2("could not get response from remote_metric server");
+    } else {
+      // if got new metrics, update licenses
+      _apply_response(resp, metrics, metric_cnt, false);
+      cJSON_Delete(resp);
     }
 
     // sleep
-    _my_sleep(5 * USEC_IN_SEC);
+    _my_sleep((int64_t) server->poll_interval * USEC_IN_SEC);
   }
 
-  xfree(addr);
-  xfree(port);
+  _free_metrics(metrics, metric_cnt);
+  xfree(server->addr);
+  xfree(server->port);
+  xfree(server->metrics);
+  xfree(server->io_groups);
+  xfree(server);
 
   return NULL;
 }
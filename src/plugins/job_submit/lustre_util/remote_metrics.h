@@ -3,9 +3,18 @@
 #ifndef _SLURM_LUSTRE_UTIL_REMOTE_METRICS_H
 #define _SLURM_LUSTRE_UTIL_REMOTE_METRICS_H
 
+#include "client_pool.h"
+
 typedef struct remote_metric_agent_arg_struct {
   char *addr;
   char *port;
+  client_pool_t *pool;  /* shared with job_submit, owned by the plugin */
+  char *metrics;        /* "metric[=license],...", consumed by the agent */
+  char *io_groups;      /* "metric:nodes;..." or NULL, consumed by the agent */
+  int poll_interval;    /* seconds */
+  int timeout_ms;       /* for the subscription connection */
+  bool subscribe;       /* have the server push updates instead of polling */
+  int heartbeat;        /* seconds between pushes when nothing changes */
 } remote_metric_agent_arg_t;
 
 /* backfill_agent - detached thread periodically attempts to read remote metrics */
@@ -0,0 +1,516 @@
+/*****************************************************************************\
+ *  jobcomp_ldms.c - report completed jobs to the SLURM-LDMS middleman.
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+/*
+ * The middleman (src/plugins/job_submit/lustre_util/protocol.md) estimates
+ * the time limit and Lustre demand of a job from its variety_id; this plugin
+ * closes the loop by reporting what the completed jobs actually used.
+ *
+ * slurm_jobcomp_log_record() runs under the job write lock, so it only
+ * copies the job's variety_id (from the "variety_id=...;" admin_comment
+ * prefix set by job_submit/lustre_util; users can set the comment, not the
+ * admin_comment), runtime, node count and Lustre usage into a
+ * bounded queue. A sender thread reports them in "process_jobs" batches
+ * (one "process_job" each to servers that don't implement it) and backs
+ * off while the server is unreachable. When the queue is full the oldest
+ * records are dropped.
+ *
+ * JobCompLoc is the server's "host:port"; if it isn't one, VINSNL_SERVER
+ * (as for job_submit/lustre_util) or 127.0.0.1:9999 is used.
+ */
+
+#include "config.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "src/common/list.h"
+#include "src/common/slurm_jobcomp.h"
+#include "src/common/slurm_protocol_defs.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+#include "src/plugins/job_submit/lustre_util/client.h"
+#include "src/slurmctld/licenses.h"
+#include "src/slurmctld/slurmctld.h"
+
+/*
+ * These variables are required by the generic plugin interface. If they
+ * are not found in the plugin, the plugin loader will ignore it.
+ *
+ * plugin_name - a string giving a human-readable description of the
+ * plugin. There is no maximum length, but the symbol must refer to
+ * a valid string.
+ *
+ * plugin_type - a string suggesting the type of the plugin or its
+ * applicability to a particular form of data or method of data handling.
+ * If the low-level plugin API is used, the contents of this string are
+ * unimportant and may be anything. Slurm uses the higher-level plugin
+ * interface which requires this string to be of the form
+ *
+ *	<application>/<method>
+ *
+ * where <application> is a description of the intended application of
+ * the plugin (e.g., "jobcomp" for Slurm job completion logging) and <method>
+ * is a description of how this plugin satisfies that application. Slurm will
+ * only load job completion logging plugins if the plugin_type string has a
+ * prefix of "jobcomp/".
+ *
+ * plugin_version - an unsigned 32-bit integer containing the Slurm version
+ * (major.minor.micro combined into a single number).
+ */
+const char plugin_name[] = "Job completion LDMS middleman feedback plugin";
+const char plugin_type[] = "jobcomp/ldms";
+const uint32_t plugin_version = SLURM_VERSION_NUMBER;
+
+#define SERVER_ENV_NAME		"VINSNL_SERVER"
+#define SERVER_DEFAULT		"127.0.0.1:9999"
+/* timeout (milliseconds) for connecting to and waiting for the server */
+#define TIMEOUT_ENV_NAME	"VINSNL_TIMEOUT"
+#define TIMEOUT_DEFAULT		5000
+/* most completed jobs in one "process_jobs" request */
+#define BATCH_ENV_NAME		"VINSNL_FEEDBACK_BATCH"
+#define BATCH_DEFAULT		100
+/* how long (seconds) a completed job waits for its batch to fill */
+#define FLUSH_ENV_NAME		"VINSNL_FEEDBACK_FLUSH"
+#define FLUSH_DEFAULT		5
+/* most completed jobs queued; older ones are dropped */
+#define QUEUE_ENV_NAME		"VINSNL_FEEDBACK_QUEUE"
+#define QUEUE_DEFAULT		10000
+/* retry interval (seconds) while the server is unreachable, doubled up to */
+#define RETRY_MIN		1
+#define RETRY_MAX		60
+
+#define LUSTRE_LICENSE		"lustre"
+
+typedef struct {
+	char *variety_id;
+	uint32_t job_id;
+	char *state;
+	time_t start_time;
+	time_t end_time;
+	uint32_t runtime;	/* seconds, without the time suspended */
+	uint32_t node_cnt;
+	uint32_t time_limit;	/* minutes */
+	uint32_t lustre;	/* "lustre" licenses requested */
+	uint64_t lustre_read;	/* MB */
+	uint64_t lustre_write;	/* MB */
+	time_t queued;
+} ldms_job_t;
+
+/* set by slurm_jobcomp_set_location(), copied by the sender */
+static char *server_addr = NULL;
+static char *server_port = NULL;
+static int server_timeout = TIMEOUT_DEFAULT;
+static int batch_size = BATCH_DEFAULT;
+static int flush_interval = FLUSH_DEFAULT;
+static int queue_size = QUEUE_DEFAULT;
+
+/* cleared once the server answers "not implemented" to process_jobs */
+static bool batch_supported = true;
+
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static List job_queue = NULL;
+static bool stop_sender = false;
+static bool server_changed = false;
+static pthread_t sender_thread = 0;
+static uint32_t dropped_cnt = 0;
+
+static void _free_job(void *x)
+{
+	ldms_job_t *job = (ldms_job_t *) x;
+
+	if (job) {
+		xfree(job->variety_id);
+		xfree(job->state);
+		xfree(job);
+	}
+}
+
+static int _get_env_int(const char *name, int default_value)
+{
+	char *end_num, *str = getenv(name);
+	long value;
+
+	if (str == NULL)
+		return default_value;
+	value = strtol(str, &end_num, 10);
+	if ((*end_num != '\0') || (value <= 0) || (value > INT_MAX)) {
+		error("%s: malformed %s: \"%s\", using %d",
+		      plugin_type, name, str, default_value);
+		return default_value;
+	}
+	return (int) value;
+}
+
+/* variety_id from the job's admin_comment (caller must xfree) or NULL */
+static char *_variety_id(char *comment)
+{
+	static const char pref[] = "variety_id=";
+	char *end;
+
+	if (xstrncmp(comment, pref, sizeof(pref) - 1))
+		return NULL;
+	comment += sizeof(pref) - 1;
+	if (!(end = xstrchr(comment, ';')) || (end == comment))
+		return NULL;
+	return xstrndup(comment, end - comment);
+}
+
+static int _find_license(void *x, void *key)
+{
+	licenses_t *license_entry = (licenses_t *) x;
+
+	return !xstrcmp(license_entry->name, (char *) key);
+}
+
+static uint32_t _lustre_licenses(job_record_t *job_ptr)
+{
+	licenses_t *license_entry;
+
+	if (!job_ptr->license_list)
+		return 0;
+	license_entry = list_find_first(job_ptr->license_list, _find_license,
+					LUSTRE_LICENSE);
+	return license_entry ? license_entry->total : 0;
+}
+
+static void _add_uint(cJSON *obj, const char *name, uint64_t value)
+{
+	char str[32];
+
+	snprintf(str, sizeof(str), "%"PRIu64, value);
+	cJSON_AddStringToObject(obj, name, str);
+}
+
+static cJSON *_job_json(ldms_job_t *job)
+{
+	cJSON *obj = cJSON_CreateObject();
+
+	cJSON_AddStringToObject(obj, "variety_id", job->variety_id);
+	_add_uint(obj, "job_id", job->job_id);
+	cJSON_AddStringToObject(obj, "state", job->state);
+	_add_uint(obj, "start_time", job->start_time);
+	_add_uint(obj, "end_time", job->end_time);
+	_add_uint(obj, "runtime", job->runtime);
+	_add_uint(obj, "nodes", job->node_cnt);
+	_add_uint(obj, "time_limit", job->time_limit);
+	_add_uint(obj, "lustre", job->lustre);
+	_add_uint(obj, "lustre_read", job->lustre_read);
+	_add_uint(obj, "lustre_write", job->lustre_write);
+	return obj;
+}
+
+/*
+ * Sends the request. Returns SLURM_SUCCESS once the server answered,
+ * ESLURM_NOT_SUPPORTED if it doesn't implement the request and SLURM_ERROR
+ * if it couldn't be reached (*conn is then closed).
+ */
+static int _send(client_conn_t **conn, char *addr, char *port, cJSON *req)
+{
+	const char *status;
+	cJSON *resp;
+	int rc = SLURM_SUCCESS;
+
+	if (!*conn && !(*conn = client_connect(addr, port, server_timeout)))
+		return SLURM_ERROR;
+
+	if (!(resp = send_receive(*conn, req))) {
+		client_disconnect(*conn);
+		*conn = NULL;
+		return SLURM_ERROR;
+	}
+	status = get_response_status(resp);
+	if (!xstrcmp(status, "not implemented")) {
+		rc = ESLURM_NOT_SUPPORTED;
+	} else if (xstrcmp(status, "ACK") && xstrcmp(status, "OK")) {
+		/* the server got the jobs and refused them, don't resend */
+		error("%s: server answered \"%s\" to %s",
+		      plugin_type, status ? status : "",
+		      cJSON_GetObjectItem(req, "type")->valuestring);
+	}
+	cJSON_Delete(resp);
+	return rc;
+}
+
+/* Reports the jobs, removing the ones sent from the list */
+static int _send_jobs(client_conn_t **conn, char *addr, char *port, List jobs)
+{
+	ListIterator iter;
+	ldms_job_t *job;
+	cJSON *req, *array;
+	int rc;
+
+	if (batch_supported) {
+		req = cJSON_CreateObject();
+		cJSON_AddStringToObject(req, "type", "process_jobs");
+		array = cJSON_AddArrayToObject(req, "jobs");
+		iter = list_iterator_create(jobs);
+		while ((job = list_next(iter)))
+			cJSON_AddItemToArray(array, _job_json(job));
+		list_iterator_destroy(iter);
+		rc = _send(conn, addr, port, req);
+		cJSON_Delete(req);
+		if (rc != ESLURM_NOT_SUPPORTED) {
+			if (rc == SLURM_SUCCESS)
+				list_flush(jobs);
+			return rc;
+		}
+		info("%s: server doesn't implement process_jobs, sending process_job",
+		     plugin_type);
+		batch_supported = false;
+	}
+
+	while ((job = list_peek(jobs))) {
+		req = _job_json(job);
+		cJSON_AddStringToObject(req, "type", "process_job");
+		rc = _send(conn, addr, port, req);
+		cJSON_Delete(req);
+		if (rc == SLURM_ERROR)
+			return rc;
+		_free_job(list_pop(jobs));
+	}
+	return SLURM_SUCCESS;
+}
+
+/* Drops the oldest records beyond queue_size, queue_mutex must be locked */
+static void _trim_queue(void)
+{
+	int cnt = list_count(job_queue) - queue_size;
+
+	if (cnt <= 0)
+		return;
+	if (!dropped_cnt)
+		error("%s: queue full, dropping the oldest completed jobs",
+		      plugin_type);
+	dropped_cnt += cnt;
+	while (cnt--)
+		_free_job(list_pop(job_queue));
+}
+
+static void *_sender(void *x)
+{
+	client_conn_t *conn = NULL;
+	List batch = list_create(_free_job);
+	ldms_job_t *job;
+	struct timespec ts = {0, 0};
+	char *addr = NULL, *port = NULL;
+	int retry = 0;
+
+	slurm_mutex_lock(&queue_mutex);
+	while (!stop_sender) {
+		if (server_changed) {
+			client_disconnect(conn);
+			conn = NULL;
+			xfree(addr);
+			xfree(port);
+			addr = xstrdup(server_addr);
+			port = xstrdup(server_port);
+			server_changed = false;
+		}
+		if (!addr || !(job = list_peek(job_queue))) {
+			slurm_cond_wait(&queue_cond, &queue_mutex);
+			continue;
+		}
+		if ((list_count(job_queue) < batch_size) &&
+		    (time(NULL) < job->queued + flush_interval)) {
+			ts.tv_sec = job->queued + flush_interval;
+			slurm_cond_timedwait(&queue_cond, &queue_mutex, &ts);
+			continue;
+		}
+
+		while ((list_count(batch) < batch_size) &&
+		       (job = list_pop(job_queue)))
+			list_append(batch, job);
+		slurm_mutex_unlock(&queue_mutex);
+		if (_send_jobs(&conn, addr, port, batch) == SLURM_SUCCESS) {
+			retry = 0;
+			slurm_mutex_lock(&queue_mutex);
+			if (dropped_cnt) {
+				info("%s: %u completed jobs were dropped",
+				     plugin_type, dropped_cnt);
+				dropped_cnt = 0;
+			}
+			continue;
+		}
+
+		retry = retry ? MIN(retry * 2, RETRY_MAX) : RETRY_MIN;
+		debug("%s: can't reach the server, retrying in %d s",
+		      plugin_type, retry);
+		slurm_mutex_lock(&queue_mutex);
+		/* put them back in front, in order */
+		list_transfer(batch, job_queue);
+		list_transfer(job_queue, batch);
+		_trim_queue();
+		ts.tv_sec = time(NULL) + retry;
+		if (!stop_sender)
+			slurm_cond_timedwait(&queue_cond, &queue_mutex, &ts);
+	}
+	slurm_mutex_unlock(&queue_mutex);
+
+	client_disconnect(conn);
+	FREE_NULL_LIST(batch);
+	xfree(addr);
+	xfree(port);
+	return NULL;
+}
+
+/*
+ * init() is called when the plugin is loaded, before any other functions
+ * are called. Put global initialization here.
+ */
+extern int init(void)
+{
+	server_timeout = _get_env_int(TIMEOUT_ENV_NAME, TIMEOUT_DEFAULT);
+	batch_size = _get_env_int(BATCH_ENV_NAME, BATCH_DEFAULT);
+	flush_interval = _get_env_int(FLUSH_ENV_NAME, FLUSH_DEFAULT);
+	queue_size = _get_env_int(QUEUE_ENV_NAME, QUEUE_DEFAULT);
+
+	job_queue = list_create(_free_job);
+	stop_sender = false;
+	slurm_thread_create(&sender_thread, _sender, NULL);
+
+	return SLURM_SUCCESS;
+}
+
+extern int fini(void)
+{
+	int cnt;
+
+	slurm_mutex_lock(&queue_mutex);
+	stop_sender = true;
+	slurm_cond_broadcast(&queue_cond);
+	slurm_mutex_unlock(&queue_mutex);
+	pthread_join(sender_thread, NULL);
+	sender_thread = 0;
+
+	if ((cnt = list_count(job_queue)))
+		info("%s: %d completed jobs not reported", plugin_type, cnt);
+	FREE_NULL_LIST(job_queue);
+	xfree(server_addr);
+	xfree(server_port);
+	return SLURM_SUCCESS;
+}
+
+/*
+ * The remainder of this file implements the standard Slurm job completion
+ * logging API.
+ */
+extern int slurm_jobcomp_set_location(char *location)
+{
+	char *colon;
+
+	/* the default JobCompLoc is a file name */
+	if (!(colon = xstrchr(location, ':')) || xstrchr(location, '/')) {
+		location = getenv(SERVER_ENV_NAME);
+		if (!location)
+			location = SERVER_DEFAULT;
+		if (!(colon = xstrchr(location, ':'))) {
+			error("%s: malformed server \"%s\"", plugin_type,
+			      location);
+			return SLURM_ERROR;
+		}
+	}
+
+	slurm_mutex_lock(&queue_mutex);
+	xfree(server_addr);
+	xfree(server_port);
+	server_addr = xstrndup(location, colon - location);
+	server_port = xstrdup(colon + 1);
+	server_changed = true;
+	slurm_cond_broadcast(&queue_cond);
+	slurm_mutex_unlock(&queue_mutex);
+	debug("%s: reporting to %s:%s", plugin_type, server_addr, server_port);
+
+	return SLURM_SUCCESS;
+}
+
+extern int slurm_jobcomp_log_record(job_record_t *job_ptr)
+{
+	ldms_job_t *job;
+	char *variety_id;
+
+	/* jobs that never ran tell nothing about their variety */
+	if (!job_ptr->start_time ||
+	    !(variety_id = _variety_id(job_ptr->admin_comment)))
+		return SLURM_SUCCESS;
+
+	job = xmalloc(sizeof(ldms_job_t));
+	job->variety_id = variety_id;
+	job->job_id = job_ptr->job_id;
+	job->state = xstrdup(job_state_string(job_ptr->job_state &
+					       JOB_STATE_BASE));
+	job->start_time = job_ptr->start_time;
+	job->end_time = job_ptr->end_time;
+	if (job_ptr->end_time > job_ptr->start_time + job_ptr->tot_sus_time)
+		job->runtime = job_ptr->end_time - job_ptr->start_time -
+			       job_ptr->tot_sus_time;
+	job->node_cnt = job_ptr->node_cnt;
+	job->time_limit = job_ptr->time_limit;
+	job->lustre = _lustre_licenses(job_ptr);
+	job->lustre_read = job_ptr->lustre_read;
+	job->lustre_write = job_ptr->lustre_write;
+	job->queued = time(NULL);
+
+	slurm_mutex_lock(&queue_mutex);
+	list_append(job_queue, job);
+	_trim_queue();
+	/* the sender waits for the first job, then for a full batch */
+	if ((list_count(job_queue) == 1) ||
+	    (list_count(job_queue) >= batch_size))
+		slurm_cond_signal(&queue_cond);
+	slurm_mutex_unlock(&queue_mutex);
+
+	return SLURM_SUCCESS;
+}
+
+/*
+ * get info from the database
+ * in/out job_list List of job_rec_t *
+ * note List needs to be freed when called
+ */
+extern List slurm_jobcomp_get_jobs(slurmdb_job_cond_t *job_cond)
+{
+	debug("%s function is not implemented", __func__);
+	return NULL;
+}
+
+/*
+ * expire old info from the database
+ */
+extern int slurm_jobcomp_archive(slurmdb_archive_cond_t *arch_cond)
+{
+	debug("%s function is not implemented", __func__);
+	return SLURM_SUCCESS;
+}
@@ -86,6 +86,7 @@
 #include "src/slurmctld/burst_buffer.h"
 #include "src/slurmctld/fed_mgr.h"
 #include "src/slurmctld/front_end.h"
+#include "src/slurmctld/info_delta.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/licenses.h"
 #include "src/slurmctld/locks.h"
@@ -101,6 +102,7 @@
 #define BACKFILL_RESOLUTION	60
 #define BACKFILL_WINDOW		(24 * 60 * 60)
 #define BF_MAX_JOB_ARRAY_RESV	20
+#define BF_MAX_LIC_RESV		1	/*AG */
 
 #define SLURMCTLD_THREAD_LIMIT	5
 #define YIELD_INTERVAL		2000000	/* time in micro-seconds */
@@ -184,12 +186,27 @@ static int backfill_resolution = BACKFILL_RESOLUTION;
 static int backfill_window = BACKFILL_WINDOW;
 static int bf_job_part_count_reserve = 0;
 static int bf_max_job_array_resv = BF_MAX_JOB_ARRAY_RESV;
+static int bf_max_lic_resv = BF_MAX_LIC_RESV; /*AG */
 static int bf_min_age_reserve = 0;
 static uint32_t bf_min_prio_reserve = 0;
 static List deadlock_global_list;
 static bool bf_hetjob_immediate = false;
 static uint16_t bf_hetjob_prio = 0;
 static bool bf_one_resv_per_job = false;
+static bool bf_predicted_runtime = false; /*AG */
+static bool predicted_ends_set = false;  /*AG jobs may have predicted_end */
+
+/*AG time (usec) spent in the phases of a cycle, see _do_diag_stats() */
+enum {
+	BF_PHASE_QUEUE_BUILD,	/* build_job_queue() */
+	BF_PHASE_LIC_INIT,	/* init_lic_tracker() and predicted ends */
+	BF_PHASE_RESV_TEST,	/* job_test_resv() */
+	BF_PHASE_TRY_SCHED,	/* _try_sched() */
+	BF_PHASE_NODE_SPACE,	/* _add_reservation() */
+	BF_PHASE_CNT
+};
+static uint64_t bf_phase_usec[BF_PHASE_CNT];
+static uint32_t bf_lic_defers = 0;	/*AG jobs deferred for licenses */
 static uint32_t job_start_cnt = 0;
 static int max_backfill_job_cnt = 100;
 static int max_backfill_job_per_assoc = 0;
@@ -215,7 +232,8 @@ static int  _attempt_backfill(void);
 static int  _clear_job_estimates(void *x, void *arg);
 static int  _clear_qos_blocked_times(void *x, void *arg);
 static void _do_diag_stats(struct timeval *tv1, struct timeval *tv2,
-			   int node_space_recs);
+			   int node_space_recs, lic_tracker_p lt,
+			   int lic_resv_cnt);
 static uint32_t _get_job_max_tl(job_record_t *job_ptr, time_t now,
 				node_space_map_t *node_space);
 static bool _hetjob_any_resv(job_record_t *het_leader);
@@ -245,6 +263,7 @@ static void _pack_start_test(node_space_map_t *node_space,
 static void _reset_job_time_limit(job_record_t *job_ptr, time_t now,
 				  node_space_map_t *node_space);
 static int  _set_hetjob_details(void *x, void *arg);
+static void _set_predicted_ends(lic_tracker_p lt, time_t now);
 static int  _start_job(job_record_t *job_ptr, bitstr_t *avail_bitmap);
 static bool _test_resv_overlap(node_space_map_t *node_space,
 			       bitstr_t *use_bitmap, uint32_t start_time,
@@ -714,6 +733,18 @@ static void _load_config(void)
 		bf_max_job_array_resv = BF_MAX_JOB_ARRAY_RESV;
 	}
 
+	/*AG */
+	if ((tmp_ptr = xstrcasestr(sched_params, "bf_max_lic_resv="))) {
+		bf_max_lic_resv = atoi(tmp_ptr + 16);
+		if (bf_max_lic_resv < 0) {
+			error("Invalid SchedulerParameters bf_max_lic_resv: %d",
+			      bf_max_lic_resv);
+			bf_max_lic_resv = BF_MAX_LIC_RESV;
+		}
+	} else {
+		bf_max_lic_resv = BF_MAX_LIC_RESV;
+	}
+
 	if ((tmp_ptr = xstrcasestr(sched_params, "bf_max_job_part="))) {
 		max_backfill_job_per_part = atoi(tmp_ptr + 16);
 		if (max_backfill_job_per_part < 0) {
@@ -897,6 +928,12 @@ static void _load_config(void)
 	else
 		bf_one_resv_per_job = false;
 
+	/*AG */
+	if (xstrcasestr(sched_params, "bf_predicted_runtime"))
+		bf_predicted_runtime = true;
+	else
+		bf_predicted_runtime = false;
+
 	if ((tmp_ptr = xstrcasestr(sched_params, "max_rpc_cnt=")))
 		max_rpc_cnt = atoi(tmp_ptr + 12);
 	else if ((tmp_ptr = xstrcasestr(sched_params, "max_rpc_count=")))
@@ -920,13 +957,22 @@ extern void backfill_reconfig(void)
 	slurm_mutex_unlock(&config_lock);
 }
 
+/*AG Add the time since *tv to a phase of the cycle */
+static void _phase_add(int phase, struct timeval *tv)
+{
+	bf_phase_usec[phase] += slurm_delta_tv(tv);
+}
+
 /* Update backfill scheduling statistics
  * IN tv1 - start time
  * IN tv2 - end (current) time
  * IN node_space_recs - count of records in resouces/time table being tested
+ * IN lt - license tracker of the cycle, for its counters
+ * IN lic_resv_cnt - count of license reservations made
  */
 static void _do_diag_stats(struct timeval *tv1, struct timeval *tv2,
-			   int node_space_recs)
+			   int node_space_recs, lic_tracker_p lt,
+			   int lic_resv_cnt)
 {
 	uint32_t delta_t, real_time;
 
@@ -949,6 +995,42 @@ static void _do_diag_stats(struct timeval *tv1, struct timeval *tv2,
 	}
 	slurmctld_diag_stats.bf_table_size = node_space_recs;
 	slurmctld_diag_stats.bf_table_size_sum += node_space_recs;
+
+	/*AG */
+	slurmctld_diag_stats.bf_queue_build_last =
+		bf_phase_usec[BF_PHASE_QUEUE_BUILD];
+	slurmctld_diag_stats.bf_queue_build_sum +=
+		bf_phase_usec[BF_PHASE_QUEUE_BUILD];
+	slurmctld_diag_stats.bf_lic_init_last =
+		bf_phase_usec[BF_PHASE_LIC_INIT];
+	slurmctld_diag_stats.bf_lic_init_sum +=
+		bf_phase_usec[BF_PHASE_LIC_INIT];
+	slurmctld_diag_stats.bf_resv_test_last =
+		bf_phase_usec[BF_PHASE_RESV_TEST];
+	slurmctld_diag_stats.bf_resv_test_sum +=
+		bf_phase_usec[BF_PHASE_RESV_TEST];
+	slurmctld_diag_stats.bf_try_sched_last =
+		bf_phase_usec[BF_PHASE_TRY_SCHED];
+	slurmctld_diag_stats.bf_try_sched_sum +=
+		bf_phase_usec[BF_PHASE_TRY_SCHED];
+	slurmctld_diag_stats.bf_node_space_last =
+		bf_phase_usec[BF_PHASE_NODE_SPACE];
+	slurmctld_diag_stats.bf_node_space_sum +=
+		bf_phase_usec[BF_PHASE_NODE_SPACE];
+
+	slurmctld_diag_stats.bf_lic_test_last = lt ? lt->test_usec : 0;
+	slurmctld_diag_stats.bf_lic_test_sum +=
+		slurmctld_diag_stats.bf_lic_test_last;
+	slurmctld_diag_stats.bf_lic_update_last = lt ? lt->update_usec : 0;
+	slurmctld_diag_stats.bf_lic_update_sum +=
+		slurmctld_diag_stats.bf_lic_update_last;
+	slurmctld_diag_stats.bf_lic_tests_last = lt ? lt->test_cnt : 0;
+	slurmctld_diag_stats.bf_lic_tests_sum +=
+		slurmctld_diag_stats.bf_lic_tests_last;
+	slurmctld_diag_stats.bf_lic_defers_last = bf_lic_defers;
+	slurmctld_diag_stats.bf_lic_defers_sum += bf_lic_defers;
+	slurmctld_diag_stats.bf_lic_resvs_last = lic_resv_cnt;
+	slurmctld_diag_stats.bf_lic_resvs_sum += lic_resv_cnt;
 }
 
 /* backfill_agent - detached thread periodically attempts to backfill jobs */
@@ -1502,6 +1584,7 @@ static int _attempt_backfill(void)
 	uint32_t end_time, end_reserve, deadline_time_limit, boot_time;
 	uint32_t orig_end_time;
 	uint32_t time_limit, comp_time_limit, orig_time_limit, part_time_limit;
+	uint32_t plan_time_limit; /*AG predicted runtime, see bf_predicted_runtime */
 	uint32_t min_nodes, max_nodes, req_nodes;
 	bitstr_t *active_bitmap = NULL, *avail_bitmap = NULL;
 	bitstr_t *exc_core_bitmap = NULL, *resv_bitmap = NULL;
@@ -1513,6 +1596,7 @@ static int _attempt_backfill(void)
    */
 	node_space_map_t *node_space;
 	struct timeval bf_time1, bf_time2;
+	struct timeval phase_tv;	/*AG see _phase_add() */
 	int rc = 0, error_code;
 	int job_test_count = 0, test_time_count = 0, pend_time;
 	bool already_counted, many_rpcs = false;
@@ -1525,6 +1609,7 @@ static int _attempt_backfill(void)
 	uint32_t test_array_job_id = 0;
 	uint32_t test_array_count = 0;
 	uint32_t job_no_reserve;
+	int lic_resv_cnt = 0;	/*AG license reservations made */
 	bool is_job_array_head, resv_overlap = false;
 	uint8_t save_share_res = 0, save_whole_node = 0;
 	int test_fini;
@@ -1557,7 +1642,11 @@ static int _attempt_backfill(void)
 	sched_start = orig_sched_start = now = time(NULL);
 	gettimeofday(&start_tv, NULL);
 
+	memset(bf_phase_usec, 0, sizeof(bf_phase_usec));	/*AG */
+	bf_lic_defers = 0;
+	gettimeofday(&phase_tv, NULL);
 	job_queue = build_job_queue(true, true);
+	_phase_add(BF_PHASE_QUEUE_BUILD, &phase_tv);
 	job_test_count = list_count(job_queue);
 	if (job_test_count == 0) {
 		if (debug_flags & DEBUG_FLAG_BACKFILL)
@@ -1613,7 +1702,15 @@ static int _attempt_backfill(void)
 	/* Ignore nodes that have been set as available during this cycle. */
 	bit_clear_all(bf_ignore_node_bitmap);
 
+	gettimeofday(&phase_tv, NULL);
 	lic_tracker_p lt = init_lic_tracker(backfill_resolution);
+	if (lt) {
+		lt->predicted = bf_predicted_runtime;
+		lt->dump = (debug_flags & DEBUG_FLAG_BACKFILL_MAP);
+	}
+	if (bf_predicted_runtime || predicted_ends_set)
+		_set_predicted_ends(lt, now);
+	_phase_add(BF_PHASE_LIC_INIT, &phase_tv);
 	dump_lic_tracker(lt);
 
 // main cycle
@@ -1626,6 +1723,7 @@ static int _attempt_backfill(void)
 		if (job_ptr) {
 			job_resv_clear_promiscous_flag(job_ptr);
 			fill_array_reasons(job_ptr, reject_array_job);
+			info_delta_job_sched(job_ptr);	/*AG*/
 		}
 
 		job_queue_rec = (job_queue_rec_t *) list_pop(job_queue);
@@ -1738,7 +1836,7 @@ static int _attempt_backfill(void)
 				job_ptr->state_reason = WAIT_NO_REASON;
 				xfree(job_ptr->state_desc);
 				job_ptr->assoc_id = assoc_rec.id;
-				last_job_update = now;
+				job_updated(job_ptr, now);
 			} else {
 				debug("backfill: %pJ has invalid association",
 				      job_ptr);
@@ -1768,13 +1866,13 @@ static int _attempt_backfill(void)
 				      job_ptr);
 				xfree(job_ptr->state_desc);
 				job_ptr->state_reason = FAIL_QOS;
-				last_job_update = now;
+				job_sched_updated(job_ptr, now);
 				assoc_mgr_unlock(&locks);
 				continue;
 			} else if (job_ptr->state_reason == FAIL_QOS) {
 				xfree(job_ptr->state_desc);
 				job_ptr->state_reason = WAIT_NO_REASON;
-				last_job_update = now;
+				job_sched_updated(job_ptr, now);
 			}
 			assoc_mgr_unlock(&locks);
 		}
@@ -1995,6 +2093,12 @@ next_task:
 			time_limit = job_ptr->time_limit = 1;
 		else if (job_ptr->time_min && (job_ptr->time_min < time_limit))
 			time_limit = job_ptr->time_limit = job_ptr->time_min;
+		/*AG plan with the prediction, the hard limit stays */
+		if (bf_predicted_runtime)
+			plan_time_limit = backfill_predicted_limit(job_ptr,
+								   time_limit);
+		else
+			plan_time_limit = time_limit;
 
 		later_start = now;
 
@@ -2097,19 +2201,36 @@ next_task:
 		do {
 		  j = backfill_licenses_test_job(lt, job_ptr, &start_res);
 		  if (j != SLURM_SUCCESS) {
+        bf_lic_defers++;
         if (debug_flags & DEBUG_FLAG_BACKFILL)
           info("backfill: %pJ license defer",
                job_ptr);
-        /*AG TODO: consider what to do to make sure that the job will run
-         *   eventually and not starve */
+        /*AG the licenses are held by usage with no known end;
+         *   reserve them for the top jobs, under the same rules as
+         *   nodes, so that the job will run eventually and not starve */
+        start_lic = start_res;
+        if ((job_no_reserve == 0) &&
+            (lic_resv_cnt < bf_max_lic_resv) &&
+            !(qos_flags & QOS_FLAG_NO_RESERVE) &&
+            (backfill_licenses_reserve_job(lt, job_ptr, &start_lic,
+                sched_start + backfill_window) == SLURM_SUCCESS)) {
+          lic_resv_cnt++;
+          if (bf_job_part_count_reserve)
+            job_ptr->part_ptr->bf_data->resv_usage->count++;
+          if (debug_flags & DEBUG_FLAG_BACKFILL)
+            info("backfill: %pJ reserved licenses at %ld",
+                 job_ptr, start_lic);
+        }
         _set_job_time_limit(job_ptr, orig_time_limit);
         goto NEXT_JOB;
       }
 		  start_lic = start_res;
       FREE_NULL_BITMAP(avail_bitmap);
       FREE_NULL_BITMAP(exc_core_bitmap);
+      gettimeofday(&phase_tv, NULL);
       j = job_test_resv(job_ptr, &start_res, true, &avail_bitmap,
             &exc_core_bitmap, &resv_overlap, false);
+      _phase_add(BF_PHASE_RESV_TEST, &phase_tv);
       if (j != SLURM_SUCCESS) {
         if (debug_flags & DEBUG_FLAG_BACKFILL)
           info("backfill: %pJ reservation defer",
@@ -2128,9 +2249,9 @@ next_task:
       };
 		} while(start_lic != start_res);
 		if (start_res > now)
-			end_time = (time_limit * 60) + start_res;
+			end_time = (plan_time_limit * 60) + start_res; /*AG */
 		else
-			end_time = (time_limit * 60) + now;
+			end_time = (plan_time_limit * 60) + now;
 		if (end_time < now)	/* Overflow 32-bits */
 			end_time = INFINITE;
 		if (resv_overlap)
@@ -2250,8 +2371,10 @@ next_task:
 // running _try_sched for the case
 // when active_bitmap different from avail_bitmap (i.e. not NULL)
 		if (active_bitmap) {
+			gettimeofday(&phase_tv, NULL);
 			j = _try_sched(job_ptr, &active_bitmap, min_nodes,
 				       max_nodes, req_nodes, exc_core_bitmap);
+			_phase_add(BF_PHASE_TRY_SCHED, &phase_tv);
 			debug3("backfill: _try_sched with active_bitmap for %pJ returned %d.",
 			           job_ptr, j);
 			if (j == SLURM_SUCCESS) {
@@ -2322,8 +2445,10 @@ next_task:
 		if (test_fini != 1) {
 			/* Either active_bitmap was NULL or not usable by the
 			 * job. Test using avail_bitmap instead */
+			gettimeofday(&phase_tv, NULL);
 			j = _try_sched(job_ptr, &avail_bitmap, min_nodes,
 				       max_nodes, req_nodes, exc_core_bitmap);
+			_phase_add(BF_PHASE_TRY_SCHED, &phase_tv);
 			debug3("backfill: _try_sched with avail_bitmap for %pJ returned %d.",
 			                 job_ptr, j);
 			if (test_fini == 0) {
@@ -2359,7 +2484,7 @@ next_task:
 
 		if (start_res > job_ptr->start_time) {
 			job_ptr->start_time = start_res;
-			last_job_update = now;
+			job_sched_updated(job_ptr, now);
 		}
 		/*
 		 * avail_bitmap at this point contains a bitmap of nodes
@@ -2392,7 +2517,7 @@ next_task:
 				     job_state_string(job_ptr->job_state),
 				     job_reason_string(job_ptr->state_reason),
 				     job_ptr->priority);
-			last_job_update = now;
+			job_sched_updated(job_ptr, now);
 			_set_job_time_limit(job_ptr, orig_time_limit);
 			later_start = 0;
 			if (bb == -1)
@@ -2481,6 +2606,8 @@ skip_start:
 					_reset_job_time_limit(job_ptr, now,
 							      node_space);
 					time_limit = job_ptr->time_limit;
+					plan_time_limit = MIN(plan_time_limit,
+							      time_limit);
 				}
 			} else if (rc == SLURM_SUCCESS) {
 				error("%s: start_time of 0 on successful "
@@ -2537,7 +2664,15 @@ skip_start:
 
 			  /* update licenses tracker */
 
-			  backfill_licenses_alloc_job(lt, job_ptr, job_ptr->start_time, job_ptr->end_time);
+			  job_ptr->predicted_end = 0;
+			  if (bf_predicted_runtime &&
+			      (job_ptr->start_time + plan_time_limit * 60 <
+			       job_ptr->end_time))
+			    job_ptr->predicted_end = job_ptr->start_time +
+			                             plan_time_limit * 60;
+			  backfill_licenses_alloc_job(lt, job_ptr, job_ptr->start_time,
+			      job_ptr->predicted_end ? job_ptr->predicted_end
+			                             : job_ptr->end_time);
 
 				/* Clear assumed rejected array status */
 				reject_array_job = NULL;
@@ -2613,7 +2748,7 @@ skip_start:
 
 		start_time  = job_ptr->start_time;
 		end_reserve = job_ptr->start_time + boot_time +
-			      (time_limit * 60);
+			      (plan_time_limit * 60); /*AG */
 		start_time  = (start_time / backfill_resolution) *
 			      backfill_resolution;
 		end_reserve = (end_reserve / backfill_resolution) *
@@ -2772,8 +2907,10 @@ skip_start:
 		bit_not(avail_bitmap);
 		if ((!bf_one_resv_per_job || !orig_start_time) &&
 		    !(job_ptr->bit_flags & JOB_PROM)) {
+			gettimeofday(&phase_tv, NULL);
 			_add_reservation(start_time, end_reserve, avail_bitmap,
 					 node_space, &node_space_recs);
+			_phase_add(BF_PHASE_NODE_SPACE, &phase_tv);
 		}
 		/*AG TODO: figure out if the above conditions also apply to licenses.
 		 *         For now we won't apply them
@@ -2813,8 +2950,6 @@ skip_start:
 NEXT_JOB:;
 	}
 
-	destroy_lic_tracker(lt);
-
 	/* Restore preemption state if needed. */
 	_restore_preempt_state(job_ptr, &tmp_preempt_start_time,
 			       &tmp_preempt_in_progress);
@@ -2838,7 +2973,9 @@ NEXT_JOB:;
 	FREE_NULL_LIST(job_queue);
 
 	gettimeofday(&bf_time2, NULL);
-	_do_diag_stats(&bf_time1, &bf_time2, node_space_recs);
+	_do_diag_stats(&bf_time1, &bf_time2, node_space_recs, lt,
+		       lic_resv_cnt);
+	destroy_lic_tracker(lt);
 	if (debug_flags & DEBUG_FLAG_BACKFILL) {
 		END_TIMER;
 		info("backfill: completed testing %u(%d) jobs, %s",
@@ -2893,7 +3030,7 @@ static int _start_job(job_record_t *job_ptr, bitstr_t *resv_bitmap)
 		FREE_NULL_BITMAP(orig_exc_nodes);
 	if (rc == SLURM_SUCCESS) {
 		/* job initiated */
-		last_job_update = time(NULL);
+		job_updated(job_ptr, time(NULL));
 		info("backfill: Started %pJ in %s on %s",
 		     job_ptr, job_ptr->part_ptr->name, job_ptr->nodes);
 		power_g_job_start(job_ptr);
@@ -2964,6 +3101,37 @@ static uint32_t _get_job_max_tl(job_record_t *job_ptr, time_t now,
 	return max_tl;
 }
 
+/*AG
+ * Set the predicted end of the running jobs (see bf_predicted_runtime)
+ *	and return their licenses to the tracker then. Without
+ *	bf_predicted_runtime, clear the predictions of earlier cycles.
+ */
+static void _set_predicted_ends(lic_tracker_p lt, time_t now)
+{
+	ListIterator job_iterator;
+	job_record_t *job_ptr;
+	int cnt = 0;
+
+	job_iterator = list_iterator_create(job_list);
+	while ((job_ptr = list_next(job_iterator))) {
+		job_ptr->predicted_end = 0;
+		if (!bf_predicted_runtime || !IS_JOB_RUNNING(job_ptr))
+			continue;
+		job_ptr->predicted_end = backfill_predicted_end(job_ptr, now);
+		if (!job_ptr->predicted_end)
+			continue;
+		cnt++;
+		if (lt)
+			backfill_licenses_return_early(lt, job_ptr,
+						       job_ptr->predicted_end);
+	}
+	list_iterator_destroy(job_iterator);
+	predicted_ends_set = bf_predicted_runtime;
+
+	if (debug_flags & DEBUG_FLAG_BACKFILL)
+		info("backfill: %d running jobs predicted to end early", cnt);
+}
+
 /*
  * Reset a job's time limit (and end_time) as high as possible
  *	within the range job_ptr->time_min and job_ptr->time_limit.
@@ -3012,7 +3180,8 @@ static bool _more_work (time_t last_backfill_time)
 	slurm_mutex_lock( &thread_flag_mutex );
 	if ( (last_job_update  >= last_backfill_time ) ||
 	     (last_node_update >= last_backfill_time ) ||
-	     (last_part_update >= last_backfill_time ) ) {
+	     (last_part_update >= last_backfill_time ) ||
+	     (last_license_update >= last_backfill_time ) ) { /*AG licenses freed remotely */
 		rc = true;
 	}
 	slurm_mutex_unlock( &thread_flag_mutex );
@@ -3263,11 +3432,11 @@ static time_t _pack_start_find(job_record_t *job_ptr, time_t now)
 		if (job_ptr->details->begin_time <= now) {
 			if (job_ptr->state_reason == WAIT_TIME) {
 				job_ptr->state_reason = WAIT_NO_REASON;
-				last_job_update = now;
+				job_sched_updated(job_ptr, now);
 			}
 			if (job_ptr->state_reason_prev == WAIT_TIME) {
 				job_ptr->state_reason_prev = WAIT_NO_REASON;
-				last_job_update = now;
+				job_sched_updated(job_ptr, now);
 			}
 		}
 
@@ -3616,7 +3785,7 @@ static void _pack_kill_now(pack_job_map_t *map)
 		job_ptr->details->begin_time = now + cred_lifetime + 1;
 		job_ptr->end_time   = now;
 		job_ptr->job_state  = JOB_PENDING | JOB_COMPLETING;
-		last_job_update     = now;
+		job_updated(job_ptr, now);
 		build_cg_bitmap(job_ptr);
 		job_completion_logger(job_ptr, false);
 		deallocate_nodes(job_ptr, false, false, false);
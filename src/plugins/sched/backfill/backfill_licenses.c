@@ -7,18 +7,26 @@
 
 #include "backfill_licenses.h"
 
+#include "src/common/timers.h"
 #include "src/common/xstring.h"
 #include "src/slurmctld/licenses.h"
 
 #define NOT_IMPLEMENTED 9999
 
+/* most phases taken from a job's license demand profile */
+#define LT_MAX_PHASES 32
+
+/* comment token set by job_submit/lustre_util */
+#define PREDICTED_RUNTIME_KEY "predicted_runtime="
+
 extern pthread_mutex_t license_mutex; /* from "src/slurmctld/licenses.c" */
 
-typedef struct lt_entry_struct{
+struct lt_entry_struct {
   char *name;
   uint32_t total;
+  uint32_t external;    /* remote usage beyond our jobs, no known end */
   utracker_int_t ut;
-} lt_entry_t;
+};
 
 
 
@@ -33,132 +41,289 @@ static time_t _convert_time_fwd(time_t d, int resolution) {
 }
 
 
-void lt_entry_delete(void *x) {
-  lt_entry_t *entry = (lt_entry_t*) x;
-  if(entry) {
-    xfree(entry->name);
-    ut_int_destroy(entry->ut);
-    xfree(entry);
+/*
+ * Finds the tracker entry of a job's license: by id if the job's entry
+ * was interned for the same license_list as the tracker, otherwise by name.
+ */
+static lt_entry_t *_lt_find(lic_tracker_p lt, licenses_t *license_entry) {
+  int i;
+
+  if (license_entry->id_gen == lt->id_gen && license_entry->id < lt->count)
+    return &lt->entries[license_entry->id];
+  for (i = 0; i < lt->count; i++) {
+    if (!xstrcmp(lt->entries[i].name, license_entry->name)) {
+      license_entry->id = i;
+      license_entry->id_gen = lt->id_gen;
+      return &lt->entries[i];
+    }
   }
+  return NULL;
 }
 
 
 
-static int _lt_find_lic_name(void *x, void *key) {
-  lt_entry_t *entry = (lt_entry_t *) x;
-  char *name = (char *) key;
+static time_t _convert_time_ceil(time_t t, int resolution) {
+  return ((t + resolution - 1)/resolution) * resolution;
+}
 
-  if ((entry->name == NULL) || (name == NULL))
+
+
+/*
+ * Reads the demand profile of a job's license from its admin_comment (set by
+ * job_submit/lustre_util, users can't), a token
+ * "<license>_profile=<offset>:<count>,<offset>:<count>...;"
+ * with offsets in seconds from the job start, the first one being 0.
+ *
+ * The phases are widened to whole resolution steps (and by one more step,
+ * as the job may start up to a step after its rounded start time), so the
+ * profile never underestimates the demand. Counts are capped at the
+ * license count of the job, which stays the peak.
+ *
+ * Returns the number of phases stored in "phases" (2*LT_MAX_PHASES at most)
+ * or 0 if the job has no valid profile for the license.
+ */
+static int _job_profile(job_record_t *job_ptr, licenses_t *license_entry,
+                        int resolution, ut_int_phase_t *phases) {
+  ut_int_phase_t raw[LT_MAX_PHASES];
+  time_t bounds[2 * LT_MAX_PHASES], from, to, b;
+  int raw_cnt = 0, bound_cnt = 0, cnt = 0, i, j, value;
+  char *key, *p, *stop;
+  long offset, count;
+
+  if (!job_ptr->admin_comment ||
+      !xstrstr(job_ptr->admin_comment, "_profile="))
     return 0;
-  if (xstrcmp(entry->name, name))
+  key = xstrdup_printf("%s_profile=", license_entry->name);
+  for (p = job_ptr->admin_comment; (p = xstrstr(p, key)); p++) {
+    if (p == job_ptr->admin_comment || p[-1] == ';')
+      break;
+  }
+  if (p)
+    p += strlen(key);
+  xfree(key);
+  if (!p)
     return 0;
-  return 1;
+
+  while (1) {
+    offset = strtol(p, &stop, 10);
+    if (stop == p || *stop != ':')
+      goto bad;
+    p = stop + 1;
+    count = strtol(p, &stop, 10);
+    if (stop == p || count < 0)
+      goto bad;
+    if (raw_cnt == 0 ? offset != 0 : offset <= raw[raw_cnt - 1].offset)
+      goto bad;
+    if (raw_cnt == LT_MAX_PHASES)
+      goto bad;
+    raw[raw_cnt].offset = offset;
+    raw[raw_cnt].value = MIN(count, license_entry->total);
+    raw_cnt++;
+    if (*stop != ',')
+      break;
+    p = stop + 1;
+  }
+  if (*stop != ';' && *stop != '\0')
+    goto bad;
+
+  /* breakpoints: where each phase starts and ends after widening */
+  for (i = 0; i < raw_cnt; i++) {
+    bounds[bound_cnt++] = _convert_time_floor(raw[i].offset, resolution);
+    if (i + 1 < raw_cnt)
+      bounds[bound_cnt++] = _convert_time_ceil(raw[i + 1].offset + resolution,
+                                               resolution);
+  }
+  for (i = 1; i < bound_cnt; i++) {
+    b = bounds[i];
+    for (j = i; j > 0 && bounds[j - 1] > b; j--)
+      bounds[j] = bounds[j - 1];
+    bounds[j] = b;
+  }
+  /* each step between breakpoints gets the most any phase covering it needs */
+  for (j = 0; j < bound_cnt; j++) {
+    if (j > 0 && bounds[j] == bounds[j - 1])
+      continue;
+    value = 0;
+    for (i = 0; i < raw_cnt; i++) {
+      from = _convert_time_floor(raw[i].offset, resolution);
+      to = (i + 1 < raw_cnt)
+          ? _convert_time_ceil(raw[i + 1].offset + resolution, resolution)
+          : bounds[j] + 1;
+      if (from <= bounds[j] && bounds[j] < to)
+        value = MAX(value, raw[i].value);
+    }
+    if (cnt > 0 && phases[cnt - 1].value == value)
+      continue;
+    phases[cnt].offset = bounds[j];
+    phases[cnt].value = value;
+    cnt++;
+  }
+  return cnt;
+
+bad:
+  error("%s: %pJ has malformed %s profile in admin comment \"%s\" -- using the peak",
+        __func__, job_ptr, license_entry->name, job_ptr->admin_comment);
+  return 0;
 }
 
 
 
-void dump_lic_tracker(lic_tracker_p lt) {
-  ListIterator iter = list_iterator_create(lt->tracker);
-  lt_entry_t *entry;
-  debug3("dumping licenses tracker; resolution: %d", lt->resolution);
-  while ((entry = list_next(iter))) {
-    debug3("license: %s, total: %d", entry->name, entry->total);
-    ut_int_dump(entry->ut);
+uint32_t backfill_predicted_limit(job_record_t *job_ptr, uint32_t time_limit) {
+  char *p, *stop;
+  long runtime;
+
+  if (!job_ptr->admin_comment)
+    return time_limit;
+  for (p = job_ptr->admin_comment; (p = xstrstr(p, PREDICTED_RUNTIME_KEY));
+       p++) {
+    if (p == job_ptr->admin_comment || p[-1] == ';')
+      break;
+  }
+  if (!p)
+    return time_limit;
+  p += strlen(PREDICTED_RUNTIME_KEY);
+  runtime = strtol(p, &stop, 10);
+  if (stop == p || (*stop != ';' && *stop != '\0') || runtime <= 0) {
+    debug2("%s: %pJ has malformed predicted runtime in admin comment \"%s\"",
+           __func__, job_ptr, job_ptr->admin_comment);
+    return time_limit;
   }
-  list_iterator_destroy(iter);
+  return MIN(runtime, time_limit);
 }
 
 
 
-void lt_return_lic(lic_tracker_p lt, job_record_t *job_ptr) {
-  /*AG TODO: implement reservations */
-  ListIterator j_iter = list_iterator_create(job_ptr->license_list);
-  licenses_t *license_entry;
-  lt_entry_t *lt_entry;
-  while ((license_entry = list_next(j_iter))) {
-    lt_entry = list_find_first(lt->tracker, _lt_find_lic_name, license_entry->name);
-    if (lt_entry) {
-      // returning a little
-      time_t t = _convert_time_fwd(job_ptr->end_time, lt->resolution);
-      ut_int_remove_till_end(lt_entry->ut, t,license_entry->total);
-    } else {
-      error("%s: Job %pJ returned unknown license \"%s\"", __func__, job_ptr,
-          license_entry->name);
-    }
+time_t backfill_predicted_end(job_record_t *job_ptr, time_t now) {
+  uint32_t limit;
+  time_t run, predicted, end;
+
+  if ((job_ptr->time_limit == NO_VAL) || (job_ptr->time_limit == INFINITE))
+    limit = INFINITE;
+  else
+    limit = job_ptr->time_limit;
+  predicted = backfill_predicted_limit(job_ptr, limit);
+  if (predicted == limit || !job_ptr->start_time)
+    return 0;
+  predicted *= 60;
+  run = now - job_ptr->start_time - job_ptr->tot_sus_time;
+  while (predicted <= run)
+    predicted *= 2;
+  end = now + (predicted - run);
+  if (end >= job_ptr->end_time)
+    return 0;
+  return end;
+}
+
+
+
+void dump_lic_tracker(lic_tracker_p lt) {
+  lt_entry_t *entry;
+  int i;
+
+  if (!lt || !lt->dump)
+    return;
+  info("dumping licenses tracker; resolution: %d", lt->resolution);
+  for (i = 0; i < lt->count; i++) {
+    entry = &lt->entries[i];
+    info("license: %s, total: %d", entry->name, entry->total);
+    ut_int_dump(entry->ut);
   }
-  list_iterator_destroy(j_iter);
-  debug3("%s: Job %pJ returned licenses", __func__, job_ptr);
-  dump_lic_tracker(lt);
 }
 
 
 
 void
 destroy_lic_tracker(lic_tracker_p lt) {
-  list_destroy(lt->tracker);
+  int i;
+
+  for (i = 0; i < lt->count; i++) {
+    xfree(lt->entries[i].name);
+    ut_int_destroy(lt->entries[i].ut);
+  }
+  xfree(lt->entries);
   xfree(lt);
 }
 
 
 
+/*
+ * Builds the tracker from the license return timeline that licenses.c
+ * maintains as jobs start and end (see licenses_t.returns), so running
+ * jobs don't have to be scanned.
+ */
 lic_tracker_p
 init_lic_tracker(int resolution) {
   licenses_t *license_entry;
+  lic_return_t *ret;
   ListIterator iter;
   lic_tracker_p res = NULL;
-  job_record_t *tmp_job_ptr;
+  uint32_t i;
+
+  /*AG TODO: implement reservations */
 
   /* create licenses tracker */
   slurm_mutex_lock(&license_mutex);
   if (license_list) {
     res = xmalloc(sizeof(lic_tracker_t));
-    res->tracker = list_create(lt_entry_delete);
+    res->count = list_count(license_list);
+    res->entries = xcalloc(MAX(res->count, 1), sizeof(lt_entry_t));
+    res->id_gen = license_id_gen;
     res->resolution = resolution;
     iter = list_iterator_create(license_list);
     while ((license_entry = list_next(iter))) {
-      lt_entry_t *entry = xmalloc(sizeof(lt_entry_t));
+      /* license_list entries are always interned */
+      xassert(license_entry->id_gen == license_id_gen);
+      lt_entry_t *entry = &res->entries[license_entry->id];
       entry->name = xstrdup(license_entry->name);
       entry->total = license_entry->total;
-      entry->ut = ut_int_create(license_entry->used > license_entry->r_used
-          ? license_entry->used : license_entry->r_used);
-      list_push(res->tracker, entry);
+      entry->external = license_entry->r_used > license_entry->used
+          ? license_entry->r_used - license_entry->used : 0;
+      entry->ut = ut_int_create(license_entry->used + entry->external);
+      /* running jobs return their licenses */
+      for (i = 0; i < license_entry->return_cnt; i++) {
+        ret = &license_entry->returns[i];
+        if (ret->end_time == 0) {
+          error("%s: %u licenses %s held by active jobs with zero end_time",
+                __func__, ret->count, license_entry->name);
+          continue;
+        }
+        ut_int_remove_till_end(entry->ut,
+            _convert_time_fwd(ret->end_time, resolution), ret->count);
+      }
     }
     list_iterator_destroy(iter);
   }
   slurm_mutex_unlock(&license_mutex);
 
-  if(!res) return NULL;
+  return res;
+}
 
-  time_t now = time(NULL);
 
-  /*AG TODO: implement reservations */
 
-  /* process running jobs */
-  ListIterator job_iterator = list_iterator_create(job_list);
-  while ((tmp_job_ptr = list_next(job_iterator))) {
-    if (!IS_JOB_RUNNING(tmp_job_ptr) &&
-        !IS_JOB_SUSPENDED(tmp_job_ptr))
-      continue;
-    if (tmp_job_ptr->license_list == NULL) {
-      debug3("%s: %pJ has NULL license list -- skipping",
-            __func__, tmp_job_ptr);
-      continue;
-    }
-    time_t end_time = tmp_job_ptr->end_time;
-    if (end_time == 0) {
-      error("%s: Active %pJ has zero end_time",
-            __func__, tmp_job_ptr);
-      continue;
-    }
-    if (end_time < now) {
-      debug3("%s: %pJ might be finish -- not skipping for now",
-            __func__, tmp_job_ptr);
-    }
-    lt_return_lic(res, tmp_job_ptr);
+void backfill_licenses_return_early(lic_tracker_p lt, job_record_t *job_ptr,
+                                    time_t end) {
+  ListIterator j_iter;
+  licenses_t *license_entry;
+  lt_entry_t *lt_entry;
+  time_t from, to;
+  struct timeval tv;
+
+  if (!job_ptr->license_list || !job_ptr->license_end_time)
+    return;
+  from = _convert_time_fwd(end, lt->resolution);
+  to = _convert_time_fwd(job_ptr->license_end_time, lt->resolution);
+  if (from >= to)
+    return;
+  gettimeofday(&tv, NULL);
+  j_iter = list_iterator_create(job_ptr->license_list);
+  while ((license_entry = list_next(j_iter))) {
+    lt_entry = _lt_find(lt, license_entry);
+    if (lt_entry)
+      ut_int_add_usage(lt_entry->ut, from, to, -(int) license_entry->total);
   }
-  list_iterator_destroy(job_iterator);
-
-  return res;
+  list_iterator_destroy(j_iter);
+  lt->update_usec += slurm_delta_tv(&tv);
+  debug3("%s: %pJ returns its licenses at %ld", __func__, job_ptr, from);
 }
 
 
@@ -176,7 +341,12 @@ int backfill_licenses_overlap(lic_tracker_p lt, job_record_t *job_ptr, time_t wh
 }
 
 
-int backfill_licenses_test_job(lic_tracker_p lt, job_record_t *job_ptr, time_t *when){
+/*
+ * See backfill_licenses_test_job();
+ * with ignore_external, also counts the external usage as available.
+ */
+static int _test_job(lic_tracker_p lt, job_record_t *job_ptr, time_t *when,
+                     bool ignore_external) {
   /*AG TODO: implement reservations */
   /*AG FIXME: should probably use job_ptr->min_time if present */
   /*AG TODO: refactor algorithm */
@@ -185,7 +355,10 @@ int backfill_licenses_test_job(lic_tracker_p lt, job_record_t *job_ptr, time_t *
    * Thus, we will adjust time and duration
    * to what would be used for scheduling. */
   time_t orig_start = _convert_time_floor(*when, lt->resolution);
-  time_t duration = _convert_time_fwd(job_ptr->time_limit * 60, lt->resolution);
+  uint32_t time_limit = lt->predicted
+      ? backfill_predicted_limit(job_ptr, job_ptr->time_limit)
+      : job_ptr->time_limit;
+  time_t duration = _convert_time_fwd(time_limit * 60, lt->resolution);
   if (job_ptr->license_list == NULL) {
     debug3("%s: %pJ has NULL license list -- skipping",
            __func__, job_ptr);
@@ -195,6 +368,8 @@ int backfill_licenses_test_job(lic_tracker_p lt, job_record_t *job_ptr, time_t *
   ListIterator j_iter = list_iterator_create(job_ptr->license_list);
   licenses_t *license_entry;
   lt_entry_t *lt_entry;
+  ut_int_phase_t phases[2 * LT_MAX_PHASES];
+  int phase_cnt, limit;
   time_t curr_start = orig_start;
   time_t prev_start = orig_start;
   enum {
@@ -211,13 +386,27 @@ int backfill_licenses_test_job(lic_tracker_p lt, job_record_t *job_ptr, time_t *
         status = CONTINUE;
         continue;
       }
-      lt_entry = list_find_first(lt->tracker, _lt_find_lic_name, license_entry->name);
+      lt_entry = _lt_find(lt, license_entry);
       if (lt_entry) {
-        curr_start = ut_int_when_below(lt_entry->ut, prev_start, duration,
-            lt_entry->total - license_entry->total + 1);
+        limit = lt_entry->total;
+        if (ignore_external)
+          limit += lt_entry->external;
+        phase_cnt = _job_profile(job_ptr, license_entry, lt->resolution,
+                                 phases);
+        if (phase_cnt)
+          curr_start = ut_int_when_fits(lt_entry->ut, prev_start, duration,
+              phases, phase_cnt, limit);
+        else
+          curr_start = ut_int_when_below(lt_entry->ut, prev_start, duration,
+              limit - license_entry->total + 1);
         if (curr_start == -1) {
-          error("%s: Job %pJ will never get %d license \"%s\"", __func__, job_ptr,
-            license_entry->total, license_entry->name);
+          if (ignore_external)
+            error("%s: Job %pJ will never get %d license \"%s\"", __func__,
+                job_ptr, license_entry->total, license_entry->name);
+          else
+            /* backfill may still reserve them (see reserve_job) */
+            debug2("%s: Job %pJ can't get %d license \"%s\" while the external usage lasts",
+                __func__, job_ptr, license_entry->total, license_entry->name);
           status = CONTINUE;
           rc = SLURM_ERROR;
           break;
@@ -251,6 +440,43 @@ int backfill_licenses_test_job(lic_tracker_p lt, job_record_t *job_ptr, time_t *
 
 
 
+int backfill_licenses_test_job(lic_tracker_p lt, job_record_t *job_ptr, time_t *when){
+  struct timeval tv;
+  int rc;
+
+  gettimeofday(&tv, NULL);
+  rc = _test_job(lt, job_ptr, when, false);
+  lt->test_cnt++;
+  lt->test_usec += slurm_delta_tv(&tv);
+  return rc;
+}
+
+
+
+int backfill_licenses_reserve_job(lic_tracker_p lt, job_record_t *job_ptr,
+                                  time_t *when, time_t latest){
+  time_t start = *when, end;
+  struct timeval tv;
+  int rc;
+
+  gettimeofday(&tv, NULL);
+  rc = _test_job(lt, job_ptr, &start, true);
+  lt->test_cnt++;
+  lt->test_usec += slurm_delta_tv(&tv);
+  if (rc != SLURM_SUCCESS)
+    return SLURM_ERROR;
+  if (start > latest)
+    return EAGAIN;
+  end = start + (lt->predicted
+                 ? backfill_predicted_limit(job_ptr, job_ptr->time_limit)
+                 : job_ptr->time_limit) * 60;
+  debug3("%s: reserving licenses for %pJ from %ld", __func__, job_ptr, start);
+  *when = start;
+  return backfill_licenses_alloc_job(lt, job_ptr, start, end);
+}
+
+
+
 int
 backfill_licenses_alloc_job(lic_tracker_p lt,
                             job_record_t *job_ptr,
@@ -265,19 +491,29 @@ backfill_licenses_alloc_job(lic_tracker_p lt,
   ListIterator j_iter = list_iterator_create(job_ptr->license_list);
   licenses_t *license_entry;
   lt_entry_t *lt_entry;
+  ut_int_phase_t phases[2 * LT_MAX_PHASES];
+  int phase_cnt;
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
   start = _convert_time_floor(start, lt->resolution);
   end = _convert_time_fwd(end, lt->resolution);
   while ((license_entry = list_next(j_iter))) {
-    lt_entry = list_find_first(lt->tracker, _lt_find_lic_name, license_entry->name);
+    lt_entry = _lt_find(lt, license_entry);
     if (lt_entry) {
-      ut_int_add_usage(lt_entry->ut, start, end, license_entry->total);
+      phase_cnt = _job_profile(job_ptr, license_entry, lt->resolution, phases);
+      if (phase_cnt)
+        ut_int_add_profile(lt_entry->ut, start, end, phases, phase_cnt);
+      else
+        ut_int_add_usage(lt_entry->ut, start, end, license_entry->total);
     } else {
       error("%s: Job %pJ require unknown license \"%s\"", __func__, job_ptr,
             license_entry->name);
     }
   }
   list_iterator_destroy(j_iter);
-  debug3("%s: allocated licenses for %pJ :", __func__, job_ptr);
+  lt->update_usec += slurm_delta_tv(&tv);
+  debug3("%s: allocated licenses for %pJ", __func__, job_ptr);
   dump_lic_tracker(lt);
   return SLURM_SUCCESS;
 }
@@ -12,9 +12,19 @@
 
 #include "usage_tracker.h"
 
+typedef struct lt_entry_struct lt_entry_t;
+
 typedef struct lic_tracker_struct {
-  List tracker;
+  lt_entry_t *entries;  /* indexed by licenses_t.id */
+  int count;
+  uint32_t id_gen;      /* license_id_gen the ids are valid for */
   int resolution;
+  bool predicted;       /* plan jobs with their predicted runtime */
+  bool dump;            /* dump on changes (DebugFlags=BackfillMap) */
+  /* counters for sdiag */
+  uint32_t test_cnt;    /* license tests, of reservations and overlaps too */
+  uint64_t test_usec;   /* time spent testing */
+  uint64_t update_usec; /* time spent adding jobs and returning licenses */
 } lic_tracker_t;
 
 typedef lic_tracker_t *lic_tracker_p;
@@ -25,6 +35,33 @@ void destroy_lic_tracker(lic_tracker_p);
 
 void dump_lic_tracker(lic_tracker_p lt);
 
+/*
+ * The time limit to plan a job with: its predicted runtime (minutes),
+ * the "predicted_runtime=<minutes>;" token of its admin_comment set by
+ * job_submit/lustre_util, capped at time_limit
+ * RET: the prediction or time_limit if the job has none
+ */
+uint32_t backfill_predicted_limit(job_record_t *job_ptr, uint32_t time_limit);
+
+/*
+ * Predict when a running job ends from its predicted runtime. A job that
+ * has run longer than predicted is pushed forward: the prediction is
+ * doubled until it is beyond the time the job has run.
+ * IN job_ptr - a running job
+ * IN now     - current time
+ * RET: the predicted end or 0 if it isn't before the job's end_time
+ */
+time_t backfill_predicted_end(job_record_t *job_ptr, time_t now);
+
+/*
+ * Return the licenses of a running job at its predicted end rather than
+ * at the end_time they are registered to be returned at
+ * IN job_ptr - a running job
+ * IN end     - its predicted end (see backfill_predicted_end())
+ */
+void backfill_licenses_return_early(lic_tracker_p lt, job_record_t *job_ptr,
+                                    time_t end);
+
 /*
  * Test when the licenses required for a job are available
  * IN job_ptr   - job identification
@@ -33,6 +70,20 @@ void dump_lic_tracker(lic_tracker_p lt);
  */
 int backfill_licenses_test_job(lic_tracker_p lt, job_record_t *job_ptr, time_t *when);
 
+/*
+ * Reserve the licenses of a job that backfill_licenses_test_job() finds
+ * never available, so that lower priority jobs can't keep taking them.
+ * The remote usage that isn't ours has no known end, so it is assumed
+ * to go away; the job gets the licenses at the earliest time they are not
+ * taken by running or already reserved jobs.
+ * IN job_ptr   - job identification
+ * IN/OUT when  - time to reserve after/reserved at
+ * IN latest    - don't reserve if the job could only start after this time
+ * RET: SLURM_SUCCESS, EAGAIN (not before latest), SLURM_ERROR (never runnable)
+ */
+int backfill_licenses_reserve_job(lic_tracker_p lt, job_record_t *job_ptr,
+                                  time_t *when, time_t latest);
+
 int backfill_licenses_overlap(lic_tracker_p lt, job_record_t *job_ptr, time_t when);
 
 /*
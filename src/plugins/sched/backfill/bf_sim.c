@@ -0,0 +1,689 @@
+/*
+ * bf_sim.c
+ *
+ * Offline simulator of the backfill license scheduling.
+ *
+ * Replays a job trace against a virtual clock using the license tracker
+ * (backfill_licenses.c) and usage tracker (usage_tracker.c) of the backfill
+ * plugin. The rest of _attempt_backfill() needs a whole slurmctld, so nodes
+ * are modeled as a single pool tracked with a usage tracker too, and jobs
+ * are considered in submit order.
+ *
+ * Usage: bf_sim [options] <trace>
+ *   -n <nodes>         nodes in the pool (default 100)
+ *   -L <name>:<count>  a license (default lustre:1000), can be repeated
+ *   -r <seconds>       bf_resolution (default 60)
+ *   -w <minutes>       bf_window (default 1440)
+ *   -i <seconds>       bf_interval, time between cycles (default 30)
+ *   -m <count>         bf_max_lic_resv (default 1)
+ *   -u <file>          remote usage series
+ *   -v                 more verbose logging (repeatable)
+ *
+ * Trace lines (# starts a comment):
+ *   <submit> <nodes> <time_limit_min> <runtime_sec> <licenses> [<comment>]
+ * where <licenses> is "-" or "name:count[,name:count...]" and <comment>
+ * is the job admin comment, e.g. "lustre_profile=0:40,600:5;".
+ *
+ * Remote usage lines: <time> <license> <count>
+ * The external usage of the license from that time on; the usage of the
+ * running jobs (following their profile if any) is added to it to get the
+ * remotely measured usage (licenses_t.r_used).
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "src/common/log.h"
+#include "src/common/xassert.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include "backfill_licenses.h"
+#include "src/slurmctld/licenses.h"
+
+/* normally from "src/slurmctld/licenses.c" */
+List license_list = NULL;
+pthread_mutex_t license_mutex = PTHREAD_MUTEX_INITIALIZER;
+uint32_t license_id_gen = 1;
+
+typedef struct sim_job_struct {
+  job_record_t *job_ptr;
+  time_t submit;
+  uint32_t nodes;
+  time_t runtime;
+  bool started;
+  time_t start;
+  time_t end;           /* actual end */
+  bool finished;
+} sim_job_t;
+
+typedef struct sim_usage_struct {
+  time_t time;
+  int line;
+  licenses_t *license;
+  uint32_t count;
+} sim_usage_t;
+
+static int nodes_total = 100;
+static int resolution = 60;
+static int window = 1440 * 60;
+static int interval = 30;
+static int max_lic_resv = 1;
+
+static sim_job_t *jobs = NULL;
+static int job_cnt = 0;
+static sim_usage_t *usages = NULL;
+static int usage_cnt = 0;
+static uint32_t *external = NULL;   /* indexed by licenses_t.id */
+
+/* statistics */
+static int cycle_cnt = 0;
+static double cycle_sum = 0, cycle_max = 0;
+static double busy_node_sec = 0;
+static long headroom_cnt = 0;
+static double *headroom_sum = NULL;
+static uint32_t *headroom_min = NULL;
+
+
+
+static void _usage(void)
+{
+  fprintf(stderr, "Usage: bf_sim [-n nodes] [-L name:count]... "
+          "[-r resolution] [-w window_min] [-i interval] [-m max_lic_resv] "
+          "[-u usage_file] [-v] <trace>\n");
+  exit(1);
+}
+
+
+
+static licenses_t *_find_license(char *name)
+{
+  licenses_t *license;
+  ListIterator iter = list_iterator_create(license_list);
+
+  while ((license = list_next(iter))) {
+    if (!xstrcmp(license->name, name))
+      break;
+  }
+  list_iterator_destroy(iter);
+  return license;
+}
+
+
+
+static void _add_license(char *spec)
+{
+  char *colon = xstrchr(spec, ':');
+  licenses_t *license;
+
+  if (!colon || atoi(colon + 1) <= 0) {
+    fprintf(stderr, "bf_sim: malformed license \"%s\"\n", spec);
+    exit(1);
+  }
+  license = xmalloc(sizeof(licenses_t));
+  license->name = xstrndup(spec, colon - spec);
+  license->total = atoi(colon + 1);
+  license->id = list_count(license_list);
+  license->id_gen = license_id_gen;
+  list_append(license_list, license);
+}
+
+
+
+static void _free_license(void *x)
+{
+  licenses_t *license = (licenses_t *) x;
+
+  if (license) {
+    xfree(license->name);
+    xfree(license->returns);
+    xfree(license);
+  }
+}
+
+
+
+/* the job's license list, as license_validate() would build it */
+static List _job_licenses(char *spec, int line)
+{
+  List list = list_create(_free_license);
+  char *tmp, *tok, *save = NULL, *colon;
+  licenses_t *license;
+
+  if (!xstrcmp(spec, "-"))
+    return list;
+  tmp = xstrdup(spec);
+  for (tok = strtok_r(tmp, ",", &save); tok;
+       tok = strtok_r(NULL, ",", &save)) {
+    colon = xstrchr(tok, ':');
+    if (!colon || atoi(colon + 1) <= 0) {
+      fprintf(stderr, "bf_sim: line %d: malformed licenses \"%s\"\n",
+              line, spec);
+      exit(1);
+    }
+    *colon = '\0';
+    if (!_find_license(tok)) {
+      fprintf(stderr, "bf_sim: line %d: unknown license \"%s\"\n", line, tok);
+      exit(1);
+    }
+    license = xmalloc(sizeof(licenses_t));
+    license->name = xstrdup(tok);
+    license->total = atoi(colon + 1);
+    list_append(list, license);
+  }
+  xfree(tmp);
+  return list;
+}
+
+
+
+static int _cmp_job(const void *a, const void *b)
+{
+  const sim_job_t *x = a, *y = b;
+
+  if (x->submit != y->submit)
+    return x->submit < y->submit ? -1 : 1;
+  return x->job_ptr->job_id < y->job_ptr->job_id ? -1 : 1;
+}
+
+
+
+static void _read_trace(char *path)
+{
+  FILE *fp = fopen(path, "r");
+  char buf[4096], lic[1024], comment[2048];
+  long submit, nodes, limit, runtime;
+  job_record_t *job_ptr;
+  sim_job_t *job;
+  int line = 0, n;
+
+  if (!fp) {
+    perror(path);
+    exit(1);
+  }
+  while (fgets(buf, sizeof(buf), fp)) {
+    line++;
+    if (buf[0] == '#' || buf[strspn(buf, " \t\n")] == '\0')
+      continue;
+    comment[0] = '\0';
+    n = sscanf(buf, "%ld %ld %ld %ld %1023s %2047s", &submit, &nodes,
+               &limit, &runtime, lic, comment);
+    if (n < 5 || submit < 0 || nodes < 1 || limit < 1 || runtime < 0) {
+      fprintf(stderr, "bf_sim: %s:%d: malformed job\n", path, line);
+      exit(1);
+    }
+    if (nodes > nodes_total) {
+      fprintf(stderr, "bf_sim: %s:%d: job needs %ld of %d nodes, skipped\n",
+              path, line, nodes, nodes_total);
+      continue;
+    }
+    job_ptr = xmalloc(sizeof(job_record_t));
+    job_ptr->magic = JOB_MAGIC;
+    job_ptr->job_id = job_cnt + 1;
+    job_ptr->array_task_id = NO_VAL;
+    job_ptr->time_limit = limit;
+    job_ptr->license_list = _job_licenses(lic, line);
+    if (comment[0])
+      job_ptr->admin_comment = xstrdup(comment);
+
+    xrecalloc(jobs, job_cnt + 1, sizeof(sim_job_t));
+    job = &jobs[job_cnt++];
+    job->job_ptr = job_ptr;
+    job->submit = submit;
+    job->nodes = nodes;
+    job->runtime = MIN(runtime, limit * 60);
+  }
+  fclose(fp);
+  qsort(jobs, job_cnt, sizeof(sim_job_t), _cmp_job);
+}
+
+
+
+static int _cmp_usage(const void *a, const void *b)
+{
+  const sim_usage_t *x = a, *y = b;
+
+  if (x->time != y->time)
+    return x->time < y->time ? -1 : 1;
+  return x->line - y->line;
+}
+
+
+
+static void _read_usage(char *path)
+{
+  FILE *fp = fopen(path, "r");
+  char buf[1024], name[256];
+  long time, count;
+  licenses_t *license;
+  int line = 0;
+
+  if (!fp) {
+    perror(path);
+    exit(1);
+  }
+  while (fgets(buf, sizeof(buf), fp)) {
+    line++;
+    if (buf[0] == '#' || buf[strspn(buf, " \t\n")] == '\0')
+      continue;
+    if (sscanf(buf, "%ld %255s %ld", &time, name, &count) != 3 ||
+        count < 0 || !(license = _find_license(name))) {
+      fprintf(stderr, "bf_sim: %s:%d: malformed usage\n", path, line);
+      exit(1);
+    }
+    xrecalloc(usages, usage_cnt + 1, sizeof(sim_usage_t));
+    usages[usage_cnt].time = time;
+    usages[usage_cnt].line = line;
+    usages[usage_cnt].license = license;
+    usages[usage_cnt].count = count;
+    usage_cnt++;
+  }
+  fclose(fp);
+  /* later lines for the same time win */
+  qsort(usages, usage_cnt, sizeof(sim_usage_t), _cmp_usage);
+}
+
+
+
+/* the usage of a running job's license "elapsed" seconds after its start */
+static uint32_t _job_usage(job_record_t *job_ptr, licenses_t *job_lic,
+                           time_t elapsed)
+{
+  char *key, *p;
+  long offset, count;
+  uint32_t usage = job_lic->total;
+
+  if (!job_ptr->admin_comment)
+    return usage;
+  key = xstrdup_printf("%s_profile=", job_lic->name);
+  p = xstrstr(job_ptr->admin_comment, key);
+  if (p) {
+    p += strlen(key);
+    while (sscanf(p, "%ld:%ld", &offset, &count) == 2 && offset <= elapsed) {
+      usage = MIN(count, job_lic->total);
+      p += strcspn(p, ",;");
+      if (*p != ',')
+        break;
+      p++;
+    }
+  }
+  xfree(key);
+  return usage;
+}
+
+
+
+/* what license_job_get() does with the license timeline */
+static void _license_get(sim_job_t *job, time_t now)
+{
+  job_record_t *job_ptr = job->job_ptr;
+  ListIterator iter = list_iterator_create(job_ptr->license_list);
+  licenses_t *job_lic, *license;
+  lic_return_t *ret;
+  uint32_t i;
+
+  job_ptr->end_time = now + job_ptr->time_limit * 60;
+  while ((job_lic = list_next(iter))) {
+    license = _find_license(job_lic->name);
+    license->used += job_lic->total;
+    if (license->return_cnt == license->return_size) {
+      license->return_size = license->return_size ? license->return_size * 2
+                                                  : 16;
+      xrecalloc(license->returns, license->return_size, sizeof(lic_return_t));
+    }
+    for (i = license->return_cnt;
+         i > 0 && license->returns[i - 1].end_time > job_ptr->end_time; i--)
+      license->returns[i] = license->returns[i - 1];
+    ret = &license->returns[i];
+    ret->end_time = job_ptr->end_time;
+    ret->count = job_lic->total;
+    license->return_cnt++;
+  }
+  list_iterator_destroy(iter);
+}
+
+
+
+/* what license_job_return() does with the license timeline */
+static void _license_return(sim_job_t *job)
+{
+  job_record_t *job_ptr = job->job_ptr;
+  ListIterator iter = list_iterator_create(job_ptr->license_list);
+  licenses_t *job_lic, *license;
+  uint32_t i;
+
+  job->finished = true;
+  while ((job_lic = list_next(iter))) {
+    license = _find_license(job_lic->name);
+    license->used -= job_lic->total;
+    for (i = 0; i < license->return_cnt; i++) {
+      if (license->returns[i].end_time == job_ptr->end_time &&
+          license->returns[i].count == job_lic->total)
+        break;
+    }
+    xassert(i < license->return_cnt);
+    license->return_cnt--;
+    memmove(&license->returns[i], &license->returns[i + 1],
+            (license->return_cnt - i) * sizeof(lic_return_t));
+  }
+  list_iterator_destroy(iter);
+}
+
+
+
+/* what license_job_test() checks before a job starts */
+static bool _license_test(job_record_t *job_ptr)
+{
+  ListIterator iter = list_iterator_create(job_ptr->license_list);
+  licenses_t *job_lic, *license;
+  bool ok = true;
+
+  while ((job_lic = list_next(iter))) {
+    license = _find_license(job_lic->name);
+    if (job_lic->total + MAX(license->used, license->r_used) >
+        license->total) {
+      ok = false;
+      break;
+    }
+  }
+  list_iterator_destroy(iter);
+  return ok;
+}
+
+
+
+/* recomputes licenses_t.r_used as the remote metrics would report it */
+static void _update_r_used(time_t now)
+{
+  ListIterator iter = list_iterator_create(license_list);
+  licenses_t *license, *job_lic, *match;
+  ListIterator j_iter;
+  int i;
+
+  while ((license = list_next(iter)))
+    license->r_used = external[license->id];
+  list_iterator_destroy(iter);
+  for (i = 0; i < job_cnt; i++) {
+    if (!jobs[i].started || jobs[i].end <= now)
+      continue;
+    j_iter = list_iterator_create(jobs[i].job_ptr->license_list);
+    while ((job_lic = list_next(j_iter))) {
+      match = _find_license(job_lic->name);
+      match->r_used += _job_usage(jobs[i].job_ptr, job_lic,
+                                  now - jobs[i].start);
+    }
+    list_iterator_destroy(j_iter);
+  }
+}
+
+
+
+/* one backfill cycle at time "now"; returns the number of jobs started */
+static int _cycle(time_t now)
+{
+  struct timespec t0, t1;
+  utracker_int_t nodes;
+  lic_tracker_p lt;
+  sim_job_t *job;
+  time_t start, prev, duration, end;
+  int i, used_nodes = 0, started = 0, lic_resv_cnt = 0;
+  double elapsed;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+
+  for (i = 0; i < job_cnt; i++) {
+    if (jobs[i].started && jobs[i].end > now)
+      used_nodes += jobs[i].nodes;
+  }
+  nodes = ut_int_create(used_nodes);
+  for (i = 0; i < job_cnt; i++) {
+    if (jobs[i].started && jobs[i].end > now)
+      ut_int_remove_till_end(nodes,
+          (jobs[i].job_ptr->end_time / resolution + 1) * resolution,
+          jobs[i].nodes);
+  }
+  lt = init_lic_tracker(resolution);
+
+  for (i = 0; i < job_cnt; i++) {
+    job = &jobs[i];
+    if (job->started || job->submit > now)
+      continue;
+    duration = (job->job_ptr->time_limit * 60 / resolution + 1) * resolution;
+
+    /* the earliest time both licenses and nodes are available */
+    start = now;
+    do {
+      prev = start;
+      if (backfill_licenses_test_job(lt, job->job_ptr, &start) !=
+          SLURM_SUCCESS) {
+        start = now;
+        if (lic_resv_cnt < max_lic_resv &&
+            backfill_licenses_reserve_job(lt, job->job_ptr, &start,
+                                          now + window) == SLURM_SUCCESS) {
+          lic_resv_cnt++;
+          debug("%pJ reserved licenses at %ld", job->job_ptr, start);
+        }
+        start = -1;
+        break;
+      }
+      start = ut_int_when_below(nodes, start, duration,
+                                nodes_total - job->nodes + 1);
+    } while (start != -1 && start != prev);
+    if (start == -1)
+      continue;
+
+    if (start <= now && _license_test(job->job_ptr)) {
+      job->started = true;
+      job->start = now;
+      job->end = now + job->runtime;
+      _license_get(job, now);
+      end = job->job_ptr->end_time;
+      started++;
+      debug("%pJ started, waited %ld", job->job_ptr, now - job->submit);
+    } else if (start < now + window) {
+      /* reservation */
+      start = MAX(start, now + 1);
+      end = start + job->job_ptr->time_limit * 60;
+    } else {
+      continue;
+    }
+    ut_int_add_usage(nodes, (start / resolution) * resolution,
+                     (end / resolution + 1) * resolution, job->nodes);
+    backfill_licenses_alloc_job(lt, job->job_ptr, start, end);
+  }
+
+  destroy_lic_tracker(lt);
+  ut_int_destroy(nodes);
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  elapsed = (t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_nsec - t0.tv_nsec) / 1e3;
+  cycle_cnt++;
+  cycle_sum += elapsed;
+  cycle_max = MAX(cycle_max, elapsed);
+  return started;
+}
+
+
+
+static void _sample(time_t now, time_t step)
+{
+  ListIterator iter = list_iterator_create(license_list);
+  licenses_t *license;
+  uint32_t headroom;
+  int i;
+
+  for (i = 0; i < job_cnt; i++) {
+    if (jobs[i].started && jobs[i].end > now)
+      busy_node_sec += (double) jobs[i].nodes *
+                       MIN(step, jobs[i].end - now);
+  }
+  while ((license = list_next(iter))) {
+    headroom = license->total - MIN(license->total,
+                                    MAX(license->used, license->r_used));
+    headroom_sum[license->id] += headroom;
+    if (!headroom_cnt || headroom < headroom_min[license->id])
+      headroom_min[license->id] = headroom;
+  }
+  list_iterator_destroy(iter);
+  headroom_cnt++;
+}
+
+
+
+static int _cmp_time(const void *a, const void *b)
+{
+  time_t x = *(const time_t *) a, y = *(const time_t *) b;
+
+  return (x > y) - (x < y);
+}
+
+
+
+static void _report(time_t first, time_t last)
+{
+  ListIterator iter = list_iterator_create(license_list);
+  time_t *waits = xcalloc(MAX(job_cnt, 1), sizeof(time_t));
+  licenses_t *license;
+  double sum = 0;
+  int i, cnt = 0;
+
+  for (i = 0; i < job_cnt; i++) {
+    if (jobs[i].started) {
+      waits[cnt] = jobs[i].start - jobs[i].submit;
+      sum += waits[cnt++];
+    }
+  }
+  qsort(waits, cnt, sizeof(time_t), _cmp_time);
+
+  printf("jobs:              %d started, %d never started\n",
+         cnt, job_cnt - cnt);
+  printf("simulated time:    %ld s\n", (long) (last - first));
+  printf("cycles:            %d, mean %.1f us, max %.1f us\n", cycle_cnt,
+         cycle_cnt ? cycle_sum / cycle_cnt : 0.0, cycle_max);
+  printf("node utilization:  %.1f%%\n", last > first ?
+         100.0 * busy_node_sec / ((double) nodes_total * (last - first)) : 0);
+  while ((license = list_next(iter))) {
+    printf("license %-10s headroom mean %.1f, min %u of %u\n", license->name,
+           headroom_cnt ? headroom_sum[license->id] / headroom_cnt : 0.0,
+           headroom_min[license->id], license->total);
+  }
+  list_iterator_destroy(iter);
+  if (cnt) {
+    printf("wait time (s):     mean %.0f, p50 %ld, p90 %ld, p99 %ld, max %ld\n",
+           sum / cnt, (long) waits[cnt / 2], (long) waits[cnt * 9 / 10],
+           (long) waits[cnt * 99 / 100], (long) waits[cnt - 1]);
+  }
+  xfree(waits);
+}
+
+
+
+int main(int argc, char **argv)
+{
+  log_options_t log_opts = LOG_OPTS_STDERR_ONLY;
+  time_t now, first, last = 0;
+  int opt, i, next_usage = 0, done = 0, lic_cnt;
+  char *usage_file = NULL;
+
+  log_opts.stderr_level = LOG_LEVEL_ERROR;
+  license_list = list_create(_free_license);
+  while ((opt = getopt(argc, argv, "n:L:r:w:i:m:u:v")) != -1) {
+    switch (opt) {
+    case 'n':
+      nodes_total = atoi(optarg);
+      break;
+    case 'L':
+      _add_license(optarg);
+      break;
+    case 'r':
+      resolution = atoi(optarg);
+      break;
+    case 'w':
+      window = atoi(optarg) * 60;
+      break;
+    case 'i':
+      interval = atoi(optarg);
+      break;
+    case 'm':
+      max_lic_resv = atoi(optarg);
+      break;
+    case 'u':
+      usage_file = optarg;
+      break;
+    case 'v':
+      log_opts.stderr_level++;
+      break;
+    default:
+      _usage();
+    }
+  }
+  if (optind != argc - 1 || nodes_total < 1 || resolution < 1 ||
+      window < 1 || interval < 1 || max_lic_resv < 0)
+    _usage();
+  log_init("bf_sim", log_opts, 0, NULL);
+  if (list_is_empty(license_list))
+    _add_license("lustre:1000");
+  lic_cnt = list_count(license_list);
+  external = xcalloc(lic_cnt, sizeof(uint32_t));
+  headroom_sum = xcalloc(lic_cnt, sizeof(double));
+  headroom_min = xcalloc(lic_cnt, sizeof(uint32_t));
+
+  _read_trace(argv[optind]);
+  if (usage_file)
+    _read_usage(usage_file);
+  if (!job_cnt) {
+    fprintf(stderr, "bf_sim: no jobs\n");
+    return 1;
+  }
+
+  first = jobs[0].submit;
+  for (now = first; done < job_cnt; now += interval) {
+    /* finish the jobs that ended by now */
+    for (i = 0; i < job_cnt; i++) {
+      if (jobs[i].started && !jobs[i].finished && jobs[i].end <= now) {
+        _license_return(&jobs[i]);
+        done++;
+        last = MAX(last, jobs[i].end);
+      }
+    }
+    while (next_usage < usage_cnt && usages[next_usage].time <= now) {
+      external[usages[next_usage].license->id] = usages[next_usage].count;
+      next_usage++;
+    }
+    _update_r_used(now);
+    _cycle(now);
+    /* a job can start and end within one interval */
+    for (i = 0; i < job_cnt; i++) {
+      if (jobs[i].started && jobs[i].start == now && jobs[i].end <= now) {
+        _license_return(&jobs[i]);
+        done++;
+        last = MAX(last, jobs[i].end);
+      }
+    }
+    _update_r_used(now);
+    _sample(now, interval);
+    if (now - first > 365 * 24 * 3600) {
+      fprintf(stderr, "bf_sim: giving up after a year of simulated time\n");
+      break;
+    }
+  }
+
+  _report(first, MAX(last, now));
+
+  for (i = 0; i < job_cnt; i++) {
+    FREE_NULL_LIST(jobs[i].job_ptr->license_list);
+    xfree(jobs[i].job_ptr->admin_comment);
+    xfree(jobs[i].job_ptr);
+  }
+  xfree(jobs);
+  xfree(usages);
+  xfree(external);
+  xfree(headroom_sum);
+  xfree(headroom_min);
+  FREE_NULL_LIST(license_list);
+  log_fini();
+  return 0;
+}
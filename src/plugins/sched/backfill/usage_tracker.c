@@ -7,37 +7,246 @@
  *      Author: alex
  */
 
-#include <time.h>
+#include <inttypes.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <time.h>
 
-#include "src/common/list.h"
+#include "src/common/macros.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xassert.h"
 #include "usage_tracker.h"
 
 #include "src/common/log.h"
-#define log(...) debug3(__VA_ARGS__)
+#define log(...) info(__VA_ARGS__)
 
+#define UT_INIT_SIZE 16
+#define UT_NIL 0		/* node index of an empty subtree */
 
-typedef struct ut_int_struct {
+
+/*
+ * Breakpoint of the step function, a node of a treap ordered by start and
+ * heap ordered by _prio() of its index. "add" is still to be added to the
+ * values of both subtrees; "value", "min" and "max" (over the subtree)
+ * already include it. 32 bytes, two nodes per cache line.
+ */
+typedef struct ut_int_node_struct {
   time_t start;
   int value;
-} ut_int_item_t;
+  int min;
+  int max;
+  int add;
+  int left;
+  int right;
+} ut_int_node_t;
+
+/*
+ * The value is a node's value from its start until the next start. Nodes
+ * live in one array grown by doubling, linked by index (0 is unused and
+ * stands for none), and freed nodes are chained through "right".
+ */
+struct ut_int_struct {
+  ut_int_node_t *nodes;
+  int size;
+  int used;
+  int free_list;
+  int root;
+};
+
+
+/*
+ * Treap priority of node n: a mix of its index (the finalizer of
+ * MurmurHash3), which is unrelated to its start even when nodes are
+ * added in time order.
+ */
+static inline uint32_t
+_prio(int n) {
+  uint32_t h = n;
+
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+
+static int
+_new_node(utracker_int_t ut, time_t start, int value) {
+  ut_int_node_t *node;
+  int n;
+
+  if (ut->free_list != UT_NIL) {
+    n = ut->free_list;
+    ut->free_list = ut->nodes[n].right;
+  } else {
+    if (ut->used == ut->size) {
+      ut->size *= 2;
+      xrecalloc(ut->nodes, ut->size, sizeof(ut_int_node_t));
+    }
+    n = ut->used++;
+  }
+
+  node = &ut->nodes[n];
+  node->start = start;
+  node->value = node->min = node->max = value;
+  node->add = 0;
+  node->left = node->right = UT_NIL;
+  return n;
+}
+
+
+static void
+_free_node(utracker_int_t ut, int n) {
+  ut->nodes[n].right = ut->free_list;
+  ut->free_list = n;
+}
+
+
+static void
+_apply(utracker_int_t ut, int n, int add) {
+  ut_int_node_t *node;
+
+  if (n == UT_NIL)
+    return;
+  node = &ut->nodes[n];
+  node->value += add;
+  node->min += add;
+  node->max += add;
+  node->add += add;
+}
+
+
+static void
+_push(utracker_int_t ut, int n) {
+  ut_int_node_t *node = &ut->nodes[n];
+
+  if (node->add) {
+    _apply(ut, node->left, node->add);
+    _apply(ut, node->right, node->add);
+    node->add = 0;
+  }
+}
+
+
+static void
+_pull(utracker_int_t ut, int n) {
+  ut_int_node_t *node = &ut->nodes[n], *child;
+
+  node->min = node->max = node->value;
+  if (node->left != UT_NIL) {
+    child = &ut->nodes[node->left];
+    node->min = MIN(node->min, child->min);
+    node->max = MAX(node->max, child->max);
+  }
+  if (node->right != UT_NIL) {
+    child = &ut->nodes[node->right];
+    node->min = MIN(node->min, child->min);
+    node->max = MAX(node->max, child->max);
+  }
+}
+
+
+/* splits n into *l with the starts before t and *r with the others */
+static void
+_split(utracker_int_t ut, int n, time_t t, int *l, int *r) {
+  if (n == UT_NIL) {
+    *l = *r = UT_NIL;
+    return;
+  }
+  _push(ut, n);
+  if (ut->nodes[n].start < t) {
+    _split(ut, ut->nodes[n].right, t, &ut->nodes[n].right, r);
+    *l = n;
+  } else {
+    _split(ut, ut->nodes[n].left, t, l, &ut->nodes[n].left);
+    *r = n;
+  }
+  _pull(ut, n);
+}
+
+
+/* joins l and r, all starts in l being before those in r */
+static int
+_merge(utracker_int_t ut, int l, int r) {
+  if (l == UT_NIL)
+    return r;
+  if (r == UT_NIL)
+    return l;
+  if (_prio(l) > _prio(r)) {
+    _push(ut, l);
+    ut->nodes[l].right = _merge(ut, ut->nodes[l].right, r);
+    _pull(ut, l);
+    return l;
+  }
+  _push(ut, r);
+  ut->nodes[r].left = _merge(ut, l, ut->nodes[r].left);
+  _pull(ut, r);
+  return r;
+}
+
+
+static int
+_first(utracker_int_t ut, int n) {
+  while (ut->nodes[n].left != UT_NIL) {
+    _push(ut, n);
+    n = ut->nodes[n].left;
+  }
+  return n;
+}
+
+
+static int
+_last(utracker_int_t ut, int n) {
+  while (ut->nodes[n].right != UT_NIL) {
+    _push(ut, n);
+    n = ut->nodes[n].right;
+  }
+  return n;
+}
+
+
+static int
+_remove_first(utracker_int_t ut, int n) {
+  int right;
+
+  _push(ut, n);
+  if (ut->nodes[n].left == UT_NIL) {
+    right = ut->nodes[n].right;
+    _free_node(ut, n);
+    return right;
+  }
+  ut->nodes[n].left = _remove_first(ut, ut->nodes[n].left);
+  _pull(ut, n);
+  return n;
+}
 
 
+/*
+ * Splits n into *l with the starts before t and *r with the others, *r
+ * starting with a node at t. n must start before t.
+ */
 static void
-_delete_item(void *x) {
-  ut_int_item_t* item = (ut_int_item_t*) x;
-  xfree(item);
+_split_at(utracker_int_t ut, int n, time_t t, int *l, int *r) {
+  int value;
+
+  _split(ut, n, t, l, r);
+  xassert(*l != UT_NIL);
+  if (*r == UT_NIL || ut->nodes[_first(ut, *r)].start != t) {
+    value = ut->nodes[_last(ut, *l)].value;
+    *r = _merge(ut, _new_node(ut, t, value), *r);
+  }
 }
 
 
-static ut_int_item_t*
-_create_item(time_t start, int value) {
-  ut_int_item_t *item = xmalloc(sizeof(ut_int_item_t));
-  item->start = start;
-  item->value = value;
-  return item;
+/* drops the first node of r if it doesn't change the value after l */
+static int
+_coalesce(utracker_int_t ut, int l, int r) {
+  if (r != UT_NIL &&
+      ut->nodes[_first(ut, r)].value == ut->nodes[_last(ut, l)].value)
+    return _remove_first(ut, r);
+  return r;
 }
 
 
@@ -45,91 +254,89 @@ void
 ut_int_add_usage(utracker_int_t ut,
                time_t start, time_t end,
                int usage) {
+  int before, during, after;
+
   xassert(start>0);
   xassert(end>start);
   if (usage == 0)
     // do nothing
     return;
 
-  utiterator_t it = list_iterator_create(ut);
-  ut_int_item_t *prev;
-  ut_int_item_t *next = list_next(it);
-  do {
-    prev = next;
-    next = list_next(it);
-  } while(next && next->start < start);
-  int prev_value = prev->value;
-  int old_value = prev_value;
-  if (!next || next->start > start) {
-    // add new item to "split the interval"
-    prev_value += usage;
-    ut_int_item_t *new_item = _create_item(start, prev_value);
-    list_insert(it, new_item);
-  }
-  if (next && next->value + usage == prev_value) {
-    // delete next for optimization
-    old_value = next->value;
-    ut_int_item_t *deleted_item = list_remove(it);
-    xassert(deleted_item == next);
-    _delete_item(deleted_item);
-    next = list_next(it);
-  }
-  while(next && next->start < end) {
-    old_value = next->value;
-    prev_value = (next->value += usage);
-    next = list_next(it);
-  }
-  if (!next || next->start > end) {
-    // add new item to "split the interval"
-    ut_int_item_t *new_item = _create_item(end, old_value);
-    list_insert(it, new_item);
-  } else if (next->value == prev_value) {
-    xassert(next->start == end);
-    // delete next for optimization
-    ut_int_item_t *deleted_item = list_remove(it);
-    xassert(deleted_item == next);
-    _delete_item(deleted_item);
-    next = list_next(it);
-  }
+  _split_at(ut, ut->root, start, &before, &during);
+  _split_at(ut, during, end, &during, &after);
+  _apply(ut, during, usage);
+  during = _coalesce(ut, before, during);
+  before = _merge(ut, before, during);
+  after = _coalesce(ut, before, after);
+  ut->root = _merge(ut, before, after);
 }
 
 
 void
 ut_int_remove_till_end(utracker_int_t ut,
                       time_t start, int usage) {
+  int before, after;
+
   xassert(start>0);
   if (usage == 0)
     // do nothing
     return;
 
-  utiterator_t it = list_iterator_create(ut);
-  ut_int_item_t *prev;
-  ut_int_item_t *next = list_next(it);
-  do {
-    prev = next;
-    next = list_next(it);
-  } while(next && next->start < start);
-  int prev_value = prev->value;
-  if (!next || next->start > start) {
-    // add new item to "split the interval"
-    prev_value -= usage;
-    ut_int_item_t *new_item = _create_item(start, prev_value);
-    list_insert(it, new_item);
-  }
-  if (!next) {
-    return;
-  }
-  if (next->value - usage == prev_value) {
-    // delete next for optimization
-    ut_int_item_t *deleted_item = list_remove(it);
-    xassert(deleted_item == next);
-    _delete_item(deleted_item);
-    next = list_next(it);
-  }
-  while(next) {
-    next->value -= usage;
-    next = list_next(it);
+  _split_at(ut, ut->root, start, &before, &after);
+  _apply(ut, after, -usage);
+  after = _coalesce(ut, before, after);
+  ut->root = _merge(ut, before, after);
+}
+
+
+/*
+ * value at t, the value of the last node starting at or before t; there is
+ * one since the first node starts at (time_t)-1
+ */
+static int
+_value_at(utracker_int_t ut, time_t t) {
+  int n = ut->root, add = 0, value = 0;
+
+  xassert(t >= 0);
+  while (n != UT_NIL) {
+    if (ut->nodes[n].start <= t) {
+      value = ut->nodes[n].value + add;
+      add += ut->nodes[n].add;
+      n = ut->nodes[n].right;
+    } else {
+      add += ut->nodes[n].add;
+      n = ut->nodes[n].left;
+    }
   }
+  return value;
+}
+
+
+/*
+ * Returns the first node of n starting after t with a value below
+ * max_value if "below", at least max_value otherwise, or UT_NIL.
+ * "add" is what the ancestors of n still have to add to it.
+ */
+static int
+_next_change(utracker_int_t ut, int n, time_t t, int add,
+             int max_value, bool below) {
+  ut_int_node_t *node;
+  int found;
+
+  if (n == UT_NIL)
+    return UT_NIL;
+  node = &ut->nodes[n];
+  if (below ? (node->min + add >= max_value) : (node->max + add < max_value))
+    return UT_NIL;
+  if (node->start <= t)
+    return _next_change(ut, node->right, t, add + node->add,
+                        max_value, below);
+  found = _next_change(ut, node->left, t, add + node->add, max_value, below);
+  if (found != UT_NIL)
+    return found;
+  if (below == (node->value + add < max_value))
+    return n;
+  return _next_change(ut, node->right, t, add + node->add, max_value, below);
 }
 
 
@@ -143,67 +350,121 @@ time_t
 ut_int_when_below(utracker_int_t ut,
                    time_t after, time_t duration,
                    int max_value){
+  time_t start = after;
+  int n;
+
   xassert(after>0);
   xassert(duration>0);
-  utiterator_t it = list_iterator_create(ut);
-  ut_int_item_t *prev;
-  ut_int_item_t *next = list_next(it);
-  do {
-    prev = next;
-    next = list_next(it);
-  } while(next && next->start < after);
+  if (_value_at(ut, start) >= max_value) {
+    n = _next_change(ut, ut->root, start, 0, max_value, true);
+    if (n == UT_NIL)
+      return(-1);
+    start = ut->nodes[n].start;
+  }
   while(1) {
-    while(prev->value >= max_value) {
-      if (!next) {
-        return(-1);
-      }
-      prev = next;
-      next = list_next(it);
-    }
-    time_t start = prev->start > after ? prev->start : after;
-    time_t end = start + duration;
-    while(prev->value < max_value) {
-      if (!next || next->start >= end) {
-        return start;
-      }
-      prev = next;
-      next = list_next(it);
+    /* below from start on, check it lasts for duration */
+    n = _next_change(ut, ut->root, start, 0, max_value, false);
+    if (n == UT_NIL || ut->nodes[n].start >= start + duration)
+      return start;
+    n = _next_change(ut, ut->root, ut->nodes[n].start, 0, max_value, true);
+    if (n == UT_NIL)
+      return(-1);
+    start = ut->nodes[n].start;
+  }
+}
+
+
+void
+ut_int_add_profile(utracker_int_t ut,
+               time_t start, time_t end,
+               const ut_int_phase_t *phases, int phase_cnt) {
+  int i;
+  time_t from, to;
+
+  xassert(phase_cnt > 0);
+  xassert(phases[0].offset == 0);
+  for (i = 0; i < phase_cnt; i++) {
+    from = start + phases[i].offset;
+    to = (i + 1 < phase_cnt) ? start + phases[i + 1].offset : end;
+    if (to > end)
+      to = end;
+    if (from >= to)
+      break;
+    ut_int_add_usage(ut, from, to, phases[i].value);
+  }
+}
+
+
+time_t
+ut_int_when_fits(utracker_int_t ut,
+                   time_t after, time_t duration,
+                   const ut_int_phase_t *phases, int phase_cnt,
+                   int limit){
+  time_t start = after, from, len, found;
+  int i;
+
+  xassert(phase_cnt > 0);
+  xassert(phases[0].offset == 0);
+  /* move the start until every phase fits; each move is forward,
+   * so this ends after at most one pass per breakpoint */
+  i = 0;
+  while (i < phase_cnt && phases[i].offset < duration) {
+    from = start + phases[i].offset;
+    len = ((i + 1 < phase_cnt && phases[i + 1].offset < duration)
+           ? phases[i + 1].offset : duration) - phases[i].offset;
+    found = ut_int_when_below(ut, from, len, limit - phases[i].value + 1);
+    if (found == -1)
+      return -1;
+    if (found != from) {
+      start = found - phases[i].offset;
+      /* recheck the earlier phases at the new start */
+      i = 0;
+      continue;
     }
+    i++;
   }
+  return start;
 }
 
 
 utracker_int_t
 ut_int_create(int start_value){
-  List list = list_create(_delete_item);
-  list_append(list, _create_item((time_t)-1, start_value));
-  return list;
+  utracker_int_t ut = xmalloc(sizeof(struct ut_int_struct));
+  ut->size = UT_INIT_SIZE;
+  ut->nodes = xcalloc(ut->size, sizeof(ut_int_node_t));
+  ut->used = 1;
+  ut->free_list = UT_NIL;
+  ut->root = _new_node(ut, (time_t)-1, start_value);
+  return ut;
 }
 
 
 void
 ut_int_destroy(utracker_int_t ut) {
-  list_destroy(ut);
+  if (!ut)
+    return;
+  xfree(ut->nodes);
+  xfree(ut);
 }
 
 
 static void
-ut_int_dump_item(ut_int_item_t *item) {
+_dump(utracker_int_t ut, int n, int add) {
   char buff[32];
-  log("%24.24s : %d", ctime_r(&(item->start), buff), item->value);
-}
+  ut_int_node_t *node;
 
-
-static int
-_dump_item(void *item, void *arg) {
-  ut_int_dump_item((ut_int_item_t *)item);
-  return 1;
+  if (n == UT_NIL)
+    return;
+  node = &ut->nodes[n];
+  _dump(ut, node->left, add + node->add);
+  log("%24.24s : %d", ctime_r(&(node->start), buff), node->value + add);
+  _dump(ut, node->right, add + node->add);
 }
 
 
 void
 ut_int_dump(utracker_int_t ut) {
   log("--------------------------------");
-  list_for_each(ut, _dump_item, NULL);
+  _dump(ut, ut->root, 0);
   log("--------------------------------");
 }
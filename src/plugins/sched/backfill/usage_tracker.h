@@ -10,11 +10,22 @@
 
 #include <time.h>
 
-#include "src/common/list.h"
-
-typedef List utracker_int_t;
+/*
+ * Integer step function of time: {start, value} breakpoints, the first one
+ * starting at (time_t)-1, kept in a treap with a lazy add and the min and
+ * max value of each subtree. Updates and searches are O(log n); the nodes
+ * share one array, so there is no allocation per breakpoint.
+ */
+typedef struct ut_int_struct *utracker_int_t;
 
-typedef ListIterator utiterator_t;
+/*
+ * One phase of a piecewise constant usage profile: "value" from "offset"
+ * (relative to the start) until the offset of the next phase.
+ */
+typedef struct ut_int_phase_struct {
+  time_t offset;
+  int value;
+} ut_int_phase_t;
 
 void ut_int_add_usage(utracker_int_t ut,
                time_t start, time_t end,
@@ -24,6 +35,24 @@ time_t ut_int_when_below(utracker_int_t ut,
                    time_t after, time_t duration,
                    int max_value);
 
+/*
+ * Adds a usage profile (phases sorted by offset, the first at offset 0)
+ * starting at "start" and lasting until "end".
+ */
+void ut_int_add_profile(utracker_int_t ut,
+               time_t start, time_t end,
+               const ut_int_phase_t *phases, int phase_cnt);
+
+/*
+ * Returns the earliest start not earlier than "after" such that adding the
+ * usage profile for "duration" keeps the tracked value at most "limit",
+ * or -1 if there is no such start.
+ */
+time_t ut_int_when_fits(utracker_int_t ut,
+                   time_t after, time_t duration,
+                   const ut_int_phase_t *phases, int phase_cnt,
+                   int limit);
+
 void ut_int_remove_till_end(utracker_int_t ut,
                       time_t start, int usage);
 
@@ -205,7 +205,6 @@ static void _compute_start_times(void)
 				       NULL, NULL,
 				       exc_core_bitmap);
 		if (rc == SLURM_SUCCESS) {
-			last_job_update = now;
 			if (job_ptr->time_limit == INFINITE)
 				time_limit = 365 * 24 * 60 * 60;
 			else if (job_ptr->time_limit != NO_VAL)
@@ -221,6 +220,7 @@ static void _compute_start_times(void)
 			}
 			bit_or(alloc_bitmap, avail_bitmap);
 			last_job_alloc = job_ptr->start_time + time_limit;
+			job_sched_updated(job_ptr, now);
 		}
 		FREE_NULL_BITMAP(avail_bitmap);
 		FREE_NULL_BITMAP(exc_core_bitmap);
@@ -86,6 +86,7 @@ int      core_array_size      = 1;
 uint16_t cr_type              = CR_CPU; /* cr_type is overwritten in init() */
 bool     gang_mode            = false;
 bool     have_dragonfly       = false;
+uint32_t io_aware_nodes       = 0; /*AG lustre licenses of I/O-heavy jobs */
 bool     is_cons_tres         = false;
 bool     pack_serial_at_end   = false;
 bool     preempt_by_part      = false;
@@ -1048,6 +1049,11 @@ extern int select_p_node_init(node_record_t *node_ptr, int node_cnt)
 		backfill_busy_nodes = true;
 	else
 		backfill_busy_nodes = false;
+	/*AG */
+	if ((tmp_ptr = xstrcasestr(sched_params, "io_aware_nodes=")))
+		io_aware_nodes = strtoul(tmp_ptr + 15, NULL, 10);
+	else
+		io_aware_nodes = 0;
 	xfree(sched_params);
 
 	preempt_type = slurm_get_preempt_type();
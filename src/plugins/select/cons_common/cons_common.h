@@ -77,7 +77,8 @@ typedef struct {
 					    node_use_record_t *node_usage,
 					    uint16_t cr_type,
 					    bool test_only, bool will_run,
-					    bitstr_t **part_core_map);
+					    bitstr_t **part_core_map,
+					    bool io_heavy);
 	int (*choose_nodes)(job_record_t *job_ptr, bitstr_t *node_map,
 			    bitstr_t **avail_core, uint32_t min_nodes,
 			    uint32_t max_nodes, uint32_t req_nodes,
@@ -106,6 +107,7 @@ extern int      core_array_size;
 extern uint16_t cr_type;
 extern bool     gang_mode;
 extern bool     have_dragonfly;
+extern uint32_t io_aware_nodes;
 extern bool     is_cons_tres;
 extern const uint16_t nodeinfo_magic;
 extern bool     pack_serial_at_end;
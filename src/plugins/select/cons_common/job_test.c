@@ -40,6 +40,7 @@
 #include "src/common/node_select.h"
 #include "src/common/xstring.h"
 
+#include "src/slurmctld/licenses.h"
 #include "src/slurmctld/preempt.h"
 
 uint64_t def_cpu_per_gpu = 0;
@@ -152,13 +153,26 @@ static struct multi_core_data *_create_default_mc(void)
 	return mc_ptr;
 }
 
+/*AG
+ * The expected end time of a running job: the end predicted by backfill
+ * (see bf_predicted_runtime) if it is before its end_time.
+ */
+static time_t _job_end(job_record_t *job_ptr)
+{
+	if (job_ptr->predicted_end &&
+	    (job_ptr->predicted_end > job_ptr->start_time) &&
+	    (job_ptr->predicted_end < job_ptr->end_time))
+		return job_ptr->predicted_end;
+	return job_ptr->end_time;
+}
+
 /* List sort function: sort by the job's expected end time */
 static int _cr_job_list_sort(void *x, void *y)
 {
 	job_record_t *job1_ptr = *(job_record_t **) x;
 	job_record_t *job2_ptr = *(job_record_t **) y;
 
-	return (int) SLURM_DIFFTIME(job1_ptr->end_time, job2_ptr->end_time);
+	return (int) SLURM_DIFFTIME(_job_end(job1_ptr), _job_end(job2_ptr)); /*AG */
 }
 
 static int _find_job (void *x, void *key)
@@ -281,6 +295,29 @@ static uint32_t _socks_per_node(job_record_t *job_ptr)
 	return s_p_n;
 }
 
+/*AG
+ * True if the job requests at least io_aware_nodes "lustre" licenses,
+ * see SchedulerParameters=io_aware_nodes
+ */
+static bool _job_io_heavy(job_record_t *job_ptr)
+{
+	ListIterator iter;
+	licenses_t *license_entry;
+	bool heavy = false;
+
+	if (!io_aware_nodes || !job_ptr->license_list)
+		return false;
+	iter = list_iterator_create(job_ptr->license_list);
+	while ((license_entry = list_next(iter))) {
+		if (!xstrcmp(license_entry->name, "lustre")) {
+			heavy = (license_entry->total >= io_aware_nodes);
+			break;
+		}
+	}
+	list_iterator_destroy(iter);
+	return heavy;
+}
+
 /*
  * Determine resource availability for pending job
  *
@@ -305,6 +342,7 @@ static avail_res_t **_get_res_avail(job_record_t *job_ptr,
 	int i, i_first, i_last;
 	avail_res_t **avail_res_array = NULL;
 	uint32_t s_p_n = _socks_per_node(job_ptr);
+	bool io_heavy = _job_io_heavy(job_ptr);
 
 	xassert(*cons_common_callbacks.can_job_run_on_node);
 
@@ -323,7 +361,7 @@ static avail_res_t **_get_res_avail(job_record_t *job_ptr,
 				job_ptr, core_map, i,
 				s_p_n, node_usage,
 				cr_type, test_only, will_run,
-				part_core_map);
+				part_core_map, io_heavy);
 	}
 
 	return avail_res_array;
@@ -1889,8 +1927,8 @@ static int _will_run_test(job_record_t *job_ptr, bitstr_t *node_bitmap,
 				if (!next_job_ptr) {
 					more_jobs = false;
 					break;
-				} else if (next_job_ptr->end_time >
-					   (first_job_ptr->end_time +
+				} else if (_job_end(next_job_ptr) > /*AG */
+					   (_job_end(first_job_ptr) +
 					    time_window)) {
 					break;
 				}
@@ -1913,8 +1951,10 @@ static int _will_run_test(job_record_t *job_ptr, bitstr_t *node_bitmap,
 						_guess_job_end(last_job_ptr,
 							       now);
 				} else {
+					/*AG a predicted end may have passed */
 					job_ptr->start_time =
-						last_job_ptr->end_time;
+						MAX(_job_end(last_job_ptr),
+						    now + 1);
 				}
 				break;
 			}
@@ -2060,6 +2060,7 @@ extern int choose_nodes(job_record_t *job_ptr, bitstr_t *node_map,
  * IN will_run      - Determining when a pending job can start
  * IN: part_core_map - per-node bitmap of cores allocated to jobs of this
  *                     partition or NULL if don't care
+ * IN io_heavy      - unused, see SchedulerParameters=io_aware_nodes
  * RET Available resources. Call _array() to release memory.
  *
  * NOTE: The returned cpu_count may be less than the number of set bits in
@@ -2073,7 +2074,7 @@ extern avail_res_t *can_job_run_on_node(job_record_t *job_ptr,
 					node_use_record_t *node_usage,
 					uint16_t cr_type,
 					bool test_only, bool will_run,
-					bitstr_t **in_part_core_map)
+					bitstr_t **in_part_core_map, bool io_heavy)
 {
 	uint16_t cpus;
 	avail_res_t *avail_res = NULL;
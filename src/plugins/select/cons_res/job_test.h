@@ -76,6 +76,7 @@
  * IN will_run      - Determining when a pending job can start
  * IN: part_core_map - per-node bitmap of cores allocated to jobs of this
  *                     partition or NULL if don't care
+ * IN io_heavy      - unused, see SchedulerParameters=io_aware_nodes
  * RET Available resources. Call _array() to release memory.
  *
  * NOTE: The returned cpu_count may be less than the number of set bits in
@@ -89,7 +90,7 @@ extern avail_res_t *can_job_run_on_node(job_record_t *job_ptr,
 					node_use_record_t *node_usage,
 					uint16_t cr_type,
 					bool test_only, bool will_run,
-					bitstr_t **part_core_map);
+					bitstr_t **part_core_map, bool io_heavy);
 
 /* this is an intermediary step between _select_nodes and _eval_nodes
  * to tackle the knapsack problem. This code incrementally removes nodes
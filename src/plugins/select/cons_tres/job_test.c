@@ -39,6 +39,7 @@
 #include "dist_tasks.h"
 #include "job_test.h"
 
+
 #define _DEBUG 0	/* Enables module specific debugging */
 
 /*
@@ -3243,6 +3244,7 @@ fini:	if ((ec == SLURM_SUCCESS) && job_ptr->gres_list && orig_core_array) {
  * IN will_run      - Determining when a pending job can start
  * IN: part_core_map - per-node bitmap of cores allocated to jobs of this
  *                     partition or NULL if don't care
+ * IN io_heavy      - job is I/O-heavy, see SchedulerParameters=io_aware_nodes
  * RET Available resources. Call _array() to release memory.
  *
  * NOTE: The returned cpu_count may be less than the number of set bits in
@@ -3256,7 +3258,7 @@ extern avail_res_t *can_job_run_on_node(job_record_t *job_ptr,
 					node_use_record_t *node_usage,
 					uint16_t cr_type,
 					bool test_only, bool will_run,
-					bitstr_t **part_core_map)
+					bitstr_t **part_core_map, bool io_heavy)
 {
 	uint16_t cpus = 0;
 	uint64_t avail_mem = NO_VAL64, req_mem;
@@ -3378,6 +3380,16 @@ extern avail_res_t *can_job_run_on_node(job_record_t *job_ptr,
 			avail_mem -= node_usage[node_i].alloc_memory;
 	}
 
+	/*
+	 *AG Favor nodes with lightly loaded I/O paths for I/O-heavy jobs,
+	 * among nodes of the same weight
+	 */
+	if (io_aware_nodes) {
+		node_ptr->sched_weight =
+			(node_ptr->sched_weight & 0xffffffffffffff00) |
+			(io_heavy ? MIN(node_ptr->io_load, 0xfe) : 0xff);
+	}
+
 	if (sock_gres_list) {
 		uint16_t near_gpu_cnt = 0;
 		avail_res->sock_gres_list = sock_gres_list;
@@ -55,6 +55,7 @@
  * IN will_run      - Determining when a pending job can start
  * IN: part_core_map - per-node bitmap of cores allocated to jobs of this
  *                     partition or NULL if don't care
+ * IN io_heavy      - job is I/O-heavy, see SchedulerParameters=io_aware_nodes
  * RET Available resources. Call _array() to release memory.
  *
  * NOTE: The returned cpu_count may be less than the number of set bits in
@@ -68,7 +69,7 @@ extern avail_res_t *can_job_run_on_node(job_record_t *job_ptr,
 					node_use_record_t *node_usage,
 					uint16_t cr_type,
 					bool test_only, bool will_run,
-					bitstr_t **part_core_map);
+					bitstr_t **part_core_map, bool io_heavy);
 
 /*
  * This is an intermediary step between _select_nodes() and _eval_nodes()
@@ -58,6 +58,8 @@ struct sdiag_parameters params;
 stats_info_response_msg_t *buf;
 uint32_t *rpc_type_ave_time = NULL, *rpc_user_ave_time = NULL;
 
+static void _print_bf_phase(char *name, uint32_t last, uint64_t sum,
+			    uint32_t cycles);
 static int  _print_stats(void);
 static void _sort_rpc(void);
 
@@ -98,6 +100,14 @@ int main(int argc, char **argv)
 	exit(rc);
 }
 
+/* Print the last and mean values of a backfill phase */
+static void _print_bf_phase(char *name, uint32_t last, uint64_t sum,
+			    uint32_t cycles)
+{
+	printf("\t\t%-26s %10u %10"PRIu64"\n", name, last,
+	       cycles ? sum / cycles : 0);
+}
+
 static int _print_stats(void)
 {
 	int i;
@@ -187,6 +197,96 @@ static int _print_stats(void)
 		printf("\tMean table size: %u\n",
 		       buf->bf_table_size_sum / buf->bf_cycle_counter);
 	}
+	if (buf->ext_version) {
+		printf("\tPhases (microseconds):%19slast%7smean\n", "", "");
+		_print_bf_phase("Queue build:", buf->bf_queue_build_last,
+				buf->bf_queue_build_sum, buf->bf_cycle_counter);
+		_print_bf_phase("License tracker init:", buf->bf_lic_init_last,
+				buf->bf_lic_init_sum, buf->bf_cycle_counter);
+		_print_bf_phase("License tests:", buf->bf_lic_test_last,
+				buf->bf_lic_test_sum, buf->bf_cycle_counter);
+		_print_bf_phase("License tracker updates:",
+				buf->bf_lic_update_last,
+				buf->bf_lic_update_sum, buf->bf_cycle_counter);
+		_print_bf_phase("Reservation tests:", buf->bf_resv_test_last,
+				buf->bf_resv_test_sum, buf->bf_cycle_counter);
+		_print_bf_phase("Try sched:", buf->bf_try_sched_last,
+				buf->bf_try_sched_sum, buf->bf_cycle_counter);
+		_print_bf_phase("Node space updates:", buf->bf_node_space_last,
+				buf->bf_node_space_sum, buf->bf_cycle_counter);
+		printf("\tLicense counts:%26slast%7smean\n", "", "");
+		_print_bf_phase("Tests:", buf->bf_lic_tests_last,
+				buf->bf_lic_tests_sum, buf->bf_cycle_counter);
+		_print_bf_phase("Deferred jobs:", buf->bf_lic_defers_last,
+				buf->bf_lic_defers_sum, buf->bf_cycle_counter);
+		_print_bf_phase("Reservations:", buf->bf_lic_resvs_last,
+				buf->bf_lic_resvs_sum, buf->bf_cycle_counter);
+	}
+
+	if (buf->lustre_util_cache_hits || buf->lustre_util_cache_misses ||
+	    buf->lustre_util_cache_size) {
+		printf("\nLustre utilization (job_submit/lustre_util) cache stats\n");
+		printf("\tHits:   %u\n", buf->lustre_util_cache_hits);
+		printf("\tMisses: %u\n", buf->lustre_util_cache_misses);
+		printf("\tSize:   %u\n", buf->lustre_util_cache_size);
+	}
+
+	if (buf->job_info_cache_hits || buf->job_info_cache_misses ||
+	    buf->job_info_cache_size) {
+		printf("\nJob information response cache stats\n");
+		printf("\tHits:   %u\n", buf->job_info_cache_hits);
+		printf("\tMisses: %u\n", buf->job_info_cache_misses);
+		printf("\tSize:   %u\n", buf->job_info_cache_size);
+	}
+
+	if (buf->lock_stats_cnt) {
+		static const char *lock_names[] = {
+			"Config", "Job", "Node", "Partition", "Federation"
+		};
+		printf("\nLock statistics (microseconds)\n");
+		printf("\t%-12s%12s%12s%12s%12s%12s\n", "",
+		       "read", "write", "contended", "mean wait", "max wait");
+		for (i = 0; i < buf->lock_stats_cnt; i++) {
+			uint64_t mean = 0;
+			if (buf->lock_contended[i])
+				mean = buf->lock_wait_usec[i] /
+				       buf->lock_contended[i];
+			printf("\t%-12s%12"PRIu64"%12"PRIu64"%12"PRIu64
+			       "%12"PRIu64"%12u\n",
+			       (i < (sizeof(lock_names) /
+				     sizeof(lock_names[0]))) ?
+			       lock_names[i] : "?",
+			       buf->lock_read_cnt[i], buf->lock_write_cnt[i],
+			       buf->lock_contended[i], mean,
+			       buf->lock_wait_max[i]);
+		}
+	}
+
+	if (buf->rpc_workers) {
+		static const char *lane_names[] = { "High", "Normal", "Low" };
+		printf("\nRPC queue statistics (microseconds)\n");
+		printf("\tWorkers:              %u (%u busy)\n",
+		       buf->rpc_workers, buf->rpc_workers_busy);
+		printf("\tConnections not read: %u (max %u)\n",
+		       buf->rpc_conn_queue, buf->rpc_conn_queue_max);
+		printf("\t%-12s%12s%12s%12s%12s%12s\n", "Lane",
+		       "queued", "max queued", "count", "mean wait",
+		       "max wait");
+		for (i = 0; i < buf->rpc_lane_cnt; i++) {
+			uint64_t mean = 0;
+			if (buf->rpc_lane_count[i])
+				mean = buf->rpc_lane_wait_usec[i] /
+				       buf->rpc_lane_count[i];
+			printf("\t%-12s%12u%12u%12"PRIu64"%12"PRIu64"%12u\n",
+			       (i < (sizeof(lane_names) /
+				     sizeof(lane_names[0]))) ?
+			       lane_names[i] : "?",
+			       buf->rpc_lane_queue[i],
+			       buf->rpc_lane_queue_max[i],
+			       buf->rpc_lane_count[i], mean,
+			       buf->rpc_lane_wait_max[i]);
+		}
+	}
 
 	printf("\nLatency for 1000 calls to gettimeofday(): %d microseconds\n",
 	       buf->gettimeofday_latency);
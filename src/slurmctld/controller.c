@@ -101,6 +101,8 @@
 #include "src/slurmctld/front_end.h"
 #include "src/slurmctld/gang.h"
 #include "src/slurmctld/heartbeat.h"
+#include "src/slurmctld/info_delta.h"
+#include "src/slurmctld/job_info_cache.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/job_submit.h"
 #include "src/slurmctld/licenses.h"
@@ -113,6 +115,8 @@
 #include "src/slurmctld/proc_req.h"
 #include "src/slurmctld/read_config.h"
 #include "src/slurmctld/reservation.h"
+#include "src/slurmctld/rpc_conn.h"
+#include "src/slurmctld/rpc_queue.h"
 #include "src/slurmctld/sched_plugin.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/slurmctld_plugstack.h"
@@ -242,7 +246,6 @@ static void *       _purge_files_thread(void *no_data);
 static void         _remove_assoc(slurmdb_assoc_rec_t *rec);
 static void         _remove_qos(slurmdb_qos_rec_t *rec);
 static void         _run_primary_prog(bool primary_on);
-static void *       _service_connection(void *arg);
 static void         _set_work_dir(void);
 static int          _shutdown_backup_controller(void);
 static void *       _slurmctld_background(void *no_data);
@@ -257,7 +260,7 @@ static void         _update_nice(void);
 static void         _update_qos(slurmdb_qos_rec_t *rec);
 inline static void  _usage(char *prog_name);
 static bool         _verify_clustername(void);
-static bool         _wait_for_server_thread(void);
+static bool         _try_server_thread(void);
 static void *       _wait_primary_prog(void *arg);
 
 /* main - slurmctld main function, start various threads and process RPCs */
@@ -863,7 +866,9 @@ int main(int argc, char **argv)
 	/* Purge our local data structures */
 	xcgroup_fini_slurm_cgroup_conf();
 	power_save_fini();
+	job_info_cache_fini();
 	job_fini();
+	info_delta_fini();	/* after job_fini() purged the jobs */
 	part_fini();	/* part_fini() must precede node_fini() */
 	node_fini();
 	node_features_g_fini();
@@ -1096,17 +1101,16 @@ static void _sig_handler(int signal)
 }
 
 /*
- * _slurmctld_rpc_mgr - Read incoming RPCs and create pthread for each
+ * _slurmctld_rpc_mgr - Accept incoming RPCs and queue them for the RPC
+ *	workers, see rpc_conn.c and rpc_queue.c
  */
 static void *_slurmctld_rpc_mgr(void *no_data)
 {
-	int newsockfd;
 	struct pollfd *fds;
-	slurm_addr_t cli_addr, srv_addr;
+	slurm_addr_t srv_addr;
 	uint16_t port;
 	char ip[32];
-	int fd_next = 0, i, nports;
-	connection_arg_t *conn_arg = NULL;
+	int i, nports;
 	/* Locks: Read config */
 	slurmctld_lock_t config_read_lock = {
 		READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK, NO_LOCK };
@@ -1158,61 +1162,16 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	xsignal(SIGUSR1, _sig_handler);
 	xsignal_unblock(sigarray);
 
+	/*AG this thread counts against max_server_threads too */
+	rpc_queue_init(MAX(max_server_threads - 1, 1));
+
 	/*
 	 * Process incoming RPCs until told to shutdown
 	 */
-	while (_wait_for_server_thread()) {
-		if (poll(fds, nports, -1) == -1) {
-			if (errno != EINTR)
-				error("slurm_accept_msg_conn select: %m");
-			server_thread_decr();
-			continue;
-		}
-
-		/* find one to process */
-		for (i = 0; i < nports; i++) {
-			if (fds[(fd_next + i) % nports].revents) {
-				i = (fd_next + i) % nports;
-				break;
-			}
-		}
-		fd_next = (i + 1) % nports;
-
-		/*
-		 * accept needed for stream implementation is a no-op in
-		 * message implementation that just passes sockfd to newsockfd
-		 */
-		if ((newsockfd = slurm_accept_msg_conn(fds[i].fd, &cli_addr))
-		    == SLURM_ERROR) {
-			if (errno != EINTR)
-				error("slurm_accept_msg_conn: %m");
-			server_thread_decr();
-			continue;
-		}
-		fd_set_close_on_exec(newsockfd);
-		conn_arg = xmalloc(sizeof(connection_arg_t));
-		conn_arg->newsockfd = newsockfd;
-		memcpy(&conn_arg->cli_addr, &cli_addr, sizeof(slurm_addr_t));
-
-		if (slurmctld_conf.debug_flags & DEBUG_FLAG_PROTOCOL) {
-			char inetbuf[64];
-
-			slurm_print_slurm_addr(&cli_addr,
-						inetbuf,
-						sizeof(inetbuf));
-			info("%s: accept() connection from %s", __func__, inetbuf);
-		}
-
-		if (slurmctld_config.shutdown_time) {
-			slurmctld_diag_stats.proc_req_raw++;
-			_service_connection(conn_arg);
-		} else {
-			slurm_thread_create_detached(NULL, _service_connection,
-						     conn_arg);
-		}
-	}
+	rpc_conn_mgr(fds, nports, _try_server_thread);	/*AG*/
 
 	debug3("%s shutting down", __func__);
+	rpc_queue_fini();	/*AG the workers finish the queued RPCs */
 	for (i = 0; i < nports; i++)
 		close(fds[i].fd);
 	xfree(fds);
@@ -1221,97 +1180,29 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	return NULL;
 }
 
-/*
- * _service_connection - service the RPC
- * IN/OUT arg - really just the connection's file descriptor, freed
- *	upon completion
- * RET - NULL
+/*AG
+ * Increment slurmctld_config.server_thread_count if its value is less than
+ * max_server_threads, without waiting
+ * RET true if incremented
  */
-static void *_service_connection(void *arg)
-{
-	connection_arg_t *conn = (connection_arg_t *) arg;
-	void *return_code = NULL;
-	slurm_msg_t msg;
-
-#if HAVE_SYS_PRCTL_H
-	if (prctl(PR_SET_NAME, "srvcn", NULL, NULL, NULL) < 0) {
-		error("%s: cannot set my name to %s %m", __func__, "srvcn");
-	}
-#endif
-	slurm_msg_t_init(&msg);
-	msg.flags |= SLURM_MSG_KEEP_BUFFER;
-	/*
-	 * slurm_receive_msg sets msg connection fd to accepted fd. This allows
-	 * possibility for slurmctld_req() to close accepted connection.
-	 */
-	if (slurm_receive_msg(conn->newsockfd, &msg, 0) != 0) {
-		char addr_buf[32];
-		slurm_print_slurm_addr(&conn->cli_addr, addr_buf,
-				       sizeof(addr_buf));
-		error("slurm_receive_msg [%s]: %m", addr_buf);
-		/* close the new socket */
-		close(conn->newsockfd);
-		goto cleanup;
-	}
-
-	if (errno != SLURM_SUCCESS) {
-		if (errno == SLURM_PROTOCOL_VERSION_ERROR) {
-			slurm_send_rc_msg(&msg, SLURM_PROTOCOL_VERSION_ERROR);
-		} else
-			info("_service_connection/slurm_receive_msg %m");
-	} else {
-		/* process the request */
-		slurmctld_req(&msg, conn);
-	}
-
-	if ((conn->newsockfd >= 0) && (close(conn->newsockfd) < 0))
-		error ("close(%d): %m",  conn->newsockfd);
-
-cleanup:
-	slurm_free_msg_members(&msg);
-	xfree(arg);
-	server_thread_decr();
-
-	return return_code;
-}
-
-/* Increment slurmctld_config.server_thread_count and don't return
- * until its value is no larger than MAX_SERVER_THREADS,
- * RET true unless shutdown in progress */
-static bool _wait_for_server_thread(void)
+static bool _try_server_thread(void)
 {
-	bool print_it = true;
-	bool rc = true;
+	bool rc = false;
 
 	slurm_mutex_lock(&slurmctld_config.thread_count_lock);
-	while (1) {
-		if (slurmctld_config.shutdown_time) {
-			rc = false;
-			break;
-		}
-		if (slurmctld_config.server_thread_count < max_server_threads) {
-			slurmctld_config.server_thread_count++;
-			break;
-		} else {
-			/* wait for state change and retry,
-			 * just a delay and not an error.
-			 * This can happen when the epilog completes
-			 * on a bunch of nodes at the same time, which
-			 * can easily happen for highly parallel jobs. */
-			if (print_it) {
-				static time_t last_print_time = 0;
-				time_t now = time(NULL);
-				if (difftime(now, last_print_time) > 2) {
-					verbose("server_thread_count over "
-						"limit (%d), waiting",
-						slurmctld_config.
-						server_thread_count);
-					last_print_time = now;
-				}
-				print_it = false;
-			}
-			slurm_cond_wait(&slurmctld_config.thread_count_cond,
-					&slurmctld_config.thread_count_lock);
+	if (slurmctld_config.shutdown_time) {
+		;
+	} else if (slurmctld_config.server_thread_count < max_server_threads) {
+		slurmctld_config.server_thread_count++;
+		rc = true;
+	} else {
+		/* just a delay and not an error, the caller retries */
+		static time_t last_print_time = 0;
+		time_t now = time(NULL);
+		if (difftime(now, last_print_time) > 2) {
+			verbose("server_thread_count over limit (%d), waiting",
+				slurmctld_config.server_thread_count);
+			last_print_time = now;
 		}
 	}
 	slurm_mutex_unlock(&slurmctld_config.thread_count_lock);
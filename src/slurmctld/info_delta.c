@@ -0,0 +1,245 @@
+/*****************************************************************************\
+ *  info_delta.c - change generations of job and node records
+ *****************************************************************************
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+
+/*
+ * squeue --iterate, sview and monitoring scripts poll all jobs and nodes
+ * every few seconds and mostly get back what they already have.
+ * REQUEST_JOB_INFO_DELTA and REQUEST_NODE_INFO_DELTA send only the records
+ * that changed since the generation the client got with its last response.
+ *
+ * Each job and node record carries the generation of its last change. The
+ * code changing a record calls info_delta_job_changed() or
+ * info_delta_node_changed() under the write lock on it, which gives it the
+ * next generation, so a delta only compares generations. For jobs that is
+ * done by job_updated(), which also sets last_job_update and so takes the
+ * place of every plain last_job_update store. The fields the schedulers and
+ * the priority plugin rewrite in bulk (state, pending reason and its
+ * description, priority, expected start) are compared with the values as of
+ * the last generation by info_delta_job_sched() instead, through
+ * job_sched_updated(), so a job evaluated again without a change keeps its
+ * generation. job_time_limit() makes the same check for every job, which
+ * bounds the delay of a state change made without a touch. The expected
+ * start pack_job() reports for a pending job relative to now is not a
+ * change.
+ *
+ * A client is sent all records ("full") instead if
+ *  - it has none yet, or a generation of another slurmctld (generations
+ *    start from the time slurmctld started),
+ *  - the configuration or the partitions changed since, which may change
+ *    which records it sees, or for nodes the node table was rebuilt,
+ *  - a purged job it wasn't told about dropped out of purged_jobs.
+ */
+
+#include <pthread.h>
+
+#include "src/common/macros.h"
+#include "src/common/xmalloc.h"
+#include "src/slurmctld/info_delta.h"
+#include "src/slurmctld/locks.h"
+#include "src/slurmctld/slurmctld.h"
+
+#define PURGED_JOBS_MAX	16384
+
+typedef struct {
+	uint32_t job_id;
+	uint64_t gen;		/* generation of its purge */
+} purged_job_t;
+
+typedef struct {
+	uint64_t horizon;	/* clients older than this are sent everything */
+	time_t conf_update;	/* slurmctld_conf.last_update as of it */
+	time_t part_update;	/* last_part_update as of it */
+	node_record_t *node_table; /* node_record_table_ptr as of it */
+	int node_cnt;		/* node_record_count as of it */
+} delta_state_t;
+
+static pthread_mutex_t delta_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t last_gen = 0;	/* atomic, records change under their locks */
+static delta_state_t delta_state[INFO_DELTA_CNT];
+static purged_job_t *purged_jobs = NULL;	/* ring of PURGED_JOBS_MAX */
+static int purged_next = 0;
+static int purged_cnt = 0;
+
+/* Generation handed out last, 0 if none yet */
+static uint64_t _last_gen(void)
+{
+	return __atomic_load_n(&last_gen, __ATOMIC_ACQUIRE);
+}
+
+static uint64_t _next_gen(void)
+{
+	uint64_t gen = _last_gen();
+
+	/*
+	 * Clients keep their generation over a slurmctld restart, so start
+	 * above anything an earlier slurmctld could have handed out
+	 */
+	if (!gen) {
+		(void) __atomic_compare_exchange_n(
+			&last_gen, &gen, ((uint64_t) time(NULL)) << 32, false,
+			__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+	}
+	return __atomic_add_fetch(&last_gen, 1, __ATOMIC_ACQ_REL);
+}
+
+extern uint64_t info_delta_current(info_delta_type_t type, uint64_t since_gen,
+				   bool *full)
+{
+	delta_state_t *state = &delta_state[type];
+	uint64_t gen;
+
+	slurm_mutex_lock(&delta_mutex);
+	if ((state->conf_update != slurmctld_conf.last_update) ||
+	    (state->part_update != last_part_update) ||
+	    ((type == INFO_DELTA_NODES) &&
+	     ((state->node_table != node_record_table_ptr) ||
+	      (state->node_cnt != node_record_count)))) {
+		state->conf_update = slurmctld_conf.last_update;
+		state->part_update = last_part_update;
+		state->node_table = node_record_table_ptr;
+		state->node_cnt = node_record_count;
+		state->horizon = _next_gen();
+	}
+	gen = _last_gen();
+	if (!gen)
+		gen = _next_gen();
+
+	*full = !since_gen || (since_gen < state->horizon) ||
+		(since_gen > gen);
+	slurm_mutex_unlock(&delta_mutex);
+
+	return gen;
+}
+
+/* FNV-1a hash of a job's state_desc, 0 for none */
+static uint32_t _desc_hash(const char *desc)
+{
+	uint32_t hash = 2166136261U;
+
+	if (!desc)
+		return 0;
+	for ( ; *desc; desc++) {
+		hash ^= (unsigned char) *desc;
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+extern void info_delta_job_changed(job_record_t *job_ptr)
+{
+	job_ptr->delta_gen = _next_gen();
+	job_ptr->delta_state = job_ptr->job_state;
+	job_ptr->delta_reason = job_ptr->state_reason;
+	job_ptr->delta_desc = _desc_hash(job_ptr->state_desc);
+	job_ptr->delta_prio = job_ptr->priority;
+	job_ptr->delta_start = job_ptr->start_time;
+}
+
+extern void info_delta_job_sched(job_record_t *job_ptr)
+{
+	if ((job_ptr->delta_state != job_ptr->job_state) ||
+	    (job_ptr->delta_reason != job_ptr->state_reason) ||
+	    (job_ptr->delta_desc != _desc_hash(job_ptr->state_desc)) ||
+	    (job_ptr->delta_prio != job_ptr->priority) ||
+	    (job_ptr->delta_start != job_ptr->start_time))
+		info_delta_job_changed(job_ptr);
+}
+
+extern void info_delta_node_changed(node_record_t *node_ptr)
+{
+	node_ptr->delta_gen = _next_gen();
+	node_ptr->delta_state = node_ptr->node_state;
+	node_ptr->delta_reason_time = node_ptr->reason_time;
+}
+
+extern void info_delta_node_sched(node_record_t *node_ptr)
+{
+	if ((node_ptr->delta_state != node_ptr->node_state) ||
+	    (node_ptr->delta_reason_time != node_ptr->reason_time))
+		info_delta_node_changed(node_ptr);
+}
+
+extern void info_delta_purged(uint64_t since_gen, uint32_t **job_ids,
+			      uint32_t *cnt)
+{
+	int i, inx;
+
+	slurm_mutex_lock(&delta_mutex);
+	/* the ring is in generation order, skip to the first after since_gen */
+	for (i = 0; i < purged_cnt; i++) {
+		inx = (purged_next - purged_cnt + i + PURGED_JOBS_MAX) %
+		      PURGED_JOBS_MAX;
+		if (purged_jobs[inx].gen > since_gen)
+			break;
+	}
+	if (i < purged_cnt)
+		xrealloc(*job_ids, sizeof(uint32_t) * (*cnt + purged_cnt - i));
+	for ( ; i < purged_cnt; i++) {
+		inx = (purged_next - purged_cnt + i + PURGED_JOBS_MAX) %
+		      PURGED_JOBS_MAX;
+		(*job_ids)[(*cnt)++] = purged_jobs[inx].job_id;
+	}
+	slurm_mutex_unlock(&delta_mutex);
+}
+
+extern void info_delta_job_purged(job_record_t *job_ptr)
+{
+	purged_job_t *purged;
+
+	slurm_mutex_lock(&delta_mutex);
+	if (!purged_jobs)
+		purged_jobs = xcalloc(PURGED_JOBS_MAX, sizeof(purged_job_t));
+	purged = &purged_jobs[purged_next];
+	if (purged_cnt == PURGED_JOBS_MAX) {
+		/* the clients that haven't seen it go yet need everything */
+		delta_state[INFO_DELTA_JOBS].horizon =
+			MAX(delta_state[INFO_DELTA_JOBS].horizon, purged->gen);
+	} else {
+		purged_cnt++;
+	}
+	purged->job_id = job_ptr->job_id;
+	purged->gen = _next_gen();
+	purged_next = (purged_next + 1) % PURGED_JOBS_MAX;
+	slurm_mutex_unlock(&delta_mutex);
+}
+
+extern void info_delta_fini(void)
+{
+	slurm_mutex_lock(&delta_mutex);
+	xfree(purged_jobs);
+	purged_cnt = 0;
+	purged_next = 0;
+	slurm_mutex_unlock(&delta_mutex);
+}
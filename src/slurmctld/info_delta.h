@@ -0,0 +1,109 @@
+/*****************************************************************************\
+ *  info_delta.h - change generations of job and node records
+ *****************************************************************************
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURMCTLD_INFO_DELTA_H
+#define _SLURMCTLD_INFO_DELTA_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "src/slurmctld/locks.h"
+#include "src/slurmctld/slurmctld.h"
+
+typedef enum {
+	INFO_DELTA_JOBS,
+	INFO_DELTA_NODES,
+	INFO_DELTA_CNT
+} info_delta_type_t;
+
+/*
+ * info_delta_current - the generation to send a client with a delta
+ *	response, all records changed since since_gen have a larger one
+ * IN type - records to report
+ * IN since_gen - generation the client has, 0 for none
+ * OUT full - set if the client must be sent all records rather than those
+ *	changed since since_gen
+ * NOTE: call with the conf and partition read locks and the lock of type
+ */
+extern uint64_t info_delta_current(info_delta_type_t type, uint64_t since_gen,
+				   bool *full);
+
+/*
+ * info_delta_job_changed - give a job the next change generation, call
+ *	when a field pack_job() reports changes
+ * NOTE: call with the job write lock
+ */
+extern void info_delta_job_changed(job_record_t *job_ptr);
+
+/*
+ * info_delta_job_sched - call info_delta_job_changed() if the job's state,
+ *	pending reason or its description, priority or start time changed
+ *	since its last generation.
+ *	For the schedulers and the priority plugin, which rewrite these on
+ *	every pass.
+ * NOTE: call with the job write lock
+ */
+extern void info_delta_job_sched(job_record_t *job_ptr);
+
+/*
+ * info_delta_node_changed - give a node the next change generation, call
+ *	when a field pack_all_node() reports changes
+ * NOTE: call with the node write lock
+ */
+extern void info_delta_node_changed(node_record_t *node_ptr);
+
+/*
+ * info_delta_node_sched - call info_delta_node_changed() if the node's state
+ *	or reason changed since its last generation. For the paths that
+ *	flip node state flags in passing (ping responses, power saving).
+ * NOTE: call with the node write lock
+ */
+extern void info_delta_node_sched(node_record_t *node_ptr);
+
+/*
+ * info_delta_purged - add the ids of the jobs purged after since_gen to
+ *	job_ids
+ * IN/OUT job_ids - xmalloc()ed array, grown as needed
+ * IN/OUT cnt - ids in job_ids
+ */
+extern void info_delta_purged(uint64_t since_gen, uint32_t **job_ids,
+			      uint32_t *cnt);
+
+/* info_delta_job_purged - record that a job left the job list */
+extern void info_delta_job_purged(job_record_t *job_ptr);
+
+/* info_delta_fini - free the purged job records, call after job_fini() */
+extern void info_delta_fini(void);
+
+#endif
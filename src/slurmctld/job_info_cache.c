@@ -0,0 +1,316 @@
+/*****************************************************************************\
+ *  job_info_cache.c - cache of packed job information responses
+ *****************************************************************************
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+
+/*
+ * squeue, sview and monitoring scripts poll REQUEST_JOB_INFO, often many of
+ * them within the same second. Instead of packing every job for each of
+ * them under the job read lock, the packed responses are kept and sent as
+ * long as nothing they depend on could have changed:
+ *  - no conf, job or partition write lock was released since they were
+ *    packed (slurmctld_lock_gen()), which is checked without taking the
+ *    job read lock, so they are also served while e.g. the backfill
+ *    scheduler holds the job write lock,
+ *  - it is the same second, as pack_job() reports the expected start time
+ *    of pending jobs relative to now,
+ *  - same show_flags and protocol version, and a user who sees the same
+ *    partitions (the "visibility class"). Responses that depend on the user
+ *    any further (PrivateData=jobs for a user who isn't an operator) aren't
+ *    cached.
+ */
+
+#include <pthread.h>
+
+#include "src/common/bitstring.h"
+#include "src/common/list.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+#include "src/slurmctld/job_info_cache.h"
+#include "src/slurmctld/locks.h"
+#include "src/slurmctld/slurmctld.h"
+
+typedef struct {
+	uint16_t show_flags;
+	uint16_t protocol_version;
+	bitstr_t *visible_parts;  /* partitions in part_list order whose jobs
+				   * the users see, NULL for all of them */
+	uint64_t conf_gen;	/* slurmctld_lock_gen() when packed */
+	uint64_t job_gen;
+	uint64_t part_gen;
+	time_t packed;		/* second it was packed in */
+	uint64_t last_used;	/* use_cnt when last served */
+	char *buffer;
+	int buffer_size;
+	int refcnt;		/* the cache's own and job_info_cache_get()'s */
+} job_info_cache_ent_t;
+
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static job_info_cache_ent_t **cache = NULL;
+static int cache_cnt = 0;
+static int cache_max = 0;	/* SchedulerParameters=job_info_cache */
+static time_t cache_conf_time = 0;
+static uint64_t use_cnt = 0;
+
+/* Read SchedulerParameters, call with the conf read lock and cache_mutex */
+static void _load_config(void)
+{
+	char *tmp_ptr;
+
+	if (cache_conf_time == slurmctld_conf.last_update)
+		return;
+	cache_conf_time = slurmctld_conf.last_update;
+
+	if ((tmp_ptr = xstrcasestr(slurmctld_conf.sched_params,
+				   "job_info_cache="))) {
+		cache_max = atoi(tmp_ptr + 15);
+		if (cache_max < 0) {
+			error("Invalid job_info_cache: %d", cache_max);
+			cache_max = 0;
+		}
+	} else {
+		cache_max = 0;
+	}
+}
+
+/*
+ * Find out which partitions' jobs uid sees, call with the conf and partition
+ * read locks
+ * OUT visible_parts - partitions in part_list order, NULL for all of them
+ * RET false if what uid sees depends on more than the partitions
+ */
+static bool _visibility_class(uid_t uid, uint16_t show_flags,
+			      bitstr_t **visible_parts)
+{
+	ListIterator part_iterator;
+	part_record_t *part_ptr;
+	int i = 0;
+
+	*visible_parts = NULL;
+
+	/* see _hide_job() */
+	if ((slurmctld_conf.private_data & PRIVATE_DATA_JOBS) &&
+	    !validate_operator(uid))
+		return false;
+
+	/* see _pack_job() and part_is_visible() */
+	if ((show_flags & SHOW_ALL) || validate_slurm_user(uid))
+		return true;
+
+	*visible_parts = bit_alloc(MAX(list_count(part_list), 1));
+	part_iterator = list_iterator_create(part_list);
+	while ((part_ptr = list_next(part_iterator))) {
+		if (part_is_visible(part_ptr, uid))
+			bit_set(*visible_parts, i);
+		i++;
+	}
+	list_iterator_destroy(part_iterator);
+
+	if (bit_set_count(*visible_parts) == i)
+		FREE_NULL_BITMAP(*visible_parts);
+
+	return true;
+}
+
+static void _release(job_info_cache_ent_t *ent)
+{
+	if (--ent->refcnt)
+		return;
+	FREE_NULL_BITMAP(ent->visible_parts);
+	xfree(ent->buffer);
+	xfree(ent);
+}
+
+/* Drop all entries, call with cache_mutex */
+static void _flush(void)
+{
+	while (cache_cnt)
+		_release(cache[--cache_cnt]);
+	slurmctld_diag_stats.job_info_cache_size = 0;
+}
+
+static bool _same_class(bitstr_t *a, bitstr_t *b)
+{
+	if (!a || !b)
+		return (!a && !b);
+	return ((bit_size(a) == bit_size(b)) && bit_equal(a, b));
+}
+
+/*
+ * Drop the entries packed before the given generations or second, and the
+ * least recently used one if the cache is still full. Call with cache_mutex.
+ */
+static void _purge(uint64_t conf_gen, uint64_t job_gen, uint64_t part_gen,
+		   time_t now)
+{
+	job_info_cache_ent_t *ent;
+	int i, lru = -1;
+
+	for (i = 0; i < cache_cnt; ) {
+		ent = cache[i];
+		if ((ent->conf_gen != conf_gen) || (ent->job_gen != job_gen) ||
+		    (ent->part_gen != part_gen) || (ent->packed != now) ||
+		    (i >= cache_max)) {
+			_release(ent);
+			cache[i] = cache[--cache_cnt];
+			continue;
+		}
+		if ((lru < 0) || (ent->last_used < cache[lru]->last_used))
+			lru = i;
+		i++;
+	}
+
+	if (cache_max && (cache_cnt >= cache_max) && (lru >= 0)) {
+		_release(cache[lru]);
+		cache[lru] = cache[--cache_cnt];
+	}
+}
+
+extern void *job_info_cache_get(uint16_t show_flags, uid_t uid,
+				uint16_t protocol_version,
+				char **buffer_ptr, int *buffer_size)
+{
+	/* Locks: Read config, partition */
+	slurmctld_lock_t class_lock = {
+		READ_LOCK, NO_LOCK, NO_LOCK, READ_LOCK, NO_LOCK };
+	/* Locks: Read config job part, as _slurm_rpc_dump_jobs() */
+	slurmctld_lock_t job_read_lock = {
+		READ_LOCK, READ_LOCK, NO_LOCK, READ_LOCK, READ_LOCK };
+	job_info_cache_ent_t *ent = NULL;
+	bitstr_t *visible_parts = NULL;
+	uint64_t conf_gen, job_gen, part_gen;
+	time_t now;
+	bool cacheable;
+	int i;
+
+	lock_slurmctld(class_lock);
+	slurm_mutex_lock(&cache_mutex);
+	_load_config();
+	if (!cache_max) {
+		_flush();
+		slurm_mutex_unlock(&cache_mutex);
+		unlock_slurmctld(class_lock);
+		return NULL;
+	}
+	slurm_mutex_unlock(&cache_mutex);
+
+	if (!_visibility_class(uid, show_flags, &visible_parts)) {
+		unlock_slurmctld(class_lock);
+		return NULL;
+	}
+	conf_gen = slurmctld_lock_gen(CONF_LOCK);
+	part_gen = slurmctld_lock_gen(PART_LOCK);
+	job_gen = slurmctld_lock_gen(JOB_LOCK);
+	now = time(NULL);
+
+	slurm_mutex_lock(&cache_mutex);
+	for (i = 0; i < cache_cnt; i++) {
+		ent = cache[i];
+		if ((ent->show_flags == show_flags) &&
+		    (ent->protocol_version == protocol_version) &&
+		    (ent->conf_gen == conf_gen) && (ent->job_gen == job_gen) &&
+		    (ent->part_gen == part_gen) && (ent->packed == now) &&
+		    _same_class(ent->visible_parts, visible_parts))
+			break;
+	}
+	if (i < cache_cnt) {
+		ent->refcnt++;
+		ent->last_used = ++use_cnt;
+		slurmctld_diag_stats.job_info_cache_hits++;
+	} else {
+		ent = NULL;
+		slurmctld_diag_stats.job_info_cache_misses++;
+	}
+	slurm_mutex_unlock(&cache_mutex);
+	unlock_slurmctld(class_lock);
+
+	if (ent) {
+		FREE_NULL_BITMAP(visible_parts);
+		*buffer_ptr = ent->buffer;
+		*buffer_size = ent->buffer_size;
+		return ent;
+	}
+
+	/*
+	 * Pack it, with the generations and the class as of when the jobs
+	 * are packed, nothing can change them under the read locks.
+	 */
+	FREE_NULL_BITMAP(visible_parts);
+	ent = xmalloc(sizeof(job_info_cache_ent_t));
+	ent->show_flags = show_flags;
+	ent->protocol_version = protocol_version;
+	ent->refcnt = 1;
+
+	lock_slurmctld(job_read_lock);
+	cacheable = _visibility_class(uid, show_flags, &ent->visible_parts);
+	ent->conf_gen = slurmctld_lock_gen(CONF_LOCK);
+	ent->job_gen = slurmctld_lock_gen(JOB_LOCK);
+	ent->part_gen = slurmctld_lock_gen(PART_LOCK);
+	ent->packed = time(NULL);
+	pack_all_jobs(&ent->buffer, &ent->buffer_size, show_flags, uid,
+		      NO_VAL, protocol_version);
+	unlock_slurmctld(job_read_lock);
+
+	*buffer_ptr = ent->buffer;
+	*buffer_size = ent->buffer_size;
+	if (!cacheable)
+		return ent;
+
+	slurm_mutex_lock(&cache_mutex);
+	_purge(ent->conf_gen, ent->job_gen, ent->part_gen, ent->packed);
+	if (cache_cnt < cache_max) {
+		xrecalloc(cache, cache_max, sizeof(job_info_cache_ent_t *));
+		ent->refcnt++;
+		ent->last_used = ++use_cnt;
+		cache[cache_cnt++] = ent;
+	}
+	slurmctld_diag_stats.job_info_cache_size = cache_cnt;
+	slurm_mutex_unlock(&cache_mutex);
+
+	return ent;
+}
+
+extern void job_info_cache_release(void *handle)
+{
+	slurm_mutex_lock(&cache_mutex);
+	_release(handle);
+	slurm_mutex_unlock(&cache_mutex);
+}
+
+extern void job_info_cache_fini(void)
+{
+	slurm_mutex_lock(&cache_mutex);
+	_flush();
+	xfree(cache);
+	slurm_mutex_unlock(&cache_mutex);
+}
@@ -0,0 +1,65 @@
+/*****************************************************************************\
+ *  job_info_cache.h - cache of packed job information responses
+ *****************************************************************************
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURMCTLD_JOB_INFO_CACHE_H
+#define _SLURMCTLD_JOB_INFO_CACHE_H
+
+#include <inttypes.h>
+#include <sys/types.h>
+
+/*
+ * job_info_cache_get - get the packed response to REQUEST_JOB_INFO for all
+ *	jobs, as pack_all_jobs() makes it, from the cache or pack it and
+ *	cache it
+ * IN show_flags - job filtering options
+ * IN uid - uid of user making request
+ * IN protocol_version - to pack with
+ * OUT buffer_ptr - set to the packed response, valid until released
+ * OUT buffer_size - set to the size of the response in bytes
+ * RET a handle for job_info_cache_release(), or NULL if the cache is
+ *	disabled (SchedulerParameters=job_info_cache) or the response is
+ *	specific to uid, in which case the caller packs it itself
+ * NOTE: takes the slurmctld locks it needs, call without holding any
+ */
+extern void *job_info_cache_get(uint16_t show_flags, uid_t uid,
+				uint16_t protocol_version,
+				char **buffer_ptr, int *buffer_size);
+
+/* job_info_cache_release - done with a response from job_info_cache_get() */
+extern void job_info_cache_release(void *handle);
+
+/* job_info_cache_fini - free the cached responses */
+extern void job_info_cache_fini(void);
+
+#endif
@@ -92,6 +92,7 @@
 #include "src/slurmctld/fed_mgr.h"
 #include "src/slurmctld/front_end.h"
 #include "src/slurmctld/gang.h"
+#include "src/slurmctld/info_delta.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/job_submit.h"
 #include "src/slurmctld/licenses.h"
@@ -606,7 +607,6 @@ static job_record_t *_create_job_record(uint32_t num_jobs)
 	}
 
 	job_count += num_jobs;
-	last_job_update = time(NULL);
 
 	job_ptr->magic = JOB_MAGIC;
 	job_ptr->array_task_id = NO_VAL;
@@ -621,6 +621,7 @@ static job_record_t *_create_job_record(uint32_t num_jobs)
 			       * hasn't been set yet  */
 	job_ptr->billable_tres = (double)NO_VAL;
 	(void) list_append(job_list, job_ptr);
+	job_updated(job_ptr, time(NULL));	/*AG*/
 
 	return job_ptr;
 }
@@ -3045,6 +3046,7 @@ extern void build_array_str(job_record_t *job_ptr)
 	    (job_ptr->array_task_id != NO_VAL) ||
 	    (bit_ffs(job_ptr->array_recs->task_id_bitmap) == -1))
 		return;
+	info_delta_job_changed(job_ptr);	/*AG*/
 
 
 	array_recs->task_id_str = bit_fmt_hexmask(array_recs->task_id_bitmap);
@@ -3354,7 +3356,7 @@ static void _rebuild_part_name_list(job_record_t *job_ptr)
 
 	if (!job_ptr->part_ptr_list) {
 		job_ptr->partition = xstrdup(job_ptr->part_ptr->name);
-		last_job_update = time(NULL);
+		job_updated(job_ptr, time(NULL));
 		return;
 	}
 
@@ -3378,7 +3380,7 @@ static void _rebuild_part_name_list(job_record_t *job_ptr)
 		xstrcat(job_ptr->partition, part_ptr->name);
 	}
 	list_iterator_destroy(part_iterator);
-	last_job_update = time(NULL);
+	job_updated(job_ptr, time(NULL));
 }
 
 /*
@@ -3597,6 +3599,7 @@ extern int kill_job_by_part_name(char *part_name)
 		}
 		if (IS_JOB_RUNNING(job_ptr) || suspended) {
 			kill_job_cnt++;
+			job_updated(job_ptr, now);	/*AG*/
 			info("Killing %pJ on defunct partition %s",
 			     job_ptr, part_name);
 			job_ptr->job_state = JOB_NODE_FAIL | JOB_COMPLETING;
@@ -3615,6 +3618,7 @@ extern int kill_job_by_part_name(char *part_name)
 						 false);
 		} else if (pending) {
 			kill_job_cnt++;
+			job_updated(job_ptr, now);	/*AG*/
 			info("Killing %pJ on defunct partition %s",
 			     job_ptr, part_name);
 			job_ptr->job_state	= JOB_CANCELLED;
@@ -3629,8 +3633,6 @@ extern int kill_job_by_part_name(char *part_name)
 	}
 	list_iterator_destroy(job_iterator);
 
-	if (kill_job_cnt)
-		last_job_update = now;
 	return kill_job_cnt;
 }
 
@@ -3682,6 +3684,7 @@ extern int kill_job_by_front_end_name(char *node_name)
 		}
 		if (IS_JOB_COMPLETING(job_ptr)) {
 			kill_job_cnt++;
+			job_updated(job_ptr, now);	/*AG*/
 			while ((i = bit_ffs(job_ptr->node_bitmap_cg)) >= 0) {
 				bit_clear(job_ptr->node_bitmap_cg, i);
 				if (job_ptr->node_cnt)
@@ -3704,6 +3707,7 @@ extern int kill_job_by_front_end_name(char *node_name)
 			}
 		} else if (IS_JOB_RUNNING(job_ptr) || suspended) {
 			kill_job_cnt++;
+			job_updated(job_ptr, now);	/*AG*/
 			if (job_ptr->batch_flag && job_ptr->details &&
 			    slurmctld_conf.job_requeue &&
 			    (job_ptr->details->requeue > 0)) {
@@ -3787,8 +3791,6 @@ extern int kill_job_by_front_end_name(char *node_name)
 	}
 	list_iterator_destroy(job_iterator);
 
-	if (kill_job_cnt)
-		last_job_update = now;
 	return kill_job_cnt;
 #else
 	return 0;
@@ -3935,6 +3937,7 @@ extern int kill_running_job_by_node_name(char *node_name)
 			if (!bit_test(job_ptr->node_bitmap_cg, node_inx))
 				continue;
 			kill_job_cnt++;
+			job_updated(job_ptr, now);	/*AG*/
 			bit_clear(job_ptr->node_bitmap_cg, node_inx);
 			job_update_tres_cnt(job_ptr, node_inx);
 			if (job_ptr->node_cnt)
@@ -3953,6 +3956,7 @@ extern int kill_running_job_by_node_name(char *node_name)
 			}
 		} else if (IS_JOB_RUNNING(job_ptr) || suspended) {
 			kill_job_cnt++;
+			job_updated(job_ptr, now);	/*AG*/
 			if ((job_ptr->details) &&
 			    (job_ptr->kill_on_node_fail == 0) &&
 			    (job_ptr->node_cnt > 1) &&
@@ -4053,8 +4057,6 @@ extern int kill_running_job_by_node_name(char *node_name)
 
 	}
 	list_iterator_destroy(job_iterator);
-	if (kill_job_cnt)
-		last_job_update = now;
 
 	return kill_job_cnt;
 }
@@ -4618,6 +4620,8 @@ extern job_record_t *job_array_split(job_record_t *job_ptr)
 	if (job_ptr->fed_details)
 		add_fed_job_info(job_ptr);
 
+	info_delta_job_changed(job_ptr);	/*AG*/
+	info_delta_job_changed(job_ptr_pend);	/*AG*/
 	return job_ptr_pend;
 }
 
@@ -4949,6 +4953,7 @@ extern int job_allocate(job_desc_msg_t * job_specs, int immediate,
 		return error_code;
 	}
 	xassert(job_ptr);
+	job_submit_plugin_created(job_ptr);	/*AG*/
 	if (job_specs->array_bitmap)
 		independent = false;
 	else
@@ -5055,7 +5060,7 @@ extern int job_allocate(job_desc_msg_t * job_specs, int immediate,
 
 	error_code = _select_nodes_parts(job_ptr, no_alloc, NULL, err_msg);
 	if (!test_only) {
-		last_job_update = now;
+		job_updated(job_ptr, now);
 	}
 
 	if (held_user)
@@ -5158,6 +5163,7 @@ static int _job_fail(job_record_t *job_ptr, uint32_t job_state)
 
 	if (IS_JOB_FINISHED(job_ptr))
 		return ESLURM_ALREADY_DONE;
+	info_delta_job_changed(job_ptr);	/*AG*/
 	if (IS_JOB_SUSPENDED(job_ptr)) {
 		uint32_t suspend_job_state = job_ptr->job_state;
 		/*
@@ -5180,7 +5186,7 @@ static int _job_fail(job_record_t *job_ptr, uint32_t job_state)
 				difftime(now, job_ptr->suspend_time);
 		} else
 			job_ptr->end_time       = now;
-		last_job_update                 = now;
+		job_updated(job_ptr, now);
 		job_ptr->job_state = job_state | JOB_COMPLETING;
 		job_ptr->exit_code = 1;
 		job_ptr->state_reason = FAIL_LAUNCH;
@@ -5260,6 +5266,7 @@ extern int job_signal(job_record_t *job_ptr, uint16_t signal,
 	time_t now = time(NULL);
 
 	trace_job(job_ptr, __func__, "enter");
+	info_delta_job_changed(job_ptr);	/*AG*/
 
 	if (IS_JOB_STAGE_OUT(job_ptr) && (flags & KILL_HURRY)) {
 		job_ptr->bit_flags |= JOB_KILL_HURRY;
@@ -5309,7 +5316,7 @@ extern int job_signal(job_record_t *job_ptr, uint16_t signal,
 
 	/* let node select plugin do any state-dependent signaling actions */
 	select_g_job_signal(job_ptr, signal);
-	last_job_update = now;
+	job_updated(job_ptr, now);
 
 	/* save user ID of the one who requested the job be cancelled */
 	if (signal == SIGKILL)
@@ -5329,7 +5336,7 @@ extern int job_signal(job_record_t *job_ptr, uint16_t signal,
 		job_ptr->bit_flags |= JOB_KILL_HURRY;
 
 	if (IS_JOB_CONFIGURING(job_ptr) && (signal == SIGKILL)) {
-		last_job_update         = now;
+		job_updated(job_ptr, now);
 		job_ptr->end_time       = now;
 		job_ptr->job_state      = JOB_CANCELLED | JOB_COMPLETING;
 		if (flags & KILL_FED_REQUEUE)
@@ -5374,7 +5381,7 @@ extern int job_signal(job_record_t *job_ptr, uint16_t signal,
 	else
 		job_term_state = JOB_CANCELLED;
 	if (IS_JOB_SUSPENDED(job_ptr) && (signal == SIGKILL)) {
-		last_job_update         = now;
+		job_updated(job_ptr, now);
 		job_ptr->end_time       = job_ptr->suspend_time;
 		job_ptr->tot_sus_time  += difftime(now, job_ptr->suspend_time);
 		job_ptr->job_state      = job_term_state | JOB_COMPLETING;
@@ -5410,7 +5417,7 @@ extern int job_signal(job_record_t *job_ptr, uint16_t signal,
 			 */
 			job_ptr->time_last_active	= now;
 			job_ptr->end_time		= now;
-			last_job_update			= now;
+			job_updated(job_ptr, now);
 			job_ptr->job_state = job_term_state | JOB_COMPLETING;
 			if (flags & KILL_FED_REQUEUE)
 				job_ptr->job_state |= JOB_REQUEUE;
@@ -5577,7 +5584,6 @@ extern int job_str_signal(char *job_id_str, uint16_t signal, uint16_t flags,
 		return job_signal(job_ptr, signal, flags, uid,preempt);
 	}
 
-	last_job_update = now;
 	job_id = (uint32_t) long_id;
 	if (end_ptr[0] == '\0') {	/* Single job (or full job array) */
 		int jobs_done = 0, jobs_signaled = 0;
@@ -5734,8 +5740,8 @@ extern int job_str_signal(char *job_id_str, uint16_t signal, uint16_t flags,
 			orig_task_cnt = job_ptr->array_recs->task_cnt;
 			new_task_count = bit_set_count(job_ptr->array_recs->
 						       task_id_bitmap);
+			job_updated(job_ptr, now);	/*AG*/
 			if (!new_task_count) {
-				last_job_update		= now;
 				job_ptr->job_state	= JOB_CANCELLED;
 				job_ptr->start_time	= now;
 				job_ptr->end_time	= now;
@@ -5896,6 +5902,7 @@ static int _job_complete(job_record_t *job_ptr, uid_t uid, bool requeue,
 	xassert(verify_lock(JOB_LOCK, WRITE_LOCK));
 	xassert(verify_lock(FED_LOCK, READ_LOCK));
 
+	info_delta_job_changed(job_ptr);	/*AG*/
 	if (IS_JOB_FINISHED(job_ptr)) {
 		if (job_ptr->exit_code == 0)
 			job_ptr->exit_code = job_return_code;
@@ -6075,7 +6082,7 @@ static int _job_complete(job_record_t *job_ptr, uid_t uid, bool requeue,
 		job_completion_logger(job_ptr, false);
 	}
 
-	last_job_update = now;
+	job_updated(job_ptr, now);
 	job_ptr->time_last_active = now;   /* Timer for resending kill RPC */
 	if (job_comp_flag) {	/* job was running */
 		build_cg_bitmap(job_ptr);
@@ -8494,6 +8501,7 @@ static void _job_time_limit_incr(job_record_t *job_ptr, uint32_t boot_job_id)
 		}
 		job_ptr->end_time = now + (job_ptr->time_limit * 60);
 		job_ptr->end_time_exp = job_ptr->end_time;
+		license_job_end_time_changed(job_ptr); /*AG */
 	}
 }
 
@@ -8538,7 +8546,7 @@ extern void job_config_fini(job_record_t *job_ptr)
 {
 	time_t now = time(NULL);
 
-	last_job_update = now;
+	job_updated(job_ptr, now);
 	job_ptr->job_state &= ~JOB_CONFIGURING;
 	if (IS_JOB_POWER_UP_NODE(job_ptr)) {
 		info("Resetting %pJ start time for node power up", job_ptr);
@@ -8667,6 +8675,7 @@ void job_time_limit(void)
 	while ((job_ptr = list_next(job_iterator))) {
 		xassert (job_ptr->magic == JOB_MAGIC);
 		job_test_count++;
+		info_delta_job_sched(job_ptr);	/*AG*/
 
 		if (job_ptr->details)
 			prolog = job_ptr->details->prolog_running;
@@ -8693,7 +8702,7 @@ void job_time_limit(void)
 		    IS_JOB_PENDING(job_ptr) && (job_ptr->priority == 0)) {
 			job_ptr->state_reason = WAIT_NO_REASON;
 			set_job_prio(job_ptr);
-			last_job_update = now;
+			job_updated(job_ptr, now);
 		}
 
 		/* Don't enforce time limits for configuring pack jobs */
@@ -8718,7 +8727,7 @@ void job_time_limit(void)
 
 			if (job_ptr->end_time <= now) {
 				uint16_t mode = slurm_job_preempt_mode(job_ptr);
-				last_job_update = now;
+				job_updated(job_ptr, now);
 				info("%s: Preemption GraceTime reached %pJ",
 				     __func__, job_ptr);
 				job_ptr->job_state = JOB_PREEMPTED |
@@ -8787,7 +8796,7 @@ void job_time_limit(void)
 			else
 				over_run = now - (over_time_limit  * 60);
 			if (job_ptr->end_time <= over_run) {
-				last_job_update = now;
+				job_updated(job_ptr, now);
 				info("Time limit exhausted for %pJ", job_ptr);
 				_job_timed_out(job_ptr, false);
 				job_ptr->state_reason = FAIL_TIMEOUT;
@@ -8799,7 +8808,7 @@ void job_time_limit(void)
 		if (job_ptr->resv_ptr &&
 		    !(job_ptr->resv_ptr->flags & RESERVE_FLAG_FLEX) &&
 		    (job_ptr->resv_ptr->end_time + resv_over_run) < time(NULL)){
-			last_job_update = now;
+			job_updated(job_ptr, now);
 			info("Reservation ended for %pJ", job_ptr);
 			_job_timed_out(job_ptr, false);
 			job_ptr->state_reason = FAIL_TIMEOUT;
@@ -8818,7 +8827,7 @@ void job_time_limit(void)
 		acct_policy_job_time_out(job_ptr);
 
 		if (job_ptr->state_reason == FAIL_TIMEOUT) {
-			last_job_update = now;
+			job_updated(job_ptr, now);
 			_job_timed_out(job_ptr, false);
 			xfree(job_ptr->state_desc);
 			goto time_check;
@@ -9049,6 +9058,24 @@ extern int job_update_tres_cnt(job_record_t *job_ptr, int node_inx)
 	return rc;
 }
 
+/*AG job_updated - see slurmctld.h */
+extern void job_updated(job_record_t *job_ptr, time_t now)
+{
+	xassert(verify_lock(JOB_LOCK, WRITE_LOCK));
+
+	last_job_update = now;
+	info_delta_job_changed(job_ptr);
+}
+
+/*AG job_sched_updated - see slurmctld.h */
+extern void job_sched_updated(job_record_t *job_ptr, time_t now)
+{
+	xassert(verify_lock(JOB_LOCK, WRITE_LOCK));
+
+	last_job_update = now;
+	info_delta_job_sched(job_ptr);
+}
+
 /* Terminate a job that has exhausted its time limit */
 static void _job_timed_out(job_record_t *job_ptr, bool preempted)
 {
@@ -9268,6 +9295,9 @@ static void _list_delete_job(void *job_entry)
 	/* Remove record from fed_job_list */
 	fed_mgr_remove_fed_job_info(job_ptr->job_id);
 
+	/*AG tell the clients of job info deltas */
+	info_delta_job_purged(job_ptr);
+
 	/* Remove the record from job hash table */
 	_remove_job_hash(job_ptr, JOB_HASH_JOB);
 
@@ -9671,6 +9701,107 @@ extern void pack_spec_jobs(char **buffer_ptr, int *buffer_size, List job_ids,
 	buffer_ptr[0] = xfer_buf_data(buffer);
 }
 
+/*AG
+ * pack_delta_jobs - dump the jobs changed since a generation in
+ *	machine independent form (for network transmission), see info_delta.c
+ * OUT buffer_ptr - the pointer is set to the allocated buffer, or NULL if
+ *	no job changed
+ * OUT buffer_size - set to size of the buffer in bytes
+ * IN since_gen - generation of the jobs the user has, 0 for none
+ * IN show_flags - job filtering options
+ * IN uid - uid of user making request (for partition filtering)
+ * global: job_list - global list of job records
+ * NOTE: the buffer at *buffer_ptr must be xfreed by the caller
+ * NOTE: change _unpack_job_info_delta_msg() in common/slurm_protocol_pack.c
+ *	whenever the data format changes
+ */
+extern void pack_delta_jobs(char **buffer_ptr, int *buffer_size,
+			    uint64_t since_gen, uint16_t show_flags, uid_t uid,
+			    uint16_t protocol_version)
+{
+	uint32_t jobs_packed = 0, tmp_offset, count_offset;
+	uint32_t removed_cnt = 0, *removed = NULL;
+	_foreach_pack_job_info_t pack_info = {0};
+	Buf buffer;
+	ListIterator itr;
+	job_record_t *job_ptr = NULL;
+	uint32_t last_packed;
+	uint64_t gen;
+	bool full;
+
+	xassert(verify_lock(JOB_LOCK, READ_LOCK));
+
+	buffer_ptr[0] = NULL;
+	*buffer_size = 0;
+
+	gen = info_delta_current(INFO_DELTA_JOBS, since_gen, &full);
+
+	/*
+	 * What a user sees with PrivateData=jobs is theirs, so not much, and
+	 * removed jobs must not tell them about the jobs of others
+	 */
+	if ((slurmctld_conf.private_data & PRIVATE_DATA_JOBS) &&
+	    !validate_operator(uid))
+		full = true;
+
+	buffer = init_buf(BUF_SIZE);
+
+	/* write message header: generation, full, size and time */
+	/* put in place holders for the generation and record count */
+	pack64((uint64_t) 0, buffer);
+	pack8((uint8_t) full, buffer);
+	count_offset = get_buf_offset(buffer);
+	pack32(jobs_packed, buffer);
+	pack_time(time(NULL), buffer);
+
+	/* write individual job records */
+	pack_info.buffer           = buffer;
+	pack_info.filter_uid       = NO_VAL;
+	pack_info.jobs_packed      = &jobs_packed;
+	pack_info.protocol_version = protocol_version;
+	pack_info.show_flags       = show_flags;
+	pack_info.uid              = uid;
+
+	itr = list_iterator_create(job_list);
+	while ((job_ptr = list_next(itr))) {
+		if (!full && (job_ptr->delta_gen <= since_gen))
+			continue;
+
+		last_packed = jobs_packed;
+		_pack_job(job_ptr, &pack_info);
+		if (!full && (jobs_packed == last_packed)) {
+			/* no longer shown */
+			if (!(removed_cnt % 64))
+				xrealloc(removed, sizeof(uint32_t) *
+					 (removed_cnt + 64));
+			removed[removed_cnt++] = job_ptr->job_id;
+		}
+	}
+	list_iterator_destroy(itr);
+
+	if (!full)
+		info_delta_purged(since_gen, &removed, &removed_cnt);
+
+	if (!full && !jobs_packed && !removed_cnt) {
+		free_buf(buffer);
+		return;
+	}
+
+	pack32_array(removed, removed_cnt, buffer);
+	xfree(removed);
+
+	/* put the real generation and record count in the header */
+	tmp_offset = get_buf_offset(buffer);
+	set_buf_offset(buffer, 0);
+	pack64(gen, buffer);
+	set_buf_offset(buffer, count_offset);
+	pack32(jobs_packed, buffer);
+	set_buf_offset(buffer, tmp_offset);
+
+	*buffer_size = get_buf_offset(buffer);
+	buffer_ptr[0] = xfer_buf_data(buffer);
+}
+
 static int _pack_hetero_job(job_record_t *job_ptr, uint16_t show_flags,
 			    Buf buffer, uint16_t protocol_version, uid_t uid)
 {
@@ -10937,6 +11068,7 @@ void reset_job_bitmaps(void)
 	while ((job_ptr = list_next(job_iterator))) {
 		xassert (job_ptr->magic == JOB_MAGIC);
 		job_fail = false;
+		job_updated(job_ptr, now);	/*AG node indexes may change */
 
 		if (job_ptr->partition == NULL) {
 			error("No partition for %pJ", job_ptr);
@@ -11067,8 +11199,6 @@ void reset_job_bitmaps(void)
 		}
 	}
 	list_iterator_destroy(job_iterator);
-
-	last_job_update = now;
 }
 
 static int _reset_detail_bitmaps(job_record_t *job_ptr)
@@ -11218,6 +11348,7 @@ extern void set_job_prio(job_record_t *job_ptr)
 		return;
 	job_ptr->priority = slurm_sched_g_initial_priority(lowest_prio,
 							   job_ptr);
+	info_delta_job_sched(job_ptr);	/*AG*/
 	if ((job_ptr->priority == 0) || (job_ptr->direct_set_prio))
 		return;
 
@@ -11435,6 +11566,7 @@ static void _hold_job(job_record_t *job_ptr, uid_t uid)
 
 static void _release_job_rec(job_record_t *job_ptr, uid_t uid)
 {
+	info_delta_job_changed(job_ptr);	/*AG*/
 	job_ptr->direct_set_prio = 0;
 	set_job_prio(job_ptr);
 	job_ptr->state_reason = WAIT_NO_REASON;
@@ -11629,6 +11761,7 @@ static int _update_job(job_record_t *job_ptr, job_desc_msg_t *job_specs,
 	if (job_ptr->db_index == NO_VAL64)
 		return ESLURM_JOB_SETTING_DB_INX;
 
+	info_delta_job_changed(job_ptr);	/*AG any field may change */
 	operator = validate_operator(uid);
 	if (job_specs->burst_buffer) {
 		/*
@@ -11640,7 +11773,7 @@ static int _update_job(job_record_t *job_ptr, job_desc_msg_t *job_specs,
 		if (IS_JOB_COMPLETED(job_ptr) && operator &&
 		    (job_specs->burst_buffer[0] == '\0')) {
 			xfree(job_ptr->burst_buffer);
-			last_job_update = now;
+			job_updated(job_ptr, now);
 		} else {
 			error_code = ESLURM_NOT_SUPPORTED;
 		}
@@ -11740,7 +11873,7 @@ static int _update_job(job_record_t *job_ptr, job_desc_msg_t *job_specs,
 	detail_ptr = job_ptr->details;
 	if (detail_ptr)
 		mc_ptr = detail_ptr->mc_ptr;
-	last_job_update = now;
+	job_updated(job_ptr, now);
 
 	/*
 	 * Check to see if the new requested job_specs exceeds any
@@ -12678,6 +12811,7 @@ static int _update_job(job_record_t *job_ptr, job_desc_msg_t *job_specs,
 					_xmit_new_end_time(job_ptr);
 				}
 				job_ptr->end_time_exp = job_ptr->end_time;
+				license_job_end_time_changed(job_ptr); /*AG */
 			}
 			sched_info("%s: setting time_limit to %u for %pJ",
 				   __func__, job_specs->time_limit, job_ptr);
@@ -12736,6 +12870,7 @@ static int _update_job(job_record_t *job_ptr, job_desc_msg_t *job_specs,
 			   (job_ptr->end_time > job_specs->end_time)) {
 			int delta_t  = job_specs->end_time - job_ptr->end_time;
 			job_ptr->end_time = job_specs->end_time;
+			license_job_end_time_changed(job_ptr); /*AG */
 			job_ptr->time_limit += (delta_t+30)/60; /* Sec->min */
 			sched_info("%s: setting time_limit to %u for %pJ",
 				   __func__, job_ptr->time_limit, job_ptr);
@@ -14835,7 +14970,7 @@ extern int job_alloc_info_ptr(uint32_t uid, job_record_t *job_ptr)
 	if (job_ptr->alias_list && !xstrcmp(job_ptr->alias_list, "TBD") &&
 	    (prolog == 0) && job_ptr->node_bitmap &&
 	    (bit_overlap_any(power_node_bitmap, job_ptr->node_bitmap) == 0)) {
-		last_job_update = time(NULL);
+		job_updated(job_ptr, time(NULL));
 		set_job_alias_list(job_ptr);
 	}
 
@@ -15128,6 +15263,7 @@ extern bool job_epilog_complete(uint32_t job_id, char *node_name,
 		return true;
 
 	trace_job(job_ptr, __func__, "enter");
+	info_delta_job_changed(job_ptr);	/*AG*/
 
 	/*
 	 * There is a potential race condition this handles.
@@ -15433,6 +15569,7 @@ extern void job_completion_logger(job_record_t *job_ptr, bool requeue)
 	uint32_t max_exit_code = 0;
 
 	xassert(job_ptr);
+	info_delta_job_changed(job_ptr);	/*AG*/
 
 	acct_policy_remove_job_submit(job_ptr);
 	if (job_ptr->nodes && ((job_ptr->bit_flags & JOB_KILL_HURRY) == 0)
@@ -15672,7 +15809,7 @@ extern int job_node_ready(uint32_t job_id, int *ready)
 	    job_ptr->alias_list && !xstrcmp(job_ptr->alias_list, "TBD") &&
 	    job_ptr->node_bitmap &&
 	    (bit_overlap_any(power_node_bitmap, job_ptr->node_bitmap) == 0)) {
-		last_job_update = time(NULL);
+		job_updated(job_ptr, time(NULL));
 		set_job_alias_list(job_ptr);
 	}
 
@@ -15819,6 +15956,7 @@ static void _suspend_job(job_record_t *job_ptr, uint16_t op, bool indf_susp)
 	agent_arg_t *agent_args;
 	suspend_int_msg_t *sus_ptr;
 
+	info_delta_job_changed(job_ptr);	/*AG*/
 	agent_args = xmalloc(sizeof(agent_arg_t));
 	agent_args->msg_type = REQUEST_SUSPEND_INT;
 	agent_args->retry = 0;	/* don't resend, gang scheduler can
@@ -15891,6 +16029,7 @@ static int _suspend_job_nodes(job_record_t *job_ptr, bool indf_susp)
 	for (i = i_first; i <= i_last; i++, node_ptr++) {
 		if (!bit_test(job_ptr->node_bitmap, i))
 			continue;
+		info_delta_node_changed(node_ptr);	/*AG*/
 		node_ptr->sus_job_cnt++;
 		if (node_ptr->run_job_cnt)
 			(node_ptr->run_job_cnt)--;
@@ -15924,7 +16063,8 @@ static int _suspend_job_nodes(job_record_t *job_ptr, bool indf_susp)
 			node_ptr->last_idle  = now;
 		}
 	}
-	last_job_update = last_node_update = now;
+	last_node_update = now;
+	job_updated(job_ptr, now);	/*AG*/
 	return rc;
 }
 
@@ -15960,6 +16100,7 @@ static int _resume_job_nodes(job_record_t *job_ptr, bool indf_susp)
 	for (i = i_first; i <= i_last; i++, node_ptr++) {
 		if (!bit_test(job_ptr->node_bitmap, i))
 			continue;
+		info_delta_node_changed(node_ptr);	/*AG*/
 
 		if (node_ptr->sus_job_cnt)
 			(node_ptr->sus_job_cnt)--;
@@ -15978,7 +16119,8 @@ static int _resume_job_nodes(job_record_t *job_ptr, bool indf_susp)
 		node_flags = node_ptr->node_state & NODE_STATE_FLAGS;
 		node_ptr->node_state = NODE_STATE_ALLOCATED | node_flags;
 	}
-	last_job_update = last_node_update = time(NULL);
+	last_node_update = time(NULL);
+	job_updated(job_ptr, last_node_update);	/*AG*/
 	return rc;
 }
 
@@ -16110,12 +16252,14 @@ static int _job_suspend_op(job_record_t *job_ptr, uint16_t op, bool indf_susp)
 			job_ptr->end_time_exp = job_ptr->end_time =
 				now + (job_ptr->time_limit * 60)
 				- job_ptr->pre_sus_time;
+			license_job_end_time_changed(job_ptr); /*AG */
 		}
 		resume_job_step(job_ptr);
 	}
 
 	job_ptr->time_last_active = now;
 	job_ptr->suspend_time = now;
+	info_delta_job_changed(job_ptr);	/*AG*/
 	jobacct_storage_g_job_suspend(acct_db_conn, job_ptr);
 
 	return rc;
@@ -16411,6 +16555,7 @@ static int _job_requeue_op(uid_t uid, job_record_t *job_ptr, bool preempt,
 	    !IS_JOB_RUNNING(job_ptr) && !IS_JOB_SUSPENDED(job_ptr)) {
 		return SLURM_SUCCESS;
 	}
+	info_delta_job_changed(job_ptr);	/*AG*/
 
 	if (flags & JOB_RECONFIG_FAIL)
 		node_features_g_get_node(job_ptr->nodes);
@@ -16462,7 +16607,7 @@ static int _job_requeue_op(uid_t uid, job_record_t *job_ptr, bool preempt,
 			return SLURM_SUCCESS;
 	}
 
-	last_job_update = now;
+	job_updated(job_ptr, now);
 
 	/*
 	 * In the job is in the process of completing
@@ -16883,6 +17028,7 @@ static int _set_top(List top_job_list, uid_t uid)
 	int64_t delta_prio, delta_nice, total_delta = 0;
 	int other_job_cnt = 0;
 	uint32_t *prio_elem;
+	time_t now = time(NULL);	/*AG*/
 
 	xassert(job_list);
 	xassert(top_job_list);
@@ -16987,6 +17133,7 @@ static int _set_top(List top_job_list, uid_t uid)
 		job_ptr->priority = next_prio;
 		job_ptr->details->nice -= delta_nice;
 		job_ptr->bit_flags &= (~TOP_PRIO_TMP);
+		job_updated(job_ptr, now);	/*AG*/
 	}
 	list_iterator_destroy(iter);
 	FREE_NULL_LIST(prio_list);
@@ -17005,6 +17152,7 @@ static int _set_top(List top_job_list, uid_t uid)
 			job_ptr->priority = next_prio;
 			job_ptr->details->nice += delta_nice;
 			job_ptr->bit_flags &= (~TOP_PRIO_TMP);
+			job_updated(job_ptr, now);	/*AG*/
 			total_delta -= delta_nice;
 			if (--other_job_cnt == 0)
 				break;	/* Count will match list size anyway */
@@ -17013,8 +17161,6 @@ static int _set_top(List top_job_list, uid_t uid)
 	}
 	FREE_NULL_LIST(other_job_list);
 
-	last_job_update = time(NULL);
-
 	return rc;
 }
 
@@ -17291,7 +17437,7 @@ extern int update_job_wckey(char *module, job_record_t *job_ptr,
 		info("%s: cleared wckey for %pJ", module, job_ptr);
 	}
 
-	last_job_update = time(NULL);
+	job_updated(job_ptr, time(NULL));
 
 	return SLURM_SUCCESS;
 }
@@ -17488,6 +17634,7 @@ extern job_desc_msg_t *copy_job_record_to_job_desc(job_record_t *job_ptr)
 /* Build a bitmap of nodes completing this job */
 extern void build_cg_bitmap(job_record_t *job_ptr)
 {
+	info_delta_job_changed(job_ptr);	/*AG*/
 	FREE_NULL_BITMAP(job_ptr->node_bitmap_cg);
 	if (job_ptr->node_bitmap) {
 		job_ptr->node_bitmap_cg = bit_copy(job_ptr->node_bitmap);
@@ -17518,6 +17665,7 @@ extern bool job_hold_requeue(job_record_t *job_ptr)
 	job_record_t *base_job_ptr = NULL;
 
 	xassert(job_ptr);
+	info_delta_job_changed(job_ptr);	/*AG*/
 
 	/* If the job is already pending it was
 	 * eventually requeued somewhere else.
@@ -17709,6 +17857,7 @@ extern void job_end_time_reset(job_record_t *job_ptr)
 				    (job_ptr->time_limit * 60);	/* secs */
 	}
 	job_ptr->end_time_exp = job_ptr->end_time;
+	license_job_end_time_changed(job_ptr); /*AG */
 }
 
 /* trace_job() - print the job details if
@@ -17752,6 +17901,7 @@ extern job_record_t *job_array_post_sched(job_record_t *job_ptr)
 	if (!job_ptr->array_recs || !job_ptr->array_recs->task_id_bitmap)
 		return job_ptr;
 
+	info_delta_job_changed(job_ptr);	/*AG*/
 	if (job_ptr->array_recs->task_cnt <= 1) {
 		/* Preserve array_recs for min/max exit codes for job array */
 		if (job_ptr->array_recs->task_cnt) {
@@ -17816,7 +17966,7 @@ static void _kill_dependent(job_record_t *job_ptr)
 	job_ptr->start_time = now;
 	job_ptr->end_time = now;
 	job_completion_logger(job_ptr, false);
-	last_job_update = now;
+	job_updated(job_ptr, now);
 	srun_allocate_abort(job_ptr);
 }
 
@@ -79,6 +79,7 @@
 #include "src/slurmctld/burst_buffer.h"
 #include "src/slurmctld/fed_mgr.h"
 #include "src/slurmctld/front_end.h"
+#include "src/slurmctld/info_delta.h"
 #include "src/slurmctld/gang.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/job_scheduler.h"
@@ -304,7 +305,7 @@ static bool _job_runnable_test1(job_record_t *job_ptr, bool sched_plugin)
 	if (job_ptr->state_reason == WAIT_FRONT_END) {
 		job_ptr->state_reason = WAIT_NO_REASON;
 		xfree(job_ptr->state_desc);
-		last_job_update = now;
+		job_sched_updated(job_ptr, now);
 	}
 #endif
 
@@ -320,7 +321,7 @@ static bool _job_runnable_test1(job_record_t *job_ptr, bool sched_plugin)
 		    && job_ptr->state_reason != WAIT_MAX_REQUEUE) {
 			job_ptr->state_reason = WAIT_HELD;
 			xfree(job_ptr->state_desc);
-			last_job_update = now;
+			job_sched_updated(job_ptr, now);
 		}
 		sched_debug3("%pJ. State=%s. Reason=%s. Priority=%u.",
 			     job_ptr,
@@ -425,6 +426,7 @@ extern List build_job_queue(bool clear_start, bool backfill)
 	List job_queue;
 	ListIterator depend_iter, job_iterator, part_iterator;
 	job_record_t *job_ptr = NULL, *new_job_ptr;
+	job_record_t *prev_job_ptr = NULL;	/*AG*/
 	part_record_t *part_ptr;
 	struct depend_spec *dep_ptr;
 	int i, pend_cnt, reason, dep_corr;
@@ -531,6 +533,9 @@ extern List build_job_queue(bool clear_start, bool backfill)
 
 	job_iterator = list_iterator_create(job_list);
 	while ((job_ptr = list_next(job_iterator))) {
+		if (prev_job_ptr)	/*AG done with it */
+			info_delta_job_sched(prev_job_ptr);
+		prev_job_ptr = job_ptr;
 		if (IS_JOB_PENDING(job_ptr))
 			acct_policy_handle_accrue_time(job_ptr, false);
 
@@ -555,7 +560,7 @@ extern List build_job_queue(bool clear_start, bool backfill)
 			    (job_ptr->state_reason != WAIT_RESOURCES))
 				job_ptr->state_reason_prev_db =
 					job_ptr->state_reason;
-			last_job_update = now;
+			job_sched_updated(job_ptr, now);
 		} else if ((job_ptr->state_reason_prev == WAIT_TIME) &&
 			   job_ptr->details &&
 			   (job_ptr->details->begin_time <= now)) {
@@ -564,7 +569,7 @@ extern List build_job_queue(bool clear_start, bool backfill)
 			    (job_ptr->state_reason != WAIT_RESOURCES))
 				job_ptr->state_reason_prev_db =
 					job_ptr->state_reason;
-			last_job_update = now;
+			job_sched_updated(job_ptr, now);
 		}
 		if (!_job_runnable_test1(job_ptr, clear_start))
 			continue;
@@ -580,7 +585,7 @@ extern List build_job_queue(bool clear_start, bool backfill)
 				    (reason != job_ptr->state_reason)) {
 					job_ptr->state_reason = reason;
 					xfree(job_ptr->state_desc);
-					last_job_update = now;
+					job_sched_updated(job_ptr, now);
 				}
 				/* priority_array index matches part_ptr_list
 				 * position: increment inx */
@@ -620,6 +625,8 @@ extern List build_job_queue(bool clear_start, bool backfill)
 		}
 	}
 	list_iterator_destroy(job_iterator);
+	if (prev_job_ptr)	/*AG*/
+		info_delta_job_sched(prev_job_ptr);
 
 	return job_queue;
 }
@@ -914,7 +921,7 @@ extern bool deadline_ok(job_record_t *job_ptr, char *func)
 		}
 	}
 	if (fail_job) {
-		last_job_update = now;
+		job_updated(job_ptr, now);
 		job_ptr->job_state = JOB_DEADLINE;
 		job_ptr->exit_code = 1;
 		job_ptr->state_reason = FAIL_DEADLINE;
@@ -1363,6 +1370,7 @@ static int _schedule(uint32_t job_limit)
 		if (job_ptr) {
 			job_resv_clear_promiscous_flag(job_ptr);
 			fill_array_reasons(job_ptr, reject_array_job);
+			info_delta_job_sched(job_ptr);	/*AG*/
 		}
 
 		if (fifo_sched) {
@@ -1380,7 +1388,7 @@ static int _schedule(uint32_t job_limit)
 			if (!avail_front_end(job_ptr)) {
 				job_ptr->state_reason = WAIT_FRONT_END;
 				xfree(job_ptr->state_desc);
-				last_job_update = now;
+				job_sched_updated(job_ptr, now);
 				continue;
 			}
 			if (!_job_runnable_test1(job_ptr, false))
@@ -1423,7 +1431,7 @@ next_part:
 			if (!avail_front_end(job_ptr)) {
 				job_ptr->state_reason = WAIT_FRONT_END;
 				xfree(job_ptr->state_desc);
-				last_job_update = now;
+				job_sched_updated(job_ptr, now);
 				continue;
 			}
 			if ((job_ptr->array_task_id != array_task_id) &&
@@ -1556,7 +1564,7 @@ next_task:
 					     failed_part_cnt)) {
 			job_ptr->state_reason = WAIT_PRIORITY;
 			xfree(job_ptr->state_desc);
-			last_job_update = now;
+			job_sched_updated(job_ptr, now);
 			sched_debug("%pJ. State=PENDING. Reason=Priority, Priority=%u. Partition=%s.",
 				    job_ptr, job_ptr->priority,
 				    job_ptr->partition);
@@ -1585,7 +1593,7 @@ next_task:
 				job_ptr->state_reason = WAIT_NO_REASON;
 				xfree(job_ptr->state_desc);
 				job_ptr->assoc_id = assoc_rec.id;
-				last_job_update = now;
+				job_updated(job_ptr, now);
 			} else {
 				sched_debug("%pJ has invalid association",
 					    job_ptr);
@@ -1611,13 +1619,13 @@ next_task:
 				sched_debug("%pJ has invalid QOS", job_ptr);
 				xfree(job_ptr->state_desc);
 				job_ptr->state_reason = FAIL_QOS;
-				last_job_update = now;
+				job_sched_updated(job_ptr, now);
 				assoc_mgr_unlock(&locks);
 				continue;
 			} else if (job_ptr->state_reason == FAIL_QOS) {
 				xfree(job_ptr->state_desc);
 				job_ptr->state_reason = WAIT_NO_REASON;
-				last_job_update = now;
+				job_sched_updated(job_ptr, now);
 			}
 			assoc_mgr_unlock(&locks);
 		}
@@ -1674,7 +1682,7 @@ next_task:
 			job_ptr->state_reason = WAIT_RESOURCES;
 			xfree(job_ptr->state_desc);
 			job_ptr->state_desc = xstrdup("Nodes required for job are DOWN, DRAINED or reserved for jobs in higher priority partitions");
-			last_job_update = now;
+			job_sched_updated(job_ptr, now);
 			sched_debug3("%pJ. State=%s. Reason=%s. Priority=%u. Partition=%s.",
 				     job_ptr,
 				     job_state_string(job_ptr->job_state),
@@ -1686,7 +1694,7 @@ next_task:
 		    SLURM_SUCCESS) {
 			job_ptr->state_reason = WAIT_LICENSES;
 			xfree(job_ptr->state_desc);
-			last_job_update = now;
+			job_sched_updated(job_ptr, now);
 			sched_debug3("%pJ. State=%s. Reason=%s. Priority=%u.",
 				     job_ptr,
 				     job_state_string(job_ptr->job_state),
@@ -1705,9 +1713,9 @@ next_task:
 			 * the time we consider running it. It should be
 			 * very rare. */
 			sched_info("%pJ has invalid account", job_ptr);
-			last_job_update = now;
 			job_ptr->state_reason = FAIL_ACCOUNT;
 			xfree(job_ptr->state_desc);
+			job_sched_updated(job_ptr, now);
 			continue;
 		}
 
@@ -1790,7 +1798,7 @@ skip_start:
 		} else if (error_code == ESLURM_FED_JOB_LOCK) {
 			job_ptr->state_reason = WAIT_FED_JOB_LOCK;
 			xfree(job_ptr->state_desc);
-			last_job_update = now;
+			job_sched_updated(job_ptr, now);
 			sched_debug3("%pJ. State=%s. Reason=%s. Priority=%u. Partition=%s.",
 				     job_ptr,
 				     job_state_string(job_ptr->job_state),
@@ -1800,7 +1808,7 @@ skip_start:
 		} else if (error_code == SLURM_SUCCESS) {
 			/* job initiated */
 			sched_debug3("%pJ initiated", job_ptr);
-			last_job_update = now;
+			job_updated(job_ptr, now);
 
 			/* Clear assumed rejected array status */
 			reject_array_job = NULL;
@@ -1850,7 +1858,7 @@ skip_start:
 			   (error_code != ESLURM_INVALID_BURST_BUFFER_REQUEST)){
 			sched_info("schedule: %pJ non-runnable: %s",
 				   job_ptr, slurm_strerror(error_code));
-			last_job_update = now;
+			job_updated(job_ptr, now);
 			job_ptr->job_state = JOB_PENDING;
 			job_ptr->state_reason = FAIL_BAD_CONSTRAINTS;
 			xfree(job_ptr->state_desc);
@@ -1921,6 +1929,8 @@ fail_this_part:	if (fail_by_part) {
 		}
 	}
 
+	if (job_ptr)
+		info_delta_job_sched(job_ptr);	/*AG*/
 	if (bb_wait_cnt)
 		(void) bb_g_job_try_stage_in();
 
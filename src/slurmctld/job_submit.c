@@ -70,8 +70,13 @@ static const char *syms[] = {
 	"job_modify"
 };
 
+/*AG optional, NULL for the plugins without it */
+typedef void (*job_created_fn_t)(job_record_t *job_ptr);
+static const char created_sym[] = "job_created";
+
 static int g_context_cnt = -1;
 static slurm_submit_ops_t *ops = NULL;
+static job_created_fn_t *created_ops = NULL;
 static plugin_context_t **g_context = NULL;
 static char *submit_plugin_list = NULL;
 static pthread_mutex_t g_context_lock = PTHREAD_MUTEX_INITIALIZER;
@@ -107,6 +112,8 @@ extern int job_submit_plugin_init(void)
 		xrecalloc(ops, g_context_cnt + 1, sizeof(slurm_submit_ops_t));
 		xrecalloc(g_context, g_context_cnt + 1,
 			  sizeof(plugin_context_t *));
+		xrecalloc(created_ops, g_context_cnt + 1,
+			  sizeof(job_created_fn_t));
 		if (xstrncmp(type, "job_submit/", 11) == 0)
 			type += 11; /* backward compatibility */
 		type = xstrdup_printf("job_submit/%s", type);
@@ -121,6 +128,9 @@ extern int job_submit_plugin_init(void)
 			break;
 		}
 
+		created_ops[g_context_cnt] = plugin_get_sym(
+			g_context[g_context_cnt]->cur_plugin, created_sym);
+
 		xfree(type);
 		g_context_cnt++;
 		names = NULL; /* for next strtok_r() iteration */
@@ -159,6 +169,7 @@ extern int job_submit_plugin_fini(void)
 		}
 	}
 	xfree(ops);
+	xfree(created_ops);
 	xfree(g_context);
 	xfree(submit_plugin_list);
 	g_context_cnt = -1;
@@ -272,3 +283,23 @@ extern int job_submit_plugin_modify(job_desc_msg_t *job_desc,
 
 	return rc;
 }
+
+/*AG
+ * Execute the optional job_created() function in each job submit plugin.
+ * IN job_ptr - job just created from a request job_submit() was run on
+ */
+extern void job_submit_plugin_created(job_record_t *job_ptr)
+{
+	int i;
+
+	xassert(verify_lock(JOB_LOCK, WRITE_LOCK));
+
+	if (job_submit_plugin_init() != SLURM_SUCCESS)
+		return;
+	slurm_mutex_lock(&g_context_lock);
+	for (i = 0; i < g_context_cnt; i++) {
+		if (created_ops[i])
+			(*(created_ops[i]))(job_ptr);
+	}
+	slurm_mutex_unlock(&g_context_lock);
+}
@@ -87,4 +87,12 @@ extern int job_submit_plugin_modify(job_desc_msg_t *job_desc,
 				    job_record_t *job_ptr,
 				    uint32_t submit_uid);
 
+/*AG
+ * Execute the optional job_created() function in each job submit plugin,
+ * letting them find the record of a job they saw in job_submit().
+ * IN job_ptr - job just created
+ * NOTE: Write lock on job
+ */
+extern void job_submit_plugin_created(job_record_t *job_ptr);
+
 #endif /* !_JOB_SUBMIT_H */
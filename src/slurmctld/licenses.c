@@ -57,6 +57,10 @@
 
 extern List license_list = (List) NULL; /*AG needed in lustre_util plugin*/
 time_t last_license_update = 0;
+uint32_t license_id_gen = 0;
+/*AG license_list entries by id (see licenses_t.id) */
+static licenses_t **license_index = NULL;
+static uint32_t license_index_cnt = 0;
 extern pthread_mutex_t license_mutex = PTHREAD_MUTEX_INITIALIZER; /*AG not static anymore - needed in lustre_util plugin*/
 static void _pack_license(struct licenses *lic, Buf buffer, uint16_t protocol_version);
 
@@ -93,10 +97,74 @@ extern void license_free_rec(void *x)
 
 	if (license_entry) {
 		xfree(license_entry->name);
+		xfree(license_entry->returns);
 		xfree(license_entry);
 	}
 }
 
+/*AG index of the first return at or after end_time */
+static uint32_t _return_find(licenses_t *license_entry, time_t end_time)
+{
+	uint32_t lo = 0, hi = license_entry->return_cnt, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (license_entry->returns[mid].end_time < end_time)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/*AG license_mutex should be locked before calling this. */
+static void _return_add(licenses_t *license_entry, time_t end_time,
+			uint32_t count)
+{
+	uint32_t i = _return_find(license_entry, end_time);
+	lic_return_t *ret;
+
+	if ((i < license_entry->return_cnt) &&
+	    (license_entry->returns[i].end_time == end_time)) {
+		license_entry->returns[i].count += count;
+		return;
+	}
+	if (license_entry->return_cnt == license_entry->return_size) {
+		license_entry->return_size =
+			MAX(16, license_entry->return_size * 2);
+		xrecalloc(license_entry->returns, license_entry->return_size,
+			  sizeof(lic_return_t));
+	}
+	ret = &license_entry->returns[i];
+	memmove(ret + 1, ret,
+		(license_entry->return_cnt - i) * sizeof(lic_return_t));
+	ret->end_time = end_time;
+	ret->count = count;
+	license_entry->return_cnt++;
+}
+
+/*AG license_mutex should be locked before calling this. */
+static void _return_remove(licenses_t *license_entry, time_t end_time,
+			   uint32_t count)
+{
+	uint32_t i = _return_find(license_entry, end_time);
+	lic_return_t *ret = &license_entry->returns[i];
+
+	if ((i == license_entry->return_cnt) || (ret->end_time != end_time)) {
+		/* This can happen after a reconfiguration */
+		debug2("%s: no %u licenses %s returned at %ld",
+		       __func__, count, license_entry->name, (long) end_time);
+		return;
+	}
+	if (ret->count > count) {
+		ret->count -= count;
+		return;
+	}
+	license_entry->return_cnt--;
+	memmove(ret, ret + 1,
+		(license_entry->return_cnt - i) * sizeof(lic_return_t));
+}
+
 /* Find a license_t record by license name (for use by list_find_first) */
 static int _license_find_rec(void *x, void *key)
 {
@@ -110,6 +178,55 @@ static int _license_find_rec(void *x, void *key)
 	return 1;
 }
 
+/*AG
+ * Assign ids to license_list entries in list order.
+ * license_mutex should be locked before calling this, after every change
+ * of license_list membership.
+ */
+static void _license_reindex(void)
+{
+	ListIterator iter;
+	licenses_t *license_entry;
+	uint32_t i = 0;
+
+	license_id_gen++;
+	license_index_cnt = license_list ? list_count(license_list) : 0;
+	xrecalloc(license_index, MAX(license_index_cnt, 1),
+		  sizeof(licenses_t *));
+	if (!license_list)
+		return;
+	iter = list_iterator_create(license_list);
+	while ((license_entry = list_next(iter))) {
+		license_entry->id = i;
+		license_entry->id_gen = license_id_gen;
+		license_index[i++] = license_entry;
+	}
+	list_iterator_destroy(iter);
+}
+
+/*AG
+ * Find the license_list record for a job's license entry, by its id if
+ * the entry was interned since the last change of license_list, otherwise
+ * by name (and intern the entry).
+ * license_mutex should be locked before calling this.
+ */
+static licenses_t *_license_lookup(licenses_t *license_entry)
+{
+	licenses_t *match;
+
+	if (license_entry->id_gen && (license_entry->id_gen == license_id_gen))
+		return license_index[license_entry->id];
+	if (!license_list)
+		return NULL;
+	match = list_find_first(license_list, _license_find_rec,
+				license_entry->name);
+	if (match) {
+		license_entry->id = match->id;
+		license_entry->id_gen = license_id_gen;
+	}
+	return match;
+}
+
 /* Find a license_t record by license name (for use by list_find_first) */
 static int _license_find_remote_rec(void *x, void *key)
 {
@@ -217,6 +334,7 @@ static void _add_res_rec_2_lic_list(slurmdb_res_rec_t *rec, bool sync)
 	license_entry->remote = sync ? 2 : 1;
 
 	list_push(license_list, license_entry);
+	_license_reindex();
 	last_license_update = time(NULL);
 }
 
@@ -259,6 +377,7 @@ extern int license_init(char *licenses)
 	license_list = _build_license_list(licenses, &valid);
 	if (!valid)
 		fatal("Invalid configured licenses: %s", licenses);
+	_license_reindex();
 
 	_licenses_print("init_license", license_list, NULL);
 	slurm_mutex_unlock(&license_mutex);
@@ -281,6 +400,7 @@ extern int license_update(char *licenses)
     slurm_mutex_lock(&license_mutex);
     if (!license_list) {        /* no licenses before now */
             license_list = new_list;
+            _license_reindex();
             slurm_mutex_unlock(&license_mutex);
             return SLURM_SUCCESS;
     }
@@ -296,6 +416,7 @@ extern int license_update(char *licenses)
         
         license_entry->used = 0;
         license_entry->r_used = 0; /*AG updated */
+        license_entry->return_cnt = 0;
         list_append(new_list, license_entry);
         continue;
       }
@@ -319,6 +440,7 @@ extern int license_update(char *licenses)
 
     FREE_NULL_LIST(license_list);
     license_list = new_list;
+    _license_reindex();
     _licenses_print("update_license", license_list, NULL);
     slurm_mutex_unlock(&license_mutex);
     return SLURM_SUCCESS;
@@ -428,6 +550,7 @@ extern void license_remove_remote(slurmdb_res_rec_t *rec)
 			     "removed with %u in use",
 			     license_entry->name, license_entry->used);
 			list_delete_item(iter);
+			_license_reindex();
 			last_license_update = time(NULL);
 			break;
 		}
@@ -501,6 +624,7 @@ extern void license_sync_remote(List res_list)
 			license_entry->remote = 1;
 	}
 	list_iterator_destroy(iter);
+	_license_reindex();
 
 	slurm_mutex_unlock(&license_mutex);
 }
@@ -510,6 +634,8 @@ extern void license_free(void)
 {
 	slurm_mutex_lock(&license_mutex);
 	FREE_NULL_LIST(license_list);
+	_license_reindex();
+	xfree(license_index);
 	slurm_mutex_unlock(&license_mutex);
 }
 
@@ -553,12 +679,7 @@ extern List license_validate(char *licenses, bool validate_configured,
 	_licenses_print("request_license", job_license_list, NULL);
 	iter = list_iterator_create(job_license_list);
 	while ((license_entry = list_next(iter))) {
-		if (license_list) {
-			match = list_find_first(license_list,
-						_license_find_rec,
-						license_entry->name);
-		} else
-			match = NULL;
+		match = _license_lookup(license_entry);
 		if (!match) {
 			debug("License name requested (%s) does not exist",
 			      license_entry->name);
@@ -629,8 +750,7 @@ extern int license_job_test(job_record_t *job_ptr, time_t when, bool reboot)
 	slurm_mutex_lock(&license_mutex);
 	iter = list_iterator_create(job_ptr->license_list);
 	while ((license_entry = list_next(iter))) {
-		match = list_find_first(license_list, _license_find_rec,
-			license_entry->name);
+		match = _license_lookup(license_entry);
 		if (!match) {
 			error("could not find license %s for job %u",
 			      license_entry->name, job_ptr->job_id);
@@ -687,6 +807,8 @@ extern List license_job_copy(List license_list_src)
 		license_entry_dest = xmalloc(sizeof(licenses_t));
 		license_entry_dest->name = xstrdup(license_entry_src->name);
 		license_entry_dest->total = license_entry_src->total;
+		license_entry_dest->id = license_entry_src->id;
+		license_entry_dest->id_gen = license_entry_src->id_gen;
 		list_push(license_list_dest, license_entry_dest);
 	}
 	list_iterator_destroy(iter);
@@ -712,12 +834,13 @@ extern int license_job_get(job_record_t *job_ptr)
 	slurm_mutex_lock(&license_mutex);
 	iter = list_iterator_create(job_ptr->license_list);
 	while ((license_entry = list_next(iter))) {
-		match = list_find_first(license_list, _license_find_rec,
-			license_entry->name);
+		match = _license_lookup(license_entry);
 		if (match) {
 			match->used += license_entry->total;
 			license_entry->used += license_entry->total;
 			match->r_used += license_entry->total; /*AG temporary update to prevent overbooking */
+			_return_add(match, job_ptr->end_time,
+				    license_entry->total);
 		} else {
 			error("could not find license %s for job %u",
 			      license_entry->name, job_ptr->job_id);
@@ -725,6 +848,7 @@ extern int license_job_get(job_record_t *job_ptr)
 		}
 	}
 	list_iterator_destroy(iter);
+	job_ptr->license_end_time = job_ptr->end_time;
 	_licenses_print("acquire_license", license_list, job_ptr);
 	slurm_mutex_unlock(&license_mutex);
 	return rc;
@@ -749,8 +873,7 @@ extern int license_job_return(job_record_t *job_ptr)
 	slurm_mutex_lock(&license_mutex);
 	iter = list_iterator_create(job_ptr->license_list);
 	while ((license_entry = list_next(iter))) {
-		match = list_find_first(license_list, _license_find_rec,
-			license_entry->name);
+		match = _license_lookup(license_entry);
 		if (match) {
 			if (match->used >= license_entry->total)
 				match->used -= license_entry->total;
@@ -768,6 +891,8 @@ extern int license_job_return(job_record_t *job_ptr)
               __func__, match->name);
         match->r_used = 0;
       }
+			_return_remove(match, job_ptr->license_end_time,
+				       license_entry->total);
 			license_entry->used = 0;
 		} else {
 			/* This can happen after a reconfiguration */
@@ -781,6 +906,38 @@ extern int license_job_return(job_record_t *job_ptr)
 	return rc;
 }
 
+/*
+ * license_job_end_time_changed - Move a running job's licenses to its new
+ *	end_time in the license return timeline
+ * IN job_ptr - job identification
+ */
+extern void license_job_end_time_changed(job_record_t *job_ptr)
+{
+	ListIterator iter;
+	licenses_t *license_entry, *match;
+
+	if (!job_ptr->license_list ||	/* no licenses needed */
+	    (job_ptr->license_end_time == job_ptr->end_time) ||
+	    (!IS_JOB_RUNNING(job_ptr) && !IS_JOB_SUSPENDED(job_ptr)))
+		return;
+
+	slurm_mutex_lock(&license_mutex);
+	iter = list_iterator_create(job_ptr->license_list);
+	while ((license_entry = list_next(iter))) {
+		if (!license_entry->used)	/* not acquired */
+			continue;
+		match = _license_lookup(license_entry);
+		if (!match)
+			continue;
+		_return_remove(match, job_ptr->license_end_time,
+			       license_entry->total);
+		_return_add(match, job_ptr->end_time, license_entry->total);
+	}
+	list_iterator_destroy(iter);
+	job_ptr->license_end_time = job_ptr->end_time;
+	slurm_mutex_unlock(&license_mutex);
+}
+
 /*
  * license_list_overlap - test if there is any overlap in licenses
  *	names found in the two lists
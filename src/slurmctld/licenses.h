@@ -42,17 +42,33 @@
 #include "src/common/list.h"
 #include "src/slurmctld/slurmctld.h"
 
+/*AG licenses of running jobs returned at the same end time */
+typedef struct lic_return {
+	time_t		end_time;	/* 0 if not known yet */
+	uint32_t	count;
+} lic_return_t;
+
 typedef struct licenses {
 	char *		name;		/* name associated with a license */
 	uint32_t	total;		/* total license configued */
 	uint32_t	used;		/* used licenses */
   uint32_t  r_used; /*AG "real" i.e. "remotely measured" used licenses */
 	uint8_t         remote;	        /* non-zero if remote (from database) */
+	/*AG index of the license in license_list, valid while id_gen equals
+	 * license_id_gen (it changes whenever license_list does) */
+	uint32_t	id;
+	uint32_t	id_gen;
+	/*AG when running jobs return the used licenses, sorted by end_time;
+	 * only in license_list, maintained by license_job_get/return */
+	lic_return_t *	returns;
+	uint32_t	return_cnt;
+	uint32_t	return_size;
 } licenses_t;
 
 extern List license_list;
 extern List clus_license_list;
 extern time_t last_license_update;
+extern uint32_t license_id_gen;	/*AG see licenses_t.id */
 
 /* Get string of used license information. Caller must xfree return value */
 extern char *get_licenses_used(void);
@@ -104,6 +120,14 @@ extern void license_job_merge(job_record_t *job_ptr);
  */
 extern int license_job_return(job_record_t *job_ptr);
 
+/*
+ * license_job_end_time_changed - Move a running job's licenses to its new
+ *	end_time in the license return timeline (see licenses_t.returns).
+ *	Call after changing end_time of a job that holds its licenses.
+ * IN job_ptr - job identification
+ */
+extern void license_job_end_time_changed(job_record_t *job_ptr);
+
 /*
  * license_job_test - Test if the licenses required for a job are available
  * IN job_ptr - job identification
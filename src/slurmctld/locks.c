@@ -41,6 +41,7 @@
 #include <pthread.h>
 #include <string.h>
 #include <sys/types.h>
+#include <time.h>
 
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
@@ -49,6 +50,14 @@ static pthread_mutex_t state_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 static pthread_rwlock_t slurmctld_locks[ENTITY_COUNT];
 
+/* write locks released on each entity, see slurmctld_lock_gen() */
+static uint64_t write_gen[ENTITY_COUNT];
+
+static lock_stats_t lock_stats[ENTITY_COUNT];
+
+/*AG how often lock_slurmctld_unless() looks at its stop flag */
+#define LOCK_STOP_POLL_NSEC 100000000
+
 #ifndef NDEBUG
 /*
  * Used to protect against double-locking within a single thread. Calling
@@ -102,49 +111,114 @@ extern bool verify_lock(lock_datatype_t datatype, lock_level_t level)
 }
 #endif
 
-/* lock_slurmctld - Issue the required lock requests in a well defined order */
-extern void lock_slurmctld(slurmctld_lock_t lock_levels)
+static void _init_locks(void)
 {
 	static bool init_run = false;
-	xassert(_store_locks(lock_levels));
 
 	if (!init_run) {
 		init_run = true;
 		for (int i = 0; i < ENTITY_COUNT; i++)
 			slurm_rwlock_init(&slurmctld_locks[i]);
 	}
+}
 
-	if (lock_levels.conf == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[CONF_LOCK]);
-	else if (lock_levels.conf == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[CONF_LOCK]);
-
-	if (lock_levels.job == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[JOB_LOCK]);
-	else if (lock_levels.job == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[JOB_LOCK]);
+/*AG
+ * _lock - take lock at level, counting the time spent waiting for it in
+ *	stats. Acquisitions are counted by the callers.
+ * IN stop - if not NULL, give up once *stop is set while waiting
+ * RET false if given up, true if locked
+ */
+static bool _lock(pthread_rwlock_t *lock, lock_level_t level,
+		  lock_stats_t *stats, const bool *stop)
+{
+	struct timespec start, end, ts;
+	uint64_t usec;
+	uint32_t max;
+	int err;
+
+	if (level == READ_LOCK)
+		err = pthread_rwlock_tryrdlock(lock);
+	else
+		err = pthread_rwlock_trywrlock(lock);
+	if (!err)
+		return true;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (!stop) {
+		if (level == READ_LOCK)
+			slurm_rwlock_rdlock(lock);
+		else
+			slurm_rwlock_wrlock(lock);
+	} else {
+		do {
+			if (__atomic_load_n(stop, __ATOMIC_ACQUIRE))
+				return false;
+			clock_gettime(CLOCK_REALTIME, &ts);
+			ts.tv_nsec += LOCK_STOP_POLL_NSEC;
+			if (ts.tv_nsec >= 1000000000) {
+				ts.tv_sec++;
+				ts.tv_nsec -= 1000000000;
+			}
+			if (level == READ_LOCK)
+				err = pthread_rwlock_timedrdlock(lock, &ts);
+			else
+				err = pthread_rwlock_timedwrlock(lock, &ts);
+		} while (err == ETIMEDOUT);
+		if (err) {
+			errno = err;
+			fatal("%s: pthread_rwlock_timed%slock(): %m",
+			      __func__, (level == READ_LOCK) ? "rd" : "wr");
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	usec = (end.tv_sec - start.tv_sec) * 1000000 +
+	       (end.tv_nsec - start.tv_nsec) / 1000;
+	__atomic_add_fetch(&stats->contended, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&stats->wait_usec, usec, __ATOMIC_RELAXED);
+	max = __atomic_load_n(&stats->wait_max, __ATOMIC_RELAXED);
+	while ((usec > max) &&
+	       !__atomic_compare_exchange_n(&stats->wait_max, &max, usec, false,
+					    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+	return true;
+}
 
-	if (lock_levels.node == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[NODE_LOCK]);
-	else if (lock_levels.node == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[NODE_LOCK]);
+static void _count_lock(lock_datatype_t datatype, lock_level_t level)
+{
+	if (level == READ_LOCK)
+		__atomic_add_fetch(&lock_stats[datatype].read_cnt, 1,
+				   __ATOMIC_RELAXED);
+	else if (level == WRITE_LOCK)
+		__atomic_add_fetch(&lock_stats[datatype].write_cnt, 1,
+				   __ATOMIC_RELAXED);
+}
 
-	if (lock_levels.part == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[PART_LOCK]);
-	else if (lock_levels.part == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[PART_LOCK]);
+static void _lock_entity(lock_datatype_t datatype, lock_level_t level)
+{
+	if (level == NO_LOCK)
+		return;
+	_count_lock(datatype, level);
+	_lock(&slurmctld_locks[datatype], level, &lock_stats[datatype], NULL);
+}
 
-	if (lock_levels.fed == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[FED_LOCK]);
-	else if (lock_levels.fed == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[FED_LOCK]);
+/* _lock_entities - Issue the lock requests in a well defined order */
+static void _lock_entities(slurmctld_lock_t lock_levels)
+{
+	_lock_entity(CONF_LOCK, lock_levels.conf);
+	_lock_entity(JOB_LOCK, lock_levels.job);
+	_lock_entity(NODE_LOCK, lock_levels.node);
+	_lock_entity(PART_LOCK, lock_levels.part);
+	_lock_entity(FED_LOCK, lock_levels.fed);
 }
 
-/* unlock_slurmctld - Issue the required unlock requests in a well
- *	defined order */
-extern void unlock_slurmctld(slurmctld_lock_t lock_levels)
+static void _unlock_entities(slurmctld_lock_t lock_levels)
 {
-	xassert(_clear_locks(lock_levels));
+	/*AG count the writes before anyone can see them */
+	for (int i = 0; i < ENTITY_COUNT; i++) {
+		if (((lock_level_t *) &lock_levels)[i] == WRITE_LOCK)
+			__atomic_add_fetch(&write_gen[i], 1, __ATOMIC_RELEASE);
+	}
 
 	if (lock_levels.fed)
 		slurm_rwlock_unlock(&slurmctld_locks[FED_LOCK]);
@@ -162,6 +236,91 @@ extern void unlock_slurmctld(slurmctld_lock_t lock_levels)
 		slurm_rwlock_unlock(&slurmctld_locks[CONF_LOCK]);
 }
 
+/* lock_slurmctld - Issue the required lock requests in a well defined order */
+extern void lock_slurmctld(slurmctld_lock_t lock_levels)
+{
+	xassert(_store_locks(lock_levels));
+
+	_init_locks();
+	_lock_entities(lock_levels);
+}
+
+/*AG lock_slurmctld_unless - lock_slurmctld() giving up on *stop, see locks.h */
+extern bool lock_slurmctld_unless(slurmctld_lock_t lock_levels,
+				  const bool *stop)
+{
+	lock_level_t *levels = (lock_level_t *) &lock_levels;
+	int i;
+
+	xassert(_store_locks(lock_levels));
+
+	_init_locks();
+	/* same order as _lock_entities() */
+	for (i = 0; i < ENTITY_COUNT; i++) {
+		if (levels[i] == NO_LOCK)
+			continue;
+		_count_lock(i, levels[i]);
+		if (!_lock(&slurmctld_locks[i], levels[i], &lock_stats[i],
+			   stop))
+			break;
+	}
+	if (i == ENTITY_COUNT)
+		return true;
+
+	while (--i >= 0) {
+		if (levels[i] != NO_LOCK)
+			slurm_rwlock_unlock(&slurmctld_locks[i]);
+	}
+	xassert(_clear_locks(lock_levels));
+	return false;
+}
+
+/* unlock_slurmctld - Issue the required unlock requests in a well
+ *	defined order */
+extern void unlock_slurmctld(slurmctld_lock_t lock_levels)
+{
+	xassert(_clear_locks(lock_levels));
+
+	_unlock_entities(lock_levels);
+}
+
+/*AG get_lock_stats - copy the lock contention counters into stats */
+extern void get_lock_stats(lock_stats_t stats[ENTITY_COUNT])
+{
+	for (int i = 0; i < ENTITY_COUNT; i++) {
+		stats[i].read_cnt = __atomic_load_n(&lock_stats[i].read_cnt,
+						    __ATOMIC_RELAXED);
+		stats[i].write_cnt = __atomic_load_n(&lock_stats[i].write_cnt,
+						     __ATOMIC_RELAXED);
+		stats[i].contended = __atomic_load_n(&lock_stats[i].contended,
+						     __ATOMIC_RELAXED);
+		stats[i].wait_usec = __atomic_load_n(&lock_stats[i].wait_usec,
+						     __ATOMIC_RELAXED);
+		stats[i].wait_max = __atomic_load_n(&lock_stats[i].wait_max,
+						    __ATOMIC_RELAXED);
+	}
+}
+
+/*AG reset_lock_stats - zero the lock contention counters */
+extern void reset_lock_stats(void)
+{
+	for (int i = 0; i < ENTITY_COUNT; i++) {
+		__atomic_store_n(&lock_stats[i].read_cnt, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&lock_stats[i].write_cnt, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&lock_stats[i].contended, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&lock_stats[i].wait_usec, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&lock_stats[i].wait_max, 0, __ATOMIC_RELAXED);
+	}
+}
+
+/*AG
+ * slurmctld_lock_gen - number of times a write lock on datatype was released
+ */
+extern uint64_t slurmctld_lock_gen(lock_datatype_t datatype)
+{
+	return __atomic_load_n(&write_gen[datatype], __ATOMIC_ACQUIRE);
+}
+
 /*
  * _report_lock_set - report whether the read or write lock is set
  */
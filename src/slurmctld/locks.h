@@ -91,6 +91,7 @@
 #ifndef _SLURMCTLD_LOCKS_H
 #define _SLURMCTLD_LOCKS_H
 
+#include <inttypes.h>
 #include <stdbool.h>
 
 /* levels of locking required for each data structure */
@@ -118,6 +119,15 @@ typedef enum {
 	ENTITY_COUNT
 }	lock_datatype_t;
 
+/*AG lock contention counters for one entity */
+typedef struct {
+	uint64_t read_cnt;	/* read locks taken */
+	uint64_t write_cnt;	/* write locks taken */
+	uint64_t contended;	/* locks that had to wait */
+	uint64_t wait_usec;	/* total time waited */
+	uint32_t wait_max;	/* longest wait, usec */
+}	lock_stats_t;
+
 #ifndef NDEBUG
 extern bool verify_lock(lock_datatype_t datatype, lock_level_t level);
 #endif
@@ -135,6 +145,30 @@ extern void unlock_slurmctld (slurmctld_lock_t lock_levels);
 
 extern int report_locks_set(void);
 
+/*AG
+ * lock_slurmctld_unless - lock_slurmctld() that gives up if *stop is set
+ *	while it waits. For the threads a plugin's fini() joins: fini() can
+ *	run with the locks already held, e.g. from read_slurm_conf().
+ * RET true if locked (release with unlock_slurmctld()), false if stopped
+ *	with nothing locked
+ */
+extern bool lock_slurmctld_unless(slurmctld_lock_t lock_levels,
+				  const bool *stop);
+
+/*AG get_lock_stats - copy the lock contention counters into stats */
+extern void get_lock_stats(lock_stats_t stats[ENTITY_COUNT]);
+
+/*AG reset_lock_stats - zero the lock contention counters */
+extern void reset_lock_stats(void);
+
+/*AG
+ * slurmctld_lock_gen - number of times a write lock on datatype was released
+ *
+ * Data read under a read lock is still current as long as this hasn't
+ * changed, which can be checked without taking the lock.
+ */
+extern uint64_t slurmctld_lock_gen(lock_datatype_t datatype);
+
 /* un/lock semaphore used for saving state of slurmctld */
 extern void lock_state_files ( void );
 extern void unlock_state_files ( void );
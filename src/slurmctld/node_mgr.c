@@ -73,6 +73,7 @@
 
 #include "src/slurmctld/agent.h"
 #include "src/slurmctld/front_end.h"
+#include "src/slurmctld/info_delta.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/ping_nodes.h"
 #include "src/slurmctld/proc_req.h"
@@ -737,6 +738,40 @@ static bool _node_is_hidden(node_record_t *node_ptr, uid_t uid)
 	return true;
 }
 
+/* Pack a node as the user sees it */
+static void _pack_node_for_uid(node_record_t *node_ptr, Buf buffer,
+			       uint16_t protocol_version, uint16_t show_flags,
+			       uid_t uid)
+{
+	bool hidden = false;
+
+	/*
+	 * We can't avoid packing node records without breaking
+	 * the node index pointers. So pack a node with a name
+	 * of NULL and let the caller deal with it.
+	 */
+	if (((show_flags & SHOW_ALL) == 0) && (uid != 0) &&
+	    (_node_is_hidden(node_ptr, uid)))
+		hidden = true;
+	else if (IS_NODE_FUTURE(node_ptr) &&
+		 (!(show_flags & SHOW_FUTURE)))
+		hidden = true;
+	else if (_is_cloud_hidden(node_ptr))
+		hidden = true;
+	else if ((node_ptr->name == NULL) ||
+		 (node_ptr->name[0] == '\0'))
+		hidden = true;
+
+	if (hidden) {
+		char *orig_name = node_ptr->name;
+		node_ptr->name = NULL;
+		_pack_node(node_ptr, buffer, protocol_version, show_flags);
+		node_ptr->name = orig_name;
+	} else {
+		_pack_node(node_ptr, buffer, protocol_version, show_flags);
+	}
+}
+
 /*
  * pack_all_node - dump all configuration and node information for all nodes
  *	in machine independent form (for network transmission)
@@ -758,7 +793,6 @@ extern void pack_all_node (char **buffer_ptr, int *buffer_size,
 	Buf buffer;
 	time_t now = time(NULL);
 	node_record_t *node_ptr = node_record_table_ptr;
-	bool hidden;
 
 	xassert(verify_lock(CONF_LOCK, READ_LOCK));
 	xassert(verify_lock(PART_LOCK, READ_LOCK));
@@ -779,34 +813,8 @@ extern void pack_all_node (char **buffer_ptr, int *buffer_size,
 			xassert(node_ptr->magic == NODE_MAGIC);
 			xassert(node_ptr->config_ptr->magic == CONFIG_MAGIC);
 
-			/*
-			 * We can't avoid packing node records without breaking
-			 * the node index pointers. So pack a node with a name
-			 * of NULL and let the caller deal with it.
-			 */
-			hidden = false;
-			if (((show_flags & SHOW_ALL) == 0) && (uid != 0) &&
-			    (_node_is_hidden(node_ptr, uid)))
-				hidden = true;
-			else if (IS_NODE_FUTURE(node_ptr) &&
-				 (!(show_flags & SHOW_FUTURE)))
-				hidden = true;
-			else if (_is_cloud_hidden(node_ptr))
-				hidden = true;
-			else if ((node_ptr->name == NULL) ||
-				 (node_ptr->name[0] == '\0'))
-				hidden = true;
-
-			if (hidden) {
-				char *orig_name = node_ptr->name;
-				node_ptr->name = NULL;
-				_pack_node(node_ptr, buffer, protocol_version,
-				           show_flags);
-				node_ptr->name = orig_name;
-			} else {
-				_pack_node(node_ptr, buffer, protocol_version,
-					   show_flags);
-			}
+			_pack_node_for_uid(node_ptr, buffer, protocol_version,
+					   show_flags, uid);
 			nodes_packed++;
 		}
 	} else {
@@ -823,6 +831,83 @@ extern void pack_all_node (char **buffer_ptr, int *buffer_size,
 	buffer_ptr[0] = xfer_buf_data (buffer);
 }
 
+/*AG
+ * pack_delta_node - dump the nodes changed since a generation in machine
+ *	independent form (for network transmission), see info_delta.c
+ * OUT buffer_ptr - pointer to the stored data, or NULL if no node changed
+ * OUT buffer_size - set to size of the buffer in bytes
+ * IN since_gen - generation of the nodes the user has, 0 for none
+ * IN show_flags - node filtering options
+ * IN uid - uid of user making request (for partition filtering)
+ * IN protocol_version - slurm protocol version of client
+ * global: node_record_table_ptr - pointer to global node table
+ * NOTE: the caller must xfree the buffer at *buffer_ptr
+ * NOTE: call with the node write lock, as for
+ *	select_g_select_nodeinfo_set_all()
+ * NOTE: change _unpack_node_info_delta_msg() in common/slurm_protocol_pack.c
+ *	whenever the data format changes
+ */
+extern void pack_delta_node(char **buffer_ptr, int *buffer_size,
+			    uint64_t since_gen, uint16_t show_flags, uid_t uid,
+			    uint16_t protocol_version)
+{
+	int inx;
+	uint32_t nodes_packed = 0, tmp_offset, count_offset;
+	Buf buffer;
+	node_record_t *node_ptr = node_record_table_ptr;
+	uint64_t gen;
+	bool full;
+
+	xassert(verify_lock(CONF_LOCK, READ_LOCK));
+	xassert(verify_lock(NODE_LOCK, WRITE_LOCK));
+	xassert(verify_lock(PART_LOCK, READ_LOCK));
+
+	buffer_ptr[0] = NULL;
+	*buffer_size = 0;
+
+	gen = info_delta_current(INFO_DELTA_NODES, since_gen, &full);
+
+	buffer = init_buf(full ? BUF_SIZE*16 : BUF_SIZE);
+
+	/* write header: generation, full, count and time */
+	pack64((uint64_t) 0, buffer);
+	pack8((uint8_t) full, buffer);
+	count_offset = get_buf_offset(buffer);
+	pack32(nodes_packed, buffer);
+	pack_time(time(NULL), buffer);
+
+	/* write node records, each after its index */
+	for (inx = 0; inx < node_record_count; inx++, node_ptr++) {
+		xassert(node_ptr->magic == NODE_MAGIC);
+		xassert(node_ptr->config_ptr->magic == CONFIG_MAGIC);
+
+		if (!full && (node_ptr->delta_gen <= since_gen))
+			continue;
+
+		pack32(inx, buffer);
+		_pack_node_for_uid(node_ptr, buffer, protocol_version,
+				   show_flags, uid);
+		nodes_packed++;
+	}
+
+
+	if (!full && !nodes_packed) {
+		free_buf(buffer);
+		return;
+	}
+
+	/* put the real generation and record count in the header */
+	tmp_offset = get_buf_offset(buffer);
+	set_buf_offset(buffer, 0);
+	pack64(gen, buffer);
+	set_buf_offset(buffer, count_offset);
+	pack32(nodes_packed, buffer);
+	set_buf_offset(buffer, tmp_offset);
+
+	*buffer_size = get_buf_offset(buffer);
+	buffer_ptr[0] = xfer_buf_data(buffer);
+}
+
 /*
  * pack_one_node - dump all configuration and node information for one node
  *	in machine independent form (for network transmission)
@@ -1187,6 +1272,7 @@ int update_node ( update_node_msg_t * update_node_msg )
 			free (this_node_name);
 			break;
 		}
+		info_delta_node_changed(node_ptr);	/*AG*/
 
 		if (hostaddr_list) {
 			char *this_addr = hostlist_shift(hostaddr_list);
@@ -2112,6 +2198,7 @@ extern int drain_nodes(char *nodes, char *reason, uint32_t reason_uid)
 		}
 
 		node_ptr->node_state |= NODE_STATE_DRAIN;
+		info_delta_node_changed(node_ptr);	/*AG*/
 		bit_clear (avail_node_bitmap, node_inx);
 		info ("drain_nodes: node %s state set to DRAIN",
 			this_node_name);
@@ -2243,6 +2330,7 @@ extern int update_node_record_acct_gather_data(
 		return ENOENT;
 
 	memcpy(node_ptr->energy, msg->energy, sizeof(acct_gather_energy_t));
+	info_delta_node_changed(node_ptr);	/*AG*/
 
 	return SLURM_SUCCESS;
 }
@@ -2733,6 +2821,7 @@ extern int validate_node_specs(slurm_node_registration_status_msg_t *reg_msg,
 
 	node_ptr->last_response = MAX(now, node_ptr->last_response);
 	node_ptr->boot_req_time = (time_t) 0;
+	info_delta_node_changed(node_ptr);	/*AG*/
 
 	*newly_up = (!orig_node_avail && bit_test(avail_node_bitmap, node_inx));
 
@@ -3240,6 +3329,7 @@ static void _node_did_resp(node_record_t *node_ptr)
 		bit_clear (up_node_bitmap, node_inx);
 	else
 		bit_set   (up_node_bitmap, node_inx);
+	info_delta_node_sched(node_ptr);	/*AG*/
 	return;
 }
 #endif
@@ -3324,6 +3414,7 @@ void node_not_resp (char *name, time_t msg_time, slurm_msg_type_t resp_type)
 #ifdef HAVE_FRONT_END
 		last_front_end_update = time(NULL);
 #else
+		info_delta_node_changed(node_ptr);	/*AG*/
 		last_node_update = time(NULL);
 		bit_clear (avail_node_bitmap, (node_ptr - node_record_table_ptr));
 #endif
@@ -3553,6 +3644,7 @@ extern void make_node_alloc(node_record_t *node_ptr, job_record_t *job_ptr)
 	int inx = node_ptr - node_record_table_ptr;
 	uint32_t node_flags;
 
+	info_delta_node_changed(node_ptr);	/*AG*/
 	(node_ptr->run_job_cnt)++;
 	bit_clear(idle_node_bitmap, inx);
 	if (job_ptr->details && (job_ptr->details->share_res == 0)) {
@@ -3608,6 +3700,7 @@ extern void make_node_comp(node_record_t *node_ptr, job_record_t *job_ptr,
 	time_t now = time(NULL);
 
 	xassert(node_ptr);
+	info_delta_node_changed(node_ptr);	/*AG*/
 	if (suspended) {
 		if (node_ptr->sus_job_cnt) {
 			(node_ptr->sus_job_cnt)--;
@@ -3678,6 +3771,7 @@ static void _make_node_down(node_record_t *node_ptr, time_t event_time)
 	node_ptr->node_state = NODE_STATE_DOWN | node_flags;
 	node_ptr->owner = NO_VAL;
 	xfree(node_ptr->mcs_label);
+	info_delta_node_changed(node_ptr);	/*AG*/
 	bit_clear (avail_node_bitmap, inx);
 	bit_clear (cg_node_bitmap,    inx);
 	bit_set   (idle_node_bitmap,  inx);
@@ -3712,9 +3806,10 @@ void make_node_idle(node_record_t *node_ptr, job_record_t *job_ptr)
 	trace_job(job_ptr, __func__, "enter");
 
 	xassert(node_ptr);
+	info_delta_node_changed(node_ptr);	/*AG*/
 	if (node_bitmap && (bit_test(node_bitmap, inx))) {
 		/* Not a replay */
-		last_job_update = now;
+		job_updated(job_ptr, now);
 		bit_clear(node_bitmap, inx);
 
 		if (!IS_JOB_FINISHED(job_ptr))
@@ -3900,6 +3995,7 @@ extern void reset_node_load(char *node_name, uint32_t cpu_load)
 		time_t now = time(NULL);
 		node_ptr->cpu_load = cpu_load;
 		node_ptr->cpu_load_time = now;
+		info_delta_node_changed(node_ptr);	/*AG*/
 		last_node_update = now;
 	} else
 		error("reset_node_load unable to find node %s", node_name);
@@ -3919,6 +4015,7 @@ extern void reset_node_free_mem(char *node_name, uint64_t free_mem)
 		time_t now = time(NULL);
 		node_ptr->free_mem = free_mem;
 		node_ptr->free_mem_time = now;
+		info_delta_node_changed(node_ptr);	/*AG*/
 		last_node_update = now;
 	} else
 		error("reset_node_free_mem unable to find node %s", node_name);
@@ -75,6 +75,7 @@
 #include "src/slurmctld/burst_buffer.h"
 #include "src/slurmctld/front_end.h"
 #include "src/slurmctld/gang.h"
+#include "src/slurmctld/info_delta.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/licenses.h"
 #include "src/slurmctld/node_scheduler.h"
@@ -487,6 +488,7 @@ extern void deallocate_nodes(job_record_t *job_ptr, bool timeout,
 	xassert(job_ptr->details);
 
 	trace_job(job_ptr, __func__, "");
+	info_delta_job_changed(job_ptr);	/*AG*/
 
 	acct_policy_job_fini(job_ptr);
 	if (select_g_job_fini(job_ptr) != SLURM_SUCCESS)
@@ -2413,6 +2415,7 @@ static void _preempt_signal(job_record_t *job_ptr, uint32_t grace_time)
 	job_ptr->preempt_time = time(NULL);
 	job_ptr->end_time = MIN(job_ptr->end_time,
 				(job_ptr->preempt_time + (time_t)grace_time));
+	license_job_end_time_changed(job_ptr); /*AG */
 
 	/* Signal the job at the beginning of preemption GraceTime */
 	job_signal(job_ptr, SIGCONT, 0, 0, 0);
@@ -2785,11 +2788,11 @@ extern int select_nodes(job_record_t *job_ptr, bool test_only,
 		    (job_ptr->state_reason == FAIL_BURST_BUFFER_OP))
 			return ESLURM_BURST_BUFFER_WAIT; /* Fatal BB event */
 		xfree(job_ptr->state_desc);
-		last_job_update = now;
 		if (bb == 0)
 			job_ptr->state_reason = WAIT_BURST_BUFFER_STAGING;
 		else
 			job_ptr->state_reason = WAIT_BURST_BUFFER_RESOURCE;
+		job_sched_updated(job_ptr, now);
 		return ESLURM_BURST_BUFFER_WAIT;
 	}
 
@@ -2947,7 +2950,7 @@ extern int select_nodes(job_record_t *job_ptr, bool test_only,
 			       __func__, job_ptr);
 			job_ptr->state_reason = WAIT_PART_NODE_LIMIT;
 			xfree(job_ptr->state_desc);
-			last_job_update = now;
+			job_sched_updated(job_ptr, now);
 
 		/* Non-fatal errors for job below */
 		} else if (error_code == ESLURM_NODE_NOT_AVAIL) {
@@ -2986,7 +2989,7 @@ extern int select_nodes(job_record_t *job_ptr, bool test_only,
 					   "for other job");
 			}
 			xfree(unavail_node);
-			last_job_update = now;
+			job_sched_updated(job_ptr, now);
 		} else if (error_code == ESLURM_RESERVATION_MAINT) {
 			error_code = ESLURM_RESERVATION_BUSY;	/* All reserved */
 			job_ptr->state_reason = WAIT_NODE_NOT_AVAIL;
@@ -3031,6 +3034,8 @@ extern int select_nodes(job_record_t *job_ptr, bool test_only,
 	xfree(job_ptr->nodes);
 	xfree(job_ptr->sched_nodes);
 	job_ptr->exit_code = 0;
+	job_ptr->lustre_read = 0;	/*AG counted again from the steps */
+	job_ptr->lustre_write = 0;
 	gres_plugin_job_clear(job_ptr->gres_list);
 	if (!job_ptr->step_list)
 		job_ptr->step_list = list_create(NULL);
@@ -3067,7 +3072,7 @@ extern int select_nodes(job_record_t *job_ptr, bool test_only,
 		job_ptr->end_time = 0;
 		job_ptr->priority = 0;
 		job_ptr->state_reason = WAIT_HELD;
-		last_job_update = now;
+		job_updated(job_ptr, now);
 		goto cleanup;
 	}
 	if (select_g_job_begin(job_ptr) != SLURM_SUCCESS) {
@@ -3082,7 +3087,7 @@ extern int select_nodes(job_record_t *job_ptr, bool test_only,
 		job_ptr->time_last_active = 0;
 		job_ptr->end_time = 0;
 		job_ptr->state_reason = WAIT_RESOURCES;
-		last_job_update = now;
+		job_sched_updated(job_ptr, now);
 		goto cleanup;
 	}
 
@@ -3105,7 +3110,7 @@ extern int select_nodes(job_record_t *job_ptr, bool test_only,
 		job_ptr->time_last_active = 0;
 		job_ptr->end_time = 0;
 		job_ptr->state_reason = WAIT_RESOURCES;
-		last_job_update = now;
+		job_sched_updated(job_ptr, now);
 		goto cleanup;
 	}
 
@@ -3133,7 +3138,7 @@ extern int select_nodes(job_record_t *job_ptr, bool test_only,
 			job_ptr->end_time = 0;
 			job_ptr->state_reason = WAIT_RESOURCES;
 			job_ptr->job_state = JOB_PENDING;
-			last_job_update = now;
+			job_sched_updated(job_ptr, now);
 			goto cleanup;
 		}
 	}
@@ -3204,6 +3209,10 @@ extern int select_nodes(job_record_t *job_ptr, bool test_only,
 	}
 
 cleanup:
+	if (!test_only && (error_code == SLURM_SUCCESS))	/*AG*/
+		info_delta_job_changed(job_ptr);
+	else
+		info_delta_job_sched(job_ptr);
 	if (job_ptr->array_recs && job_ptr->array_recs->task_id_bitmap &&
 	    !IS_JOB_STARTED(job_ptr) &&
 	    (bit_ffs(job_ptr->array_recs->task_id_bitmap) != -1)) {
@@ -4241,6 +4250,7 @@ end_node_set:
  * 0x10000000000 - Outside of flex reservation
  * 0x0########00 - Node weight
  * 0x000000000## - Reserved for cons_tres, favor nodes with co-located CPU/GPU
+ *                 or, with io_aware_nodes, with a lightly loaded I/O path
  */
 static void _set_sched_weight(struct node_set *node_set_ptr)
 {
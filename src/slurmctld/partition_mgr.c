@@ -2196,7 +2196,7 @@ extern int part_policy_valid_acct(part_record_t *part_ptr, char *acct,
 				xfree(job_ptr->state_desc);
 				job_ptr->state_desc = tmp_err;
 				job_ptr->state_reason = WAIT_ACCOUNT;
-				last_job_update = time(NULL);
+				job_sched_updated(job_ptr, time(NULL));
 			} else {
 				xfree(tmp_err);
 			}
@@ -2220,7 +2220,7 @@ extern int part_policy_valid_acct(part_record_t *part_ptr, char *acct,
 				xfree(job_ptr->state_desc);
 				job_ptr->state_desc = tmp_err;
 				job_ptr->state_reason = WAIT_ACCOUNT;
-				last_job_update = time(NULL);
+				job_sched_updated(job_ptr, time(NULL));
 			} else {
 				xfree(tmp_err);
 			}
@@ -2251,7 +2251,7 @@ extern int part_policy_valid_acct(part_record_t *part_ptr, char *acct,
 				xfree(job_ptr->state_desc);
 				job_ptr->state_desc = tmp_err;
 				job_ptr->state_reason = WAIT_ACCOUNT;
-				last_job_update = time(NULL);
+				job_sched_updated(job_ptr, time(NULL));
 			} else {
 				xfree(tmp_err);
 			}
@@ -2287,7 +2287,7 @@ extern int part_policy_valid_qos(part_record_t *part_ptr,
 				xfree(job_ptr->state_desc);
 				job_ptr->state_desc = tmp_err;
 				job_ptr->state_reason = WAIT_QOS;
-				last_job_update = time(NULL);
+				job_sched_updated(job_ptr, time(NULL));
 			} else {
 				xfree(tmp_err);
 			}
@@ -2306,7 +2306,7 @@ extern int part_policy_valid_qos(part_record_t *part_ptr,
 				xfree(job_ptr->state_desc);
 				job_ptr->state_desc = tmp_err;
 				job_ptr->state_reason = WAIT_QOS;
-				last_job_update = time(NULL);
+				job_sched_updated(job_ptr, time(NULL));
 			} else {
 				xfree(tmp_err);
 			}
@@ -2332,7 +2332,7 @@ extern int part_policy_valid_qos(part_record_t *part_ptr,
 				xfree(job_ptr->state_desc);
 				job_ptr->state_desc = tmp_err;
 				job_ptr->state_reason = WAIT_QOS;
-				last_job_update = time(NULL);
+				job_sched_updated(job_ptr, time(NULL));
 			} else {
 				xfree(tmp_err);
 			}
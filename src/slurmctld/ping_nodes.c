@@ -48,6 +48,7 @@
 #include "src/common/read_config.h"
 #include "src/slurmctld/agent.h"
 #include "src/slurmctld/front_end.h"
+#include "src/slurmctld/info_delta.h"
 #include "src/slurmctld/ping_nodes.h"
 #include "src/slurmctld/slurmctld.h"
 
@@ -265,6 +266,7 @@ void ping_nodes (void)
 #else
 	for (i = 0, node_ptr = node_record_table_ptr;
 	     i < node_record_count; i++, node_ptr++) {
+		info_delta_node_sched(node_ptr);	/*AG*/
 		if (IS_NODE_FUTURE(node_ptr) ||
 		    IS_NODE_POWER_SAVE(node_ptr) ||
 		    IS_NODE_POWER_UP(node_ptr) ||
@@ -63,6 +63,7 @@
 #include "src/common/read_config.h"
 #include "src/common/slurm_accounting_storage.h"
 #include "src/common/xstring.h"
+#include "src/slurmctld/info_delta.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/node_scheduler.h"
@@ -453,6 +454,7 @@ static void _do_power_work(time_t now)
 				bit_set(failed_node_bitmap, i);
 			}
 		}
+		info_delta_node_sched(node_ptr);	/*AG*/
 	}
 	FREE_NULL_BITMAP(avoid_node_bitmap);
 	if (power_save_debug && ((now - last_log) > 600) && (susp_total > 0)) {
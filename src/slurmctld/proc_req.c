@@ -89,6 +89,7 @@
 #include "src/slurmctld/fed_mgr.h"
 #include "src/slurmctld/front_end.h"
 #include "src/slurmctld/gang.h"
+#include "src/slurmctld/job_info_cache.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/licenses.h"
 #include "src/slurmctld/locks.h"
@@ -151,10 +152,12 @@ inline static void  _slurm_rpc_dump_batch_script(slurm_msg_t *msg);
 inline static void  _slurm_rpc_dump_conf(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_front_end(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_jobs(slurm_msg_t * msg);
+inline static void  _slurm_rpc_dump_jobs_delta(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_jobs_user(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_job_single(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_licenses(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_nodes(slurm_msg_t * msg);
+inline static void  _slurm_rpc_dump_nodes_delta(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_node_single(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_partitions(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_stats(slurm_msg_t * msg);
@@ -335,6 +338,9 @@ void slurmctld_req(slurm_msg_t *msg, connection_arg_t *arg)
 	case REQUEST_JOB_INFO:
 		_slurm_rpc_dump_jobs(msg);
 		break;
+	case REQUEST_JOB_INFO_DELTA:
+		_slurm_rpc_dump_jobs_delta(msg);
+		break;
 	case REQUEST_JOB_USER_INFO:
 		_slurm_rpc_dump_jobs_user(msg);
 		break;
@@ -362,6 +368,9 @@ void slurmctld_req(slurm_msg_t *msg, connection_arg_t *arg)
 	case REQUEST_NODE_INFO:
 		_slurm_rpc_dump_nodes(msg);
 		break;
+	case REQUEST_NODE_INFO_DELTA:
+		_slurm_rpc_dump_nodes_delta(msg);
+		break;
 	case REQUEST_NODE_INFO_SINGLE:
 		_slurm_rpc_dump_node_single(msg);
 		break;
@@ -1819,6 +1828,7 @@ static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 	DEF_TIMERS;
 	char *dump;
 	int dump_size;
+	void *cache_ent;
 	slurm_msg_t response_msg;
 	job_info_request_msg_t *job_info_request_msg =
 		(job_info_request_msg_t *) msg->data;
@@ -1829,6 +1839,26 @@ static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 
 	START_TIMER;
 	debug3("Processing RPC: REQUEST_JOB_INFO from uid=%d", uid);
+
+	/*AG a changed job list, try the cached responses first */
+	if (!job_info_request_msg->job_ids &&
+	    ((job_info_request_msg->last_update - 1) < last_job_update) &&
+	    (cache_ent = job_info_cache_get(job_info_request_msg->show_flags,
+					    uid, msg->protocol_version,
+					    &dump, &dump_size))) {
+		END_TIMER2("_slurm_rpc_dump_jobs");
+
+		response_init(&response_msg, msg);
+		response_msg.msg_type = RESPONSE_JOB_INFO;
+		response_msg.data = dump;
+		response_msg.data_size = dump_size;
+
+		/* send message */
+		slurm_send_node_msg(msg->conn_fd, &response_msg);
+		job_info_cache_release(cache_ent);
+		return;
+	}
+
 	lock_slurmctld(job_read_lock);
 
 	if ((job_info_request_msg->last_update - 1) >= last_job_update) {
@@ -1863,6 +1893,45 @@ static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 	}
 }
 
+/*AG _slurm_rpc_dump_jobs_delta - process RPC for the job state information
+ *	changed since a generation */
+static void _slurm_rpc_dump_jobs_delta(slurm_msg_t * msg)
+{
+	DEF_TIMERS;
+	char *dump;
+	int dump_size;
+	slurm_msg_t response_msg;
+	info_delta_request_msg_t *delta_req_msg =
+		(info_delta_request_msg_t *) msg->data;
+	/* Locks: Read config job part */
+	slurmctld_lock_t job_read_lock = {
+		READ_LOCK, READ_LOCK, NO_LOCK, READ_LOCK, READ_LOCK };
+	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred);
+
+	START_TIMER;
+	debug3("Processing RPC: REQUEST_JOB_INFO_DELTA from uid=%d", uid);
+	lock_slurmctld(job_read_lock);
+	pack_delta_jobs(&dump, &dump_size, delta_req_msg->delta_gen,
+			delta_req_msg->show_flags, uid, msg->protocol_version);
+	unlock_slurmctld(job_read_lock);
+	END_TIMER2("_slurm_rpc_dump_jobs_delta");
+
+	if (!dump) {
+		debug3("_slurm_rpc_dump_jobs_delta, no change");
+		slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
+		return;
+	}
+
+	response_init(&response_msg, msg);
+	response_msg.msg_type = RESPONSE_JOB_INFO_DELTA;
+	response_msg.data = dump;
+	response_msg.data_size = dump_size;
+
+	/* send message */
+	slurm_send_node_msg(msg->conn_fd, &response_msg);
+	xfree(dump);
+}
+
 /* _slurm_rpc_dump_jobs - process RPC for job state information */
 static void _slurm_rpc_dump_jobs_user(slurm_msg_t * msg)
 {
@@ -2084,6 +2153,56 @@ static void _slurm_rpc_dump_front_end(slurm_msg_t * msg)
 	}
 }
 
+/*AG _slurm_rpc_dump_nodes_delta - dump RPC for the node state information
+ *	changed since a generation */
+static void _slurm_rpc_dump_nodes_delta(slurm_msg_t * msg)
+{
+	DEF_TIMERS;
+	char *dump;
+	int dump_size;
+	slurm_msg_t response_msg;
+	info_delta_request_msg_t *delta_req_msg =
+		(info_delta_request_msg_t *) msg->data;
+	/* Locks: Read config, write node (reset allocated CPU count in some
+	 * select plugins), read part (for part_is_visible) */
+	slurmctld_lock_t node_write_lock = {
+		READ_LOCK, NO_LOCK, WRITE_LOCK, READ_LOCK, NO_LOCK };
+	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred);
+
+	START_TIMER;
+	debug3("Processing RPC: REQUEST_NODE_INFO_DELTA from uid=%d", uid);
+
+	if ((slurmctld_conf.private_data & PRIVATE_DATA_NODES) &&
+	    (!validate_operator(uid))) {
+		error("Security violation, REQUEST_NODE_INFO_DELTA RPC "
+		      "from uid=%d", uid);
+		slurm_send_rc_msg(msg, ESLURM_ACCESS_DENIED);
+		return;
+	}
+
+	lock_slurmctld(node_write_lock);
+	select_g_select_nodeinfo_set_all();
+	pack_delta_node(&dump, &dump_size, delta_req_msg->delta_gen,
+			delta_req_msg->show_flags, uid, msg->protocol_version);
+	unlock_slurmctld(node_write_lock);
+	END_TIMER2("_slurm_rpc_dump_nodes_delta");
+
+	if (!dump) {
+		debug3("_slurm_rpc_dump_nodes_delta, no change");
+		slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
+		return;
+	}
+
+	response_init(&response_msg, msg);
+	response_msg.msg_type = RESPONSE_NODE_INFO_DELTA;
+	response_msg.data = dump;
+	response_msg.data_size = dump_size;
+
+	/* send message */
+	slurm_send_node_msg(msg->conn_fd, &response_msg);
+	xfree(dump);
+}
+
 /* _slurm_rpc_dump_nodes - dump RPC for node state information */
 static void _slurm_rpc_dump_nodes(slurm_msg_t * msg)
 {
@@ -2537,6 +2656,8 @@ static void _slurm_rpc_complete_batch_script(slurm_msg_t *msg,
 			step_ptr->jobacct = comp_msg->jobacct;
 			comp_msg->jobacct = NULL;
 			step_ptr->state |= JOB_COMPLETING;
+			step_add_lustre_usage(job_ptr,
+					      step_ptr->jobacct); /*AG */
 			jobacct_storage_g_step_complete(acct_db_conn, step_ptr);
 			delete_step_record(job_ptr, step_ptr->step_id);
 		}
@@ -6042,11 +6163,13 @@ inline static void _slurm_rpc_dump_stats(slurm_msg_t * msg)
 		_clear_rpc_stats();
 		pack_all_stat(0, &dump, &dump_size, msg->protocol_version);
 		_pack_rpc_stats(0, &dump, &dump_size, msg->protocol_version);
+		pack_ext_stat(0, &dump, &dump_size, msg->protocol_version);
 		response_msg.data = dump;
 		response_msg.data_size = dump_size;
 	} else {
 		pack_all_stat(1, &dump, &dump_size, msg->protocol_version);
 		_pack_rpc_stats(1, &dump, &dump_size, msg->protocol_version);
+		pack_ext_stat(1, &dump, &dump_size, msg->protocol_version);
 		response_msg.data = dump;
 		response_msg.data_size = dump_size;
 	}
@@ -0,0 +1,561 @@
+/*****************************************************************************\
+ *  rpc_conn.c - event driven reading of incoming RPC connections
+ *****************************************************************************
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+/*
+ * A thread per connection blocks in slurm_receive_msg() for as long as the
+ * client takes to send its message, so slow or idle clients each pin a
+ * thread. Instead the rpc manager thread accepts the connections and reads
+ * them without blocking from one epoll loop, or poll() where epoll isn't
+ * available, keeping only the partly read message of each. A message read in full goes to the RPC workers
+ * (rpc_queue.c), which unpack, authenticate and service it and write the
+ * response as before.
+ *
+ * Connections not read in full within MessageTimeout are closed, as
+ * slurm_receive_msg() would time out. When out of file descriptors no more
+ * connections are accepted for a second, they wait in the listen backlog.
+ *
+ * The message length comes from the peer before it is authenticated, so the
+ * buffer starts small and grows as the bytes arrive. The first
+ * RPC_CONN_BUF_MIN bytes, enough for most RPCs, are always buffered, the
+ * file descriptor limit bounds those. Beyond that at most
+ * RPC_CONN_MAX_BUFFERED bytes are buffered over all connections, one that
+ * needs more room stops being read until other messages are handed off, and
+ * is closed at its MessageTimeout if that doesn't happen in time.
+ *
+ * The loop never waits. A message read in full while server_thread_count is
+ * at max_server_threads is parked, still buffered, and handed off in order
+ * once a thread slot frees up, checked every RPC_CONN_PARKED_WAIT msec.
+ */
+
+#define _GNU_SOURCE	/* accept4() */
+
+#include "config.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#  define RPC_CONN_EPOLL
+#  include <sys/epoll.h>
+#endif
+
+#include "src/common/fd.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/pack.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/xmalloc.h"
+#include "src/slurmctld/rpc_conn.h"
+#include "src/slurmctld/rpc_queue.h"
+#include "src/slurmctld/slurmctld.h"
+
+#define RPC_CONN_ACCEPT_MAX	64	/* accepts per listener wakeup */
+#define RPC_CONN_EVENTS		256
+#define RPC_CONN_PARKED_WAIT	10	/* msec between tries for a slot */
+#define RPC_CONN_MAX_MSG_SIZE	(1024 * 1024 * 1024)	/* as the sockets */
+#define RPC_CONN_BUF_MIN	(16 * 1024)	/* first buffer of a message */
+#define RPC_CONN_MAX_BUFFERED	(256 * 1024 * 1024) /* over all connections */
+
+typedef struct rpc_conn {
+	int fd;
+	bool listener;
+	bool watched;		/* read when readable */
+	slurm_addr_t cli_addr;
+	char len_buf[sizeof(uint32_t)];	/* length of the message */
+	uint32_t msg_len;
+	uint32_t read_len;	/* bytes read, length included */
+	char *msg;
+	uint32_t msg_size;	/* allocated, grows up to msg_len */
+	bool throttled;		/* not read until there's room to buffer */
+	bool parked;		/* read in full, waiting for a thread slot */
+	struct timespec accepted;
+	time_t deadline;
+	struct rpc_conn *prev, *next;	/* in accept order */
+} rpc_conn_t;
+
+#ifdef RPC_CONN_EPOLL
+static int epoll_fd = -1;
+#else
+static struct pollfd *pfds = NULL;
+static rpc_conn_t **pfd_conns = NULL;
+static int pfd_size = 0;
+#endif
+static rpc_conn_t **listeners = NULL;
+static int listener_cnt = 0;
+static rpc_conn_t *conn_head = NULL, *conn_tail = NULL;	/* being read */
+static rpc_conn_t *parked_head = NULL, *parked_tail = NULL;
+static uint64_t buffered = 0;	/* bytes allocated for messages */
+static int throttled_cnt = 0;
+
+static void _link_conn(rpc_conn_t **head, rpc_conn_t **tail,
+		       rpc_conn_t *conn)
+{
+	conn->prev = *tail;
+	conn->next = NULL;
+	if (*tail)
+		(*tail)->next = conn;
+	else
+		*head = conn;
+	*tail = conn;
+}
+
+static void _unlink_conn(rpc_conn_t **head, rpc_conn_t **tail,
+			 rpc_conn_t *conn)
+{
+	if (conn->prev)
+		conn->prev->next = conn->next;
+	else
+		*head = conn->next;
+	if (conn->next)
+		conn->next->prev = conn->prev;
+	else
+		*tail = conn->prev;
+}
+
+static void _close_conn(rpc_conn_t *conn)
+{
+	if (conn->parked)
+		_unlink_conn(&parked_head, &parked_tail, conn);
+	else
+		_unlink_conn(&conn_head, &conn_tail, conn);
+
+	/* closing the fd takes it out of the epoll set */
+	if ((conn->fd >= 0) && (close(conn->fd) < 0))
+		error("close(%d): %m", conn->fd);
+	if (conn->throttled)
+		throttled_cnt--;
+	buffered -= conn->msg_size;
+	xfree(conn->msg);
+	xfree(conn);
+	rpc_queue_conn_reading(-1);
+}
+
+static void _conn_error(rpc_conn_t *conn, const char *what)
+{
+	char addr_buf[32];
+
+	slurm_print_slurm_addr(&conn->cli_addr, addr_buf, sizeof(addr_buf));
+	error("slurm_receive_msg [%s]: %s", addr_buf, what);
+	_close_conn(conn);
+}
+
+/* Start watching a new connection or listener */
+static int _watch_add(rpc_conn_t *conn)
+{
+#ifdef RPC_CONN_EPOLL
+	struct epoll_event ev = { .events = EPOLLIN, .data.ptr = conn };
+
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, conn->fd, &ev)) {
+		error("%s: epoll_ctl: %m", __func__);
+		return SLURM_ERROR;
+	}
+#endif
+	conn->watched = true;
+	return SLURM_SUCCESS;
+}
+
+/* Start or stop reading the connection */
+static void _watch_conn(rpc_conn_t *conn, bool on)
+{
+#ifdef RPC_CONN_EPOLL
+	struct epoll_event ev = { .events = on ? EPOLLIN : 0, .data.ptr = conn };
+
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev))
+		error("%s: epoll_ctl: %m", __func__);
+#endif
+	conn->watched = on;
+}
+
+/* Stop watching the connection for good, it stays open */
+static void _watch_del(rpc_conn_t *conn)
+{
+#ifdef RPC_CONN_EPOLL
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL))
+		error("%s: epoll_ctl: %m", __func__);
+#endif
+	conn->watched = false;
+}
+
+#ifndef RPC_CONN_EPOLL
+static void _add_pfd(rpc_conn_t *conn, int *cnt)
+{
+	if (*cnt == pfd_size) {
+		pfd_size = MAX(pfd_size * 2, 64);
+		xrecalloc(pfds, pfd_size, sizeof(struct pollfd));
+		xrecalloc(pfd_conns, pfd_size, sizeof(rpc_conn_t *));
+	}
+	pfds[*cnt].fd = conn->fd;
+	pfds[*cnt].events = POLLIN;
+	pfds[*cnt].revents = 0;
+	pfd_conns[(*cnt)++] = conn;
+}
+#endif
+
+/*
+ * Wait up to timeout msec for watched connections or listeners to become
+ * readable
+ * OUT ready - set to the readable ones
+ * RET how many, -1 on error
+ */
+static int _wait_conns(rpc_conn_t ***ready, int timeout)
+{
+#ifdef RPC_CONN_EPOLL
+	static struct epoll_event events[RPC_CONN_EVENTS];
+	static rpc_conn_t *ready_conns[RPC_CONN_EVENTS];
+	int cnt = epoll_wait(epoll_fd, events, RPC_CONN_EVENTS, timeout);
+
+	for (int i = 0; i < cnt; i++)
+		ready_conns[i] = events[i].data.ptr;
+	*ready = ready_conns;
+	return cnt;
+#else
+	int cnt = 0, ready_cnt = 0;
+
+	for (int i = 0; i < listener_cnt; i++) {
+		if (listeners[i]->watched)
+			_add_pfd(listeners[i], &cnt);
+	}
+	for (rpc_conn_t *conn = conn_head; conn; conn = conn->next) {
+		if (conn->watched)
+			_add_pfd(conn, &cnt);
+	}
+	if (poll(pfds, cnt, timeout) < 0)
+		return -1;
+
+	for (int i = 0; i < cnt; i++) {
+		if (pfds[i].revents)
+			pfd_conns[ready_cnt++] = pfd_conns[i];
+	}
+	*ready = pfd_conns;
+	return ready_cnt;
+#endif
+}
+
+static uint32_t _grow_size(rpc_conn_t *conn)
+{
+	uint64_t size = MAX((uint64_t) conn->msg_size * 2, RPC_CONN_BUF_MIN);
+
+	return MIN(size, conn->msg_len);
+}
+
+static bool _room_for(rpc_conn_t *conn, uint32_t size)
+{
+	return (size <= RPC_CONN_BUF_MIN) ||
+	       ((buffered + size - conn->msg_size) <= RPC_CONN_MAX_BUFFERED) ||
+	       (buffered == conn->msg_size);
+}
+
+/*
+ * Grow the message buffer for the bytes to come, past the first
+ * RPC_CONN_BUF_MIN bytes within RPC_CONN_MAX_BUFFERED unless no other message
+ * is buffered
+ * RET false if there is no room, the connection is throttled then
+ */
+static bool _grow_msg(rpc_conn_t *conn)
+{
+	uint32_t size = _grow_size(conn);
+
+	if (!_room_for(conn, size)) {
+		if (!conn->throttled) {
+			conn->throttled = true;
+			throttled_cnt++;
+			_watch_conn(conn, false);
+		}
+		return false;
+	}
+
+	xrealloc_nz(conn->msg, MAX(size, 1));
+	buffered += size - conn->msg_size;
+	conn->msg_size = size;
+	return true;
+}
+
+/* Read the throttled connections again once there may be room */
+static void _unthrottle_conns(void)
+{
+	for (rpc_conn_t *conn = conn_head; conn && throttled_cnt;
+	     conn = conn->next) {
+		if (!conn->throttled)
+			continue;
+		if (!_room_for(conn, _grow_size(conn)))
+			break;	/* in accept order, oldest first */
+		conn->throttled = false;
+		throttled_cnt--;
+		_watch_conn(conn, true);
+	}
+}
+
+static void _set_listeners(bool on)
+{
+	for (int i = 0; i < listener_cnt; i++)
+		_watch_conn(listeners[i], on);
+}
+
+/* RET false if out of file descriptors */
+static bool _accept_conns(rpc_conn_t *listener)
+{
+	slurm_addr_t cli_addr;
+	socklen_t addr_len;
+	rpc_conn_t *conn;
+	int fd;
+
+	for (int i = 0; i < RPC_CONN_ACCEPT_MAX; i++) {
+		addr_len = sizeof(cli_addr);
+#ifdef RPC_CONN_EPOLL
+		fd = accept4(listener->fd, (struct sockaddr *) &cli_addr,
+			     &addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+		if ((fd = accept(listener->fd, (struct sockaddr *) &cli_addr,
+				 &addr_len)) >= 0) {
+			fd_set_nonblocking(fd);
+			fd_set_close_on_exec(fd);
+		}
+#endif
+		if (fd < 0) {
+			if ((errno == EMFILE) || (errno == ENFILE)) {
+				error("slurm_accept_msg_conn: %m");
+				return false;
+			}
+			if ((errno != EAGAIN) && (errno != EWOULDBLOCK) &&
+			    (errno != EINTR) && (errno != ECONNABORTED))
+				error("slurm_accept_msg_conn: %m");
+			return true;
+		}
+
+		if (slurmctld_conf.debug_flags & DEBUG_FLAG_PROTOCOL) {
+			char inetbuf[64];
+
+			slurm_print_slurm_addr(&cli_addr, inetbuf,
+					       sizeof(inetbuf));
+			info("%s: accept() connection from %s", __func__,
+			     inetbuf);
+		}
+
+		conn = xmalloc(sizeof(*conn));
+		conn->fd = fd;
+		memcpy(&conn->cli_addr, &cli_addr, sizeof(slurm_addr_t));
+		clock_gettime(CLOCK_MONOTONIC, &conn->accepted);
+		conn->deadline = conn->accepted.tv_sec +
+				 slurm_get_msg_timeout();
+		_link_conn(&conn_head, &conn_tail, conn);
+		rpc_queue_conn_reading(1);
+
+		if (_watch_add(conn))
+			_close_conn(conn);
+	}
+
+	return true;
+}
+
+/* Hand a message to the RPC workers, counted in server_thread_count */
+static void _hand_off_msg(rpc_conn_t *conn)
+{
+	connection_arg_t *conn_arg;
+	Buf buffer;
+
+	conn_arg = xmalloc(sizeof(connection_arg_t));
+	conn_arg->newsockfd = conn->fd;
+	memcpy(&conn_arg->cli_addr, &conn->cli_addr, sizeof(slurm_addr_t));
+	if (!conn->msg)
+		conn->msg = xmalloc(1);	/* empty message */
+	buffer = create_buf(conn->msg, conn->msg_len);
+	rpc_queue_add_msg(conn_arg, buffer, &conn->accepted);
+
+	conn->fd = -1;
+	conn->msg = NULL;
+	_close_conn(conn);
+}
+
+/* Queue a message read in full, or park it if there is no thread slot */
+static void _queue_msg(rpc_conn_t *conn, bool (*try_server_thread)(void))
+{
+	_watch_del(conn);
+	if (!parked_head && try_server_thread()) {
+		_hand_off_msg(conn);
+		return;
+	}
+
+	_unlink_conn(&conn_head, &conn_tail, conn);
+	_link_conn(&parked_head, &parked_tail, conn);
+	conn->parked = true;
+}
+
+/* Hand off the parked messages while there are thread slots */
+static void _queue_parked(bool (*try_server_thread)(void))
+{
+	while (parked_head && try_server_thread())
+		_hand_off_msg(parked_head);
+}
+
+/* Read what the connection has for us */
+static void _read_conn(rpc_conn_t *conn, bool (*try_server_thread)(void))
+{
+	ssize_t len;
+
+	while (1) {
+		if (conn->read_len < sizeof(conn->len_buf)) {
+			len = read(conn->fd, conn->len_buf + conn->read_len,
+				   sizeof(conn->len_buf) - conn->read_len);
+		} else {
+			uint32_t off = conn->read_len - sizeof(conn->len_buf);
+
+			if ((off == conn->msg_size) && !_grow_msg(conn))
+				return;
+			len = read(conn->fd, conn->msg + off,
+				   conn->msg_size - off);
+		}
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+				_conn_error(conn, strerror(errno));
+			return;
+		}
+		if (len == 0) {
+			_conn_error(conn, slurm_strerror(
+				SLURM_COMMUNICATIONS_CONNECTION_ERROR));
+			return;
+		}
+
+		conn->read_len += len;
+		if (conn->read_len == sizeof(conn->len_buf)) {
+			uint32_t msg_len;
+
+			memcpy(&msg_len, conn->len_buf, sizeof(msg_len));
+			conn->msg_len = ntohl(msg_len);
+			if (conn->msg_len > RPC_CONN_MAX_MSG_SIZE) {
+				_conn_error(conn, slurm_strerror(
+					SLURM_PROTOCOL_INSANE_MSG_LENGTH));
+				return;
+			}
+		}
+		if ((conn->read_len >= sizeof(conn->len_buf)) &&
+		    (conn->read_len - sizeof(conn->len_buf) ==
+		     conn->msg_len)) {
+			_queue_msg(conn, try_server_thread);
+			return;
+		}
+	}
+}
+
+/* Close connections not read in full within MessageTimeout */
+static void _timeout_conns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	while (conn_head && (conn_head->deadline <= now.tv_sec))
+		_conn_error(conn_head, slurm_strerror(
+			SLURM_PROTOCOL_SOCKET_IMPL_TIMEOUT));
+}
+
+extern void rpc_conn_mgr(struct pollfd *fds, int nports,
+			 bool (*try_server_thread)(void))
+{
+	rpc_conn_t **ready;
+	time_t paused_until = 0;
+	int i, cnt;
+
+#ifdef RPC_CONN_EPOLL
+	if ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+		fatal("%s: epoll_create1: %m", __func__);
+#endif
+	listeners = xcalloc(nports, sizeof(rpc_conn_t *));
+	listener_cnt = nports;
+	for (i = 0; i < nports; i++) {
+		listeners[i] = xmalloc(sizeof(rpc_conn_t));
+		listeners[i]->fd = fds[i].fd;
+		listeners[i]->listener = true;
+		fd_set_nonblocking(fds[i].fd);
+		if (_watch_add(listeners[i]))
+			fatal("%s: cannot watch listening socket", __func__);
+	}
+
+#ifdef RPC_CONN_EPOLL
+	debug("%s: reading RPC connections with epoll", __func__);
+#else
+	debug("%s: reading RPC connections with poll", __func__);
+#endif
+
+	while (!slurmctld_config.shutdown_time) {
+		_queue_parked(try_server_thread);
+		cnt = _wait_conns(&ready, parked_head ?
+					  RPC_CONN_PARKED_WAIT : 1000);
+		if (cnt < 0) {
+			if (errno != EINTR)
+				error("%s: wait: %m", __func__);
+			continue;
+		}
+
+		for (i = 0; i < cnt; i++) {
+			rpc_conn_t *conn = ready[i];
+
+			if (!conn->listener) {
+				_read_conn(conn, try_server_thread);
+			} else if (!paused_until &&
+				   !_accept_conns(conn)) {
+				/* out of fds, let the backlog wait */
+				_set_listeners(false);
+				paused_until = time(NULL) + 1;
+			}
+		}
+
+		if (paused_until && (time(NULL) >= paused_until)) {
+			_set_listeners(true);
+			paused_until = 0;
+		}
+		_timeout_conns();
+		if (throttled_cnt)
+			_unthrottle_conns();
+	}
+
+	while (conn_head)
+		_close_conn(conn_head);
+	while (parked_head)
+		_close_conn(parked_head);
+	for (i = 0; i < nports; i++)
+		xfree(listeners[i]);
+	xfree(listeners);
+	listener_cnt = 0;
+#ifdef RPC_CONN_EPOLL
+	close(epoll_fd);
+	epoll_fd = -1;
+#else
+	xfree(pfds);
+	xfree(pfd_conns);
+	pfd_size = 0;
+#endif
+}
@@ -0,0 +1,350 @@
+/*****************************************************************************\
+ *  rpc_queue.c - worker threads and priority queues for incoming RPCs
+ *****************************************************************************
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+/*
+ * Instead of a thread per accepted connection, a fixed pool of workers
+ * (SlurmctldParameters=rpc_workers) services the received messages.
+ * rpc_conn.c reads the messages without blocking and queues them with
+ * rpc_queue_add_msg() in one of the priority lanes by message type, the
+ * workers unpack and service them, highest lane first. A lane passed over
+ * RPC_LANE_SKIP_MAX times in a row while it has messages waiting is served
+ * next, so the information dumps aren't starved.
+ *
+ * The connections queued here still count in server_thread_count, so the
+ * rpc manager stops accepting at max_server_threads as before and the
+ * schedulers' max_rpc_cnt tests still see the RPC load.
+ */
+
+#include "config.h"
+
+#include <pthread.h>
+#include <time.h>
+
+#if HAVE_SYS_PRCTL_H
+#  include <sys/prctl.h>
+#endif
+
+#include "src/common/forward.h"
+#include "src/common/list.h"
+#include "src/common/macros.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/slurm_protocol_pack.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+#include "src/slurmctld/rpc_queue.h"
+
+#define RPC_LANE_SKIP_MAX	8
+
+typedef struct {
+	connection_arg_t *conn;
+	Buf buffer;		/* as received, not unpacked */
+	slurm_msg_t msg;
+	rpc_lane_t lane;
+	struct timespec accepted;
+} rpc_queue_ent_t;
+
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static List lane_queue[RPC_LANE_CNT];
+static int lane_skipped[RPC_LANE_CNT];
+static uint32_t pool_gen = 0;	/* workers of an older pool exit when idle */
+static rpc_queue_stats_t stats;
+
+static rpc_lane_t _rpc_lane(uint16_t msg_type)
+{
+	switch (msg_type) {
+	case MESSAGE_NODE_REGISTRATION_STATUS:
+	case MESSAGE_EPILOG_COMPLETE:
+	case MESSAGE_COMPOSITE:
+	case REQUEST_COMPLETE_BATCH_SCRIPT:
+	case REQUEST_COMPLETE_JOB_ALLOCATION:
+	case REQUEST_COMPLETE_PROLOG:
+	case REQUEST_STEP_COMPLETE:
+	case REQUEST_CONTROL:
+	case REQUEST_CONTROL_STATUS:
+	case REQUEST_PING:
+		return RPC_LANE_HIGH;
+	case REQUEST_ASSOC_MGR_INFO:
+	case REQUEST_BUILD_INFO:
+	case REQUEST_BURST_BUFFER_INFO:
+	case REQUEST_FRONT_END_INFO:
+	case REQUEST_JOB_INFO:
+	case REQUEST_JOB_INFO_DELTA:
+	case REQUEST_JOB_STEP_INFO:
+	case REQUEST_JOB_USER_INFO:
+	case REQUEST_LICENSE_INFO:
+	case REQUEST_NODE_INFO:
+	case REQUEST_NODE_INFO_DELTA:
+	case REQUEST_PARTITION_INFO:
+	case REQUEST_PRIORITY_FACTORS:
+	case REQUEST_RESERVATION_INFO:
+	case REQUEST_SHARE_INFO:
+	case REQUEST_TRIGGER_GET:
+		return RPC_LANE_LOW;
+	default:
+		return RPC_LANE_NORMAL;
+	}
+}
+
+/* Done with a connection, serviced or not */
+static void _free_ent(rpc_queue_ent_t *ent)
+{
+	if ((ent->conn->newsockfd >= 0) && (close(ent->conn->newsockfd) < 0))
+		error("close(%d): %m", ent->conn->newsockfd);
+	slurm_free_msg_members(&ent->msg);
+	FREE_NULL_BUFFER(ent->buffer);
+	xfree(ent->conn);
+	xfree(ent);
+	server_thread_decr();
+}
+
+/*
+ * Unpack the message rpc_conn.c read
+ * RET false if there is nothing to service
+ */
+static bool _read_msg(rpc_queue_ent_t *ent)
+{
+	int rc;
+
+	/*
+	 * slurm_receive_msg sets msg connection fd to accepted fd. This allows
+	 * possibility for slurmctld_req() to close accepted connection.
+	 */
+	ent->msg.conn_fd = ent->conn->newsockfd;
+	rc = slurm_unpack_received_msg(&ent->msg, ent->conn->newsockfd,
+				       ent->buffer);
+	/* as slurm_receive_msg() does with SLURM_MSG_KEEP_BUFFER */
+	ent->msg.buffer = ent->buffer;
+	ent->buffer = NULL;
+	if (rc != 0) {
+		char addr_buf[32];
+		slurm_print_slurm_addr(&ent->conn->cli_addr, addr_buf,
+				       sizeof(addr_buf));
+		error("slurm_receive_msg [%s]: %m", addr_buf);
+		return false;
+	}
+
+	if (errno != SLURM_SUCCESS) {
+		if (errno == SLURM_PROTOCOL_VERSION_ERROR) {
+			slurm_send_rc_msg(&ent->msg,
+					  SLURM_PROTOCOL_VERSION_ERROR);
+		} else
+			info("%s/slurm_receive_msg %m", __func__);
+		return false;
+	}
+
+	return true;
+}
+
+/* Take the next message to service, call with queue_mutex */
+static rpc_queue_ent_t *_next_msg(void)
+{
+	int lane = -1;
+
+	for (int i = 0; i < RPC_LANE_CNT; i++) {
+		if (!list_count(lane_queue[i]))
+			continue;
+		if (lane < 0) {
+			lane = i;
+		} else if (++lane_skipped[i] > RPC_LANE_SKIP_MAX) {
+			lane = i;
+			break;
+		}
+	}
+	if (lane < 0)
+		return NULL;
+
+	lane_skipped[lane] = 0;
+	stats.lane_queue[lane]--;
+	return list_dequeue(lane_queue[lane]);
+}
+
+/* Count the time from accept until now in the message's lane */
+static void _count_wait(rpc_queue_ent_t *ent)
+{
+	struct timespec now;
+	uint64_t usec;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	usec = (now.tv_sec - ent->accepted.tv_sec) * 1000000 +
+	       (now.tv_nsec - ent->accepted.tv_nsec) / 1000;
+	stats.lane_count[ent->lane]++;
+	stats.lane_wait_usec[ent->lane] += usec;
+	if (usec > stats.lane_wait_max[ent->lane])
+		stats.lane_wait_max[ent->lane] = usec;
+}
+
+static void *_worker(void *arg)
+{
+	uint32_t gen = (uint32_t) (uintptr_t) arg;
+	rpc_queue_ent_t *ent;
+
+#if HAVE_SYS_PRCTL_H
+	if (prctl(PR_SET_NAME, "rpcwrk", NULL, NULL, NULL) < 0) {
+		error("%s: cannot set my name to %s %m", __func__, "rpcwrk");
+	}
+#endif
+
+	slurm_mutex_lock(&queue_mutex);
+	while (1) {
+		if ((ent = _next_msg())) {
+			_count_wait(ent);
+			stats.busy++;
+			slurm_mutex_unlock(&queue_mutex);
+
+			if (_read_msg(ent))
+				slurmctld_req(&ent->msg, ent->conn);
+			_free_ent(ent);
+
+			slurm_mutex_lock(&queue_mutex);
+			stats.busy--;
+			continue;
+		}
+
+		if (gen != pool_gen)
+			break;
+		slurm_cond_wait(&queue_cond, &queue_mutex);
+	}
+	stats.workers--;
+	slurm_mutex_unlock(&queue_mutex);
+
+	return NULL;
+}
+
+extern void rpc_queue_init(uint32_t max_workers)
+{
+	char *ctld_params = slurm_get_slurmctld_params();
+	char *tmp_ptr;
+	int workers = max_workers;
+
+	if ((tmp_ptr = xstrcasestr(ctld_params, "rpc_workers="))) {
+		workers = atoi(tmp_ptr + 12);
+		if (workers < 1) {
+			error("Invalid rpc_workers: %d", workers);
+			workers = max_workers;
+		}
+	}
+	xfree(ctld_params);
+	if ((uint32_t) workers > max_workers) {
+		info("Reducing rpc_workers from %d to %u", workers,
+		     max_workers);
+		workers = max_workers;
+	}
+
+	slurm_mutex_lock(&queue_mutex);
+	if (!lane_queue[0]) {
+		for (int i = 0; i < RPC_LANE_CNT; i++)
+			lane_queue[i] = list_create(NULL);
+	}
+	pool_gen++;
+	for (int i = 0; i < workers; i++)
+		slurm_thread_create_detached(NULL, _worker,
+					     (void *) (uintptr_t) pool_gen);
+	stats.workers += workers;
+	slurm_mutex_unlock(&queue_mutex);
+	debug("%s: started %d RPC workers", __func__, workers);
+}
+
+/* The message type from the header, without unpacking the rest */
+static uint16_t _peek_msg_type(Buf buffer)
+{
+	header_t header;
+	uint16_t msg_type = 0;
+
+	if (unpack_header(&header, buffer) == SLURM_SUCCESS) {
+		msg_type = header.msg_type;
+		destroy_forward(&header.forward);
+		FREE_NULL_LIST(header.ret_list);
+	}
+	set_buf_offset(buffer, 0);
+
+	return msg_type;
+}
+
+extern void rpc_queue_add_msg(connection_arg_t *conn, Buf buffer,
+			      struct timespec *accepted)
+{
+	rpc_queue_ent_t *ent = xmalloc(sizeof(*ent));
+
+	ent->conn = conn;
+	ent->buffer = buffer;
+	slurm_msg_t_init(&ent->msg);
+	ent->msg.flags |= SLURM_MSG_KEEP_BUFFER;
+	ent->lane = _rpc_lane(_peek_msg_type(buffer));
+	ent->accepted = *accepted;
+
+	slurm_mutex_lock(&queue_mutex);
+	list_enqueue(lane_queue[ent->lane], ent);
+	if (++stats.lane_queue[ent->lane] > stats.lane_queue_max[ent->lane])
+		stats.lane_queue_max[ent->lane] = stats.lane_queue[ent->lane];
+	slurm_cond_signal(&queue_cond);
+	slurm_mutex_unlock(&queue_mutex);
+}
+
+extern void rpc_queue_conn_reading(int delta)
+{
+	slurm_mutex_lock(&queue_mutex);
+	stats.conn_queue += delta;
+	if (stats.conn_queue > stats.conn_queue_max)
+		stats.conn_queue_max = stats.conn_queue;
+	slurm_mutex_unlock(&queue_mutex);
+}
+
+extern void rpc_queue_fini(void)
+{
+	slurm_mutex_lock(&queue_mutex);
+	pool_gen++;
+	slurm_cond_broadcast(&queue_cond);
+	slurm_mutex_unlock(&queue_mutex);
+}
+
+extern void rpc_queue_get_stats(rpc_queue_stats_t *stats_ptr)
+{
+	slurm_mutex_lock(&queue_mutex);
+	memcpy(stats_ptr, &stats, sizeof(stats));
+	slurm_mutex_unlock(&queue_mutex);
+}
+
+extern void rpc_queue_reset_stats(void)
+{
+	slurm_mutex_lock(&queue_mutex);
+	stats.conn_queue_max = stats.conn_queue;
+	for (int i = 0; i < RPC_LANE_CNT; i++) {
+		stats.lane_queue_max[i] = stats.lane_queue[i];
+		stats.lane_count[i] = 0;
+		stats.lane_wait_usec[i] = 0;
+		stats.lane_wait_max[i] = 0;
+	}
+	slurm_mutex_unlock(&queue_mutex);
+}
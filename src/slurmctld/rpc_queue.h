@@ -0,0 +1,101 @@
+/*****************************************************************************\
+ *  rpc_queue.h - worker threads and priority queues for incoming RPCs
+ *****************************************************************************
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURMCTLD_RPC_QUEUE_H
+#define _SLURMCTLD_RPC_QUEUE_H
+
+#include <inttypes.h>
+#include <time.h>
+
+#include "src/common/pack.h"
+#include "src/slurmctld/slurmctld.h"
+#include "src/slurmctld/proc_req.h"
+
+/* Priority lanes of received RPCs, served in this order */
+typedef enum {
+	RPC_LANE_HIGH,		/* node registration, job and step completion */
+	RPC_LANE_NORMAL,
+	RPC_LANE_LOW,		/* information dumps */
+	RPC_LANE_CNT
+} rpc_lane_t;
+
+typedef struct {
+	uint32_t workers;	/* worker threads */
+	uint32_t busy;		/* workers servicing a message */
+	uint32_t conn_queue;	/* connections accepted, message not queued */
+	uint32_t conn_queue_max;
+	uint32_t lane_queue[RPC_LANE_CNT];	/* messages read, not serviced */
+	uint32_t lane_queue_max[RPC_LANE_CNT];
+	uint64_t lane_count[RPC_LANE_CNT];	/* messages serviced */
+	uint64_t lane_wait_usec[RPC_LANE_CNT];	/* from accept to service */
+	uint32_t lane_wait_max[RPC_LANE_CNT];
+} rpc_queue_stats_t;
+
+/*
+ * rpc_queue_init - start the worker threads, max_workers or as many as
+ *	SlurmctldParameters=rpc_workers says if fewer
+ */
+extern void rpc_queue_init(uint32_t max_workers);
+
+/*
+ * rpc_queue_add_msg - queue a message read by rpc_conn.c for a worker to
+ *	unpack and service in turn
+ * IN conn - the connection, freed once serviced
+ * IN buffer - the message as received, without the length, freed with it
+ * IN accepted - CLOCK_MONOTONIC time the connection was accepted
+ * NOTE: the caller has counted the connection in server_thread_count,
+ *	server_thread_decr() is called once it is serviced
+ */
+extern void rpc_queue_add_msg(connection_arg_t *conn, Buf buffer,
+			      struct timespec *accepted);
+
+/*
+ * rpc_queue_conn_reading - count a connection rpc_conn.c started (1) or
+ *	stopped (-1) reading as one not yet read
+ */
+extern void rpc_queue_conn_reading(int delta);
+
+/*
+ * rpc_queue_fini - let the worker threads exit once the queues are empty,
+ *	does not wait for them
+ */
+extern void rpc_queue_fini(void);
+
+/* rpc_queue_get_stats - copy the queue statistics into stats */
+extern void rpc_queue_get_stats(rpc_queue_stats_t *stats);
+
+/* rpc_queue_reset_stats - reset the counters and maximums */
+extern void rpc_queue_reset_stats(void);
+
+#endif
@@ -193,6 +193,35 @@ typedef struct diag_stats {
 	uint32_t bf_table_size;
 	uint32_t bf_table_size_sum;
 	time_t   bf_when_last_cycle;
+	/*AG backfill phases: time (usec) and counts, last cycle and sum */
+	uint32_t bf_queue_build_last;
+	uint64_t bf_queue_build_sum;
+	uint32_t bf_lic_init_last;
+	uint64_t bf_lic_init_sum;
+	uint32_t bf_lic_test_last;
+	uint64_t bf_lic_test_sum;
+	uint32_t bf_lic_update_last;
+	uint64_t bf_lic_update_sum;
+	uint32_t bf_resv_test_last;
+	uint64_t bf_resv_test_sum;
+	uint32_t bf_try_sched_last;
+	uint64_t bf_try_sched_sum;
+	uint32_t bf_node_space_last;
+	uint64_t bf_node_space_sum;
+	uint32_t bf_lic_tests_last;
+	uint32_t bf_lic_tests_sum;
+	uint32_t bf_lic_defers_last;
+	uint32_t bf_lic_defers_sum;
+	uint32_t bf_lic_resvs_last;
+	uint32_t bf_lic_resvs_sum;
+
+	uint32_t lustre_util_cache_hits;
+	uint32_t lustre_util_cache_misses;
+	uint32_t lustre_util_cache_size;
+
+	uint32_t job_info_cache_hits;
+	uint32_t job_info_cache_misses;
+	uint32_t job_info_cache_size;
 
 	uint32_t latency;
 } diag_stats_t;
@@ -700,6 +729,13 @@ struct job_record {
 	uint64_t db_index;              /* used only for database plugins */
 	time_t deadline;		/* deadline */
 	uint32_t delay_boot;		/* Delay boot for desired node mode */
+	uint64_t delta_gen;		/*AG change generation, see
+					 * info_delta.c, not saved */
+	uint32_t delta_desc;		/*AG hash of state_desc, */
+	uint32_t delta_prio;		/*AG priority, */
+	uint32_t delta_reason;		/*AG state_reason, */
+	time_t delta_start;		/*AG start_time and */
+	uint32_t delta_state;		/*AG job_state as of delta_gen */
 	uint32_t derived_ec;		/* highest exit code of all job steps */
 	struct job_details *details;	/* job details */
 	uint16_t direct_set_prio;	/* Priority set directly if
@@ -738,6 +774,16 @@ struct job_record {
 	time_t last_sched_eval;		/* last time job was evaluated for scheduling */
 	char *licenses;			/* licenses required by the job */
 	List license_list;		/* structure with license info */
+	time_t license_end_time;	/*AG end_time its licenses are
+					 * registered to be returned at */
+	uint64_t lustre_read;		/*AG MB read from Lustre by its
+					 * completed steps since it last
+					 * started, not saved */
+	uint64_t lustre_write;		/*AG MB written to Lustre, as
+					 * lustre_read */
+	time_t predicted_end;		/*AG end predicted by backfill from
+					 * its predicted runtime, 0 if none
+					 * (use end_time), not saved */
 	acct_policy_limit_set_t limit_set; /* flags if indicate an
 					    * associated limit was set from
 					    * a limit instead of from
@@ -1701,6 +1747,26 @@ extern void job_set_alloc_tres(job_record_t *job_ptr, bool assoc_mgr_locked);
  */
 extern int job_update_tres_cnt(job_record_t *job_ptr, int node_inx);
 
+/*AG
+ * job_updated - set last_job_update and give the job a new change generation
+ *	(see info_delta.c), call for any change to a job record
+ * IN job_ptr - job that changed
+ * IN now - time of the change
+ * NOTE: call with the job write lock
+ */
+extern void job_updated(job_record_t *job_ptr, time_t now);
+
+/*AG
+ * job_sched_updated - job_updated() for the schedulers, which rewrite a
+ *	job's state, reason and its description, priority and expected start
+ *	on every pass: the job only gets a new change generation if one of
+ *	them differs from what it was at its last generation
+ * IN job_ptr - job that was evaluated
+ * IN now - time of the evaluation
+ * NOTE: call with the job write lock
+ */
+extern void job_sched_updated(job_record_t *job_ptr, time_t now);
+
 /*
  * Modify a job's memory limit if allocated all memory on a node and that node
  * reboots, possibly with a different memory size (e.g. KNL MCDRAM mode changed)
@@ -1946,10 +2012,47 @@ extern void pack_all_node (char **buffer_ptr, int *buffer_size,
 			   uint16_t show_flags, uid_t uid,
 			   uint16_t protocol_version);
 
+/*AG
+ * pack_delta_jobs - dump the jobs changed since a generation in
+ *	machine independent form (for network transmission), see info_delta.c
+ * OUT buffer_ptr - the pointer is set to the allocated buffer, or NULL if
+ *	no job changed
+ * OUT buffer_size - set to size of the buffer in bytes
+ * IN since_gen - generation of the jobs the user has, 0 for none
+ * IN show_flags - job filtering options
+ * IN uid - uid of user making request (for partition filtering)
+ * IN protocol_version - slurm protocol version of client
+ * NOTE: the buffer at *buffer_ptr must be xfreed by the caller
+ * NOTE: READ lock_slurmctld config, job and partition before entry
+ */
+extern void pack_delta_jobs(char **buffer_ptr, int *buffer_size,
+			    uint64_t since_gen, uint16_t show_flags, uid_t uid,
+			    uint16_t protocol_version);
+
+/*AG
+ * pack_delta_node - dump the nodes changed since a generation in machine
+ *	independent form (for network transmission), see info_delta.c
+ * OUT buffer_ptr - pointer to the stored data, or NULL if no node changed
+ * OUT buffer_size - set to size of the buffer in bytes
+ * IN since_gen - generation of the nodes the user has, 0 for none
+ * IN show_flags - node filtering options
+ * IN uid - uid of user making request (for partition filtering)
+ * IN protocol_version - slurm protocol version of client
+ * NOTE: the caller must xfree the buffer at *buffer_ptr
+ * NOTE: READ lock_slurmctld config and partition, WRITE node before entry
+ */
+extern void pack_delta_node(char **buffer_ptr, int *buffer_size,
+			    uint64_t since_gen, uint16_t show_flags, uid_t uid,
+			    uint16_t protocol_version);
+
 /* Pack all scheduling statistics */
 extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 			  uint16_t protocol_version);
 
+/*AG Append the statistics added to those of 20.02, after the RPC ones */
+extern void pack_ext_stat(int resp, char **buffer_ptr, int *buffer_size,
+			  uint16_t protocol_version);
+
 /*
  * pack_ctld_job_step_info_response_msg - packs job step info
  * IN job_id - specific id or NO_VAL for all
@@ -2149,6 +2252,15 @@ extern void rebuild_step_bitmaps(job_record_t *job_ptr,
  */
 extern int post_job_step(step_record_t *step_ptr);
 
+/*AG
+ * step_add_lustre_usage - Add the fs/lustre TRES usage of a completed step
+ *	to its job's lustre_read and lustre_write, for jobcomp/ldms
+ * IN job_ptr - the step's job
+ * IN jobacct - the step's accounting data (NULL is OK)
+ */
+extern void step_add_lustre_usage(job_record_t *job_ptr,
+				  jobacctinfo_t *jobacct);
+
 /*
  * Create the extern step and add it to the job.
  */
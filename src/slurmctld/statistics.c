@@ -39,6 +39,8 @@
 #include <stdio.h>
 
 #include "src/slurmctld/agent.h"
+#include "src/slurmctld/locks.h"
+#include "src/slurmctld/rpc_queue.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/common/list.h"
 #include "src/common/pack.h"
@@ -47,6 +49,46 @@
 
 extern int retry_list_size(void);
 
+/*AG pack the lock contention counters, one array per counter */
+static void _pack_lock_stats(Buf buffer)
+{
+	lock_stats_t stats[ENTITY_COUNT];
+	uint64_t read_cnt[ENTITY_COUNT], write_cnt[ENTITY_COUNT];
+	uint64_t contended[ENTITY_COUNT], wait_usec[ENTITY_COUNT];
+	uint32_t wait_max[ENTITY_COUNT];
+
+	get_lock_stats(stats);
+	for (int i = 0; i < ENTITY_COUNT; i++) {
+		read_cnt[i] = stats[i].read_cnt;
+		write_cnt[i] = stats[i].write_cnt;
+		contended[i] = stats[i].contended;
+		wait_usec[i] = stats[i].wait_usec;
+		wait_max[i] = stats[i].wait_max;
+	}
+	pack64_array(read_cnt, ENTITY_COUNT, buffer);
+	pack64_array(write_cnt, ENTITY_COUNT, buffer);
+	pack64_array(contended, ENTITY_COUNT, buffer);
+	pack64_array(wait_usec, ENTITY_COUNT, buffer);
+	pack32_array(wait_max, ENTITY_COUNT, buffer);
+}
+
+/*AG pack the RPC worker and queue statistics */
+static void _pack_rpc_queue_stats(Buf buffer)
+{
+	rpc_queue_stats_t stats;
+
+	rpc_queue_get_stats(&stats);
+	pack32(stats.workers, buffer);
+	pack32(stats.busy, buffer);
+	pack32(stats.conn_queue, buffer);
+	pack32(stats.conn_queue_max, buffer);
+	pack32_array(stats.lane_queue, RPC_LANE_CNT, buffer);
+	pack32_array(stats.lane_queue_max, RPC_LANE_CNT, buffer);
+	pack64_array(stats.lane_count, RPC_LANE_CNT, buffer);
+	pack64_array(stats.lane_wait_usec, RPC_LANE_CNT, buffer);
+	pack32_array(stats.lane_wait_max, RPC_LANE_CNT, buffer);
+}
+
 /* Pack all scheduling statistics */
 extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 			  uint16_t protocol_version)
@@ -213,6 +255,59 @@ extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 	buffer_ptr[0] = xfer_buf_data(buffer);
 }
 
+/*AG
+ * Append the statistics this tree adds to those of 20.02, see
+ * STAT_EXT_VERSION. Called after the RPC statistics are packed.
+ */
+extern void pack_ext_stat(int resp, char **buffer_ptr, int *buffer_size,
+			  uint16_t protocol_version)
+{
+	Buf buffer;
+
+	if (!resp || (protocol_version < SLURM_20_02_PROTOCOL_VERSION))
+		return;
+
+	buffer = create_buf(*buffer_ptr, *buffer_size);
+	set_buf_offset(buffer, *buffer_size);
+
+	pack32(STAT_EXT_VERSION, buffer);
+
+	pack32(slurmctld_diag_stats.bf_queue_build_last, buffer);
+	pack64(slurmctld_diag_stats.bf_queue_build_sum, buffer);
+	pack32(slurmctld_diag_stats.bf_lic_init_last, buffer);
+	pack64(slurmctld_diag_stats.bf_lic_init_sum, buffer);
+	pack32(slurmctld_diag_stats.bf_lic_test_last, buffer);
+	pack64(slurmctld_diag_stats.bf_lic_test_sum, buffer);
+	pack32(slurmctld_diag_stats.bf_lic_update_last, buffer);
+	pack64(slurmctld_diag_stats.bf_lic_update_sum, buffer);
+	pack32(slurmctld_diag_stats.bf_resv_test_last, buffer);
+	pack64(slurmctld_diag_stats.bf_resv_test_sum, buffer);
+	pack32(slurmctld_diag_stats.bf_try_sched_last, buffer);
+	pack64(slurmctld_diag_stats.bf_try_sched_sum, buffer);
+	pack32(slurmctld_diag_stats.bf_node_space_last, buffer);
+	pack64(slurmctld_diag_stats.bf_node_space_sum, buffer);
+	pack32(slurmctld_diag_stats.bf_lic_tests_last, buffer);
+	pack32(slurmctld_diag_stats.bf_lic_tests_sum, buffer);
+	pack32(slurmctld_diag_stats.bf_lic_defers_last, buffer);
+	pack32(slurmctld_diag_stats.bf_lic_defers_sum, buffer);
+	pack32(slurmctld_diag_stats.bf_lic_resvs_last, buffer);
+	pack32(slurmctld_diag_stats.bf_lic_resvs_sum, buffer);
+
+	pack32(slurmctld_diag_stats.lustre_util_cache_hits, buffer);
+	pack32(slurmctld_diag_stats.lustre_util_cache_misses, buffer);
+	pack32(slurmctld_diag_stats.lustre_util_cache_size, buffer);
+
+	pack32(slurmctld_diag_stats.job_info_cache_hits, buffer);
+	pack32(slurmctld_diag_stats.job_info_cache_misses, buffer);
+	pack32(slurmctld_diag_stats.job_info_cache_size, buffer);
+
+	_pack_lock_stats(buffer);
+	_pack_rpc_queue_stats(buffer);
+
+	*buffer_size = get_buf_offset(buffer);
+	buffer_ptr[0] = xfer_buf_data(buffer);
+}
+
 /* Reset all scheduling statistics
  * level IN - clear backfilled_jobs count if set */
 extern void reset_stats(int level)
@@ -247,6 +342,22 @@ extern void reset_stats(int level)
 	slurmctld_diag_stats.bf_last_depth = 0;
 	slurmctld_diag_stats.bf_last_depth_try = 0;
 	slurmctld_diag_stats.bf_active = 0;
+	slurmctld_diag_stats.bf_queue_build_sum = 0;
+	slurmctld_diag_stats.bf_lic_init_sum = 0;
+	slurmctld_diag_stats.bf_lic_test_sum = 0;
+	slurmctld_diag_stats.bf_lic_update_sum = 0;
+	slurmctld_diag_stats.bf_resv_test_sum = 0;
+	slurmctld_diag_stats.bf_try_sched_sum = 0;
+	slurmctld_diag_stats.bf_node_space_sum = 0;
+	slurmctld_diag_stats.bf_lic_tests_sum = 0;
+	slurmctld_diag_stats.bf_lic_defers_sum = 0;
+	slurmctld_diag_stats.bf_lic_resvs_sum = 0;
+	slurmctld_diag_stats.lustre_util_cache_hits = 0;
+	slurmctld_diag_stats.lustre_util_cache_misses = 0;
+	slurmctld_diag_stats.job_info_cache_hits = 0;
+	slurmctld_diag_stats.job_info_cache_misses = 0;
+	reset_lock_stats();
+	rpc_queue_reset_stats();
 
 	last_proc_req_start = time(NULL);
 }
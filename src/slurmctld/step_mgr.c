@@ -179,7 +179,7 @@ static step_record_t *_create_step_record(job_record_t *job_ptr,
 
 	step_ptr = xmalloc(sizeof(*step_ptr));
 
-	last_job_update = time(NULL);
+	job_updated(job_ptr, time(NULL));
 	step_ptr->job_ptr    = job_ptr;
 	step_ptr->exit_code  = NO_VAL;
 	step_ptr->time_limit = INFINITE;
@@ -281,6 +281,7 @@ static void _internal_step_complete(job_record_t *job_ptr,
 		job_ptr->bit_flags |= TRES_STR_CALC;
 	}
 
+	step_add_lustre_usage(job_ptr, jobacct); /*AG */
 	jobacct_storage_g_step_complete(acct_db_conn, step_ptr);
 
 	if (step_ptr->step_id == SLURM_PENDING_STEP)
@@ -301,6 +302,35 @@ static void _internal_step_complete(job_record_t *job_ptr,
 	post_job_step(step_ptr);
 }
 
+/*AG
+ * step_add_lustre_usage - Add the fs/lustre TRES usage of a completed step
+ *	to its job's lustre_read and lustre_write, for jobcomp/ldms
+ * IN job_ptr - the step's job
+ * IN jobacct - the step's accounting data (NULL is OK)
+ */
+extern void step_add_lustre_usage(job_record_t *job_ptr,
+				  jobacctinfo_t *jobacct)
+{
+	slurmdb_tres_rec_t tres_rec;
+	int tres_pos;
+
+	if (!jobacct || !jobacct->tres_usage_in_tot)
+		return;
+
+	memset(&tres_rec, 0, sizeof(slurmdb_tres_rec_t));
+	tres_rec.type = "fs";
+	tres_rec.name = "lustre";
+	tres_pos = assoc_mgr_find_tres_pos(&tres_rec, false);
+	if ((tres_pos < 0) || (tres_pos >= jobacct->tres_count))
+		return;
+
+	/* INFINITE64 if the step's nodes didn't gather it */
+	if (jobacct->tres_usage_in_tot[tres_pos] != INFINITE64)
+		job_ptr->lustre_read += jobacct->tres_usage_in_tot[tres_pos];
+	if (jobacct->tres_usage_out_tot[tres_pos] != INFINITE64)
+		job_ptr->lustre_write += jobacct->tres_usage_out_tot[tres_pos];
+}
+
 /*
  * delete_step_records - Delete step record for specified job_ptr.
  * This function is called when a step fails to run to completion. For example,
@@ -315,7 +345,7 @@ extern void delete_step_records(job_record_t *job_ptr)
 
 	xassert(job_ptr);
 
-	last_job_update = time(NULL);
+	job_updated(job_ptr, time(NULL));
 	step_iterator = list_iterator_create(job_ptr->step_list);
 	while ((step_ptr = list_next(step_iterator))) {
 		/* Only check if not a pending step */
@@ -425,7 +455,7 @@ int delete_step_record(job_record_t *job_ptr, uint32_t step_id)
 	if (!job_ptr->step_list)
 		return error_code;
 
-	last_job_update = time(NULL);
+	job_updated(job_ptr, time(NULL));
 	step_iterator = list_iterator_create (job_ptr->step_list);
 	while ((step_ptr = list_next(step_iterator))) {
 		if (step_ptr->step_id != step_id)
@@ -826,7 +856,7 @@ int job_step_complete(uint32_t job_id, uint32_t step_id, uid_t uid,
 
 	_internal_step_complete(job_ptr, step_ptr);
 
-	last_job_update = time(NULL);
+	job_updated(job_ptr, time(NULL));
 
 	return SLURM_SUCCESS;
 }
@@ -4350,7 +4380,7 @@ extern int update_step(step_update_request_msg_t *req, uid_t uid)
 		}
 	}
 	if (mod_cnt)
-		last_job_update = time(NULL);
+		job_updated(job_ptr, time(NULL));
 	if (new_step) {
 		/*
 		 * This was a temporary step record, never linked to the job,
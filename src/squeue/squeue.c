@@ -63,6 +63,8 @@ int max_line_size;
  *************/
 static int  _get_info(bool clear_old, bool log_cluster_name);
 static int  _get_window_width( void );
+static int  _load_jobs_delta(job_info_msg_t **job_pptr, bool clear_old,
+			     uint16_t show_flags);
 static int  _multi_cluster(List clusters);
 static int  _print_job(bool clear_old, bool log_cluster_name);
 static int  _print_job_steps( bool clear_old );
@@ -166,12 +168,39 @@ _get_window_width( void )
 }
 
 
+/*AG
+ * _load_jobs_delta - bring the jobs of the last iteration up to date with
+ *	only those that changed since then
+ * IN/OUT job_pptr - jobs of the last iteration, NULL if none, left as they
+ *	were on error
+ * RET 0 or -1 on error, e.g. if the controller doesn't know the RPC
+ */
+static int _load_jobs_delta(job_info_msg_t **job_pptr, bool clear_old,
+			    uint16_t show_flags)
+{
+	job_info_msg_t *delta_ptr = NULL;
+	uint64_t delta_gen = 0;
+
+	if (*job_pptr && !clear_old)
+		delta_gen = (*job_pptr)->delta_gen;
+
+	if (slurm_load_jobs_delta(delta_gen, &delta_ptr, show_flags)) {
+		if (delta_gen && (slurm_get_errno() == SLURM_NO_CHANGE_IN_DATA))
+			return SLURM_SUCCESS;
+		return SLURM_ERROR;
+	}
+
+	return slurm_merge_job_info(job_pptr, delta_ptr);
+}
+
 /* _print_job - print the specified job's information */
 static int _print_job(bool clear_old, bool log_cluster_name)
 {
 	static job_info_msg_t *old_job_ptr;
+	static bool use_delta = true;
 	job_info_msg_t *new_job_ptr = NULL;
 	int error_code;
+	bool delta_loaded = false, delta_failed = false;
 	uint16_t show_flags = 0;
 
 	if (params.all_flag || (params.job_list && list_count(params.job_list)))
@@ -187,8 +216,23 @@ static int _print_job(bool clear_old, bool log_cluster_name)
 	if (params.format && strstr(params.format, "C"))
 		show_flags |= SHOW_DETAIL;
 
-	if (old_job_ptr) {
-		if (clear_old)
+	if (use_delta && params.iterate && !params.job_id && !params.user_id &&
+	    !(show_flags & SHOW_FEDERATION)) {
+		/*AG local jobs only, as slurm_load_jobs() gets them */
+		if (params.clusters)
+			show_flags |= SHOW_LOCAL;
+		if (_load_jobs_delta(&old_job_ptr, clear_old, show_flags))
+			delta_failed = true;
+		else
+			delta_loaded = true;
+	}
+
+	if (delta_loaded) {
+		error_code = SLURM_SUCCESS;
+		new_job_ptr = old_job_ptr;
+	} else if (old_job_ptr) {
+		/*AG after a failed delta load them all, not those since then */
+		if (clear_old || delta_failed)
 			old_job_ptr->last_update = 0;
 		if (params.job_id) {
 			error_code = slurm_load_job(
@@ -226,6 +270,15 @@ static int _print_job(bool clear_old, bool log_cluster_name)
 		slurm_perror ("slurm_load_jobs error");
 		return SLURM_ERROR;
 	}
+	if (delta_failed) {
+		/*AG
+		 * The delta failed but loading all jobs worked, the controller
+		 * doesn't support it (e.g. an older version). Stop asking.
+		 */
+		if (params.verbose)
+			printf("job info delta not available, loading all jobs\n");
+		use_delta = false;
+	}
 	old_job_ptr = new_job_ptr;
 	if (params.job_id || params.user_id)
 		old_job_ptr->last_update = (time_t) 0;
@@ -0,0 +1,83 @@
+/*****************************************************************************\
+ *  test5.12.prog.c - Report whether a job is in the delta of
+ *                    slurm_load_jobs_delta().
+ *
+ *  Usage: test5.12.prog gen
+ *         test5.12.prog check <delta_gen> <job_id>
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "slurm/slurm.h"
+#include "slurm/slurm_errno.h"
+
+int main(int argc, char **argv)
+{
+	job_info_msg_t *job_info_msg = NULL;
+	uint64_t delta_gen;
+	uint32_t job_id;
+	int i;
+
+	if ((argc == 2) && !strcmp(argv[1], "gen")) {
+		if (slurm_load_jobs_delta(0, &job_info_msg, SHOW_ALL)) {
+			slurm_perror("slurm_load_jobs_delta");
+			printf("FAILURE\n");
+			exit(1);
+		}
+		printf("DeltaGen=%"PRIu64"\n", job_info_msg->delta_gen);
+		slurm_free_job_info_msg(job_info_msg);
+		exit(0);
+	}
+	if ((argc != 4) || strcmp(argv[1], "check")) {
+		fprintf(stderr, "Usage: %s gen | check <delta_gen> <job_id>\n",
+			argv[0]);
+		exit(1);
+	}
+
+	delta_gen = strtoull(argv[2], NULL, 10);
+	job_id = strtoul(argv[3], NULL, 10);
+	if (slurm_load_jobs_delta(delta_gen, &job_info_msg, SHOW_ALL)) {
+		if (slurm_get_errno() == SLURM_NO_CHANGE_IN_DATA)
+			printf("FAILURE: no change since %"PRIu64"\n",
+			       delta_gen);
+		else
+			slurm_perror("slurm_load_jobs_delta");
+		exit(1);
+	}
+	if (job_info_msg->delta_full) {
+		/* everything is sent, the job would be found anyway */
+		printf("FAILURE: full response for %"PRIu64"\n", delta_gen);
+		exit(1);
+	}
+	for (i = 0; i < job_info_msg->record_count; i++) {
+		if (job_info_msg->job_array[i].job_id == job_id)
+			break;
+	}
+	if (i < job_info_msg->record_count)
+		printf("JobId=%u in delta\n", job_id);
+	else
+		printf("FAILURE: JobId=%u not in delta since %"PRIu64"\n",
+		       job_id, delta_gen);
+	slurm_free_job_info_msg(job_info_msg);
+	exit(0);
+}
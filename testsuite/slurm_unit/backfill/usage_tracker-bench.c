@@ -0,0 +1,104 @@
+/* Benchmark of src/plugins/sched/backfill/usage_tracker.c
+ *
+ * Not run by "make check"; build it with "make check" and run
+ *   ./usage_tracker-bench [max_intervals]
+ * to time building trackers of 10^3 intervals and up (10^6 by default)
+ * and querying them with ut_int_when_below().
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "src/plugins/sched/backfill/usage_tracker.h"
+
+#define BASE		1000
+#define RES		60	/* bf_resolution */
+#define QUERIES		100000
+
+static double _now_us(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+/* a tracker with about "n" intervals of values 0-9, built in time order */
+static utracker_int_t _build_sorted(int n, double *us)
+{
+	utracker_int_t ut = ut_int_create(0);
+	double start = _now_us();
+	int i;
+
+	for (i = 0; i < n; i++)
+		ut_int_add_usage(ut, BASE + (time_t) i * RES,
+				 BASE + (time_t) (i + 1) * RES, 1 + rand() % 9);
+	*us = _now_us() - start;
+	return ut;
+}
+
+/* the same, in random order (what backfill does with reservations) */
+static utracker_int_t _build_random(int n, double *us)
+{
+	utracker_int_t ut = ut_int_create(0);
+	double start = _now_us();
+	time_t t;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		t = BASE + (time_t) (rand() % n) * RES;
+		ut_int_add_usage(ut, t, t + RES * (1 + rand() % 4),
+				 1 + rand() % 3);
+	}
+	*us = _now_us() - start;
+	return ut;
+}
+
+/* ns per ut_int_when_below() call for windows of "len" intervals */
+static double _query(utracker_int_t ut, int n, int len, int max_value)
+{
+	double start = _now_us();
+	volatile time_t sink = 0;
+	time_t after;
+	int i;
+
+	for (i = 0; i < QUERIES; i++) {
+		after = BASE + 1 + (time_t) (rand() % n) * RES;
+		sink += ut_int_when_below(ut, after, (time_t) len * RES,
+					  max_value);
+	}
+	(void) sink;
+	return (_now_us() - start) * 1000 / QUERIES;
+}
+
+int
+main(int argc, char *argv[])
+{
+	int max_n = (argc > 1) ? atoi(argv[1]) : 1000000;
+	utracker_int_t ut;
+	double build_us;
+	int n;
+
+	srand(12345);
+	printf("%10s %12s %12s %12s %12s\n", "intervals", "build ns/op",
+	       "fits ns/op", "scan ns/op", "random ns/op");
+	for (n = 1000; n <= max_n; n *= 10) {
+		ut = _build_sorted(n, &build_us);
+		printf("%10d %12.1f %12.1f %12.1f", n, build_us * 1000 / n,
+		       /* fits immediately: one lookup */
+		       _query(ut, n, 1, 10),
+		       /* a window of 10 intervals below 9: scans some */
+		       _query(ut, n, 10, 9));
+		ut_int_destroy(ut);
+
+		/* inserting in the middle moves the rest of the array */
+		if (n <= 100000) {
+			ut = _build_random(n, &build_us);
+			printf(" %12.1f\n", build_us * 1000 / n);
+			ut_int_destroy(ut);
+		} else {
+			printf(" %12s\n", "-");
+		}
+	}
+	return 0;
+}
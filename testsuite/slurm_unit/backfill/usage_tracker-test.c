@@ -0,0 +1,323 @@
+/* Test of src/plugins/sched/backfill/usage_tracker.c and backfill_licenses.c
+ *
+ * Random sequences of operations are checked against a brute-force
+ * reference that keeps the tracked value for every second.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+#include "src/plugins/sched/backfill/backfill_licenses.h"
+#include "src/plugins/sched/backfill/usage_tracker.h"
+#include "src/slurmctld/licenses.h"
+/* dejagnu.h defines wait(), already declared by <sys/wait.h> */
+#define wait dejagnu_wait
+#include <testsuite/dejagnu.h>
+#undef wait
+
+/* normally from src/slurmctld/licenses.c */
+List license_list = NULL;
+pthread_mutex_t license_mutex = PTHREAD_MUTEX_INITIALIZER;
+uint32_t license_id_gen = 1;
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+#define BASE	1000	/* first time used, the tracker needs times > 0 */
+#define SPAN	400	/* operations start in [BASE, BASE + SPAN) */
+#define LEN	60	/* and last at most LEN */
+#define END	(BASE + SPAN + LEN)
+#define ROUNDS	200
+#define OPS	100
+
+/* reference: value at BASE + i, the value at END holds until infinity */
+static int ref[END - BASE + 1];
+
+static void _ref_add(time_t start, time_t end, int usage)
+{
+	time_t t;
+
+	for (t = start; t < end && t <= END; t++)
+		ref[t - BASE] += usage;
+}
+
+static int _ref_at(time_t t)
+{
+	return ref[MIN(t, END) - BASE];
+}
+
+static time_t _ref_when_below(time_t after, time_t duration, int max_value)
+{
+	time_t s, t;
+
+	/* from END on the value is constant */
+	for (s = after; s <= END; s++) {
+		for (t = s; t < s + duration; t++) {
+			if (_ref_at(t) >= max_value)
+				break;
+		}
+		if (t == s + duration)
+			return s;
+	}
+	return -1;
+}
+
+static time_t _ref_when_fits(time_t after, time_t duration,
+			     ut_int_phase_t *phases, int cnt, int limit)
+{
+	time_t s, t;
+	int i, v;
+
+	for (s = after; s <= END; s++) {
+		for (t = s; t < s + duration; t++) {
+			for (i = 0, v = 0; i < cnt; i++) {
+				if (phases[i].offset <= t - s)
+					v = phases[i].value;
+			}
+			if (_ref_at(t) + v > limit)
+				break;
+		}
+		if (t == s + duration)
+			return s;
+	}
+	return -1;
+}
+
+static int _check_tracker(utracker_int_t ut, int queries)
+{
+	time_t after, duration, got, want;
+	int max_value, bad = 0;
+
+	while (queries--) {
+		after = BASE + 1 + rand() % (SPAN - 1);
+		duration = 1 + rand() % LEN;
+		max_value = rand() % 12 - 2;
+		got = ut_int_when_below(ut, after, duration, max_value);
+		want = _ref_when_below(after, duration, max_value);
+		if (got != want) {
+			if (!bad)
+				note("when_below(%ld, %ld, %d) = %ld, expected %ld",
+				     (long) after, (long) duration, max_value,
+				     (long) got, (long) want);
+			bad++;
+		}
+	}
+	return bad;
+}
+
+static void _test_usage_tracker(void)
+{
+	utracker_int_t ut;
+	ut_int_phase_t phases[4];
+	time_t start, end, after, duration, got, want;
+	int round, op, usage, cnt, i, limit;
+	int bad_below = 0, bad_fits = 0, bad_profile = 0;
+
+	note("Testing random add/remove sequences against the reference");
+	for (round = 0; round < ROUNDS; round++) {
+		usage = rand() % 4;
+		memset(ref, 0, sizeof(ref));
+		_ref_add(BASE, END + 1, usage);
+		ut = ut_int_create(usage);
+		for (op = 0; op < OPS; op++) {
+			start = BASE + 1 + rand() % (SPAN - 1);
+			end = start + 1 + rand() % LEN;
+			usage = rand() % 7 - 2;
+			switch (rand() % 4) {
+			case 0:
+			case 1:
+				/* includes 0 and adjacent/overlapping ranges */
+				ut_int_add_usage(ut, start, end, usage);
+				_ref_add(start, end, usage);
+				break;
+			case 2:
+				ut_int_remove_till_end(ut, start, usage);
+				_ref_add(start, END + 1, -usage);
+				break;
+			case 3:
+				/* add and take back: must merge back */
+				ut_int_add_usage(ut, start, end, usage);
+				ut_int_add_usage(ut, start, end, -usage);
+				break;
+			}
+			bad_below += _check_tracker(ut, 5);
+
+			cnt = 1 + rand() % 4;
+			for (i = 0; i < cnt; i++) {
+				phases[i].offset = i ? phases[i - 1].offset +
+						1 + rand() % 20 : 0;
+				phases[i].value = rand() % 5;
+			}
+			after = BASE + 1 + rand() % (SPAN - 1);
+			duration = 1 + rand() % LEN;
+			limit = 4 + rand() % 6;
+			got = ut_int_when_fits(ut, after, duration, phases, cnt,
+					       limit);
+			want = _ref_when_fits(after, duration, phases, cnt,
+					      limit);
+			if (got != want) {
+				if (!bad_fits)
+					note("when_fits(%ld, %ld, ..., %d) = %ld, expected %ld",
+					     (long) after, (long) duration,
+					     limit, (long) got, (long) want);
+				bad_fits++;
+			}
+		}
+
+		/* a profile is the same as its phases added one by one */
+		start = BASE + 1 + rand() % (SPAN / 2);
+		end = start + 1 + rand() % (SPAN / 2 - 1);
+		ut_int_add_profile(ut, start, end, phases, cnt);
+		for (i = 0; i < cnt && start + phases[i].offset < end; i++)
+			_ref_add(start + phases[i].offset,
+				 MIN(end, i + 1 < cnt ?
+				     start + phases[i + 1].offset : end),
+				 phases[i].value);
+		bad_profile += _check_tracker(ut, 20);
+		ut_int_destroy(ut);
+	}
+	TEST(!bad_below, "when_below matches the reference");
+	TEST(!bad_fits, "when_fits matches the reference");
+	TEST(!bad_profile, "add_profile matches the reference");
+}
+
+static licenses_t *_make_license(char *name, uint32_t total)
+{
+	licenses_t *license = xmalloc(sizeof(licenses_t));
+
+	license->name = xstrdup(name);
+	license->total = total;
+	return license;
+}
+
+static void _free_license(void *x)
+{
+	licenses_t *license = (licenses_t *) x;
+
+	xfree(license->name);
+	xfree(license->returns);
+	xfree(license);
+}
+
+static job_record_t *_make_job(uint32_t count, uint32_t time_limit,
+			       char *admin_comment)
+{
+	job_record_t *job_ptr = xmalloc(sizeof(job_record_t));
+
+	job_ptr->magic = JOB_MAGIC;
+	job_ptr->job_id = 1;
+	job_ptr->array_task_id = NO_VAL;
+	job_ptr->time_limit = time_limit;
+	job_ptr->admin_comment = xstrdup(admin_comment);
+	job_ptr->license_list = list_create(_free_license);
+	list_append(job_ptr->license_list, _make_license("lustre", count));
+	return job_ptr;
+}
+
+static void _free_job(job_record_t *job_ptr)
+{
+	FREE_NULL_LIST(job_ptr->license_list);
+	xfree(job_ptr->admin_comment);
+	xfree(job_ptr);
+}
+
+static void _test_license_tracker(void)
+{
+	/* 30 used by a job ending at 6000, 20 more measured remotely */
+	time_t now = 3000, end = 6000, when;
+	licenses_t *license = _make_license("lustre", 100);
+	job_record_t *job_ptr;
+	lic_tracker_p lt;
+
+	note("Testing the license tracker");
+	license->used = 30;
+	license->r_used = 50;
+	license->id_gen = license_id_gen;
+	license->returns = xcalloc(1, sizeof(lic_return_t));
+	license->returns[0].end_time = end;
+	license->returns[0].count = 30;
+	license->return_cnt = license->return_size = 1;
+	license_list = list_create(_free_license);
+	list_append(license_list, license);
+
+	lt = init_lic_tracker(60);
+	TEST(lt != NULL, "tracker created");
+
+	job_ptr = _make_job(50, 10, NULL);
+	when = now;
+	TEST(backfill_licenses_test_job(lt, job_ptr, &when) == SLURM_SUCCESS &&
+	     when == now, "job fitting now starts now");
+	_free_job(job_ptr);
+
+	job_ptr = _make_job(60, 10, NULL);
+	when = now;
+	TEST(backfill_licenses_test_job(lt, job_ptr, &when) == SLURM_SUCCESS &&
+	     when == 6060, "job starts after the running job returns licenses");
+	backfill_licenses_alloc_job(lt, job_ptr, when, when + 600);
+	_free_job(job_ptr);
+
+	job_ptr = _make_job(30, 10, NULL);
+	when = now;
+	TEST(backfill_licenses_test_job(lt, job_ptr, &when) == SLURM_SUCCESS &&
+	     when == now, "short job backfills before the allocated one");
+	when = 6000;
+	TEST(backfill_licenses_test_job(lt, job_ptr, &when) == SLURM_SUCCESS &&
+	     when > 6060, "job doesn't overlap the allocated one");
+	_free_job(job_ptr);
+
+	job_ptr = _make_job(40, 60, "lustre_profile=0:40,600:10;");
+	when = 5400;
+	TEST(backfill_licenses_test_job(lt, job_ptr, &when) == SLURM_SUCCESS &&
+	     when == 5400, "profile fits under the allocated job");
+	_free_job(job_ptr);
+
+	job_ptr = _make_job(40, 60, "lustre_profile=0:40,bad;");
+	when = 5400;
+	TEST(backfill_licenses_test_job(lt, job_ptr, &when) == SLURM_SUCCESS &&
+	     when > 5400, "malformed profile falls back to the peak");
+	_free_job(job_ptr);
+
+	job_ptr = _make_job(90, 10, NULL);
+	when = now;
+	TEST(backfill_licenses_test_job(lt, job_ptr, &when) == SLURM_ERROR,
+	     "job blocked by external usage never fits");
+	when = now;
+	TEST(backfill_licenses_reserve_job(lt, job_ptr, &when, now + 86400) ==
+	     SLURM_SUCCESS && when > 6060,
+	     "job blocked by external usage is reserved");
+	_free_job(job_ptr);
+
+	job_ptr = _make_job(30, 10, NULL);
+	when = 6600;
+	TEST(backfill_licenses_test_job(lt, job_ptr, &when) == SLURM_SUCCESS &&
+	     when > 6600, "job doesn't overlap the license reservation");
+	_free_job(job_ptr);
+
+	destroy_lic_tracker(lt);
+	FREE_NULL_LIST(license_list);
+}
+
+int
+main(int argc, char *argv[])
+{
+	log_options_t log_opts = LOG_OPTS_STDERR_ONLY;
+
+	log_opts.stderr_level = LOG_LEVEL_QUIET;
+	log_init(argv[0], log_opts, 0, NULL);
+	srand(12345);
+
+	_test_usage_tracker();
+	_test_license_tracker();
+
+	totals();
+	return failed;
+}